@@ -0,0 +1,187 @@
+#include "echoserver.h"
+
+#include <libsoup/soup.h>
+
+#define CLEAR_MESSAGE "{\"type\":\"clear\"}"
+
+struct _WsBenchEchoServer
+{
+  GThread *thread;
+  GMainContext *context;
+  GMainLoop *loop;
+  guint clear_interval_ms;
+
+  // set by the server thread before it signals ready
+  GMutex lock;
+  GCond ready_cond;
+  gboolean ready;
+  guint port;
+  GError *error;
+
+  // server thread only, apart from the count
+  GList *connections;
+  gint n_connections;
+};
+
+static void
+on_message(SoupWebsocketConnection *conn, gint type, GBytes *message, gpointer user_data)
+{
+  // audio only, the element's own control messages mean nothing to an echo
+  if (type == SOUP_WEBSOCKET_DATA_BINARY &&
+      soup_websocket_connection_get_state(conn) == SOUP_WEBSOCKET_STATE_OPEN)
+    soup_websocket_connection_send_message(conn, SOUP_WEBSOCKET_DATA_BINARY, message);
+}
+
+static void
+on_closed(SoupWebsocketConnection *conn, gpointer user_data)
+{
+  WsBenchEchoServer *server = user_data;
+
+  server->connections = g_list_remove(server->connections, conn);
+  g_atomic_int_add(&server->n_connections, -1);
+  g_object_unref(conn);
+}
+
+static void
+on_websocket(SoupServer *soup_server, SoupServerMessage *msg, const char *path,
+    SoupWebsocketConnection *conn, gpointer user_data)
+{
+  WsBenchEchoServer *server = user_data;
+
+  g_object_ref(conn);
+  server->connections = g_list_prepend(server->connections, conn);
+  g_atomic_int_inc(&server->n_connections);
+  g_signal_connect(conn, "message", G_CALLBACK(on_message), server);
+  g_signal_connect(conn, "closed", G_CALLBACK(on_closed), server);
+}
+
+static gboolean
+clear_cb(gpointer user_data)
+{
+  WsBenchEchoServer *server = user_data;
+
+  for (GList *l = server->connections; l; l = l->next) {
+    if (soup_websocket_connection_get_state(l->data) == SOUP_WEBSOCKET_STATE_OPEN)
+      soup_websocket_connection_send_text(l->data, CLEAR_MESSAGE);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+quit_cb(gpointer user_data)
+{
+  WsBenchEchoServer *server = user_data;
+
+  g_main_loop_quit(server->loop);
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer
+server_thread(gpointer user_data)
+{
+  WsBenchEchoServer *server = user_data;
+  SoupServer *soup_server;
+  GError *error = NULL;
+  GSList *uris;
+  GSource *clear_source = NULL;
+
+  g_main_context_push_thread_default(server->context);
+
+  soup_server = soup_server_new(NULL, NULL);
+  soup_server_add_websocket_handler(soup_server, NULL, NULL, NULL, on_websocket, server,
+      NULL);
+  if (soup_server_listen_local(soup_server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error)) {
+    uris = soup_server_get_uris(soup_server);
+    server->port = uris ? (guint)g_uri_get_port(uris->data) : 0;
+    g_slist_free_full(uris, (GDestroyNotify)g_uri_unref);
+  }
+
+  if (!error && server->clear_interval_ms > 0) {
+    clear_source = g_timeout_source_new(server->clear_interval_ms);
+    g_source_set_callback(clear_source, clear_cb, server, NULL);
+    g_source_attach(clear_source, server->context);
+  }
+
+  g_mutex_lock(&server->lock);
+  server->error = error;
+  server->ready = TRUE;
+  g_cond_signal(&server->ready_cond);
+  g_mutex_unlock(&server->lock);
+
+  if (!error)
+    g_main_loop_run(server->loop);
+
+  if (clear_source) {
+    g_source_destroy(clear_source);
+    g_source_unref(clear_source);
+  }
+  // connections the clients did not close go down with the server
+  while (server->connections) {
+    SoupWebsocketConnection *conn = server->connections->data;
+
+    g_signal_handlers_disconnect_by_data(conn, server);
+    server->connections = g_list_delete_link(server->connections, server->connections);
+    g_object_unref(conn);
+  }
+  soup_server_disconnect(soup_server);
+  g_object_unref(soup_server);
+
+  g_main_context_pop_thread_default(server->context);
+  return NULL;
+}
+
+WsBenchEchoServer *
+ws_bench_echo_server_new(guint clear_interval_ms, GError **error)
+{
+  WsBenchEchoServer *server = g_new0(WsBenchEchoServer, 1);
+
+  server->clear_interval_ms = clear_interval_ms;
+  server->context = g_main_context_new();
+  server->loop = g_main_loop_new(server->context, FALSE);
+  g_mutex_init(&server->lock);
+  g_cond_init(&server->ready_cond);
+
+  server->thread = g_thread_new("ws-bench-echo", server_thread, server);
+  g_mutex_lock(&server->lock);
+  while (!server->ready)
+    g_cond_wait(&server->ready_cond, &server->lock);
+  g_mutex_unlock(&server->lock);
+
+  if (server->error) {
+    g_propagate_error(error, server->error);
+    server->error = NULL;
+    ws_bench_echo_server_free(server);
+    return NULL;
+  }
+  return server;
+}
+
+void
+ws_bench_echo_server_free(WsBenchEchoServer *server)
+{
+  // a quit from here could land before the loop runs and be lost, an idle on the
+  // server context cannot
+  GSource *quit = g_idle_source_new();
+
+  g_source_set_callback(quit, quit_cb, server, NULL);
+  g_source_attach(quit, server->context);
+  g_source_unref(quit);
+  g_thread_join(server->thread);
+  g_main_loop_unref(server->loop);
+  g_main_context_unref(server->context);
+  g_mutex_clear(&server->lock);
+  g_cond_clear(&server->ready_cond);
+  g_free(server);
+}
+
+guint
+ws_bench_echo_server_get_port(WsBenchEchoServer *server)
+{
+  return server->port;
+}
+
+guint
+ws_bench_echo_server_get_connections(WsBenchEchoServer *server)
+{
+  return (guint)g_atomic_int_get(&server->n_connections);
+}
@@ -0,0 +1,20 @@
+#ifndef __WS_BENCH_ECHO_SERVER_H__
+#define __WS_BENCH_ECHO_SERVER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// a WebSocket server on 127.0.0.1 that sends every binary message straight back, run by
+// a thread of its own so the load generator measures the element and not the server.
+// every clear_interval_ms (0 = never) it sends {"type":"clear"} down each connection.
+typedef struct _WsBenchEchoServer WsBenchEchoServer;
+
+WsBenchEchoServer *ws_bench_echo_server_new(guint clear_interval_ms, GError **error);
+void ws_bench_echo_server_free(WsBenchEchoServer *server);
+guint ws_bench_echo_server_get_port(WsBenchEchoServer *server);
+guint ws_bench_echo_server_get_connections(WsBenchEchoServer *server);
+
+G_END_DECLS
+
+#endif /* __WS_BENCH_ECHO_SERVER_H__ */
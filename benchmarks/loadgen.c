@@ -0,0 +1,612 @@
+// load generator for websockettransceiver: runs N calls of
+//   appsrc ! websockettransceiver ! appsink
+// against an in-process echo server for each N of --instances, and reports CPU per call,
+// threads, RSS, frames per second, end-to-end latency and barge-in latency. with
+// --baseline the results are compared against an earlier --save-baseline run and the
+// exit status is 1 when a metric regressed by more than --tolerance.
+
+#include <gst/gst.h>
+#include <gst/app/app.h>
+#include <json-glib/json-glib.h>
+
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "echoserver.h"
+
+#define SAMPLE_RATE 16000
+#define FRAME_MS 20
+#define FRAME_BYTES (SAMPLE_RATE / 1000 * FRAME_MS * 2)
+// the element's histogram layout, see gstwsstats.h
+#define HISTOGRAM_BUCKETS 24
+// marks a frame the load generator stamped, as opposed to silence the element made up
+#define FRAME_MAGIC 0x57534231u
+
+typedef struct
+{
+  guint32 magic;
+  guint32 call;
+  gint64 sent_us;
+} WsBenchStamp;
+
+typedef struct
+{
+  guint index;
+  GstElement *pipeline;
+  GstElement *appsrc;
+  GstElement *transceiver;
+
+  // written by the appsink streaming thread while measuring
+  GMutex lock;
+  guint64 frames;
+  GArray *latencies;
+} WsBenchCall;
+
+typedef enum
+{
+  METRIC_CPU_PER_CALL,
+  METRIC_THREADS,
+  METRIC_RSS_PER_CALL,
+  METRIC_FRAMES_PER_SEC,
+  METRIC_LATENCY_P50,
+  METRIC_LATENCY_P99,
+  METRIC_BARGE_IN_P50,
+  METRIC_BARGE_IN_P99,
+  N_METRICS,
+} WsBenchMetric;
+
+static const struct
+{
+  const gchar *name;
+  const gchar *format;
+  gboolean higher_is_better;
+} metrics[N_METRICS] = {
+  [METRIC_CPU_PER_CALL] = { "cpu-per-call-pct", "%10.2f", FALSE },
+  [METRIC_THREADS] = { "threads", "%10.0f", FALSE },
+  [METRIC_RSS_PER_CALL] = { "rss-per-call-kb", "%10.1f", FALSE },
+  [METRIC_FRAMES_PER_SEC] = { "frames-per-sec", "%10.0f", TRUE },
+  [METRIC_LATENCY_P50] = { "latency-p50-us", "%10.0f", FALSE },
+  [METRIC_LATENCY_P99] = { "latency-p99-us", "%10.0f", FALSE },
+  [METRIC_BARGE_IN_P50] = { "barge-in-p50-us", "%10.0f", FALSE },
+  [METRIC_BARGE_IN_P99] = { "barge-in-p99-us", "%10.0f", FALSE },
+};
+
+typedef struct
+{
+  guint instances;
+  gdouble values[N_METRICS];
+} WsBenchResult;
+
+static gchar *opt_instances = NULL;
+static gint opt_duration = 10;
+static gint opt_warmup = 2;
+static gint opt_clear_interval_ms = 1000;
+static gchar **opt_set = NULL;
+static gchar *opt_baseline = NULL;
+static gchar *opt_save_baseline = NULL;
+static gdouble opt_tolerance = 0.25;
+static gchar *opt_loopback = NULL;
+
+static GOptionEntry entries[] = {
+  { "instances", 'n', 0, G_OPTION_ARG_STRING, &opt_instances,
+    "Comma separated call counts to run (default 1,10,100,1000)", "N,..." },
+  { "duration", 'd', 0, G_OPTION_ARG_INT, &opt_duration,
+    "Seconds measured per call count (default 10)", "S" },
+  { "warmup", 'w', 0, G_OPTION_ARG_INT, &opt_warmup,
+    "Seconds run before measuring (default 2)", "S" },
+  { "clear-interval-ms", 'c', 0, G_OPTION_ARG_INT, &opt_clear_interval_ms,
+    "Interval of the server's clear messages, for barge-in latency (0 = none, "
+    "default 1000)", "MS" },
+  { "set", 's', 0, G_OPTION_ARG_STRING_ARRAY, &opt_set,
+    "Set a websockettransceiver property on every call, may be repeated",
+    "PROPERTY=VALUE" },
+  { "baseline", 'b', 0, G_OPTION_ARG_FILENAME, &opt_baseline,
+    "Compare against the results stored in FILE", "FILE" },
+  { "save-baseline", 'o', 0, G_OPTION_ARG_FILENAME, &opt_save_baseline,
+    "Store the results in FILE", "FILE" },
+  { "tolerance", 't', 0, G_OPTION_ARG_DOUBLE, &opt_tolerance,
+    "Relative change against the baseline that counts as a regression (default 0.25)",
+    "F" },
+  { "loopback", 'l', 0, G_OPTION_ARG_STRING, &opt_loopback,
+    "Run against an in-memory loopback:// peer with these URI parameters instead of "
+    "the echo server, e.g. delay-ms=20&jitter-ms=5 (use \"\" for none)", "PARAMS" },
+  { NULL }
+};
+
+static gint measuring = FALSE;
+
+static GstFlowReturn
+on_new_sample(GstAppSink *sink, gpointer user_data)
+{
+  WsBenchCall *call = user_data;
+  GstSample *sample = gst_app_sink_pull_sample(sink);
+  GstBuffer *buffer;
+  WsBenchStamp stamp;
+  gint64 now = g_get_monotonic_time();
+
+  if (!sample)
+    return GST_FLOW_FLUSHING;
+  buffer = gst_sample_get_buffer(sample);
+
+  if (g_atomic_int_get(&measuring) && buffer) {
+    g_mutex_lock(&call->lock);
+    call->frames++;
+    if (gst_buffer_extract(buffer, 0, &stamp, sizeof(stamp)) == sizeof(stamp) &&
+        stamp.magic == FRAME_MAGIC && stamp.call == call->index && stamp.sent_us <= now) {
+      gint64 latency = now - stamp.sent_us;
+      g_array_append_val(call->latencies, latency);
+    }
+    g_mutex_unlock(&call->lock);
+  }
+
+  gst_sample_unref(sample);
+  return GST_FLOW_OK;
+}
+
+static WsBenchCall *
+ws_bench_call_new(guint index, const gchar *uri, GError **error)
+{
+  WsBenchCall *call = g_new0(WsBenchCall, 1);
+  GstAppSinkCallbacks callbacks = { .new_sample = on_new_sample };
+  GstElement *appsink;
+  GstCaps *caps;
+
+  call->index = index;
+  g_mutex_init(&call->lock);
+  call->latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+
+  call->pipeline = gst_pipeline_new(NULL);
+  call->appsrc = gst_element_factory_make("appsrc", NULL);
+  call->transceiver = gst_element_factory_make("websockettransceiver", NULL);
+  appsink = gst_element_factory_make("appsink", NULL);
+  if (!call->appsrc || !call->transceiver || !appsink) {
+    g_set_error(error, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN,
+        "appsrc, websockettransceiver or appsink is not available");
+    g_clear_object(&call->appsrc);
+    g_clear_object(&call->transceiver);
+    g_clear_object(&appsink);
+    return call;
+  }
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, SAMPLE_RATE,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  g_object_set(call->appsrc, "caps", caps, "format", GST_FORMAT_TIME, "is-live", TRUE,
+      NULL);
+  gst_caps_unref(caps);
+
+  // one frame in, one frame out, so every echoed frame still starts with its stamp
+  g_object_set(call->transceiver,
+      "uri", uri,
+      "frame-duration-ms", FRAME_MS,
+      "initial-buffer-count", 0,
+      NULL);
+  for (gchar **set = opt_set; set && *set; set++) {
+    gchar **kv = g_strsplit(*set, "=", 2);
+
+    if (kv[0] && kv[1])
+      gst_util_set_object_arg(G_OBJECT(call->transceiver), kv[0], kv[1]);
+    g_strfreev(kv);
+  }
+
+  g_object_set(appsink, "sync", FALSE, NULL);
+  gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, call, NULL);
+
+  gst_bin_add_many(GST_BIN(call->pipeline), call->appsrc, call->transceiver, appsink,
+      NULL);
+  gst_element_link_many(call->appsrc, call->transceiver, appsink, NULL);
+
+  if (gst_element_set_state(call->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+    g_set_error(error, GST_CORE_ERROR, GST_CORE_ERROR_STATE_CHANGE,
+        "call %u could not start", index);
+  return call;
+}
+
+static void
+ws_bench_call_free(WsBenchCall *call)
+{
+  if (call->pipeline) {
+    gst_element_set_state(call->pipeline, GST_STATE_NULL);
+    gst_object_unref(call->pipeline);
+  }
+  g_array_unref(call->latencies);
+  g_mutex_clear(&call->lock);
+  g_free(call);
+}
+
+static void
+ws_bench_call_push(WsBenchCall *call, GstClockTime pts)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate(NULL, FRAME_BYTES, NULL);
+  WsBenchStamp stamp = { FRAME_MAGIC, call->index, g_get_monotonic_time() };
+
+  gst_buffer_memset(buffer, 0, 0, FRAME_BYTES);
+  gst_buffer_fill(buffer, 0, &stamp, sizeof(stamp));
+  GST_BUFFER_PTS(buffer) = pts;
+  GST_BUFFER_DURATION(buffer) = FRAME_MS * GST_MSECOND;
+  gst_app_src_push_buffer(GST_APP_SRC(call->appsrc), buffer);
+}
+
+// the element's barge-in histogram buckets, summed over all calls
+static void
+ws_bench_barge_in_buckets(GPtrArray *calls, guint64 *buckets)
+{
+  memset(buckets, 0, HISTOGRAM_BUCKETS * sizeof(guint64));
+
+  for (guint i = 0; i < calls->len; i++) {
+    WsBenchCall *call = g_ptr_array_index(calls, i);
+    GstStructure *stats = NULL;
+    const GValue *array;
+
+    g_object_get(call->transceiver, "stats", &stats, NULL);
+    if (!stats)
+      continue;
+    array = gst_structure_get_value(stats, "barge-in-latency-buckets");
+    for (guint b = 0; array && b < MIN(gst_value_array_get_size(array), HISTOGRAM_BUCKETS);
+        b++)
+      buckets[b] += g_value_get_uint64(gst_value_array_get_value(array, b));
+    gst_structure_free(stats);
+  }
+}
+
+// upper bucket edge, like the element's own percentiles
+static gdouble
+ws_bench_bucket_percentile(const guint64 *buckets, guint pct)
+{
+  guint64 total = 0, seen = 0;
+
+  for (guint b = 0; b < HISTOGRAM_BUCKETS; b++)
+    total += buckets[b];
+  if (total == 0)
+    return 0;
+  for (guint b = 0; b < HISTOGRAM_BUCKETS; b++) {
+    seen += buckets[b];
+    if (seen * 100 >= total * pct)
+      return (gdouble)(G_GUINT64_CONSTANT(2) << b);
+  }
+  return (gdouble)(G_GUINT64_CONSTANT(2) << (HISTOGRAM_BUCKETS - 1));
+}
+
+static gint
+compare_gint64(gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static gdouble
+ws_bench_sample_percentile(GArray *samples, guint pct)
+{
+  guint index;
+
+  if (samples->len == 0)
+    return 0;
+  index = MIN((guint)((guint64)samples->len * pct / 100), samples->len - 1);
+  return (gdouble)g_array_index(samples, gint64, index);
+}
+
+static gint64
+ws_bench_cpu_us(void)
+{
+  struct rusage usage;
+
+  getrusage(RUSAGE_SELF, &usage);
+  return (gint64)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+      usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// linux only, 0 elsewhere
+static guint
+ws_bench_threads(void)
+{
+  GDir *dir = g_dir_open("/proc/self/task", 0, NULL);
+  guint threads = 0;
+
+  if (!dir)
+    return 0;
+  while (g_dir_read_name(dir))
+    threads++;
+  g_dir_close(dir);
+  return threads;
+}
+
+static guint64
+ws_bench_rss_kb(void)
+{
+  gchar *statm = NULL;
+  guint64 resident = 0;
+
+  if (g_file_get_contents("/proc/self/statm", &statm, NULL, NULL)) {
+    gchar **fields = g_strsplit(statm, " ", 3);
+
+    if (fields[0] && fields[1])
+      resident = g_ascii_strtoull(fields[1], NULL, 10);
+    g_strfreev(fields);
+    g_free(statm);
+  }
+  return resident * (guint64)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// feeds every call one frame per FRAME_MS until the monotonic time end_us
+static void
+ws_bench_feed(GPtrArray *calls, gint64 end_us, GstClockTime *pts)
+{
+  gint64 next = g_get_monotonic_time();
+
+  while (next < end_us) {
+    for (guint i = 0; i < calls->len; i++)
+      ws_bench_call_push(g_ptr_array_index(calls, i), *pts);
+    *pts += FRAME_MS * GST_MSECOND;
+    next += FRAME_MS * 1000;
+    if (next > g_get_monotonic_time())
+      g_usleep((gulong)(next - g_get_monotonic_time()));
+  }
+}
+
+static gboolean
+ws_bench_run(const gchar *uri, guint instances, WsBenchResult *result, GError **error)
+{
+  GPtrArray *calls = g_ptr_array_new_with_free_func((GDestroyNotify)ws_bench_call_free);
+  GArray *latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+  guint64 buckets_before[HISTOGRAM_BUCKETS], buckets_after[HISTOGRAM_BUCKETS];
+  guint64 rss_idle = ws_bench_rss_kb(), rss, frames = 0;
+  GstClockTime pts = 0;
+  gint64 cpu_start, wall_start, cpu_us, wall_us;
+  gboolean ok = TRUE;
+
+  memset(result, 0, sizeof(*result));
+  result->instances = instances;
+
+  for (guint i = 0; i < instances && ok; i++) {
+    g_ptr_array_add(calls, ws_bench_call_new(i, uri, error));
+    ok = *error == NULL;
+  }
+  if (!ok)
+    goto out;
+
+  ws_bench_feed(calls, g_get_monotonic_time() + opt_warmup * G_USEC_PER_SEC, &pts);
+
+  ws_bench_barge_in_buckets(calls, buckets_before);
+  g_atomic_int_set(&measuring, TRUE);
+  cpu_start = ws_bench_cpu_us();
+  wall_start = g_get_monotonic_time();
+  ws_bench_feed(calls, wall_start + opt_duration * G_USEC_PER_SEC, &pts);
+  g_atomic_int_set(&measuring, FALSE);
+  cpu_us = ws_bench_cpu_us() - cpu_start;
+  wall_us = MAX(g_get_monotonic_time() - wall_start, 1);
+  ws_bench_barge_in_buckets(calls, buckets_after);
+
+  rss = ws_bench_rss_kb();
+  result->values[METRIC_THREADS] = ws_bench_threads();
+  result->values[METRIC_RSS_PER_CALL] = (gdouble)(rss - MIN(rss_idle, rss)) / instances;
+
+  for (guint i = 0; i < calls->len; i++) {
+    WsBenchCall *call = g_ptr_array_index(calls, i);
+
+    g_mutex_lock(&call->lock);
+    frames += call->frames;
+    g_array_append_vals(latencies, call->latencies->data, call->latencies->len);
+    g_mutex_unlock(&call->lock);
+  }
+  g_array_sort(latencies, compare_gint64);
+  for (guint b = 0; b < HISTOGRAM_BUCKETS; b++)
+    buckets_after[b] -= MIN(buckets_before[b], buckets_after[b]);
+
+  // the echo server shares the process, so its share is in here too
+  result->values[METRIC_CPU_PER_CALL] = 100.0 * cpu_us / wall_us / instances;
+  result->values[METRIC_FRAMES_PER_SEC] = (gdouble)frames * G_USEC_PER_SEC / wall_us;
+  result->values[METRIC_LATENCY_P50] = ws_bench_sample_percentile(latencies, 50);
+  result->values[METRIC_LATENCY_P99] = ws_bench_sample_percentile(latencies, 99);
+  result->values[METRIC_BARGE_IN_P50] = ws_bench_bucket_percentile(buckets_after, 50);
+  result->values[METRIC_BARGE_IN_P99] = ws_bench_bucket_percentile(buckets_after, 99);
+
+out:
+  g_ptr_array_unref(calls);
+  g_array_unref(latencies);
+  return ok;
+}
+
+static void
+ws_bench_print_header(void)
+{
+  g_print("%9s", "instances");
+  for (guint m = 0; m < N_METRICS; m++)
+    g_print(" %s", metrics[m].name);
+  g_print("\n");
+}
+
+static void
+ws_bench_print(const WsBenchResult *result)
+{
+  g_print("%9u", result->instances);
+  for (guint m = 0; m < N_METRICS; m++) {
+    gchar *value = g_strdup_printf(metrics[m].format, result->values[m]);
+
+    g_print(" %*s", (int)strlen(metrics[m].name), g_strstrip(value));
+    g_free(value);
+  }
+  g_print("\n");
+}
+
+static gboolean
+ws_bench_save(const gchar *path, GArray *results, GError **error)
+{
+  JsonBuilder *builder = json_builder_new();
+  JsonGenerator *generator = json_generator_new();
+  JsonNode *root;
+  gboolean ok;
+
+  json_builder_begin_object(builder);
+  json_builder_set_member_name(builder, "results");
+  json_builder_begin_array(builder);
+  for (guint i = 0; i < results->len; i++) {
+    WsBenchResult *result = &g_array_index(results, WsBenchResult, i);
+
+    json_builder_begin_object(builder);
+    json_builder_set_member_name(builder, "instances");
+    json_builder_add_int_value(builder, result->instances);
+    for (guint m = 0; m < N_METRICS; m++) {
+      json_builder_set_member_name(builder, metrics[m].name);
+      json_builder_add_double_value(builder, result->values[m]);
+    }
+    json_builder_end_object(builder);
+  }
+  json_builder_end_array(builder);
+  json_builder_end_object(builder);
+
+  root = json_builder_get_root(builder);
+  json_generator_set_root(generator, root);
+  json_generator_set_pretty(generator, TRUE);
+  ok = json_generator_to_file(generator, path, error);
+
+  json_node_unref(root);
+  g_object_unref(generator);
+  g_object_unref(builder);
+  return ok;
+}
+
+// returns the number of regressed metrics, or -1 when the baseline cannot be read.
+// call counts missing from the baseline are not compared.
+static gint
+ws_bench_compare(const gchar *path, GArray *results, GError **error)
+{
+  JsonParser *parser = json_parser_new();
+  JsonArray *entries;
+  JsonObject *root;
+  gint regressions = 0;
+
+  if (!json_parser_load_from_file(parser, path, error)) {
+    g_object_unref(parser);
+    return -1;
+  }
+  root = JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser)) ?
+      json_node_get_object(json_parser_get_root(parser)) : NULL;
+  entries = root && json_object_has_member(root, "results") ?
+      json_object_get_array_member(root, "results") : NULL;
+  if (!entries) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s has no results array", path);
+    g_object_unref(parser);
+    return -1;
+  }
+
+  for (guint i = 0; i < results->len; i++) {
+    WsBenchResult *result = &g_array_index(results, WsBenchResult, i);
+
+    for (guint e = 0; e < json_array_get_length(entries); e++) {
+      JsonObject *entry = json_array_get_object_element(entries, e);
+
+      if (!entry || json_object_get_int_member(entry, "instances") != (gint64)result->instances)
+        continue;
+      for (guint m = 0; m < N_METRICS; m++) {
+        gdouble base, change;
+
+        if (!json_object_has_member(entry, metrics[m].name))
+          continue;
+        base = json_object_get_double_member(entry, metrics[m].name);
+        // a metric the baseline never saw, e.g. no clears, cannot regress
+        if (base <= 0)
+          continue;
+        change = (result->values[m] - base) / base;
+        if (metrics[m].higher_is_better)
+          change = -change;
+        if (change > opt_tolerance) {
+          g_print("REGRESSION %u instances: %s %.2f, baseline %.2f (%+.0f%%)\n",
+              result->instances, metrics[m].name, result->values[m], base, 100 * change);
+          regressions++;
+        }
+      }
+    }
+  }
+
+  g_object_unref(parser);
+  return regressions;
+}
+
+int
+main(int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  WsBenchEchoServer *server = NULL;
+  GArray *results;
+  gchar **counts;
+  gchar *uri;
+  struct rlimit limit;
+  gint status = 0;
+
+  context = g_option_context_new("- websockettransceiver load test");
+  g_option_context_add_main_entries(context, entries, NULL);
+  g_option_context_add_group(context, gst_init_get_option_group());
+  if (!g_option_context_parse(context, &argc, &argv, &error)) {
+    g_printerr("%s\n", error->message);
+    return 2;
+  }
+  g_option_context_free(context);
+
+  // two sockets per call, both ends live in this process
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  // no sockets and no server thread, what is left is the element's own cost
+  if (opt_loopback) {
+    uri = g_strdup_printf("loopback://?clear-ms=%d%s%s", MAX(opt_clear_interval_ms, 0),
+        *opt_loopback ? "&" : "", opt_loopback);
+  } else {
+    server = ws_bench_echo_server_new((guint)MAX(opt_clear_interval_ms, 0), &error);
+    if (!server) {
+      g_printerr("Echo server: %s\n", error->message);
+      return 2;
+    }
+    uri = g_strdup_printf("ws://127.0.0.1:%u/", ws_bench_echo_server_get_port(server));
+  }
+
+  results = g_array_new(FALSE, FALSE, sizeof(WsBenchResult));
+  counts = g_strsplit(opt_instances ? opt_instances : "1,10,100,1000", ",", -1);
+  ws_bench_print_header();
+  for (gchar **count = counts; *count && status == 0; count++) {
+    WsBenchResult result;
+    guint instances = (guint)g_ascii_strtoull(*count, NULL, 10);
+
+    if (instances == 0)
+      continue;
+    if (!ws_bench_run(uri, instances, &result, &error)) {
+      g_printerr("%u instances: %s\n", instances, error->message);
+      g_clear_error(&error);
+      status = 2;
+      break;
+    }
+    ws_bench_print(&result);
+    g_array_append_val(results, result);
+  }
+  g_strfreev(counts);
+
+  if (status == 0 && opt_save_baseline && !ws_bench_save(opt_save_baseline, results, &error)) {
+    g_printerr("%s: %s\n", opt_save_baseline, error->message);
+    g_clear_error(&error);
+    status = 2;
+  }
+  if (status == 0 && opt_baseline) {
+    gint regressions = ws_bench_compare(opt_baseline, results, &error);
+
+    if (regressions < 0) {
+      g_printerr("%s: %s\n", opt_baseline, error->message);
+      g_clear_error(&error);
+      status = 2;
+    } else if (regressions > 0) {
+      status = 1;
+    }
+  }
+
+  g_array_unref(results);
+  g_free(uri);
+  if (server)
+    ws_bench_echo_server_free(server);
+  return status;
+}
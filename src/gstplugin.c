@@ -1,9 +1,12 @@
 #include <gst/gst.h>
 #include "gstwebsockettransceiver.h"
+#include "gstwstracer.h"
 
 static gboolean
 plugin_init(GstPlugin *plugin)
 {
+  if (!gst_tracer_register(plugin, "websocket", GST_TYPE_WS_TRACER))
+    return FALSE;
   return gst_element_register(plugin, "websockettransceiver",
       GST_RANK_NONE, GST_TYPE_WEBSOCKET_TRANSCEIVER);
 }
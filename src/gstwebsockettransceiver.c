@@ -14,24 +14,93 @@ enum
   PROP_CHANNELS,
   PROP_FRAME_DURATION_MS,
   PROP_MAX_QUEUE_SIZE,
+  PROP_MAX_QUEUE_BYTES,
+  PROP_MAX_QUEUE_TIME_MS,
+  PROP_PROCESS_MAX_QUEUE_BYTES,
   PROP_INITIAL_BUFFER_COUNT,
   PROP_RECONNECT_ENABLED,
   PROP_INITIAL_RECONNECT_DELAY_MS,
   PROP_MAX_BACKOFF_MS,
   PROP_MAX_RECONNECTS,
+  PROP_ASYNC_CONNECT,
+  PROP_IO_POOL,
+  PROP_IO_POOL_SIZE,
+  PROP_PREWARM_CONNECTIONS,
+  PROP_MUX,
+  PROP_SEND_QUEUE_SIZE,
+  PROP_SEND_OVERFLOW,
+  PROP_SEND_BATCH_MS,
+  PROP_SEND_BATCH_BYTES,
+  PROP_SEND_BATCH_MAX_LATENCY_MS,
+  PROP_RECV_BUFFER_MODE,
+  PROP_JITTER_MODE,
+  PROP_MIN_LATENCY_MS,
+  PROP_MAX_LATENCY_MS,
+  PROP_FILL_MODE,
+  PROP_PACING,
+  PROP_PACING_SPEED,
+  PROP_FRAMING,
+  PROP_BARGE_IN_MODE,
+  PROP_REPLAY_BUFFER_MS,
+  PROP_COMPRESSION,
+  PROP_COMPRESSION_WINDOW_BITS,
+  PROP_WIRE_FORMAT,
+  PROP_WIRE_RATE,
+  PROP_WIRE_CODEC,
+  PROP_VAD,
+  PROP_VAD_THRESHOLD,
+  PROP_VAD_HANGOVER_MS,
+  PROP_VAD_KEEPALIVE_MS,
+  PROP_STATS_INTERVAL_MS,
+  PROP_TRACE_BUFFER_SIZE,
+  PROP_THREAD_NAME,
+  PROP_OUTPUT_THREAD_PRIORITY,
+  PROP_OUTPUT_THREAD_CPUS,
+  PROP_WS_THREAD_PRIORITY,
+  PROP_WS_THREAD_CPUS,
   // read-only statistics
   PROP_BYTES_SENT,
   PROP_BYTES_RECEIVED,
   PROP_BUFFERS_SENT,
   PROP_BUFFERS_RECEIVED,
   PROP_BUFFERS_DROPPED,
+  PROP_ACTIVE_RECV_BUFFER_MODE,
+  PROP_POOL_HITS,
+  PROP_POOL_MISSES,
+  PROP_JITTER_MS,
+  PROP_TARGET_LATENCY_MS,
+  PROP_SILENCE_TRIMMED,
+  PROP_FRAMES_FILLED,
+  PROP_LATE_FRAMES,
+  PROP_MAX_LATENESS_US,
+  PROP_FRAMING_ACTIVE,
+  PROP_ONE_WAY_DELAY_US,
+  PROP_STALE_FRAMES,
+  PROP_BARGE_IN_LATENCY_US,
+  PROP_WARM_CONNECTS,
+  PROP_RESUME_TOKEN,
+  PROP_BUFFERS_REPLAYED,
+  PROP_COMPRESSION_RATIO,
+  PROP_BUFFERS_SUPPRESSED,
+  PROP_MUX_STREAM_ID,
+  PROP_STATS,
 };
 
+enum
+{
+  SIGNAL_DUMP_TRACE,
+  LAST_SIGNAL,
+};
+
+static guint signals[LAST_SIGNAL];
+
 #define DEFAULT_URI NULL
 #define DEFAULT_SAMPLE_RATE 16000
 #define DEFAULT_CHANNELS 1
 #define DEFAULT_FRAME_DURATION_MS 250
 #define DEFAULT_MAX_QUEUE_SIZE 100
+#define DEFAULT_MAX_QUEUE_BYTES 0
+#define DEFAULT_MAX_QUEUE_TIME_MS 0
 #define DEFAULT_INITIAL_BUFFER_COUNT 3
 
 #define DEFAULT_RECONNECT_ENABLED TRUE
@@ -39,6 +108,69 @@ enum
 #define DEFAULT_MAX_BACKOFF_MS 30000
 #define DEFAULT_MAX_RECONNECTS 10
 #define CONNECTION_TIMEOUT_SECONDS 5
+#define DEFAULT_ASYNC_CONNECT FALSE
+#define DEFAULT_REPLAY_BUFFER_MS 0
+#define DEFAULT_COMPRESSION FALSE
+#define DEFAULT_COMPRESSION_WINDOW_BITS GST_WS_DEFLATE_MAX_WINDOW_BITS
+#define DEFAULT_WIRE_FORMAT GST_WEBSOCKET_WIRE_FORMAT_NATIVE
+#define DEFAULT_WIRE_RATE 0
+#define DEFAULT_WIRE_CODEC GST_WEBSOCKET_WIRE_CODEC_RAW
+#define DEFAULT_VAD FALSE
+// about -40 dBFS RMS, well under quiet speech and over a typical headset noise floor
+#define DEFAULT_VAD_THRESHOLD 0.01
+#define DEFAULT_VAD_HANGOVER_MS 300
+#define DEFAULT_VAD_KEEPALIVE_MS 1000
+#define DEFAULT_STATS_INTERVAL_MS 0
+#define DEFAULT_TRACE_BUFFER_SIZE 0
+#define DEFAULT_THREAD_NAME NULL
+#define DEFAULT_OUTPUT_THREAD_PRIORITY 0
+#define DEFAULT_OUTPUT_THREAD_CPUS NULL
+#define DEFAULT_WS_THREAD_PRIORITY 0
+#define DEFAULT_WS_THREAD_CPUS NULL
+// request header carrying the resume token, so a server can attach a reconnect to the
+// session it interrupted
+#define RESUME_TOKEN_HEADER "X-Resume-Token"
+
+#define DEFAULT_IO_POOL FALSE
+#define DEFAULT_IO_POOL_SIZE 0
+#define DEFAULT_PREWARM_CONNECTIONS 0
+#define DEFAULT_MUX FALSE
+// control messages opening and closing a stream of a multiplexed connection
+#define MUX_STREAM_OPEN "{\"type\":\"stream-open\"}"
+#define MUX_STREAM_CLOSE "{\"type\":\"stream-close\"}"
+
+#define DEFAULT_SEND_QUEUE_SIZE 32
+#define DEFAULT_SEND_OVERFLOW GST_WEBSOCKET_OVERFLOW_DROP_OLDEST
+// upper bound of buffers sent per send source dispatch, so one busy element cannot
+// monopolize a shared reactor thread
+#define SEND_DRAIN_BATCH 64
+
+#define DEFAULT_SEND_BATCH_MS 0
+#define DEFAULT_SEND_BATCH_BYTES 0
+#define DEFAULT_SEND_BATCH_MAX_LATENCY_MS 60
+
+#define DEFAULT_RECV_BUFFER_MODE GST_WEBSOCKET_RECV_BUFFER_AUTO
+// frames that may be held downstream on top of a full receive queue before the pool
+// runs dry and frames fall back to plain allocations
+#define RECV_POOL_HEADROOM 8
+
+#define DEFAULT_JITTER_MODE GST_WEBSOCKET_JITTER_FIXED
+#define DEFAULT_MIN_LATENCY_MS 40
+#define DEFAULT_MAX_LATENCY_MS 500
+// frames whose peak stays below about -50 dBFS may be trimmed from a deep playout buffer
+#define SILENCE_THRESHOLD 0.003
+
+#define DEFAULT_FILL_MODE GST_WEBSOCKET_FILL_NONE
+// about -60 dBFS, audible as a faint hiss that masks the gap without drawing attention
+#define COMFORT_NOISE_AMPLITUDE 0.001
+// filler buffers cycled by the output thread. downstream rarely holds more than a couple
+#define FILL_BUFFER_COUNT 4
+
+#define DEFAULT_PACING GST_WEBSOCKET_PACING_REALTIME
+#define DEFAULT_PACING_SPEED 2.0
+
+#define DEFAULT_FRAMING GST_WEBSOCKET_FRAMING_NONE
+#define DEFAULT_BARGE_IN_MODE GST_WEBSOCKET_BARGE_IN_FLUSH
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
     GST_PAD_SINK,
@@ -70,6 +202,163 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE("src",
         "rate = (int) [ 8000, 48000 ], "
         "channels = (int) [ 1, 2 ]"));
 
+#define GST_TYPE_WEBSOCKET_OVERFLOW (gst_websocket_overflow_get_type())
+static GType
+gst_websocket_overflow_get_type(void)
+{
+  static GType overflow_type = 0;
+  static const GEnumValue overflow_types[] = {
+    {GST_WEBSOCKET_OVERFLOW_DROP_OLDEST, "Drop the oldest queued buffer", "drop-oldest"},
+    {GST_WEBSOCKET_OVERFLOW_DROP_NEWEST, "Drop the incoming buffer", "drop-newest"},
+    {GST_WEBSOCKET_OVERFLOW_BLOCK, "Block upstream until there is room", "block"},
+    {0, NULL, NULL},
+  };
+
+  if (!overflow_type)
+    overflow_type = g_enum_register_static("GstWebSocketOverflow", overflow_types);
+  return overflow_type;
+}
+
+#define GST_TYPE_WEBSOCKET_RECV_BUFFER_MODE (gst_websocket_recv_buffer_mode_get_type())
+static GType
+gst_websocket_recv_buffer_mode_get_type(void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode_types[] = {
+    {GST_WEBSOCKET_RECV_BUFFER_AUTO, "Pool once the frame size is known, wrap before", "auto"},
+    {GST_WEBSOCKET_RECV_BUFFER_COPY, "Copy each message into a new allocation", "copy"},
+    {GST_WEBSOCKET_RECV_BUFFER_POOL, "Copy frames into buffers recycled from a pool", "pool"},
+    {GST_WEBSOCKET_RECV_BUFFER_WRAP, "Wrap the received message without copying", "wrap"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static("GstWebSocketRecvBufferMode", mode_types);
+  return mode_type;
+}
+
+#define GST_TYPE_WEBSOCKET_JITTER_MODE (gst_websocket_jitter_mode_get_type())
+static GType
+gst_websocket_jitter_mode_get_type(void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode_types[] = {
+    {GST_WEBSOCKET_JITTER_FIXED, "Wait for initial-buffer-count once, then play", "fixed"},
+    {GST_WEBSOCKET_JITTER_ADAPTIVE, "Keep a depth that follows the measured jitter", "adaptive"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static("GstWebSocketJitterMode", mode_types);
+  return mode_type;
+}
+
+#define GST_TYPE_WEBSOCKET_FILL_MODE (gst_websocket_fill_mode_get_type())
+static GType
+gst_websocket_fill_mode_get_type(void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode_types[] = {
+    {GST_WEBSOCKET_FILL_NONE, "Push nothing, leave a gap in the timeline", "none"},
+    {GST_WEBSOCKET_FILL_SILENCE, "Push a frame of digital silence", "silence"},
+    {GST_WEBSOCKET_FILL_COMFORT_NOISE, "Push a frame of low-level noise", "comfort-noise"},
+    {GST_WEBSOCKET_FILL_GAP_EVENT, "Push a GAP event for the missing frame", "gap-event"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static("GstWebSocketFillMode", mode_types);
+  return mode_type;
+}
+
+#define GST_TYPE_WEBSOCKET_PACING (gst_websocket_pacing_get_type())
+static GType
+gst_websocket_pacing_get_type(void)
+{
+  static GType pacing_type = 0;
+  static const GEnumValue pacing_types[] = {
+    {GST_WEBSOCKET_PACING_REALTIME, "One frame per frame duration of the pipeline clock",
+        "realtime"},
+    {GST_WEBSOCKET_PACING_SCALED, "pacing-speed times faster than realtime", "scaled"},
+    {GST_WEBSOCKET_PACING_NONE, "As fast as the server sends and downstream takes it",
+        "as-fast-as-possible"},
+    {0, NULL, NULL},
+  };
+
+  if (!pacing_type)
+    pacing_type = g_enum_register_static("GstWebSocketPacing", pacing_types);
+  return pacing_type;
+}
+
+#define GST_TYPE_WEBSOCKET_FRAMING (gst_websocket_framing_get_type())
+static GType
+gst_websocket_framing_get_type(void)
+{
+  static GType framing_type = 0;
+  static const GEnumValue framing_types[] = {
+    {GST_WEBSOCKET_FRAMING_NONE, "Binary messages are raw audio", "none"},
+    {GST_WEBSOCKET_FRAMING_V1, "Request the " GST_WS_FRAME_SUBPROTOCOL " header, "
+        "fall back to raw audio if the server declines", "v1"},
+    {0, NULL, NULL},
+  };
+
+  if (!framing_type)
+    framing_type = g_enum_register_static("GstWebSocketFraming", framing_types);
+  return framing_type;
+}
+
+#define GST_TYPE_WEBSOCKET_BARGE_IN_MODE (gst_websocket_barge_in_mode_get_type())
+static GType
+gst_websocket_barge_in_mode_get_type(void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode_types[] = {
+    {GST_WEBSOCKET_BARGE_IN_FLUSH, "Flush downstream and restart the timeline", "flush"},
+    {GST_WEBSOCKET_BARGE_IN_FAST, "Drop stale audio in the element only, keep the timeline",
+        "fast"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static("GstWebSocketBargeInMode", mode_types);
+  return mode_type;
+}
+
+#define GST_TYPE_WEBSOCKET_WIRE_FORMAT (gst_websocket_wire_format_get_type())
+static GType
+gst_websocket_wire_format_get_type(void)
+{
+  static GType format_type = 0;
+  static const GEnumValue format_types[] = {
+    {GST_WEBSOCKET_WIRE_FORMAT_NATIVE, "The sample format of the negotiated caps",
+        "native"},
+    {GST_WEBSOCKET_WIRE_FORMAT_S16LE, "Signed 16-bit little endian PCM", "s16le"},
+    {0, NULL, NULL},
+  };
+
+  if (!format_type)
+    format_type = g_enum_register_static("GstWebSocketWireFormat", format_types);
+  return format_type;
+}
+
+#define GST_TYPE_WEBSOCKET_WIRE_CODEC (gst_websocket_wire_codec_get_type())
+static GType
+gst_websocket_wire_codec_get_type(void)
+{
+  static GType codec_type = 0;
+  static const GEnumValue codec_types[] = {
+    {GST_WEBSOCKET_WIRE_CODEC_RAW, "Binary messages carry audio in the negotiated caps",
+        "raw"},
+    {GST_WEBSOCKET_WIRE_CODEC_OPUS, "Binary messages carry one 20 ms Opus packet each",
+        "opus"},
+    {0, NULL, NULL},
+  };
+
+  if (!codec_type)
+    codec_type = g_enum_register_static("GstWebSocketWireCodec", codec_types);
+  return codec_type;
+}
+
 #define gst_websocket_transceiver_parent_class parent_class
 G_DEFINE_TYPE(GstWebSocketTransceiver, gst_websocket_transceiver, GST_TYPE_ELEMENT);
 
@@ -89,7 +378,15 @@ static gboolean gst_websocket_transceiver_sink_event(GstPad *pad, GstObject *par
 static gboolean gst_websocket_transceiver_sink_setcaps(GstWebSocketTransceiver *self,
     GstCaps *caps);
 static gpointer gst_websocket_transceiver_output_thread(gpointer user_data);
-static gpointer gst_websocket_transceiver_ws_thread(gpointer user_data);
+static void gst_websocket_transceiver_connect(GstWebSocketTransceiver *self);
+static void gst_websocket_transceiver_adopt_connection(GstWebSocketTransceiver *self,
+    SoupWebsocketConnection *conn);
+static void gst_websocket_transceiver_reset_batch(GstWebSocketTransceiver *self);
+static void gst_websocket_transceiver_replay(GstWebSocketTransceiver *self);
+static void gst_websocket_transceiver_clear_replay(GstWebSocketTransceiver *self);
+static void gst_websocket_transceiver_free_recv_pool_locked(GstWebSocketTransceiver *self);
+static void gst_websocket_transceiver_reset_vad(GstWebSocketTransceiver *self);
+static gchar *gst_websocket_transceiver_dump_trace(GstWebSocketTransceiver *self);
 
 static void
 gst_websocket_transceiver_class_init(GstWebSocketTransceiverClass *klass)
@@ -127,6 +424,28 @@ gst_websocket_transceiver_class_init(GstWebSocketTransceiverClass *klass)
           1, 1000, DEFAULT_MAX_QUEUE_SIZE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(gobject_class, PROP_MAX_QUEUE_BYTES,
+      g_param_spec_uint("max-queue-bytes", "Max Queue Bytes",
+          "Maximum receive queue size in bytes, oldest audio is dropped first "
+          "(0 = no limit)",
+          0, G_MAXUINT, DEFAULT_MAX_QUEUE_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_MAX_QUEUE_TIME_MS,
+      g_param_spec_uint("max-queue-time-ms", "Max Queue Time",
+          "Maximum receive queue size in milliseconds of audio, oldest audio is dropped "
+          "first (0 = no limit)",
+          0, G_MAXUINT, DEFAULT_MAX_QUEUE_TIME_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_PROCESS_MAX_QUEUE_BYTES,
+      g_param_spec_uint64("process-max-queue-bytes", "Process Max Queue Bytes",
+          "Budget in bytes for the receive queues of all elements in the process, "
+          "shared: setting it on one element sets it for all. When it runs out the "
+          "deepest queues are trimmed first (0 = no limit)",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property(gobject_class, PROP_INITIAL_BUFFER_COUNT,
       g_param_spec_uint("initial-buffer-count", "Initial Buffer Count",
           "Number of buffers to accumulate before starting playback (0 = no buffering)",
@@ -156,6 +475,239 @@ gst_websocket_transceiver_class_init(GstWebSocketTransceiverClass *klass)
           0, 100, DEFAULT_MAX_RECONNECTS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(gobject_class, PROP_ASYNC_CONNECT,
+      g_param_spec_boolean("async-connect", "Async Connect",
+          "Return ASYNC from NULL_TO_READY and post async-done once connected, "
+          "instead of blocking the state change for up to 5 s",
+          DEFAULT_ASYNC_CONNECT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_IO_POOL,
+      g_param_spec_boolean("io-pool", "Shared I/O Pool",
+          "Run the WebSocket connection on the process-wide shared reactor pool "
+          "instead of a dedicated thread",
+          DEFAULT_IO_POOL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_IO_POOL_SIZE,
+      g_param_spec_uint("io-pool-size", "I/O Pool Size",
+          "Number of shared reactor threads (0 = one per CPU, up to 4). "
+          "Only applies when the pool is first started",
+          0, 64, DEFAULT_IO_POOL_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_PREWARM_CONNECTIONS,
+      g_param_spec_uint("prewarm-connections", "Prewarm Connections",
+          "Open connections kept on standby per URI in a process-wide pool, so going "
+          "to READY takes one instead of connecting (0 = off, implies io-pool)",
+          0, 16, DEFAULT_PREWARM_CONNECTIONS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_MUX,
+      g_param_spec_boolean("mux", "Multiplex",
+          "Share one connection per URI with the other elements in the process, as a "
+          "stream of its own (needs a server speaking " GST_WS_FRAME_MUX_SUBPROTOCOL
+          "; implies binary framing and io-pool, replaces prewarm-connections)",
+          DEFAULT_MUX, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_SEND_QUEUE_SIZE,
+      g_param_spec_uint("send-queue-size", "Send Queue Size",
+          "Maximum outbound buffers waiting for the WebSocket thread "
+          "(capacity is fixed when going to READY)",
+          1, 1024, DEFAULT_SEND_QUEUE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_SEND_OVERFLOW,
+      g_param_spec_enum("send-overflow", "Send Overflow",
+          "What to do when the send queue is full",
+          GST_TYPE_WEBSOCKET_OVERFLOW, DEFAULT_SEND_OVERFLOW,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_SEND_BATCH_MS,
+      g_param_spec_uint("send-batch-ms", "Send Batch Duration",
+          "Coalesce outbound audio into one WebSocket frame per this many ms "
+          "(0 = no time threshold)",
+          0, 1000, DEFAULT_SEND_BATCH_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_SEND_BATCH_BYTES,
+      g_param_spec_uint("send-batch-bytes", "Send Batch Size",
+          "Coalesce outbound audio into one WebSocket frame per this many bytes "
+          "(0 = no size threshold)",
+          0, 1024 * 1024, DEFAULT_SEND_BATCH_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_SEND_BATCH_MAX_LATENCY_MS,
+      g_param_spec_uint("send-batch-max-latency-ms", "Send Batch Max Latency",
+          "Longest time the first buffer of a batch may wait before the batch is sent",
+          1, 1000, DEFAULT_SEND_BATCH_MAX_LATENCY_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_RECV_BUFFER_MODE,
+      g_param_spec_enum("recv-buffer-mode", "Receive Buffer Mode",
+          "How buffers for received audio are allocated",
+          GST_TYPE_WEBSOCKET_RECV_BUFFER_MODE, DEFAULT_RECV_BUFFER_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_JITTER_MODE,
+      g_param_spec_enum("jitter-mode", "Jitter Mode",
+          "How the receive side protects playback against network jitter",
+          GST_TYPE_WEBSOCKET_JITTER_MODE, DEFAULT_JITTER_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_MIN_LATENCY_MS,
+      g_param_spec_uint("min-latency-ms", "Min Latency",
+          "Lower bound of the adaptive playout buffer depth in milliseconds",
+          0, 10000, DEFAULT_MIN_LATENCY_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_MAX_LATENCY_MS,
+      g_param_spec_uint("max-latency-ms", "Max Latency",
+          "Upper bound of the adaptive playout buffer depth in milliseconds",
+          0, 10000, DEFAULT_MAX_LATENCY_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_FILL_MODE,
+      g_param_spec_enum("fill-mode", "Fill Mode",
+          "What to push downstream for a frame when the receive queue is empty",
+          GST_TYPE_WEBSOCKET_FILL_MODE, DEFAULT_FILL_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_PACING,
+      g_param_spec_enum("pacing", "Pacing",
+          "Rate at which received audio is pushed downstream. Other than realtime, an "
+          "empty queue is waited on instead of filled, for offline processing. Applied "
+          "on READY->PAUSED",
+          GST_TYPE_WEBSOCKET_PACING, DEFAULT_PACING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_PACING_SPEED,
+      g_param_spec_double("pacing-speed", "Pacing Speed",
+          "Multiple of realtime that pacing=scaled plays at",
+          0.01, 1000.0, DEFAULT_PACING_SPEED,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_FRAMING,
+      g_param_spec_enum("framing", "Framing",
+          "Header carried by binary messages, negotiated as a WebSocket subprotocol",
+          GST_TYPE_WEBSOCKET_FRAMING, DEFAULT_FRAMING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_BARGE_IN_MODE,
+      g_param_spec_enum("barge-in-mode", "Barge-in Mode",
+          "How a clear control message interrupts playback",
+          GST_TYPE_WEBSOCKET_BARGE_IN_MODE, DEFAULT_BARGE_IN_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_REPLAY_BUFFER_MS,
+      g_param_spec_uint("replay-buffer-ms", "Replay Buffer",
+          "Outbound audio kept and sent again after a reconnect, in ms. Also keeps the "
+          "receive queue and playback running across the reconnect (0 = off)",
+          0, 10000, DEFAULT_REPLAY_BUFFER_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_COMPRESSION,
+      g_param_spec_boolean("compression", "Compression",
+          "Negotiate permessage-deflate and compress outgoing PCM. Never applied to "
+          "mu-law or A-law audio, which is already compressed",
+          DEFAULT_COMPRESSION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_COMPRESSION_WINDOW_BITS,
+      g_param_spec_uint("compression-window-bits", "Compression Window Bits",
+          "Compression window of outgoing messages as a power of two; smaller windows "
+          "use less memory per connection (the server may lower it further)",
+          GST_WS_DEFLATE_MIN_WINDOW_BITS, GST_WS_DEFLATE_MAX_WINDOW_BITS,
+          DEFAULT_COMPRESSION_WINDOW_BITS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_WIRE_FORMAT,
+      g_param_spec_enum("wire-format", "Wire Format",
+          "Sample format of the audio on the WebSocket, converted from and to the caps",
+          GST_TYPE_WEBSOCKET_WIRE_FORMAT, DEFAULT_WIRE_FORMAT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_WIRE_RATE,
+      g_param_spec_uint("wire-rate", "Wire Rate",
+          "Sample rate of the audio on the WebSocket, resampled from and to the caps; "
+          "must be in a small integer ratio with it, such as 8, 16, 24 or 48 kHz "
+          "(0 = the caps rate)",
+          0, 48000, DEFAULT_WIRE_RATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_WIRE_CODEC,
+      g_param_spec_enum("wire-codec", "Wire Codec",
+          "Codec of the audio in binary messages. Opus encodes outbound and decodes "
+          "inbound audio in the element, at the negotiated rate and channels",
+          GST_TYPE_WEBSOCKET_WIRE_CODEC, DEFAULT_WIRE_CODEC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_VAD,
+      g_param_spec_boolean("vad", "Voice Activity Detection",
+          "Hold back outbound silence and send a silence control message in its place",
+          DEFAULT_VAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_VAD_THRESHOLD,
+      g_param_spec_double("vad-threshold", "VAD Threshold",
+          "RMS level, as a fraction of full scale, from which a buffer counts as speech "
+          "(half of it for noisy, consonant-like buffers)",
+          0.0, 1.0, DEFAULT_VAD_THRESHOLD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_VAD_HANGOVER_MS,
+      g_param_spec_uint("vad-hangover-ms", "VAD Hangover",
+          "Silence still sent after speech before suppression starts, so trailing "
+          "syllables and short pauses are not cut",
+          0, G_MAXUINT, DEFAULT_VAD_HANGOVER_MS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_VAD_KEEPALIVE_MS,
+      g_param_spec_uint("vad-keepalive-ms", "VAD Keepalive",
+          "Interval of suppressed audio after which the silence message is repeated "
+          "(0 = only at the start of the silence)",
+          0, G_MAXUINT, DEFAULT_VAD_KEEPALIVE_MS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_STATS_INTERVAL_MS,
+      g_param_spec_uint("stats-interval-ms", "Stats Interval",
+          "Post the stats structure as a websocket-stats element message this often "
+          "while the element is READY or above (0 = never)",
+          0, G_MAXUINT, DEFAULT_STATS_INTERVAL_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_TRACE_BUFFER_SIZE,
+      g_param_spec_uint("trace-buffer-size", "Trace Buffer Size",
+          "Events kept in the flight recorder, rounded up to a power of two, applied "
+          "on NULL->READY (0 = disabled)",
+          0, 1 << 20, DEFAULT_TRACE_BUFFER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_THREAD_NAME,
+      g_param_spec_string("thread-name", "Thread Name",
+          "Prefix of the element's own thread names, <prefix>-out and <prefix>-ws "
+          "(NULL = output-thread and websocket-thread). Shared reactor threads keep "
+          "their names",
+          DEFAULT_THREAD_NAME, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_OUTPUT_THREAD_PRIORITY,
+      g_param_spec_uint("output-thread-priority", "Output Thread Priority",
+          "SCHED_FIFO priority of the output thread, asked of rtkit when the process "
+          "may not set it itself (0 = normal scheduling)",
+          0, GST_WS_SCHED_MAX_PRIORITY, DEFAULT_OUTPUT_THREAD_PRIORITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_OUTPUT_THREAD_CPUS,
+      g_param_spec_string("output-thread-cpus", "Output Thread CPUs",
+          "CPUs the output thread may run on, e.g. \"2\" or \"0-3,6\" (NULL = any)",
+          DEFAULT_OUTPUT_THREAD_CPUS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_WS_THREAD_PRIORITY,
+      g_param_spec_uint("ws-thread-priority", "WebSocket Thread Priority",
+          "SCHED_FIFO priority of the WebSocket thread, or of the shared reactor the "
+          "element runs on, which keeps the highest any of its elements asked for "
+          "(0 = normal scheduling)",
+          0, GST_WS_SCHED_MAX_PRIORITY, DEFAULT_WS_THREAD_PRIORITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_WS_THREAD_CPUS,
+      g_param_spec_string("ws-thread-cpus", "WebSocket Thread CPUs",
+          "CPUs the WebSocket thread may run on, like output-thread-cpus. A shared "
+          "reactor keeps the first list it was given (NULL = any)",
+          DEFAULT_WS_THREAD_CPUS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   // read-only statistics properties
   g_object_class_install_property(gobject_class, PROP_BYTES_SENT,
       g_param_spec_uint64("bytes-sent", "Bytes Sent",
@@ -187,6 +739,135 @@ gst_websocket_transceiver_class_init(GstWebSocketTransceiverClass *klass)
           0, G_MAXUINT64, 0,
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(gobject_class, PROP_ACTIVE_RECV_BUFFER_MODE,
+      g_param_spec_enum("active-recv-buffer-mode", "Active Receive Buffer Mode",
+          "Receive buffer mode in use for the last message (auto resolved)",
+          GST_TYPE_WEBSOCKET_RECV_BUFFER_MODE, DEFAULT_RECV_BUFFER_MODE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_POOL_HITS,
+      g_param_spec_uint64("pool-hits", "Pool Hits",
+          "Received frames served from the receive buffer pool",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_POOL_MISSES,
+      g_param_spec_uint64("pool-misses", "Pool Misses",
+          "Received frames allocated outside the pool because it was exhausted",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_JITTER_MS,
+      g_param_spec_uint("jitter-ms", "Jitter",
+          "Current interarrival jitter estimate of received audio in milliseconds",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_TARGET_LATENCY_MS,
+      g_param_spec_uint("target-latency-ms", "Target Latency",
+          "Playout buffer depth the adaptive jitter buffer currently aims for",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_SILENCE_TRIMMED,
+      g_param_spec_uint64("silence-trimmed", "Silence Trimmed",
+          "Silent frames dropped to bring a deep playout buffer back to its target",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_FRAMES_FILLED,
+      g_param_spec_uint64("frames-filled", "Frames Filled",
+          "Frames covered by fill-mode because no audio was queued",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_LATE_FRAMES,
+      g_param_spec_uint64("late-frames", "Late Frames",
+          "Frames whose scheduled output time had already passed on the pipeline clock",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_MAX_LATENESS_US,
+      g_param_spec_uint64("max-lateness-us", "Max Lateness",
+          "Largest scheduling lateness of the output thread in microseconds",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_FRAMING_ACTIVE,
+      g_param_spec_boolean("framing-active", "Framing Active",
+          "Whether the server accepted binary framing on the current connection",
+          FALSE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_ONE_WAY_DELAY_US,
+      g_param_spec_int64("one-way-delay-us", "One-Way Delay",
+          "Smoothed delay between the sender timestamp of framed audio and its arrival "
+          "in microseconds (meaningful only with synchronized clocks)",
+          G_MININT64, G_MAXINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_STALE_FRAMES,
+      g_param_spec_uint64("stale-frames", "Stale Frames",
+          "Framed audio discarded because it was sent before a clear",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_BARGE_IN_LATENCY_US,
+      g_param_spec_uint64("barge-in-latency-us", "Barge-in Latency",
+          "Time from the last clear until no stale audio could leave the element, "
+          "in microseconds",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_WARM_CONNECTS,
+      g_param_spec_uint64("warm-connects", "Warm Connects",
+          "Connections taken from the standby pool instead of being opened",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_RESUME_TOKEN,
+      g_param_spec_string("resume-token", "Resume Token",
+          "Token sent in the " RESUME_TOKEN_HEADER " header of every handshake while "
+          "replay-buffer-ms is set, stable from READY to NULL",
+          NULL, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_BUFFERS_REPLAYED,
+      g_param_spec_uint64("buffers-replayed", "Buffers Replayed",
+          "Outbound buffers sent again on a resumed connection",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_COMPRESSION_RATIO,
+      g_param_spec_double("compression-ratio", "Compression Ratio",
+          "Outgoing audio bytes per byte on the wire on the current connection "
+          "(0 = nothing sent through permessage-deflate yet)",
+          0, G_MAXDOUBLE, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_BUFFERS_SUPPRESSED,
+      g_param_spec_uint64("buffers-suppressed", "Buffers Suppressed",
+          "Outbound buffers held back as silence by voice activity detection",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_MUX_STREAM_ID,
+      g_param_spec_uint("mux-stream-id", "Mux Stream ID",
+          "Stream id of the element on the shared connection (0 = none)",
+          0, G_MAXUINT16, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(gobject_class, PROP_STATS,
+      g_param_spec_boxed("stats", "Statistics",
+          "Counters, queue depths and latency histograms as a websocket-stats structure",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  // returns the flight recorder as text, oldest event first, or NULL when
+  // trace-buffer-size is 0
+  signals[SIGNAL_DUMP_TRACE] = g_signal_new_class_handler("dump-trace",
+      G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK(gst_websocket_transceiver_dump_trace), NULL, NULL, NULL,
+      G_TYPE_STRING, 0);
+
   gstelement_class->change_state = gst_websocket_transceiver_change_state;
 
   gst_element_class_set_static_metadata(gstelement_class,
@@ -202,6 +883,50 @@ gst_websocket_transceiver_class_init(GstWebSocketTransceiverClass *klass)
       0, "WebSocket Audio Transceiver");
 }
 
+// only while none of the writing threads runs
+static void
+gst_websocket_transceiver_reset_stats(GstWebSocketTransceiver *self)
+{
+  self->buffers_dropped = 0;
+  self->buffers_suppressed = 0;
+  gst_ws_gauge_reset(&self->send_queue_depth);
+  self->chain_time_us = 0;
+
+  self->bytes_sent = 0;
+  self->bytes_received = 0;
+  self->buffers_sent = 0;
+  self->buffers_received = 0;
+  self->ws_buffers_dropped = 0;
+  self->pool_hits = 0;
+  self->pool_misses = 0;
+  self->ws_stale_frames = 0;
+  self->warm_connects = 0;
+  self->buffers_replayed = 0;
+  self->payload_bytes_sent = 0;
+  self->wire_bytes_sent = 0;
+  self->wire_bytes_received = 0;
+  gst_ws_histogram_reset(&self->send_latency);
+  gst_ws_histogram_reset(&self->interarrival);
+  gst_ws_histogram_reset(&self->reconnect_time);
+  self->last_arrival_us = 0;
+  self->disconnected_us = 0;
+
+  self->silence_trimmed = 0;
+  self->frames_filled = 0;
+  self->late_frames = 0;
+  self->max_lateness = 0;
+  self->stale_frames = 0;
+  self->output_buffers_dropped = 0;
+  self->underruns = 0;
+  self->underrun_time_us = 0;
+  gst_ws_gauge_reset(&self->recv_queue_depth);
+  gst_ws_histogram_reset(&self->output_lateness);
+  self->output_preemptions = 0;
+
+  self->barge_in_latency_us = 0;
+  gst_ws_histogram_reset(&self->barge_in_latency);
+}
+
 static void
 gst_websocket_transceiver_init(GstWebSocketTransceiver *self)
 {
@@ -219,6 +944,9 @@ gst_websocket_transceiver_init(GstWebSocketTransceiver *self)
   self->channels = DEFAULT_CHANNELS;
   self->frame_duration_ms = DEFAULT_FRAME_DURATION_MS;
   self->max_queue_size = DEFAULT_MAX_QUEUE_SIZE;
+  self->max_queue_bytes = DEFAULT_MAX_QUEUE_BYTES;
+  self->max_queue_time_ms = DEFAULT_MAX_QUEUE_TIME_MS;
+  self->budget = gst_ws_budget_join();
   self->initial_buffer_count = DEFAULT_INITIAL_BUFFER_COUNT;
   self->reconnect_enabled = DEFAULT_RECONNECT_ENABLED;
   self->initial_reconnect_delay_ms = DEFAULT_INITIAL_RECONNECT_DELAY_MS;
@@ -226,21 +954,111 @@ gst_websocket_transceiver_init(GstWebSocketTransceiver *self)
   self->max_reconnects = DEFAULT_MAX_RECONNECTS;
   self->reconnect_count = 0;
   self->current_backoff_ms = 0;
+  self->async_connect = DEFAULT_ASYNC_CONNECT;
+  self->async_pending = FALSE;
+  self->async_timeout_source = NULL;
+  self->io_pool = DEFAULT_IO_POOL;
+  self->io_pool_size = DEFAULT_IO_POOL_SIZE;
+  self->reactor = NULL;
+  self->prewarm_connections = DEFAULT_PREWARM_CONNECTIONS;
+  self->warm = NULL;
+  self->mux = DEFAULT_MUX;
+  self->mux_endpoint = NULL;
+  self->mux_stream = NULL;
+  self->mux_stream_id = 0;
+  self->connect_cancellable = NULL;
+  self->replay_buffer_ms = DEFAULT_REPLAY_BUFFER_MS;
+  g_queue_init(&self->replay_queue);
+  self->replay_duration = 0;
+  self->replay_unsent = 0;
+  self->resume_token = NULL;
+  self->resuming = FALSE;
+  self->compression = DEFAULT_COMPRESSION;
+  self->compression_window_bits = DEFAULT_COMPRESSION_WINDOW_BITS;
+  self->deflate = NULL;
+  memset(&self->compression_stats, 0, sizeof(self->compression_stats));
+  self->wire_format = DEFAULT_WIRE_FORMAT;
+  self->wire_rate = DEFAULT_WIRE_RATE;
+  self->wire_sample_format = GST_WS_SAMPLE_FORMAT_UNKNOWN;
+  self->wire_sample_rate = 0;
+  self->wire_bpf = 0;
+  self->send_converter = NULL;
+  self->recv_converter = NULL;
+  self->wire_codec = DEFAULT_WIRE_CODEC;
+  self->opus_encoder = NULL;
+  self->encode_adapter = gst_adapter_new();
+  self->opus_decoder = NULL;
+  self->vad = DEFAULT_VAD;
+  self->vad_threshold = DEFAULT_VAD_THRESHOLD;
+  self->vad_hangover_ms = DEFAULT_VAD_HANGOVER_MS;
+  self->vad_keepalive_ms = DEFAULT_VAD_KEEPALIVE_MS;
+  self->stats_interval_ms = DEFAULT_STATS_INTERVAL_MS;
+  self->stats_source = NULL;
+  self->trace_buffer_size = DEFAULT_TRACE_BUFFER_SIZE;
+  self->flight = NULL;
+  self->thread_name = DEFAULT_THREAD_NAME;
+  self->output_thread_priority = DEFAULT_OUTPUT_THREAD_PRIORITY;
+  self->output_thread_cpus = DEFAULT_OUTPUT_THREAD_CPUS;
+  self->ws_thread_priority = DEFAULT_WS_THREAD_PRIORITY;
+  self->ws_thread_cpus = DEFAULT_WS_THREAD_CPUS;
+  self->output_realtime = FALSE;
+  self->ws_realtime = FALSE;
+  gst_ws_vad_init(&self->vad_state);
+  self->vad_preroll = NULL;
+  gst_websocket_transceiver_reset_vad(self);
+  self->reconnect_source = NULL;
+
+  self->send_queue_size = DEFAULT_SEND_QUEUE_SIZE;
+  self->send_overflow = DEFAULT_SEND_OVERFLOW;
+  self->send_ring = NULL;
+  self->send_source = NULL;
+  self->send_context = NULL;
+  g_mutex_init(&self->send_lock);
+  g_cond_init(&self->send_cond);
+  self->send_waiting = 0;
+
+  self->send_batch_ms = DEFAULT_SEND_BATCH_MS;
+  self->send_batch_bytes = DEFAULT_SEND_BATCH_BYTES;
+  self->send_batch_max_latency_ms = DEFAULT_SEND_BATCH_MAX_LATENCY_MS;
+  self->batch = NULL;
+  self->batch_bytes = 0;
+  self->batch_duration = 0;
+  self->batch_timer = NULL;
 
   self->bytes_per_sample = 0;
+  self->sample_format = GST_WS_SAMPLE_FORMAT_UNKNOWN;
   self->frame_size_bytes = 0;
   self->frame_duration = self->frame_duration_ms * GST_MSECOND;
 
   self->base_timestamp = GST_CLOCK_TIME_NONE;
   self->next_timestamp = 0;
+  self->output_offset = 0;
   self->first_timestamp_set = FALSE;
   self->need_segment = FALSE;
 
-  self->recv_queue = g_queue_new();
+  self->recv_ring = NULL;
+  self->recv_waiting = 0;
+  self->recv_adapter = gst_adapter_new();
+  self->recv_buffer_mode = DEFAULT_RECV_BUFFER_MODE;
+  self->recv_buffer_mode_active = DEFAULT_RECV_BUFFER_MODE;
+  self->recv_pool = NULL;
+  self->recv_pool_frame_size = 0;
+
+  self->jitter_mode = DEFAULT_JITTER_MODE;
+  self->min_latency_ms = DEFAULT_MIN_LATENCY_MS;
+  self->max_latency_ms = DEFAULT_MAX_LATENCY_MS;
+  gst_ws_jitter_reset(&self->jitter);
+  self->jitter_us = 0;
+  self->jitter_target_us = 0;
+  self->posted_latency = GST_CLOCK_TIME_NONE;
+  self->fill_mode = DEFAULT_FILL_MODE;
+  self->pacing = DEFAULT_PACING;
+  self->pacing_speed = DEFAULT_PACING_SPEED;
   g_mutex_init(&self->queue_lock);
 
   g_mutex_init(&self->output_lock);
   g_cond_init(&self->output_cond);
+  self->clock_id = NULL;
   self->output_thread_running = FALSE;
   self->ws_thread_running = FALSE;
 
@@ -253,19 +1071,14 @@ gst_websocket_transceiver_init(GstWebSocketTransceiver *self)
   g_cond_init(&self->caps_cond);
   self->caps_ready = FALSE;
 
-  self->session = NULL;
-  self->ws_conn = NULL;
-  self->context = NULL;
-  self->loop = NULL;
-  self->ws_thread = NULL;
+  self->transport = NULL;
   self->output_thread = NULL;
 
-  // statistics counters
-  self->bytes_sent = 0;
-  self->bytes_received = 0;
-  self->buffers_sent = 0;
-  self->buffers_received = 0;
-  self->buffers_dropped = 0;
+  gst_websocket_transceiver_reset_stats(self);
+  self->playout_paused = FALSE;
+  self->framing = DEFAULT_FRAMING;
+  self->framing_active = FALSE;
+  self->barge_in_mode = DEFAULT_BARGE_IN_MODE;
 
   // mark as live source for real-time data production
   GST_OBJECT_FLAG_SET(self, GST_ELEMENT_FLAG_SOURCE);
@@ -277,10 +1090,27 @@ gst_websocket_transceiver_finalize(GObject *object)
   GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(object);
 
   g_free(self->uri);
+  g_free(self->resume_token);
+  g_free(self->thread_name);
+  g_free(self->output_thread_cpus);
+  g_free(self->ws_thread_cpus);
+  g_queue_clear_full(&self->replay_queue, (GDestroyNotify)gst_buffer_unref);
 
   g_mutex_lock(&self->queue_lock);
-  g_queue_free_full(self->recv_queue, (GDestroyNotify)gst_buffer_unref);
+  if (self->recv_ring)
+    gst_ws_ring_free(self->recv_ring, (GDestroyNotify)gst_buffer_unref);
+  g_clear_pointer(&self->budget, gst_ws_budget_leave);
+  g_clear_object(&self->recv_adapter);
+  gst_websocket_transceiver_free_recv_pool_locked(self);
+  g_clear_pointer(&self->opus_decoder, gst_ws_opus_decoder_free);
+  g_clear_pointer(&self->recv_converter, gst_ws_converter_free);
   g_mutex_unlock(&self->queue_lock);
+  g_clear_pointer(&self->opus_encoder, gst_ws_opus_encoder_free);
+  g_clear_pointer(&self->send_converter, gst_ws_converter_free);
+  g_clear_object(&self->encode_adapter);
+  gst_websocket_transceiver_reset_vad(self);
+  gst_ws_vad_clear(&self->vad_state);
+  g_clear_pointer(&self->flight, gst_ws_flight_free);
 
   g_mutex_clear(&self->queue_lock);
   g_mutex_clear(&self->output_lock);
@@ -289,10 +1119,22 @@ gst_websocket_transceiver_finalize(GObject *object)
   g_cond_clear(&self->connect_cond);
   g_cond_clear(&self->queue_cond);
   g_cond_clear(&self->caps_cond);
+  g_mutex_clear(&self->send_lock);
+  g_cond_clear(&self->send_cond);
 
   G_OBJECT_CLASS(parent_class)->finalize(object);
 }
 
+// frames are cut on whole samples so a frame never splits a sample across buffers
+static void
+gst_websocket_transceiver_update_frame_size(GstWebSocketTransceiver *self)
+{
+  guint samples_per_frame = (self->sample_rate * self->frame_duration_ms) / 1000;
+
+  self->frame_size_bytes = samples_per_frame * self->bytes_per_sample * self->channels;
+  self->frame_duration = self->frame_duration_ms * GST_MSECOND;
+}
+
 static void
 gst_websocket_transceiver_set_property(GObject *object, guint prop_id,
     const GValue *value, GParamSpec *pspec)
@@ -306,23 +1148,28 @@ gst_websocket_transceiver_set_property(GObject *object, guint prop_id,
       break;
     case PROP_SAMPLE_RATE:
       self->sample_rate = g_value_get_uint(value);
-      self->frame_size_bytes = (self->sample_rate * self->bytes_per_sample *
-                                self->channels * self->frame_duration_ms) / 1000;
+      gst_websocket_transceiver_update_frame_size(self);
       break;
     case PROP_CHANNELS:
       self->channels = g_value_get_uint(value);
-      self->frame_size_bytes = (self->sample_rate * self->bytes_per_sample *
-                                self->channels * self->frame_duration_ms) / 1000;
+      gst_websocket_transceiver_update_frame_size(self);
       break;
     case PROP_FRAME_DURATION_MS:
       self->frame_duration_ms = g_value_get_uint(value);
-      self->frame_size_bytes = (self->sample_rate * self->bytes_per_sample *
-                                self->channels * self->frame_duration_ms) / 1000;
-      self->frame_duration = self->frame_duration_ms * GST_MSECOND;
+      gst_websocket_transceiver_update_frame_size(self);
       break;
     case PROP_MAX_QUEUE_SIZE:
       self->max_queue_size = g_value_get_uint(value);
       break;
+    case PROP_MAX_QUEUE_BYTES:
+      self->max_queue_bytes = g_value_get_uint(value);
+      break;
+    case PROP_MAX_QUEUE_TIME_MS:
+      self->max_queue_time_ms = g_value_get_uint(value);
+      break;
+    case PROP_PROCESS_MAX_QUEUE_BYTES:
+      gst_ws_budget_set_limit(g_value_get_uint64(value));
+      break;
     case PROP_INITIAL_BUFFER_COUNT:
       self->initial_buffer_count = g_value_get_uint(value);
       break;
@@ -338,12 +1185,214 @@ gst_websocket_transceiver_set_property(GObject *object, guint prop_id,
     case PROP_MAX_RECONNECTS:
       self->max_reconnects = g_value_get_uint(value);
       break;
+    case PROP_ASYNC_CONNECT:
+      self->async_connect = g_value_get_boolean(value);
+      break;
+    case PROP_IO_POOL:
+      self->io_pool = g_value_get_boolean(value);
+      break;
+    case PROP_IO_POOL_SIZE:
+      self->io_pool_size = g_value_get_uint(value);
+      break;
+    case PROP_PREWARM_CONNECTIONS:
+      self->prewarm_connections = g_value_get_uint(value);
+      break;
+    case PROP_MUX:
+      self->mux = g_value_get_boolean(value);
+      break;
+    case PROP_SEND_QUEUE_SIZE:
+      self->send_queue_size = g_value_get_uint(value);
+      break;
+    case PROP_SEND_OVERFLOW:
+      self->send_overflow = g_value_get_enum(value);
+      break;
+    case PROP_SEND_BATCH_MS:
+      self->send_batch_ms = g_value_get_uint(value);
+      break;
+    case PROP_SEND_BATCH_BYTES:
+      self->send_batch_bytes = g_value_get_uint(value);
+      break;
+    case PROP_SEND_BATCH_MAX_LATENCY_MS:
+      self->send_batch_max_latency_ms = g_value_get_uint(value);
+      break;
+    case PROP_RECV_BUFFER_MODE:
+      g_mutex_lock(&self->queue_lock);
+      self->recv_buffer_mode = g_value_get_enum(value);
+      g_mutex_unlock(&self->queue_lock);
+      break;
+    case PROP_JITTER_MODE:
+      self->jitter_mode = g_value_get_enum(value);
+      break;
+    case PROP_MIN_LATENCY_MS:
+      self->min_latency_ms = g_value_get_uint(value);
+      break;
+    case PROP_MAX_LATENCY_MS:
+      self->max_latency_ms = g_value_get_uint(value);
+      break;
+    case PROP_FILL_MODE:
+      self->fill_mode = g_value_get_enum(value);
+      break;
+    case PROP_PACING:
+      self->pacing = g_value_get_enum(value);
+      break;
+    case PROP_PACING_SPEED:
+      self->pacing_speed = g_value_get_double(value);
+      break;
+    case PROP_FRAMING:
+      self->framing = g_value_get_enum(value);
+      break;
+    case PROP_BARGE_IN_MODE:
+      self->barge_in_mode = g_value_get_enum(value);
+      break;
+    case PROP_REPLAY_BUFFER_MS:
+      self->replay_buffer_ms = g_value_get_uint(value);
+      break;
+    case PROP_COMPRESSION:
+      self->compression = g_value_get_boolean(value);
+      break;
+    case PROP_COMPRESSION_WINDOW_BITS:
+      self->compression_window_bits = g_value_get_uint(value);
+      break;
+    case PROP_WIRE_FORMAT:
+      self->wire_format = g_value_get_enum(value);
+      break;
+    case PROP_WIRE_RATE:
+      self->wire_rate = g_value_get_uint(value);
+      break;
+    case PROP_WIRE_CODEC:
+      self->wire_codec = g_value_get_enum(value);
+      break;
+    case PROP_VAD:
+      self->vad = g_value_get_boolean(value);
+      break;
+    case PROP_VAD_THRESHOLD:
+      self->vad_threshold = g_value_get_double(value);
+      break;
+    case PROP_VAD_HANGOVER_MS:
+      self->vad_hangover_ms = g_value_get_uint(value);
+      break;
+    case PROP_VAD_KEEPALIVE_MS:
+      self->vad_keepalive_ms = g_value_get_uint(value);
+      break;
+    case PROP_STATS_INTERVAL_MS:
+      self->stats_interval_ms = g_value_get_uint(value);
+      break;
+    case PROP_TRACE_BUFFER_SIZE:
+      self->trace_buffer_size = g_value_get_uint(value);
+      break;
+    case PROP_THREAD_NAME:
+      g_free(self->thread_name);
+      self->thread_name = g_value_dup_string(value);
+      break;
+    case PROP_OUTPUT_THREAD_PRIORITY:
+      self->output_thread_priority = g_value_get_uint(value);
+      break;
+    case PROP_OUTPUT_THREAD_CPUS:
+      g_free(self->output_thread_cpus);
+      self->output_thread_cpus = g_value_dup_string(value);
+      break;
+    case PROP_WS_THREAD_PRIORITY:
+      self->ws_thread_priority = g_value_get_uint(value);
+      break;
+    case PROP_WS_THREAD_CPUS:
+      g_free(self->ws_thread_cpus);
+      self->ws_thread_cpus = g_value_dup_string(value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
   }
 }
 
+// every value is a relaxed load of a counter its writer keeps updating, so building the
+// structure takes no lock and never holds up the threads being measured. single values
+// are exact, fields next to each other may be a message or a frame apart.
+static GstStructure *
+gst_websocket_transceiver_build_stats(GstWebSocketTransceiver *self)
+{
+  GstStructure *s = gst_structure_new("websocket-stats",
+      "bytes-sent", G_TYPE_UINT64, gst_ws_stat_get(&self->bytes_sent),
+      "bytes-received", G_TYPE_UINT64, gst_ws_stat_get(&self->bytes_received),
+      "buffers-sent", G_TYPE_UINT64, gst_ws_stat_get(&self->buffers_sent),
+      "buffers-received", G_TYPE_UINT64, gst_ws_stat_get(&self->buffers_received),
+      "buffers-dropped", G_TYPE_UINT64, gst_ws_stat_get(&self->buffers_dropped) +
+          gst_ws_stat_get(&self->ws_buffers_dropped) +
+          gst_ws_stat_get(&self->output_buffers_dropped),
+      "payload-bytes-sent", G_TYPE_UINT64, gst_ws_stat_get(&self->payload_bytes_sent),
+      "wire-bytes-sent", G_TYPE_UINT64, gst_ws_stat_get(&self->wire_bytes_sent),
+      "payload-bytes-received", G_TYPE_UINT64, gst_ws_stat_get(&self->bytes_received),
+      "wire-bytes-received", G_TYPE_UINT64, gst_ws_stat_get(&self->wire_bytes_received),
+      "underruns", G_TYPE_UINT64, gst_ws_stat_get(&self->underruns),
+      "underrun-time-us", G_TYPE_UINT64, gst_ws_stat_get(&self->underrun_time_us),
+      "late-frames", G_TYPE_UINT64, gst_ws_stat_get(&self->late_frames),
+      "jitter-us", G_TYPE_UINT64, (guint64)g_atomic_int_get(&self->jitter_us),
+      "output-thread-realtime", G_TYPE_BOOLEAN, g_atomic_int_get(&self->output_realtime),
+      "ws-thread-realtime", G_TYPE_BOOLEAN, g_atomic_int_get(&self->ws_realtime),
+      "output-thread-preemptions", G_TYPE_UINT64, gst_ws_stat_get(&self->output_preemptions),
+      "recv-queue-bytes", G_TYPE_UINT64, gst_ws_budget_get_queued(self->budget),
+      "process-queue-bytes", G_TYPE_UINT64, gst_ws_budget_get_total(),
+      NULL);
+
+  gst_ws_gauge_to_structure(&self->send_queue_depth, s, "send-queue-depth");
+  gst_ws_gauge_to_structure(&self->recv_queue_depth, s, "recv-queue-depth");
+  gst_ws_histogram_to_structure(&self->send_latency, s, "send-latency");
+  gst_ws_histogram_to_structure(&self->interarrival, s, "interarrival");
+  gst_ws_histogram_to_structure(&self->output_lateness, s, "output-lateness");
+  gst_ws_histogram_to_structure(&self->barge_in_latency, s, "barge-in-latency");
+  gst_ws_histogram_to_structure(&self->reconnect_time, s, "reconnect-time");
+  return s;
+}
+
+// the recorder is only replaced on NULL->READY, when no thread that records runs
+static inline void
+gst_websocket_transceiver_flight(GstWebSocketTransceiver *self, GstWsFlightEvent event,
+    guint32 a, guint64 b)
+{
+  if (self->flight)
+    gst_ws_flight_record(self->flight, event, a, b);
+}
+
+// "dump-trace" action signal
+static gchar *
+gst_websocket_transceiver_dump_trace(GstWebSocketTransceiver *self)
+{
+  gchar *dump = NULL;
+
+  GST_OBJECT_LOCK(self);
+  if (self->flight)
+    dump = gst_ws_flight_dump(self->flight);
+  GST_OBJECT_UNLOCK(self);
+  return dump;
+}
+
+// hands the recorded events leading up to a failure to the application
+static void
+gst_websocket_transceiver_post_trace(GstWebSocketTransceiver *self, const gchar *reason)
+{
+  gchar *dump = gst_websocket_transceiver_dump_trace(self);
+
+  if (!dump)
+    return;
+  gst_element_post_message(GST_ELEMENT(self),
+      gst_message_new_element(GST_OBJECT(self),
+          gst_structure_new("websocket-trace",
+              "reason", G_TYPE_STRING, reason,
+              "records", G_TYPE_STRING, dump,
+              NULL)));
+  g_free(dump);
+}
+
+// a buffer or message that will never be sent or played. counter is the calling thread's
+// part of buffers-dropped, or of stale-frames.
+static void
+gst_websocket_transceiver_count_dropped(GstWebSocketTransceiver *self, guint64 *counter,
+    GstWsTraceDirection direction, guint64 count, gsize bytes)
+{
+  gst_ws_stat_add(counter, count);
+  GST_WS_TRACE(self, direction, GST_WS_TRACE_DROPPED, bytes, GST_CLOCK_TIME_NONE);
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_DROPPED, (guint32)count, direction);
+}
+
 static void
 gst_websocket_transceiver_get_property(GObject *object, guint prop_id,
     GValue *value, GParamSpec *pspec)
@@ -366,6 +1415,15 @@ gst_websocket_transceiver_get_property(GObject *object, guint prop_id,
     case PROP_MAX_QUEUE_SIZE:
       g_value_set_uint(value, self->max_queue_size);
       break;
+    case PROP_MAX_QUEUE_BYTES:
+      g_value_set_uint(value, self->max_queue_bytes);
+      break;
+    case PROP_MAX_QUEUE_TIME_MS:
+      g_value_set_uint(value, self->max_queue_time_ms);
+      break;
+    case PROP_PROCESS_MAX_QUEUE_BYTES:
+      g_value_set_uint64(value, gst_ws_budget_get_limit());
+      break;
     case PROP_INITIAL_BUFFER_COUNT:
       g_value_set_uint(value, self->initial_buffer_count);
       break;
@@ -381,51 +1439,290 @@ gst_websocket_transceiver_get_property(GObject *object, guint prop_id,
     case PROP_MAX_RECONNECTS:
       g_value_set_uint(value, self->max_reconnects);
       break;
-    case PROP_BYTES_SENT:
-      g_value_set_uint64(value, self->bytes_sent);
+    case PROP_ASYNC_CONNECT:
+      g_value_set_boolean(value, self->async_connect);
       break;
-    case PROP_BYTES_RECEIVED:
-      g_value_set_uint64(value, self->bytes_received);
+    case PROP_IO_POOL:
+      g_value_set_boolean(value, self->io_pool);
       break;
-    case PROP_BUFFERS_SENT:
-      g_value_set_uint64(value, self->buffers_sent);
+    case PROP_IO_POOL_SIZE:
+      g_value_set_uint(value, self->io_pool_size);
       break;
-    case PROP_BUFFERS_RECEIVED:
-      g_value_set_uint64(value, self->buffers_received);
+    case PROP_PREWARM_CONNECTIONS:
+      g_value_set_uint(value, self->prewarm_connections);
       break;
-    case PROP_BUFFERS_DROPPED:
-      g_value_set_uint64(value, self->buffers_dropped);
+    case PROP_MUX:
+      g_value_set_boolean(value, self->mux);
       break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    case PROP_SEND_QUEUE_SIZE:
+      g_value_set_uint(value, self->send_queue_size);
       break;
-  }
-}
-
-static gboolean
-gst_websocket_transceiver_src_query(GstPad *pad, GstObject *parent, GstQuery *query)
-{
-  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(parent);
-  gboolean ret = TRUE;
-
-  switch (GST_QUERY_TYPE(query)) {
-    case GST_QUERY_LATENCY:
-    {
-      GstClockTime min_latency = self->frame_duration;
-      GstClockTime max_latency = self->frame_duration * self->max_queue_size;
-
-      gst_query_set_latency(query, TRUE, min_latency, max_latency);
-      GST_DEBUG_OBJECT(self, "Reporting latency: min=%" GST_TIME_FORMAT
-          " max=%" GST_TIME_FORMAT,
-          GST_TIME_ARGS(min_latency), GST_TIME_ARGS(max_latency));
+    case PROP_SEND_OVERFLOW:
+      g_value_set_enum(value, self->send_overflow);
       break;
-    }
-    case GST_QUERY_SCHEDULING:
-    {
-      gst_query_set_scheduling(query, GST_SCHEDULING_FLAG_SEQUENTIAL, 1, -1, 0);
-      gst_query_add_scheduling_mode(query, GST_PAD_MODE_PUSH);
+    case PROP_SEND_BATCH_MS:
+      g_value_set_uint(value, self->send_batch_ms);
       break;
-    }
+    case PROP_SEND_BATCH_BYTES:
+      g_value_set_uint(value, self->send_batch_bytes);
+      break;
+    case PROP_SEND_BATCH_MAX_LATENCY_MS:
+      g_value_set_uint(value, self->send_batch_max_latency_ms);
+      break;
+    case PROP_RECV_BUFFER_MODE:
+      g_value_set_enum(value, self->recv_buffer_mode);
+      break;
+    case PROP_JITTER_MODE:
+      g_value_set_enum(value, self->jitter_mode);
+      break;
+    case PROP_MIN_LATENCY_MS:
+      g_value_set_uint(value, self->min_latency_ms);
+      break;
+    case PROP_MAX_LATENCY_MS:
+      g_value_set_uint(value, self->max_latency_ms);
+      break;
+    case PROP_FILL_MODE:
+      g_value_set_enum(value, self->fill_mode);
+      break;
+    case PROP_PACING:
+      g_value_set_enum(value, self->pacing);
+      break;
+    case PROP_PACING_SPEED:
+      g_value_set_double(value, self->pacing_speed);
+      break;
+    case PROP_FRAMING:
+      g_value_set_enum(value, self->framing);
+      break;
+    case PROP_BARGE_IN_MODE:
+      g_value_set_enum(value, self->barge_in_mode);
+      break;
+    case PROP_REPLAY_BUFFER_MS:
+      g_value_set_uint(value, self->replay_buffer_ms);
+      break;
+    case PROP_COMPRESSION:
+      g_value_set_boolean(value, self->compression);
+      break;
+    case PROP_COMPRESSION_WINDOW_BITS:
+      g_value_set_uint(value, self->compression_window_bits);
+      break;
+    case PROP_WIRE_FORMAT:
+      g_value_set_enum(value, self->wire_format);
+      break;
+    case PROP_WIRE_RATE:
+      g_value_set_uint(value, self->wire_rate);
+      break;
+    case PROP_WIRE_CODEC:
+      g_value_set_enum(value, self->wire_codec);
+      break;
+    case PROP_VAD:
+      g_value_set_boolean(value, self->vad);
+      break;
+    case PROP_VAD_THRESHOLD:
+      g_value_set_double(value, self->vad_threshold);
+      break;
+    case PROP_VAD_HANGOVER_MS:
+      g_value_set_uint(value, self->vad_hangover_ms);
+      break;
+    case PROP_VAD_KEEPALIVE_MS:
+      g_value_set_uint(value, self->vad_keepalive_ms);
+      break;
+    case PROP_STATS_INTERVAL_MS:
+      g_value_set_uint(value, self->stats_interval_ms);
+      break;
+    case PROP_TRACE_BUFFER_SIZE:
+      g_value_set_uint(value, self->trace_buffer_size);
+      break;
+    case PROP_THREAD_NAME:
+      g_value_set_string(value, self->thread_name);
+      break;
+    case PROP_OUTPUT_THREAD_PRIORITY:
+      g_value_set_uint(value, self->output_thread_priority);
+      break;
+    case PROP_OUTPUT_THREAD_CPUS:
+      g_value_set_string(value, self->output_thread_cpus);
+      break;
+    case PROP_WS_THREAD_PRIORITY:
+      g_value_set_uint(value, self->ws_thread_priority);
+      break;
+    case PROP_WS_THREAD_CPUS:
+      g_value_set_string(value, self->ws_thread_cpus);
+      break;
+    case PROP_BYTES_SENT:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->bytes_sent));
+      break;
+    case PROP_BYTES_RECEIVED:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->bytes_received));
+      break;
+    case PROP_BUFFERS_SENT:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->buffers_sent));
+      break;
+    case PROP_BUFFERS_RECEIVED:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->buffers_received));
+      break;
+    case PROP_BUFFERS_DROPPED:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->buffers_dropped) +
+          gst_ws_stat_get(&self->ws_buffers_dropped) +
+          gst_ws_stat_get(&self->output_buffers_dropped));
+      break;
+    case PROP_ACTIVE_RECV_BUFFER_MODE:
+      g_mutex_lock(&self->queue_lock);
+      g_value_set_enum(value, self->recv_buffer_mode_active);
+      g_mutex_unlock(&self->queue_lock);
+      break;
+    case PROP_POOL_HITS:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->pool_hits));
+      break;
+    case PROP_POOL_MISSES:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->pool_misses));
+      break;
+    case PROP_JITTER_MS:
+      g_value_set_uint(value, g_atomic_int_get(&self->jitter_us) / 1000);
+      break;
+    case PROP_TARGET_LATENCY_MS:
+      g_value_set_uint(value, g_atomic_int_get(&self->jitter_target_us) / 1000);
+      break;
+    case PROP_SILENCE_TRIMMED:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->silence_trimmed));
+      break;
+    case PROP_FRAMES_FILLED:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->frames_filled));
+      break;
+    case PROP_LATE_FRAMES:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->late_frames));
+      break;
+    case PROP_MAX_LATENESS_US:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->max_lateness) / GST_USECOND);
+      break;
+    case PROP_FRAMING_ACTIVE:
+      g_value_set_boolean(value, self->framing_active);
+      break;
+    case PROP_ONE_WAY_DELAY_US:
+      g_mutex_lock(&self->queue_lock);
+      g_value_set_int64(value, self->one_way_delay_us);
+      g_mutex_unlock(&self->queue_lock);
+      break;
+    case PROP_STALE_FRAMES:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->stale_frames) +
+          gst_ws_stat_get(&self->ws_stale_frames));
+      break;
+    case PROP_BARGE_IN_LATENCY_US:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->barge_in_latency_us));
+      break;
+    case PROP_WARM_CONNECTS:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->warm_connects));
+      break;
+    case PROP_RESUME_TOKEN:
+      g_value_set_string(value, self->resume_token);
+      break;
+    case PROP_BUFFERS_REPLAYED:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->buffers_replayed));
+      break;
+    case PROP_BUFFERS_SUPPRESSED:
+      g_value_set_uint64(value, gst_ws_stat_get(&self->buffers_suppressed));
+      break;
+    case PROP_MUX_STREAM_ID:
+      g_value_set_uint(value, g_atomic_int_get(&self->mux_stream_id));
+      break;
+    case PROP_STATS:
+      g_value_take_boxed(value, gst_websocket_transceiver_build_stats(self));
+      break;
+    case PROP_COMPRESSION_RATIO:
+    {
+      GstWsDeflateStats stats = self->compression_stats;
+      g_value_set_double(value, stats.out_wire > 0 ?
+          (gdouble)stats.out_raw / (gdouble)stats.out_wire : 0.0);
+      break;
+    }
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+// latency comes from how deep the playout buffer is kept, not from how deep it may get.
+// one frame is always held by the pacing, plus the initial reservoir in fixed mode or
+// the jitter target in adaptive mode. the adaptive target is rounded up to whole frames,
+// since that is the granularity the queue actually moves in and it keeps latency
+// messages from firing on every jitter update. max is where the adaptive target may
+// grow to. the receive queue can hold more than that, but audio that deep is either
+// trimmed or dropped, so it is not latency anyone should provision for.
+static void
+gst_websocket_transceiver_get_latency(GstWebSocketTransceiver *self, GstClockTime *min_latency,
+    GstClockTime *max_latency)
+{
+  GstClockTime frame = self->frame_duration;
+  GstClockTime depth, ceiling;
+
+  if (self->jitter_mode == GST_WEBSOCKET_JITTER_ADAPTIVE) {
+    GstClockTime target = (GstClockTime)g_atomic_int_get(&self->jitter_target_us) * GST_USECOND;
+    guint64 frames;
+
+    if (target == 0)
+      target = MAX(frame, self->min_latency_ms * GST_MSECOND);
+    frames = frame > 0 ? (target + frame - 1) / frame : 0;
+    depth = frames * frame;
+    ceiling = MAX(depth, self->max_latency_ms * GST_MSECOND);
+  } else {
+    depth = self->initial_buffer_count * frame;
+    ceiling = depth;
+  }
+
+  *min_latency = frame + depth;
+  *max_latency = frame + ceiling;
+}
+
+// posts a latency message when the minimum latency moved since it was last reported, so
+// the pipeline re-queries and live sinks run at the current depth rather than a guess
+static void
+gst_websocket_transceiver_check_latency(GstWebSocketTransceiver *self)
+{
+  GstClockTime min_latency, max_latency;
+  gboolean changed;
+
+  gst_websocket_transceiver_get_latency(self, &min_latency, &max_latency);
+
+  GST_OBJECT_LOCK(self);
+  changed = GST_CLOCK_TIME_IS_VALID(self->posted_latency) &&
+      self->posted_latency != min_latency;
+  if (changed)
+    self->posted_latency = min_latency;
+  GST_OBJECT_UNLOCK(self);
+
+  if (changed) {
+    GST_INFO_OBJECT(self, "Latency changed to %" GST_TIME_FORMAT,
+        GST_TIME_ARGS(min_latency));
+    gst_element_post_message(GST_ELEMENT(self), gst_message_new_latency(GST_OBJECT(self)));
+  }
+}
+
+static gboolean
+gst_websocket_transceiver_src_query(GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(parent);
+  gboolean ret = TRUE;
+
+  switch (GST_QUERY_TYPE(query)) {
+    case GST_QUERY_LATENCY:
+    {
+      GstClockTime min_latency, max_latency;
+
+      gst_websocket_transceiver_get_latency(self, &min_latency, &max_latency);
+      GST_OBJECT_LOCK(self);
+      self->posted_latency = min_latency;
+      GST_OBJECT_UNLOCK(self);
+
+      gst_query_set_latency(query, TRUE, min_latency, max_latency);
+      GST_DEBUG_OBJECT(self, "Reporting latency: min=%" GST_TIME_FORMAT
+          " max=%" GST_TIME_FORMAT,
+          GST_TIME_ARGS(min_latency), GST_TIME_ARGS(max_latency));
+      break;
+    }
+    case GST_QUERY_SCHEDULING:
+    {
+      gst_query_set_scheduling(query, GST_SCHEDULING_FLAG_SEQUENTIAL, 1, -1, 0);
+      gst_query_add_scheduling_mode(query, GST_PAD_MODE_PUSH);
+      break;
+    }
     default:
       ret = gst_pad_query_default(pad, parent, query);
       break;
@@ -434,6 +1731,76 @@ gst_websocket_transceiver_src_query(GstPad *pad, GstObject *parent, GstQuery *qu
   return ret;
 }
 
+// works out what goes over the socket for the negotiated caps and (re)creates the
+// converters and the Opus codec for it. PCM still waiting for a full packet was cut for
+// the old format, so it is dropped like a partial frame.
+static gboolean
+gst_websocket_transceiver_setup_wire(GstWebSocketTransceiver *self)
+{
+  GstWsConverter *send_converter = NULL, *recv_converter = NULL;
+  GstWsOpusEncoder *encoder = NULL;
+  GstWsOpusDecoder *decoder = NULL;
+  GError *error = NULL;
+
+  gst_adapter_clear(self->encode_adapter);
+  g_clear_pointer(&self->opus_encoder, gst_ws_opus_encoder_free);
+  g_clear_pointer(&self->send_converter, gst_ws_converter_free);
+
+  if (self->wire_format == GST_WEBSOCKET_WIRE_FORMAT_S16LE) {
+    self->wire_sample_format = GST_WS_SAMPLE_FORMAT_S16LE;
+    self->wire_bpf = gst_ws_sample_format_width(GST_WS_SAMPLE_FORMAT_S16LE) * self->channels;
+  } else {
+    self->wire_sample_format = self->sample_format;
+    self->wire_bpf = self->bytes_per_sample * self->channels;
+  }
+  self->wire_sample_rate = self->wire_rate > 0 ? self->wire_rate : self->sample_rate;
+
+  if (self->wire_sample_format != self->sample_format ||
+      self->wire_sample_rate != self->sample_rate) {
+    send_converter = gst_ws_converter_new(self->sample_format, self->sample_rate,
+        self->wire_sample_format, self->wire_sample_rate, self->channels, &error);
+    if (send_converter)
+      recv_converter = gst_ws_converter_new(self->wire_sample_format,
+          self->wire_sample_rate, self->sample_format, self->sample_rate, self->channels,
+          &error);
+    if (!recv_converter)
+      goto failed;
+    GST_INFO_OBJECT(self, "Converting to %u Hz on the wire", self->wire_sample_rate);
+  }
+
+  if (self->wire_codec == GST_WEBSOCKET_WIRE_CODEC_OPUS) {
+    encoder = gst_ws_opus_encoder_new(self->wire_sample_format, self->wire_sample_rate,
+        self->channels, &error);
+    if (encoder)
+      decoder = gst_ws_opus_decoder_new(self->wire_sample_format, self->wire_sample_rate,
+          self->channels, &error);
+    if (!decoder)
+      goto failed;
+    GST_INFO_OBJECT(self, "Opus wire codec, %zu PCM bytes per %d ms packet",
+        gst_ws_opus_encoder_frame_size(encoder), GST_WS_OPUS_FRAME_MS);
+  }
+
+  self->send_converter = send_converter;
+  self->opus_encoder = encoder;
+  g_mutex_lock(&self->queue_lock);
+  g_clear_pointer(&self->recv_converter, gst_ws_converter_free);
+  g_clear_pointer(&self->opus_decoder, gst_ws_opus_decoder_free);
+  self->recv_converter = recv_converter;
+  self->opus_decoder = decoder;
+  g_mutex_unlock(&self->queue_lock);
+  return TRUE;
+
+failed:
+  GST_ELEMENT_ERROR(self, STREAM, FORMAT, ("%s", error->message),
+      ("The negotiated caps cannot be carried with the configured wire-format, wire-rate "
+       "and wire-codec"));
+  g_error_free(error);
+  gst_ws_converter_free(send_converter);
+  gst_ws_converter_free(recv_converter);
+  gst_ws_opus_encoder_free(encoder);
+  return FALSE;
+}
+
 static gboolean
 gst_websocket_transceiver_sink_setcaps(GstWebSocketTransceiver *self, GstCaps *caps)
 {
@@ -452,6 +1819,7 @@ gst_websocket_transceiver_sink_setcaps(GstWebSocketTransceiver *self, GstCaps *c
 
   self->sample_rate = rate;
   self->channels = channels;
+  self->sample_format = gst_ws_sample_format_from_caps(caps);
 
   if (g_str_equal(format_name, "audio/x-raw")) {
     GstAudioInfo info;
@@ -473,9 +1841,14 @@ gst_websocket_transceiver_sink_setcaps(GstWebSocketTransceiver *self, GstCaps *c
     self->bytes_per_sample = 1;
   }
 
-  self->frame_size_bytes = (self->sample_rate * self->bytes_per_sample *
-                            self->channels * self->frame_duration_ms) / 1000;
-  self->frame_duration = self->frame_duration_ms * GST_MSECOND;
+  gst_websocket_transceiver_update_frame_size(self);
+  if (!gst_websocket_transceiver_setup_wire(self))
+    return FALSE;
+
+  // a partial frame buffered under the old format no longer lines up with samples
+  g_mutex_lock(&self->queue_lock);
+  gst_adapter_clear(self->recv_adapter);
+  g_mutex_unlock(&self->queue_lock);
 
   GST_INFO_OBJECT(self, "Caps negotiated: format=%s, rate=%d Hz, channels=%d, "
       "bytes_per_sample=%d, frame_size=%d bytes (%.1f ms)",
@@ -487,6 +1860,7 @@ gst_websocket_transceiver_sink_setcaps(GstWebSocketTransceiver *self, GstCaps *c
     GST_ERROR_OBJECT(self, "Failed to set caps on src pad");
     return FALSE;
   }
+  gst_websocket_transceiver_check_latency(self);
 
   g_mutex_lock(&self->state_lock);
   self->caps_ready = TRUE;
@@ -519,6 +1893,12 @@ gst_websocket_transceiver_sink_event(GstPad *pad, GstObject *parent, GstEvent *e
       ret = TRUE;
       break;
     }
+    case GST_EVENT_FLUSH_STOP:
+      // serialized with chain, which owns the send converter
+      if (self->send_converter)
+        gst_ws_converter_reset(self->send_converter);
+      ret = gst_pad_event_default(pad, parent, event);
+      break;
     default:
       ret = gst_pad_event_default(pad, parent, event);
       break;
@@ -527,26 +1907,172 @@ gst_websocket_transceiver_sink_event(GstPad *pad, GstObject *parent, GstEvent *e
   return ret;
 }
 
+// audio sequence numbers ride in GST_BUFFER_OFFSET while frames sit in the ring, raw
+// audio keeps GST_BUFFER_OFFSET_NONE and is never stale
+static gboolean
+gst_websocket_transceiver_is_stale(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  guint64 seq = GST_BUFFER_OFFSET(buffer);
+
+  return seq != GST_BUFFER_OFFSET_NONE && g_atomic_int_get(&self->epoch_set) &&
+      gst_ws_frame_seq_before((guint32)seq, (guint32)g_atomic_int_get(&self->recv_epoch));
+}
+
+// marks travel through the receive ring as empty buffers carrying their name, so they
+// leave it exactly when the audio received before them does
+static GQuark
+gst_websocket_mark_quark(void)
+{
+  static GQuark quark = 0;
+
+  if (!quark)
+    quark = g_quark_from_static_string("gst-websocket-mark");
+  return quark;
+}
+
+static const gchar *
+gst_websocket_buffer_get_mark(GstBuffer *buffer)
+{
+  return gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(buffer), gst_websocket_mark_quark());
+}
+
+static void
+gst_websocket_transceiver_post_mark(GstWebSocketTransceiver *self, const gchar *mark)
+{
+  gst_element_post_message(GST_ELEMENT(self),
+      gst_message_new_element(GST_OBJECT(self),
+          gst_structure_new("websocket-mark",
+              "name", G_TYPE_STRING, mark,
+              NULL)));
+}
+
+// every pop of the receive ring goes through here, so the budget sees what left it
+static GstBuffer *
+gst_websocket_transceiver_recv_pop(GstWebSocketTransceiver *self)
+{
+  GstBuffer *buffer = gst_ws_ring_pop(self->recv_ring);
+
+  if (buffer)
+    gst_ws_budget_remove(self->budget, gst_buffer_get_size(buffer));
+  return buffer;
+}
+
+static void
+gst_websocket_transceiver_recv_clear(GstWebSocketTransceiver *self)
+{
+  GstBuffer *buffer;
+
+  while ((buffer = gst_websocket_transceiver_recv_pop(self)) != NULL)
+    gst_buffer_unref(buffer);
+}
+
+// a buffer popped to make room. a mark costs no memory but is still what the server
+// waits for: the audio before it is gone, so it is reported as reached rather than lost,
+// unless a clear already discarded its turn.
+static void
+gst_websocket_transceiver_drop_old(GstWebSocketTransceiver *self, GstBuffer *buffer,
+    guint64 *counter)
+{
+  const gchar *mark = gst_websocket_buffer_get_mark(buffer);
+
+  if (!mark) {
+    gst_websocket_transceiver_count_dropped(self, counter, GST_WS_TRACE_RECV, 1,
+        gst_buffer_get_size(buffer));
+  } else if (!gst_websocket_transceiver_is_stale(self, buffer)) {
+    GST_DEBUG_OBJECT(self, "Mark '%s' dropped with the audio before it", mark);
+    gst_websocket_transceiver_post_mark(self, mark);
+  }
+  gst_buffer_unref(buffer);
+}
+
+// drops the oldest audio the process budget asked this queue to give up. counter is the
+// calling thread's part of buffers-dropped.
+static void
+gst_websocket_transceiver_shed(GstWebSocketTransceiver *self, guint64 *counter)
+{
+  guint64 shed = gst_ws_budget_take_shed(self->budget);
+  GstBuffer *dropped;
+
+  if (shed == 0)
+    return;
+
+  GST_WARNING_OBJECT(self, "Process queue budget exceeded, trimming %" G_GUINT64_FORMAT
+      " bytes of old audio", shed);
+  while (shed > 0 && (dropped = gst_websocket_transceiver_recv_pop(self))) {
+    gsize size = gst_buffer_get_size(dropped);
+
+    gst_websocket_transceiver_drop_old(self, dropped, counter);
+    shed -= MIN(shed, size);
+  }
+}
+
+// the receive queue's limit in bytes from max-queue-bytes and max-queue-time-ms, whichever
+// is lower, or 0 for none. queued audio is in the output format, so time is bytes.
+static guint64
+gst_websocket_transceiver_queue_byte_limit(GstWebSocketTransceiver *self)
+{
+  guint64 limit = self->max_queue_bytes;
+
+  if (self->max_queue_time_ms > 0 && self->frame_size_bytes > 0 && self->frame_duration > 0) {
+    guint64 time_limit = gst_util_uint64_scale(self->max_queue_time_ms * GST_MSECOND,
+        self->frame_size_bytes, self->frame_duration);
+
+    limit = limit > 0 ? MIN(limit, time_limit) : time_limit;
+  }
+  return limit;
+}
+
 // barge-in handler: immediately clears all queued audio when the remote signals interruption
 // (e.g., user starts speaking while AI is still playing). the sequence is critical:
 // 1. clear queue to stop pending audio
 // 2. reset timestamps so new audio starts fresh
 // 3. send flush events to notify downstream elements to discard their buffers
 // 4. set need_segment flag so output thread sends a new segment before resuming
+//
+// with binary framing a clear arriving in a control frame carries an epoch, its own
+// sequence number. only audio sent before it is stale: the ring is left alone and the
+// output thread drops frames older than the epoch as it reaches them, together with
+// any stale audio still in flight, while newer audio already queued survives.
+//
+// without downstream set only the element's own queue is emptied: no flush events, and
+// the timeline keeps running, so the next audio plays in the next frame slot.
 static void
-gst_websocket_transceiver_flush_queue(GstWebSocketTransceiver *self)
+gst_websocket_transceiver_flush_queue_full(GstWebSocketTransceiver *self,
+    const GstWsFrameHeader *clear, gboolean downstream)
 {
   GST_INFO_OBJECT(self, "Flushing receive queue (barge-in)");
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_CLEAR,
+      (guint32)g_atomic_int_get(&self->barge_in_epoch), clear ? clear->seq : 0);
 
   g_mutex_lock(&self->queue_lock);
-  while (!g_queue_is_empty(self->recv_queue)) {
-    GstBuffer *buf = g_queue_pop_head(self->recv_queue);
-    gst_buffer_unref(buf);
+  if (clear) {
+    guint64 pending = gst_adapter_prev_offset(self->recv_adapter, NULL);
+
+    g_atomic_int_set(&self->recv_epoch, (gint)clear->seq);
+    g_atomic_int_set(&self->epoch_set, TRUE);
+    if (pending == GST_BUFFER_OFFSET_NONE ||
+        gst_ws_frame_seq_before((guint32)pending, clear->seq))
+      gst_adapter_clear(self->recv_adapter);
+    GST_DEBUG_OBJECT(self, "Clear epoch now %u", clear->seq);
+  } else {
+    gst_websocket_transceiver_recv_clear(self);
+    gst_adapter_clear(self->recv_adapter);
   }
+  // the next response starts a new burst, its first packet must not count as jitter,
+  // and must not be mixed with the filter tail or a partial sample of the old one
+  gst_ws_jitter_reset(&self->jitter);
+  if (self->recv_converter)
+    gst_ws_converter_reset(self->recv_converter);
   g_mutex_unlock(&self->queue_lock);
 
+  if (!downstream) {
+    GST_DEBUG_OBJECT(self, "Queue flushed, timeline kept");
+    return;
+  }
+
   g_mutex_lock(&self->output_lock);
   self->next_timestamp = 0;
+  self->output_offset = 0;
   self->first_timestamp_set = FALSE;
   g_mutex_unlock(&self->output_lock);
 
@@ -561,113 +2087,774 @@ gst_websocket_transceiver_flush_queue(GstWebSocketTransceiver *self)
 }
 
 static void
-on_websocket_message(SoupWebsocketConnection *conn, gint type, GBytes *message,
-    gpointer user_data)
+gst_websocket_transceiver_flush_queue(GstWebSocketTransceiver *self)
 {
-  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
-  GstBuffer *buffer;
-  gconstpointer data;
-  gsize size;
+  gst_websocket_transceiver_flush_queue_full(self, NULL, TRUE);
+}
 
-  data = g_bytes_get_data(message, &size);
+// posts the barge-in latency once no stale sample can leave the element any more. called
+// from the WS thread when the output thread was not pushing, or from the output thread
+// once it has dropped or finished the push that may have been stale; the exchange makes
+// sure only one of them reports.
+static void
+gst_websocket_transceiver_report_barge_in(GstWebSocketTransceiver *self)
+{
+  gint64 latency;
 
-  // text frames are control messages (JSON), not audio data. currently only "clear" is
-  // supported which triggers barge-in flush. binary frames contain raw audio bytes.
-  if (type == SOUP_WEBSOCKET_DATA_TEXT) {
-    GST_DEBUG_OBJECT(self, "Received text message: %.*s", (int)size, (const gchar *)data);
+  if (!g_atomic_int_compare_and_exchange(&self->barge_in_pending, TRUE, FALSE))
+    return;
 
-    JsonParser *parser = json_parser_new();
-    GError *error = NULL;
-    gboolean handled = FALSE;
-
-    if (json_parser_load_from_data(parser, data, size, &error)) {
-      JsonNode *root = json_parser_get_root(parser);
-      if (root && JSON_NODE_HOLDS_OBJECT(root)) {
-        JsonObject *obj = json_node_get_object(root);
-        const gchar *msg_type = json_object_get_string_member_with_default(obj, "type", NULL);
-        if (msg_type && g_strcmp0(msg_type, "clear") == 0) {
-          gst_websocket_transceiver_flush_queue(self);
-          handled = TRUE;
-        }
-      }
-    } else {
-      GST_WARNING_OBJECT(self, "Failed to parse JSON: %s", error->message);
-      g_error_free(error);
-    }
+  latency = MAX(g_get_monotonic_time() - self->barge_in_start_us, 0);
+  gst_ws_stat_set(&self->barge_in_latency_us, (guint64)latency);
+  gst_ws_histogram_record_shared(&self->barge_in_latency, (guint64)latency);
+  GST_DEBUG_OBJECT(self, "Barge-in completed in %" G_GINT64_FORMAT " us", latency);
 
-    if (!handled) {
-      GST_WARNING_OBJECT(self, "Unknown control message: %.*s", (int)size, (const gchar *)data);
-    }
+  gst_element_post_message(GST_ELEMENT(self),
+      gst_message_new_element(GST_OBJECT(self),
+          gst_structure_new("websocket-barge-in",
+              "latency-us", G_TYPE_UINT64, (guint64)latency,
+              "mode", G_TYPE_STRING,
+              self->barge_in_mode == GST_WEBSOCKET_BARGE_IN_FAST ? "fast" : "flush",
+              NULL)));
+}
 
-    g_object_unref(parser);
-    return;
-  }
+static void
+gst_websocket_transceiver_barge_in(GstWebSocketTransceiver *self,
+    const GstWsFrameHeader *clear)
+{
+  // the start time is published by the atomic set that follows it
+  self->barge_in_start_us = g_get_monotonic_time();
+  g_atomic_int_set(&self->barge_in_pending, TRUE);
+  g_atomic_int_inc(&self->barge_in_epoch);
 
-  if (type != SOUP_WEBSOCKET_DATA_BINARY) {
-    GST_WARNING_OBJECT(self, "Received unknown WebSocket message type: %d", type);
-    return;
-  }
+  gst_websocket_transceiver_flush_queue_full(self, clear,
+      self->barge_in_mode == GST_WEBSOCKET_BARGE_IN_FLUSH);
+
+  if (!g_atomic_int_get(&self->output_pushing))
+    gst_websocket_transceiver_report_barge_in(self);
+}
 
-  GST_DEBUG_OBJECT(self, "Received WebSocket message: %zu bytes", size);
+// frames cut from framed audio carry the sequence number of the message their first
+// byte came from, so the epoch check also covers frames that are already queued
+static GstBuffer *
+gst_websocket_transceiver_tag_frame(GstBuffer *buffer, guint64 seq)
+{
+  if (GST_BUFFER_OFFSET(buffer) == seq)
+    return buffer;
 
-  buffer = gst_buffer_new_allocate(NULL, size, NULL);
-  gst_buffer_fill(buffer, 0, data, size);
+  buffer = gst_buffer_make_writable(buffer);
+  GST_BUFFER_OFFSET(buffer) = seq;
+  return buffer;
+}
 
-  g_mutex_lock(&self->queue_lock);
+static void
+gst_websocket_transceiver_enqueue_locked(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  guint limit = MIN(self->max_queue_size, gst_ws_ring_capacity(self->recv_ring));
+  guint64 byte_limit = gst_websocket_transceiver_queue_byte_limit(self);
+  gsize size = gst_buffer_get_size(buffer);
+
+  gst_websocket_transceiver_shed(self, &self->ws_buffers_dropped);
 
   // drop oldest buffers when queue is full. for real-time audio, fresh data is more
   // valuable than stale data - playing outdated audio causes worse user experience
   // than a brief gap. this also prevents memory exhaustion under sustained load.
-  while (g_queue_get_length(self->recv_queue) >= self->max_queue_size) {
-    GstBuffer *dropped = g_queue_pop_head(self->recv_queue);
-    gst_buffer_unref(dropped);
-    self->buffers_dropped++;
-    GST_WARNING_OBJECT(self, "Queue full (%u), dropped old buffer", self->max_queue_size);
+  // popping here races with the output thread popping, the ring's CAS settles that.
+  // the byte limit works the same way, a single buffer above it still gets in.
+  while (gst_ws_ring_length(self->recv_ring) >= limit ||
+         (byte_limit > 0 && gst_ws_ring_length(self->recv_ring) > 0 &&
+          gst_ws_budget_get_queued(self->budget) + size > byte_limit)) {
+    GstBuffer *dropped = gst_websocket_transceiver_recv_pop(self);
+    if (dropped) {
+      // per buffer under sustained overload, buffers-dropped and the flight recorder
+      // already count it
+      GST_WS_HOT_LOG(self, "Queue full (%u buffers, %" G_GUINT64_FORMAT
+          " bytes), dropped old buffer", limit, byte_limit);
+      gst_websocket_transceiver_drop_old(self, dropped, &self->ws_buffers_dropped);
+    }
+  }
+
+  // the offset end carries the time into the ring for the popped trace. receive
+  // buffers are the element's own, no copy is needed to stamp them.
+  if (GST_WS_TRACING()) {
+    GST_BUFFER_OFFSET_END(buffer) = (guint64)g_get_monotonic_time();
+    gst_ws_tracer_report(GST_ELEMENT_CAST(self), GST_WS_TRACE_RECV, GST_WS_TRACE_QUEUED,
+        gst_buffer_get_size(buffer), GST_CLOCK_TIME_NONE);
   }
 
-  g_queue_push_tail(self->recv_queue, buffer);
-  self->bytes_received += size;
-  self->buffers_received++;
-  GST_DEBUG_OBJECT(self, "Queued buffer, queue length: %u",
-      g_queue_get_length(self->recv_queue));
+  // we are the only producer, so after making room the push cannot fail. the bytes are
+  // counted first, a pop of this buffer must not find them missing.
+  gst_ws_budget_add(self->budget, size);
+  gst_ws_ring_push(self->recv_ring, buffer, NULL);
 
-  g_cond_signal(&self->queue_cond);
-  g_mutex_unlock(&self->queue_lock);
+  // the output thread only parks on queue_cond while building its initial reservoir
+  // or, when not paced in realtime, for the next buffer. in a live steady state there
+  // is nothing to signal, and no syscall on the receive path.
+  if (g_atomic_int_get(&self->recv_waiting))
+    g_cond_signal(&self->queue_cond);
 }
 
 static void
-on_websocket_error(SoupWebsocketConnection *conn, GError *error, gpointer user_data)
+gst_websocket_transceiver_free_recv_pool_locked(GstWebSocketTransceiver *self)
 {
-  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
-  (void)conn;
+  if (self->recv_pool) {
+    gst_buffer_pool_set_active(self->recv_pool, FALSE);
+    gst_object_unref(self->recv_pool);
+    self->recv_pool = NULL;
+  }
+  self->recv_pool_frame_size = 0;
+}
 
-  GST_ERROR_OBJECT(self, "WebSocket error: %s", error ? error->message : "unknown");
+// the pool is sized for a full receive queue plus what downstream may hold, and is
+// rebuilt whenever caps change the frame size. buffers still out when it is replaced
+// are simply freed on release.
+static gboolean
+gst_websocket_transceiver_ensure_recv_pool_locked(GstWebSocketTransceiver *self)
+{
+  GstStructure *config;
 
-  // post bus message so applications can react to errors
-  gst_element_post_message(GST_ELEMENT(self),
-      gst_message_new_element(GST_OBJECT(self),
-          gst_structure_new("websocket-error",
-              "error-message", G_TYPE_STRING, error ? error->message : "unknown",
-              NULL)));
+  if (self->recv_pool && self->recv_pool_frame_size == self->frame_size_bytes)
+    return TRUE;
+
+  gst_websocket_transceiver_free_recv_pool_locked(self);
+
+  self->recv_pool = gst_buffer_pool_new();
+  config = gst_buffer_pool_get_config(self->recv_pool);
+  gst_buffer_pool_config_set_params(config, NULL, self->frame_size_bytes, 0,
+      self->max_queue_size + RECV_POOL_HEADROOM);
+  if (!gst_buffer_pool_set_config(self->recv_pool, config) ||
+      !gst_buffer_pool_set_active(self->recv_pool, TRUE)) {
+    GST_WARNING_OBJECT(self, "Failed to set up receive buffer pool");
+    gst_websocket_transceiver_free_recv_pool_locked(self);
+    return FALSE;
+  }
+  self->recv_pool_frame_size = self->frame_size_bytes;
 
-  if (self->loop)
-    g_main_loop_quit(self->loop);
+  GST_DEBUG_OBJECT(self, "Receive buffer pool of %u byte frames ready",
+      self->recv_pool_frame_size);
+  return TRUE;
 }
 
-static void
-on_websocket_closed(SoupWebsocketConnection *conn, gpointer user_data)
+static GstWebSocketRecvBufferMode
+gst_websocket_transceiver_resolve_recv_mode_locked(GstWebSocketTransceiver *self)
 {
-  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
-  guint close_code;
-  const gchar *close_data;
+  GstWebSocketRecvBufferMode mode = self->recv_buffer_mode;
+
+  // a pool needs a fixed buffer size, so until caps give us one we wrap instead
+  if (mode == GST_WEBSOCKET_RECV_BUFFER_AUTO || mode == GST_WEBSOCKET_RECV_BUFFER_POOL) {
+    if (self->frame_size_bytes > 0 && gst_websocket_transceiver_ensure_recv_pool_locked(self))
+      mode = GST_WEBSOCKET_RECV_BUFFER_POOL;
+    else
+      mode = GST_WEBSOCKET_RECV_BUFFER_WRAP;
+  }
 
-  close_code = soup_websocket_connection_get_close_code(conn);
-  close_data = soup_websocket_connection_get_close_data(conn);
+  return mode;
+}
 
-  GST_WARNING_OBJECT(self, "WebSocket connection closed (code: %u, reason: %s)",
-      close_code, close_data ? close_data : "none");
+// in pool mode a full frame is copied once from the adapter into a recycled buffer.
+// in the other modes the adapter hands out a sub-buffer of the message when the frame
+// lies within one message, and only merges when a frame straddles two of them.
+static GstBuffer *
+gst_websocket_transceiver_take_frame_locked(GstWebSocketTransceiver *self, gsize size)
+{
+  GstBufferPoolAcquireParams params = { 0, };
+  GstBuffer *buffer = NULL;
+  GstMapInfo map;
+  guint64 seq = gst_adapter_prev_offset(self->recv_adapter, NULL);
 
-  // post bus message so applications can react to disconnection
+  if (self->recv_buffer_mode_active != GST_WEBSOCKET_RECV_BUFFER_POOL ||
+      !self->recv_pool || size != self->recv_pool_frame_size) {
+    return gst_websocket_transceiver_tag_frame(
+        gst_adapter_take_buffer(self->recv_adapter, size), seq);
+  }
+
+  // never wait for a buffer to come back, that would stall the WebSocket thread
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+  if (gst_buffer_pool_acquire_buffer(self->recv_pool, &buffer, &params) != GST_FLOW_OK) {
+    gst_ws_stat_add(&self->pool_misses, 1);
+    return gst_websocket_transceiver_tag_frame(
+        gst_adapter_take_buffer(self->recv_adapter, size), seq);
+  }
+
+  gst_ws_stat_add(&self->pool_hits, 1);
+  gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+  gst_adapter_copy(self->recv_adapter, map.data, 0, size);
+  gst_buffer_unmap(buffer, &map);
+  gst_adapter_flush(self->recv_adapter, size);
+
+  // released pool buffers keep the last offset they carried
+  GST_BUFFER_OFFSET(buffer) = seq;
+  return buffer;
+}
+
+// servers send audio in whatever message sizes suit them (a 20 ms packet, a 1 s TTS
+// chunk), so incoming bytes are re-cut into frame_size_bytes pieces. that keeps every
+// queued buffer one frame long, which is what the pacing, max-queue-size and
+// initial-buffer-count all assume. with partial set, the trailing bytes are queued too,
+// rounded down to whole samples.
+static void
+gst_websocket_transceiver_drain_adapter_locked(GstWebSocketTransceiver *self,
+    gboolean partial)
+{
+  guint bpf = self->bytes_per_sample * self->channels;
+  gsize available;
+
+  while (self->frame_size_bytes > 0 &&
+         gst_adapter_available(self->recv_adapter) >= self->frame_size_bytes) {
+    gst_websocket_transceiver_enqueue_locked(self,
+        gst_websocket_transceiver_take_frame_locked(self, self->frame_size_bytes));
+  }
+
+  if (!partial)
+    return;
+
+  available = gst_adapter_available(self->recv_adapter);
+  if (bpf > 0)
+    available -= available % bpf;
+  if (available > 0) {
+    guint64 seq = gst_adapter_prev_offset(self->recv_adapter, NULL);
+    gst_websocket_transceiver_enqueue_locked(self, gst_websocket_transceiver_tag_frame(
+        gst_adapter_take_buffer(self->recv_adapter, available), seq));
+  }
+  gst_adapter_clear(self->recv_adapter);
+}
+
+// the estimator runs in every jitter mode so jitter-ms is meaningful even while the
+// fixed playout buffer is in use
+static void
+gst_websocket_transceiver_update_jitter_locked(GstWebSocketTransceiver *self, gsize size)
+{
+  guint bpf = self->bytes_per_sample * self->channels;
+  GstClockTime duration, target;
+
+  if (bpf == 0 || self->sample_rate == 0)
+    return;
+
+  duration = gst_util_uint64_scale_int(size / bpf, GST_SECOND, self->sample_rate);
+  gst_ws_jitter_update(&self->jitter, g_get_monotonic_time(), duration);
+
+  target = gst_ws_jitter_target(&self->jitter, self->frame_duration,
+      self->min_latency_ms * GST_MSECOND, self->max_latency_ms * GST_MSECOND);
+  g_atomic_int_set(&self->jitter_us, (gint)MIN(gst_ws_jitter_get(&self->jitter) / GST_USECOND,
+      G_MAXINT));
+  g_atomic_int_set(&self->jitter_target_us, (gint)(target / GST_USECOND));
+}
+
+static void
+gst_websocket_transceiver_queue_mark(GstWebSocketTransceiver *self, const gchar *name,
+    gsize len, const GstWsFrameHeader *frame)
+{
+  GstBuffer *mark = gst_buffer_new();
+
+  gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(mark), gst_websocket_mark_quark(),
+      g_strndup(name ? name : "", len), g_free);
+
+  g_mutex_lock(&self->queue_lock);
+  // a mark belongs to the turn it was sent in, so a later clear discards it too
+  if (frame)
+    GST_BUFFER_OFFSET(mark) = frame->seq;
+  else if (self->framing_active)
+    GST_BUFFER_OFFSET(mark) = self->last_recv_seq;
+  // a partial frame still in the adapter was received before the mark, so it is queued
+  // first. that costs one short buffer and keeps the mark sample accurate.
+  gst_websocket_transceiver_drain_adapter_locked(self, TRUE);
+  gst_websocket_transceiver_enqueue_locked(self, mark);
+  g_mutex_unlock(&self->queue_lock);
+}
+
+// frame is the header of the control frame when the message came in with binary
+// framing, NULL for a text frame
+static void
+gst_websocket_transceiver_handle_control(GstWebSocketTransceiver *self,
+    const GstWsControlFields *fields, gconstpointer data, gsize size,
+    const GstWsFrameHeader *frame)
+{
+  switch (gst_ws_control_type_lookup(fields->type, fields->type_len)) {
+    case GST_WS_CONTROL_CLEAR:
+      gst_websocket_transceiver_barge_in(self, frame);
+      // an id lets the server tell which of its clears has taken effect
+      if (fields->id) {
+        gchar *id = g_strndup(fields->id, fields->id_len);
+        gst_element_post_message(GST_ELEMENT(self),
+            gst_message_new_element(GST_OBJECT(self),
+                gst_structure_new("websocket-clear",
+                    "id", G_TYPE_STRING, id,
+                    NULL)));
+        g_free(id);
+      }
+      break;
+    case GST_WS_CONTROL_MARK:
+      if (fields->name)
+        gst_websocket_transceiver_queue_mark(self, fields->name, fields->name_len, frame);
+      else
+        gst_websocket_transceiver_queue_mark(self, fields->id, fields->id_len, frame);
+      break;
+    case GST_WS_CONTROL_PAUSE:
+      GST_INFO_OBJECT(self, "Playout paused");
+      g_atomic_int_set(&self->playout_paused, TRUE);
+      break;
+    case GST_WS_CONTROL_RESUME:
+      GST_INFO_OBJECT(self, "Playout resumed");
+      g_atomic_int_set(&self->playout_paused, FALSE);
+      break;
+    default:
+      GST_WARNING_OBJECT(self, "Unknown control message: %.*s", (int)size, (const gchar *)data);
+      break;
+  }
+}
+
+// slow path for whatever the scanner does not take: escaped strings, nested objects
+// (e.g. {"type":"mark","mark":{"name":"..."}}) or invalid JSON
+static void
+gst_websocket_transceiver_parse_control(GstWebSocketTransceiver *self, gconstpointer data,
+    gsize size, const GstWsFrameHeader *frame)
+{
+  JsonParser *parser = json_parser_new();
+  GError *error = NULL;
+  GstWsControlFields fields = { 0, };
+
+  if (!json_parser_load_from_data(parser, data, size, &error)) {
+    GST_WARNING_OBJECT(self, "Failed to parse JSON: %s", error->message);
+    g_error_free(error);
+    g_object_unref(parser);
+    return;
+  }
+
+  JsonNode *root = json_parser_get_root(parser);
+  if (root && JSON_NODE_HOLDS_OBJECT(root)) {
+    JsonObject *obj = json_node_get_object(root);
+
+    fields.type = json_object_get_string_member_with_default(obj, "type", NULL);
+    fields.id = json_object_get_string_member_with_default(obj, "id", NULL);
+    fields.name = json_object_get_string_member_with_default(obj, "name", NULL);
+    if (!fields.name && json_object_has_member(obj, "mark")) {
+      JsonNode *mark = json_object_get_member(obj, "mark");
+      if (JSON_NODE_HOLDS_OBJECT(mark)) {
+        fields.name = json_object_get_string_member_with_default(
+            json_node_get_object(mark), "name", NULL);
+      }
+    }
+    fields.type_len = fields.type ? strlen(fields.type) : 0;
+    fields.id_len = fields.id ? strlen(fields.id) : 0;
+    fields.name_len = fields.name ? strlen(fields.name) : 0;
+  }
+
+  // the fields point into the parser, so dispatch before it goes away
+  gst_websocket_transceiver_handle_control(self, &fields, data, size, frame);
+  g_object_unref(parser);
+}
+
+// control messages are small, flat and few in kind, so a scanner recognizes them in
+// place and only anything it cannot handle pays for a full JsonParser
+static void
+gst_websocket_transceiver_dispatch_control(GstWebSocketTransceiver *self,
+    gconstpointer data, gsize size, const GstWsFrameHeader *frame)
+{
+  GstWsControlFields fields;
+
+  // the payload itself is only logged when it is not understood
+  GST_WS_HOT_DEBUG(self, "Received %zu byte control message", size);
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_CONTROL, (guint32)size, 0);
+
+  if (gst_ws_control_scan(data, size, &fields) &&
+      gst_ws_control_type_lookup(fields.type, fields.type_len) != GST_WS_CONTROL_UNKNOWN)
+    gst_websocket_transceiver_handle_control(self, &fields, data, size, frame);
+  else
+    gst_websocket_transceiver_parse_control(self, data, size, frame);
+}
+
+// smoothed like the jitter estimate, one late packet should not swing the value
+static void
+gst_websocket_transceiver_update_delay_locked(GstWebSocketTransceiver *self,
+    const GstWsFrameHeader *header)
+{
+  gint64 delay;
+
+  // a sender without a usable clock leaves the timestamp at zero
+  if (header->timestamp_us == 0)
+    return;
+
+  delay = g_get_real_time() - header->timestamp_us;
+  if (!self->have_one_way_delay) {
+    self->one_way_delay_us = delay;
+    self->have_one_way_delay = TRUE;
+  } else {
+    self->one_way_delay_us += (delay - self->one_way_delay_us) / 16;
+  }
+}
+
+// the receive side of gst_websocket_transceiver_count_wire_sent, server frames are not
+// masked
+static void
+gst_websocket_transceiver_count_wire_received(GstWebSocketTransceiver *self, gsize size)
+{
+  if (self->deflate) {
+    guint64 before = self->compression_stats.in_wire;
+    gst_ws_deflate_get_stats(self->deflate, &self->compression_stats);
+    size = self->compression_stats.in_wire - before;
+  }
+  gst_ws_stat_add(&self->wire_bytes_received, size + gst_ws_stats_frame_overhead(size, FALSE));
+}
+
+// time between audio messages, the raw material of the jitter estimate. a new connection
+// starts over, the outage is not an interval.
+static void
+gst_websocket_transceiver_count_arrival(GstWebSocketTransceiver *self)
+{
+  gint64 now = g_get_monotonic_time();
+
+  if (self->last_arrival_us != 0)
+    gst_ws_histogram_record(&self->interarrival, (guint64)MAX(now - self->last_arrival_us, 0));
+  self->last_arrival_us = now;
+}
+
+static void
+on_websocket_message(GstWsTransport *transport, gint type, GBytes *message,
+    gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+  GstBuffer *buffer;
+  gconstpointer data;
+  gsize size;
+  GstWsFrameHeader header;
+  GBytes *payload = NULL;
+  gsize pcm_size;
+
+  data = g_bytes_get_data(message, &size);
+  gst_websocket_transceiver_count_wire_received(self, size);
+
+  // text frames are control messages (JSON), not audio data. binary frames contain raw
+  // audio bytes, behind a header when binary framing was negotiated.
+  if (type == SOUP_WEBSOCKET_DATA_TEXT) {
+    gst_websocket_transceiver_dispatch_control(self, data, size, NULL);
+    return;
+  }
+
+  if (type != SOUP_WEBSOCKET_DATA_BINARY) {
+    GST_WARNING_OBJECT(self, "Received unknown WebSocket message type: %d", type);
+    return;
+  }
+
+  if (self->framing_active) {
+    if (!gst_ws_frame_header_parse(data, size, &header)) {
+      GST_WARNING_OBJECT(self, "Dropping malformed %zu byte framed message", size);
+      return;
+    }
+    if (header.type == GST_WS_FRAME_CONTROL) {
+      gst_websocket_transceiver_dispatch_control(self,
+          (const guint8 *)data + GST_WS_FRAME_HEADER_SIZE, header.length, &header);
+      return;
+    }
+    if (header.type != GST_WS_FRAME_AUDIO) {
+      GST_WARNING_OBJECT(self, "Ignoring frame of unknown type %u", header.type);
+      return;
+    }
+    // a sub-range of the message, so wrap mode still does not copy
+    payload = g_bytes_new_from_bytes(message, GST_WS_FRAME_HEADER_SIZE, header.length);
+    message = payload;
+    data = g_bytes_get_data(payload, &size);
+  }
+
+  GST_WS_HOT_DEBUG(self, "Received WebSocket message: %zu bytes", size);
+  GST_WS_TRACE(self, GST_WS_TRACE_RECV, GST_WS_TRACE_RECEIVED, size, GST_CLOCK_TIME_NONE);
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_RECEIVED, (guint32)size,
+      payload ? header.seq : 0);
+
+  g_mutex_lock(&self->queue_lock);
+
+  if (payload) {
+    gst_websocket_transceiver_update_delay_locked(self, &header);
+    if (g_atomic_int_get(&self->epoch_set) &&
+        gst_ws_frame_seq_before(header.seq, (guint32)g_atomic_int_get(&self->recv_epoch))) {
+      GST_WS_HOT_LOG(self, "Dropping audio %u sent before the last clear", header.seq);
+      gst_websocket_transceiver_count_dropped(self, &self->ws_stale_frames,
+          GST_WS_TRACE_RECV, 1, size);
+      g_mutex_unlock(&self->queue_lock);
+      g_bytes_unref(payload);
+      return;
+    }
+    self->last_recv_seq = header.seq;
+  }
+
+  self->recv_buffer_mode_active = gst_websocket_transceiver_resolve_recv_mode_locked(self);
+  if (self->wire_codec == GST_WEBSOCKET_WIRE_CODEC_OPUS) {
+    // the decoder only exists once caps have fixed the format, rate and channels
+    buffer = self->opus_decoder ?
+        gst_ws_opus_decoder_decode(self->opus_decoder, data, size) : NULL;
+    if (!buffer) {
+      GST_WS_HOT_DEBUG(self, "Dropping %zu byte Opus packet that could not be decoded",
+          size);
+      g_mutex_unlock(&self->queue_lock);
+      if (payload)
+        g_bytes_unref(payload);
+      return;
+    }
+  } else if (self->recv_buffer_mode_active == GST_WEBSOCKET_RECV_BUFFER_COPY) {
+    buffer = gst_buffer_new_allocate(NULL, size, NULL);
+    gst_buffer_fill(buffer, 0, data, size);
+  } else {
+    // the buffer keeps the message bytes alive, libsoup never reuses them
+    buffer = gst_buffer_new_wrapped_bytes(message);
+  }
+  // back from the wire format into the caps. the converter keeps a trailing partial
+  // sample, so NULL only means the message was shorter than one sample.
+  if (self->recv_converter) {
+    buffer = gst_ws_converter_process(self->recv_converter, buffer);
+    if (!buffer) {
+      g_mutex_unlock(&self->queue_lock);
+      if (payload)
+        g_bytes_unref(payload);
+      return;
+    }
+  }
+  if (payload)
+    GST_BUFFER_OFFSET(buffer) = header.seq;
+  pcm_size = gst_buffer_get_size(buffer);
+
+  // before caps there is no frame size to cut at, so the message is queued as is
+  if (self->frame_size_bytes == 0) {
+    gst_websocket_transceiver_enqueue_locked(self, buffer);
+  } else {
+    gst_adapter_push(self->recv_adapter, buffer);
+    gst_websocket_transceiver_drain_adapter_locked(self, FALSE);
+  }
+  gst_ws_stat_add(&self->bytes_received, size);
+  gst_ws_stat_add(&self->buffers_received, 1);
+  gst_websocket_transceiver_count_arrival(self);
+  gst_websocket_transceiver_update_jitter_locked(self, pcm_size);
+  GST_WS_HOT_DEBUG(self, "Queued message, queue length: %u",
+      gst_ws_ring_length(self->recv_ring));
+
+  g_mutex_unlock(&self->queue_lock);
+
+  if (payload)
+    g_bytes_unref(payload);
+
+  if (self->jitter_mode == GST_WEBSOCKET_JITTER_ADAPTIVE)
+    gst_websocket_transceiver_check_latency(self);
+}
+
+// posts what permessage-deflate did on the connection that is going away
+static void
+gst_websocket_transceiver_finish_compression(GstWebSocketTransceiver *self)
+{
+  GstWsDeflateStats stats;
+
+  if (!self->deflate)
+    return;
+
+  gst_ws_deflate_get_stats(self->deflate, &stats);
+  self->deflate = NULL;
+  gst_element_post_message(GST_ELEMENT(self),
+      gst_message_new_element(GST_OBJECT(self),
+          gst_structure_new("websocket-compression",
+              "out-raw-bytes", G_TYPE_UINT64, stats.out_raw,
+              "out-wire-bytes", G_TYPE_UINT64, stats.out_wire,
+              "in-raw-bytes", G_TYPE_UINT64, stats.in_raw,
+              "in-wire-bytes", G_TYPE_UINT64, stats.in_wire,
+              NULL)));
+}
+
+static void gst_websocket_transceiver_send_control(GstWebSocketTransceiver *self,
+    const gchar *json);
+
+// cleanup connection safely: we must release state_lock BEFORE calling any soup
+// methods because soup callbacks (on_websocket_closed, etc.) also acquire state_lock.
+// holding the lock while calling soup_websocket_connection_close would deadlock if
+// the close triggers a callback on this same thread.
+static void
+gst_websocket_transceiver_release_connection(GstWebSocketTransceiver *self)
+{
+  gst_websocket_transceiver_finish_compression(self);
+
+  // the shared connection stays, only the stream goes. the server hears about it so it
+  // can end its side of the call.
+  if (self->mux_stream) {
+    gst_websocket_transceiver_send_control(self, MUX_STREAM_CLOSE);
+    gst_ws_mux_stream_close(self->mux_stream);
+    self->mux_stream = NULL;
+    g_atomic_int_set(&self->mux_stream_id, 0);
+    g_mutex_lock(&self->state_lock);
+    self->connected = FALSE;
+    g_mutex_unlock(&self->state_lock);
+    return;
+  }
+
+  g_mutex_lock(&self->state_lock);
+  if (self->transport) {
+    GstWsTransport *transport = self->transport;
+    self->transport = NULL;
+    self->connected = FALSE;
+    g_mutex_unlock(&self->state_lock);
+    gst_ws_transport_close(transport);
+  } else {
+    g_mutex_unlock(&self->state_lock);
+  }
+}
+
+static gboolean
+gst_websocket_transceiver_reconnect_cb(gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  g_source_unref(self->reconnect_source);
+  self->reconnect_source = NULL;
+
+  gst_websocket_transceiver_connect(self);
+  return G_SOURCE_REMOVE;
+}
+
+// the next attempt is a timeout source on the reactor, never a sleep, so the thread
+// keeps serving other connections and teardown can cancel it at any point.
+static void
+gst_websocket_transceiver_schedule_reconnect(GstWebSocketTransceiver *self)
+{
+  guint delay;
+
+  gst_websocket_transceiver_release_connection(self);
+
+  if (!self->ws_thread_running || self->reconnect_source)
+    return;
+
+  self->reconnect_count++;
+  if (!self->reconnect_enabled ||
+      (self->max_reconnects > 0 && self->reconnect_count >= self->max_reconnects)) {
+    GST_WARNING_OBJECT(self, "Connection lost, not reconnecting (attempt %u/%u)",
+        self->reconnect_count, self->max_reconnects);
+    // the session is over: the output thread may drain and send EOS now
+    if (g_atomic_int_get(&self->resuming)) {
+      g_atomic_int_set(&self->resuming, FALSE);
+      gst_websocket_transceiver_clear_replay(self);
+    }
+    return;
+  }
+
+  // exponential backoff: the first attempt uses initial_reconnect_delay_ms, subsequent
+  // attempts double the ceiling up to max_backoff_ms. the actual delay is drawn
+  // uniformly below the ceiling (full jitter), so calls dropped by the same server
+  // restart spread their reconnects out instead of arriving together.
+  guint backoff = self->current_backoff_ms > 0 ?
+                  MIN(self->current_backoff_ms * 2, self->max_backoff_ms) : self->initial_reconnect_delay_ms;
+  self->current_backoff_ms = backoff;
+  delay = (guint)g_random_int_range(0, (gint32)backoff + 1);
+  GST_INFO_OBJECT(self, "Reconnection attempt %u/%u failed, retrying in %u ms (backoff %u ms)",
+                  self->reconnect_count, self->max_reconnects, delay, backoff);
+
+  self->reconnect_source = g_timeout_source_new(delay);
+  g_source_set_callback(self->reconnect_source,
+      gst_websocket_transceiver_reconnect_cb, self, NULL);
+  g_source_attach(self->reconnect_source, gst_ws_reactor_get_context(self->reactor));
+}
+
+// an established connection dropped. with replay-buffer-ms the element keeps acting
+// connected until the reconnect succeeds or gives up, so a short outage only shows up
+// as jitter. a server that closes normally or goes away ended the session on purpose,
+// there is nothing to resume. must run before connected is cleared.
+static void
+gst_websocket_transceiver_begin_resume(GstWebSocketTransceiver *self, guint close_code)
+{
+  if (self->replay_buffer_ms == 0 || !self->reconnect_enabled || !self->ws_thread_running ||
+      !self->transport || g_atomic_int_get(&self->resuming))
+    return;
+  if (close_code == SOUP_WEBSOCKET_CLOSE_NORMAL ||
+      close_code == SOUP_WEBSOCKET_CLOSE_GOING_AWAY) {
+    GST_INFO_OBJECT(self, "Server ended the session (code %u), not resuming", close_code);
+    return;
+  }
+
+  GST_INFO_OBJECT(self, "Connection lost, keeping queues for a resume");
+  g_atomic_int_set(&self->resuming, TRUE);
+}
+
+// called from the soup callbacks once the current connection (or attempt) is over
+static void
+gst_websocket_transceiver_connection_done(GstWebSocketTransceiver *self)
+{
+  gst_websocket_transceiver_schedule_reconnect(self);
+}
+
+static void
+gst_websocket_transceiver_async_done_cb(GstElement *element, gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(element);
+  (void)user_data;
+
+  // READY_TO_NULL clears async_pending under the state lock, so once we hold it the
+  // flag says whether the ASYNC state change is still ours to finish
+  GST_STATE_LOCK(element);
+  if (g_atomic_int_compare_and_exchange(&self->async_pending, TRUE, FALSE)) {
+    GST_INFO_OBJECT(self, "Completing asynchronous state change");
+    gst_element_continue_state(element, GST_STATE_CHANGE_SUCCESS);
+    gst_element_post_message(element,
+        gst_message_new_async_done(GST_OBJECT(element), GST_CLOCK_TIME_NONE));
+  }
+  GST_STATE_UNLOCK(element);
+}
+
+// finishes a pending ASYNC NULL_TO_READY. runs on the reactor, which must not block on
+// the state lock (READY_TO_NULL holds it while waiting for the reactor), so the commit
+// itself happens on a GStreamer worker thread.
+static void
+gst_websocket_transceiver_complete_async(GstWebSocketTransceiver *self)
+{
+  if (self->async_timeout_source) {
+    g_source_destroy(self->async_timeout_source);
+    g_source_unref(self->async_timeout_source);
+    self->async_timeout_source = NULL;
+  }
+  if (g_atomic_int_get(&self->async_pending))
+    gst_element_call_async(GST_ELEMENT(self), gst_websocket_transceiver_async_done_cb,
+        NULL, NULL);
+}
+
+// like the blocking wait, an asynchronous NULL_TO_READY gives up waiting for the first
+// connection after CONNECTION_TIMEOUT_SECONDS and lets reconnects continue in the
+// background
+static gboolean
+gst_websocket_transceiver_async_timeout_cb(gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  GST_WARNING_OBJECT(self, "WebSocket connection timeout, completing state change anyway");
+  g_source_unref(self->async_timeout_source);
+  self->async_timeout_source = NULL;
+  gst_websocket_transceiver_complete_async(self);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_websocket_error(GstWsTransport *transport, const GError *error, gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+  (void)transport;
+
+  GST_ERROR_OBJECT(self, "WebSocket error: %s", error ? error->message : "unknown");
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_ERROR, 0, 0);
+  gst_websocket_transceiver_post_trace(self, "error");
+  gst_websocket_transceiver_begin_resume(self, SOUP_WEBSOCKET_CLOSE_ABNORMAL);
+
+  // post bus message so applications can react to errors
+  gst_element_post_message(GST_ELEMENT(self),
+      gst_message_new_element(GST_OBJECT(self),
+          gst_structure_new("websocket-error",
+              "error-message", G_TYPE_STRING, error ? error->message : "unknown",
+              NULL)));
+
+  gst_websocket_transceiver_connection_done(self);
+}
+
+// the connection, or the element's stream on a shared one, is gone
+static void
+gst_websocket_transceiver_handle_closed(GstWebSocketTransceiver *self, guint close_code,
+    const gchar *close_data)
+{
+  GST_WARNING_OBJECT(self, "WebSocket connection closed (code: %u, reason: %s)",
+      close_code, close_data ? close_data : "none");
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_DISCONNECTED, close_code, 0);
+  if (close_code != SOUP_WEBSOCKET_CLOSE_NORMAL)
+    gst_websocket_transceiver_post_trace(self, "closed");
+
+  // post bus message so applications can react to disconnection
   gst_element_post_message(GST_ELEMENT(self),
       gst_message_new_element(GST_OBJECT(self),
           gst_structure_new("websocket-disconnected",
@@ -675,45 +2862,93 @@ on_websocket_closed(SoupWebsocketConnection *conn, gpointer user_data)
               "close-reason", G_TYPE_STRING, close_data ? close_data : "",
               NULL)));
 
+  // the server will not complete a partial frame any more, queue what there is
+  g_mutex_lock(&self->queue_lock);
+  gst_websocket_transceiver_drain_adapter_locked(self, TRUE);
+  gst_ws_jitter_reset(&self->jitter);
+  g_mutex_unlock(&self->queue_lock);
+  self->last_arrival_us = 0;
+  if (self->disconnected_us == 0)
+    self->disconnected_us = g_get_monotonic_time();
+
+  gst_websocket_transceiver_begin_resume(self, close_code);
+
+  // nobody is left to send "resume", play out what was received. a resumed session
+  // keeps its pause state, the server still knows about it.
+  if (!g_atomic_int_get(&self->resuming))
+    g_atomic_int_set(&self->playout_paused, FALSE);
+
   // mark as disconnected, output thread will drain queue before sending eos
   g_mutex_lock(&self->state_lock);
   self->connected = FALSE;
   g_mutex_unlock(&self->state_lock);
 
-  GST_INFO_OBJECT(self, "WebSocket disconnected, output thread will drain queue and send EOS");
-  if (self->loop)
-    g_main_loop_quit(self->loop);
+  if (!g_atomic_int_get(&self->resuming))
+    GST_INFO_OBJECT(self, "WebSocket disconnected, output thread will drain queue and send EOS");
 }
 
 static void
-on_websocket_connected(GObject *source, GAsyncResult *res, gpointer user_data)
+on_websocket_closed(GstWsTransport *transport, guint close_code, const gchar *reason,
+    gpointer user_data)
 {
   GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+  (void)transport;
+
+  gst_websocket_transceiver_handle_closed(self, close_code, reason);
+  gst_websocket_transceiver_connection_done(self);
+}
+
+static const GstWsTransportCallbacks transport_callbacks = {
+  on_websocket_message,
+  on_websocket_error,
+  on_websocket_closed,
+};
+
+static void
+gst_websocket_transceiver_handle_connect_result(GstWebSocketTransceiver *self,
+    GObject *source, GAsyncResult *res)
+{
   GError *error = NULL;
   SoupWebsocketConnection *conn;
 
   conn = soup_session_websocket_connect_finish(
       SOUP_SESSION(source), res, &error);
 
+  // the attempt was cancelled by READY_TO_NULL, the element is already torn down
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    GST_DEBUG_OBJECT(self, "WebSocket connection attempt cancelled");
+    g_error_free(error);
+    return;
+  }
+
   if (error) {
     GST_ERROR_OBJECT(self, "WebSocket connection failed: %s", error->message);
     g_error_free(error);
-    if (self->loop)
-      g_main_loop_quit(self->loop);
+    gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_ERROR, 0, 0);
+    gst_websocket_transceiver_post_trace(self, "connect-failed");
+    gst_websocket_transceiver_connection_done(self);
     return;
   }
 
   if (!conn) {
     GST_ERROR_OBJECT(self, "WebSocket connection returned NULL without error");
-    if (self->loop)
-      g_main_loop_quit(self->loop);
+    gst_websocket_transceiver_connection_done(self);
     return;
   }
 
-  GST_INFO_OBJECT(self, "WebSocket %sconnected to %s (attempt %u)",
-      (self->reconnect_count > 0 ? "re" : ""), self->uri, self->reconnect_count);
-  GST_DEBUG_OBJECT(self, "Connection state: %d",
-      soup_websocket_connection_get_state(conn));
+  gst_websocket_transceiver_adopt_connection(self, conn);
+}
+
+// posts websocket-connected and resets the per-connection state, common to a private
+// connection and a stream on a shared one
+static void
+gst_websocket_transceiver_begin_connection(GstWebSocketTransceiver *self, gboolean resumed)
+{
+  GST_INFO_OBJECT(self, "WebSocket %sconnected to %s (attempt %u%s)",
+      (self->reconnect_count > 0 ? "re" : ""), self->uri, self->reconnect_count,
+      resumed ? ", resumed" : "");
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_CONNECTED, self->reconnect_count,
+      resumed);
 
   // post bus message so applications can react to connection state changes
   gst_element_post_message(GST_ELEMENT(self),
@@ -721,338 +2956,1728 @@ on_websocket_connected(GObject *source, GAsyncResult *res, gpointer user_data)
           gst_structure_new("websocket-connected",
               "uri", G_TYPE_STRING, self->uri,
               "reconnect-count", G_TYPE_UINT, self->reconnect_count,
+              "resumed", G_TYPE_BOOLEAN, resumed,
               NULL)));
 
-  g_signal_connect(conn, "message",
-      G_CALLBACK(on_websocket_message), self);
-  g_signal_connect(conn, "error",
-      G_CALLBACK(on_websocket_error), self);
-  g_signal_connect(conn, "closed",
-      G_CALLBACK(on_websocket_closed), self);
+  // a fresh connection starts both sequence spaces over. a resumed one continues the
+  // outbound sequence, so replayed audio keeps the numbers it was first sent with.
+  if (!resumed)
+    self->send_seq = 0;
 
-  g_mutex_lock(&self->state_lock);
-  self->ws_conn = conn;
-  self->connected = TRUE;
-  g_cond_signal(&self->connect_cond);
+  memset(&self->compression_stats, 0, sizeof(self->compression_stats));
+  g_mutex_lock(&self->queue_lock);
+  self->last_recv_seq = 0;
+  self->have_one_way_delay = FALSE;
+  g_atomic_int_set(&self->epoch_set, FALSE);
+  g_mutex_unlock(&self->queue_lock);
+}
+
+// the element can send from here on: wakes a blocking NULL_TO_READY, replays or flushes
+// the queue and finishes an asynchronous state change
+static void
+gst_websocket_transceiver_finish_connection(GstWebSocketTransceiver *self,
+    gboolean resumed)
+{
+  g_mutex_lock(&self->state_lock);
+  self->connected = TRUE;
+  g_cond_signal(&self->connect_cond);
   g_mutex_unlock(&self->state_lock);
 
+  // the next outage starts over at initial-reconnect-delay-ms
+  self->current_backoff_ms = 0;
+  if (self->disconnected_us != 0) {
+    gst_ws_histogram_record(&self->reconnect_time,
+        (guint64)MAX(g_get_monotonic_time() - self->disconnected_us, 0));
+    self->disconnected_us = 0;
+  }
+
+  // a resumed session keeps the audio already queued for playout, and the timeline
+  if (resumed) {
+    gst_websocket_transceiver_replay(self);
+    g_atomic_int_set(&self->resuming, FALSE);
+    gst_websocket_transceiver_check_latency(self);
+    gst_websocket_transceiver_complete_async(self);
+    return;
+  }
+
   gst_websocket_transceiver_flush_queue(self);
+  // the jitter estimate starts over on a new connection
+  gst_websocket_transceiver_check_latency(self);
+  gst_websocket_transceiver_complete_async(self);
+}
+
+// takes ownership of an open transport
+static void
+gst_websocket_transceiver_adopt_transport(GstWebSocketTransceiver *self,
+    GstWsTransport *transport)
+{
+  gboolean resumed = g_atomic_int_get(&self->resuming);
+  SoupWebsocketConnection *conn = gst_ws_transport_get_connection(transport);
+
+  gst_websocket_transceiver_begin_connection(self, resumed);
+
+  self->framing_active = self->framing != GST_WEBSOCKET_FRAMING_NONE &&
+      g_strcmp0(gst_ws_transport_get_protocol(transport), GST_WS_FRAME_SUBPROTOCOL) == 0;
+  if (self->framing != GST_WEBSOCKET_FRAMING_NONE && !self->framing_active)
+    GST_WARNING_OBJECT(self, "Server declined binary framing, using raw audio messages");
+
+  // compression is negotiated per connection, so are its statistics
+  self->deflate = conn ? gst_ws_deflate_find(conn) : NULL;
+  if (self->deflate) {
+    gst_ws_deflate_set_window_bits(self->deflate, self->compression_window_bits);
+    GST_INFO_OBJECT(self, "permessage-deflate negotiated");
+  }
+
+  g_mutex_lock(&self->state_lock);
+  self->transport = transport;
+  g_mutex_unlock(&self->state_lock);
+
+  gst_websocket_transceiver_finish_connection(self, resumed);
+}
+
+// takes ownership of an open connection, freshly connected or from the standby pool
+static void
+gst_websocket_transceiver_adopt_connection(GstWebSocketTransceiver *self,
+    SoupWebsocketConnection *conn)
+{
+  GST_DEBUG_OBJECT(self, "Connection state: %d",
+      soup_websocket_connection_get_state(conn));
+  gst_websocket_transceiver_adopt_transport(self,
+      gst_ws_transport_new_soup(conn, &transport_callbacks, self));
+}
+
+// a stream is always framed, the mux subprotocol is framing with stream ids. there is
+// nothing to resume: outbound audio queued for a shared connection is dropped with it.
+static void
+on_mux_stream_opened(GstWsMuxStream *stream, gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  g_atomic_int_set(&self->mux_stream_id, gst_ws_mux_stream_get_id(stream));
+  GST_INFO_OBJECT(self, "Stream %u on the shared connection",
+      gst_ws_mux_stream_get_id(stream));
+  gst_websocket_transceiver_begin_connection(self, FALSE);
+  self->framing_active = TRUE;
+  self->deflate = NULL;
+  gst_websocket_transceiver_send_control(self, MUX_STREAM_OPEN);
+  gst_websocket_transceiver_finish_connection(self, FALSE);
+}
+
+static void
+on_mux_stream_message(GstWsMuxStream *stream, gint type, GBytes *message, gpointer user_data)
+{
+  (void)stream;
+  on_websocket_message(NULL, type, message, user_data);
+}
+
+// the mux reconnects the shared connection itself. until then the element is
+// disconnected like any other, and a stream the server ended stays that way.
+static void
+on_mux_stream_closed(GstWsMuxStream *stream, guint close_code, const gchar *reason,
+    gboolean ended, gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+  (void)stream;
+
+  if (ended)
+    GST_INFO_OBJECT(self, "Stream ended by the server");
+  gst_websocket_transceiver_handle_closed(self, close_code, reason);
+}
+
+static const GstWsMuxStreamCallbacks mux_stream_callbacks = {
+  on_mux_stream_opened,
+  on_mux_stream_message,
+  on_mux_stream_closed,
+};
+
+// attempts hold a ref on the element: a cancelled attempt still completes on the
+// reactor after READY_TO_NULL has returned
+static void
+on_websocket_connected(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  gst_websocket_transceiver_handle_connect_result(self, source, res);
+  gst_object_unref(self);
+}
+
+// subprotocols offered in the handshake. a server that does not know the framing
+// subprotocol simply picks none, and the element falls back to raw audio.
+static gchar **
+gst_websocket_transceiver_protocols(GstWebSocketTransceiver *self)
+{
+  static gchar *framed_protocols[] = { (gchar *)GST_WS_FRAME_SUBPROTOCOL, NULL };
+  static gchar *no_protocols[] = { NULL };
+
+  return self->framing == GST_WEBSOCKET_FRAMING_V1 ? framed_protocols : no_protocols;
+}
+
+// starts one connection attempt. runs on the reactor thread, the result arrives in
+// on_websocket_connected.
+static void
+gst_websocket_transceiver_connect(GstWebSocketTransceiver *self)
+{
+  SoupMessage *msg;
+
+  if (!self->ws_thread_running)
+    return;
+
+  if (self->mux_endpoint) {
+    if (!self->mux_stream)
+      self->mux_stream = gst_ws_mux_stream_open(self->mux_endpoint, &mux_stream_callbacks,
+          self);
+    return;
+  }
+
+  // nothing to wait for, the loopback is open as soon as it exists
+  if (gst_ws_loopback_is_uri(self->uri)) {
+    GError *error = NULL;
+    GstWsTransport *transport = gst_ws_loopback_new(self->uri,
+        gst_websocket_transceiver_protocols(self), gst_ws_reactor_get_context(self->reactor),
+        &transport_callbacks, self, &error);
+
+    if (!transport) {
+      GST_ERROR_OBJECT(self, "Invalid loopback URI %s: %s", self->uri, error->message);
+      g_error_free(error);
+      return;
+    }
+    GST_INFO_OBJECT(self, "Connecting to loopback %s", self->uri);
+    gst_websocket_transceiver_adopt_transport(self, transport);
+    return;
+  }
+
+  // a standby connection has already been through DNS, TCP, TLS and the upgrade. it was
+  // opened without a resume token, so elements with replay-buffer-ms connect themselves.
+  if (self->warm && !self->resume_token) {
+    SoupWebsocketConnection *conn = gst_ws_warm_pool_take(self->warm);
+    if (conn) {
+      GST_INFO_OBJECT(self, "Using standby connection to %s", self->uri);
+      gst_ws_stat_add(&self->warm_connects, 1);
+      gst_websocket_transceiver_adopt_connection(self, conn);
+      return;
+    }
+  }
+
+  msg = soup_message_new(SOUP_METHOD_GET, self->uri);
+  if (!msg) {
+    GST_ERROR_OBJECT(self, "Failed to create SoupMessage for URI: %s", self->uri);
+    return;
+  }
+  if (self->resume_token)
+    soup_message_headers_replace(soup_message_get_request_headers(msg),
+        RESUME_TOKEN_HEADER, self->resume_token);
+  // without the extension manager the handshake offers no extensions at all
+  if (!self->compression)
+    soup_message_disable_feature(msg, SOUP_TYPE_WEBSOCKET_EXTENSION_MANAGER);
+
+  g_clear_object(&self->connect_cancellable);
+  self->connect_cancellable = g_cancellable_new();
+
+  GST_INFO_OBJECT(self, "Connecting to WebSocket URI: %s", self->uri);
+  soup_session_websocket_connect_async(gst_ws_reactor_get_session(self->reactor), msg,
+      NULL, gst_websocket_transceiver_protocols(self), 0, self->connect_cancellable,
+      on_websocket_connected,
+      gst_object_ref(self));
+  g_object_unref(msg);
+}
+
+// the same structure the stats property returns, as the connection messages are posted
+static gboolean
+gst_websocket_transceiver_stats_cb(gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  gst_element_post_message(GST_ELEMENT(self),
+      gst_message_new_element(GST_OBJECT(self), gst_websocket_transceiver_build_stats(self)));
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+gst_websocket_transceiver_start_cb(gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  if (self->stats_interval_ms > 0 && self->ws_thread_running) {
+    self->stats_source = g_timeout_source_new(self->stats_interval_ms);
+    g_source_set_callback(self->stats_source, gst_websocket_transceiver_stats_cb, self, NULL);
+    g_source_attach(self->stats_source, gst_ws_reactor_get_context(self->reactor));
+  }
+
+  if (g_atomic_int_get(&self->async_pending) && self->ws_thread_running) {
+    self->async_timeout_source = g_timeout_source_new_seconds(CONNECTION_TIMEOUT_SECONDS);
+    g_source_set_callback(self->async_timeout_source,
+        gst_websocket_transceiver_async_timeout_cb, self, NULL);
+    g_source_attach(self->async_timeout_source, gst_ws_reactor_get_context(self->reactor));
+  }
+  gst_websocket_transceiver_connect(self);
+  return G_SOURCE_REMOVE;
+}
+
+// runs on the reactor thread via gst_ws_reactor_invoke_sync(), so once it returns no
+// soup callback for this element can be in flight anymore
+static gboolean
+gst_websocket_transceiver_stop_cb(gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  if (self->connect_cancellable) {
+    g_cancellable_cancel(self->connect_cancellable);
+    g_clear_object(&self->connect_cancellable);
+  }
+
+  if (self->reconnect_source) {
+    g_source_destroy(self->reconnect_source);
+    g_source_unref(self->reconnect_source);
+    self->reconnect_source = NULL;
+  }
+
+  if (self->async_timeout_source) {
+    g_source_destroy(self->async_timeout_source);
+    g_source_unref(self->async_timeout_source);
+    self->async_timeout_source = NULL;
+  }
+
+  if (self->stats_source) {
+    g_source_destroy(self->stats_source);
+    g_source_unref(self->stats_source);
+    self->stats_source = NULL;
+  }
+
+  g_atomic_int_set(&self->resuming, FALSE);
+  gst_websocket_transceiver_clear_replay(self);
+
+  if (self->send_source) {
+    g_source_destroy(self->send_source);
+    g_source_unref(self->send_source);
+    self->send_source = NULL;
+  }
+  gst_websocket_transceiver_reset_batch(self);
+
+  gst_websocket_transceiver_release_connection(self);
+  return G_SOURCE_REMOVE;
+}
+
+// filler frames for fill-mode. they are owned by the output thread and recycled: a
+// buffer whose only reference is ours again has been released downstream and can be
+// restamped and pushed once more, so underruns allocate nothing in steady state.
+// silence is written once; comfort noise is rewritten on each use so consecutive
+// frames do not repeat the same pattern at the frame rate. downstream may still hold
+// the memory through a sub-buffer or a shallow copy, so noise goes into fresh memory
+// whenever ours is shared.
+typedef struct
+{
+  GstBuffer *buffers[FILL_BUFFER_COUNT];
+  gsize size;
+  GstWsSampleFormat format;
+  GstWebSocketFillMode mode;
+  guint32 seed;
+} GstWebSocketFiller;
+
+static void
+gst_websocket_filler_clear(GstWebSocketFiller *filler)
+{
+  for (guint i = 0; i < FILL_BUFFER_COUNT; i++) {
+    if (filler->buffers[i]) {
+      gst_buffer_unref(filler->buffers[i]);
+      filler->buffers[i] = NULL;
+    }
+  }
+  filler->size = 0;
+}
+
+static void
+gst_websocket_filler_write(GstWebSocketFiller *filler, GstBuffer *buffer)
+{
+  GstMapInfo map;
+
+  // a silence frame says so, which lets sinks and encoders skip processing it
+  if (filler->mode == GST_WEBSOCKET_FILL_SILENCE)
+    GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_GAP);
+
+  if (!gst_buffer_map(buffer, &map, GST_MAP_WRITE))
+    return;
+  if (filler->mode == GST_WEBSOCKET_FILL_COMFORT_NOISE)
+    gst_ws_audio_fill_noise(filler->format, map.data, map.size, COMFORT_NOISE_AMPLITUDE,
+        &filler->seed);
+  else
+    gst_ws_audio_fill_silence(filler->format, map.data, map.size);
+  gst_buffer_unmap(buffer, &map);
+}
+
+// returns a stamped filler frame to push (the caller owns the returned reference), or
+// NULL if the frame size is not known yet. the buffer is stamped here, while ours is
+// still the only reference to it.
+static GstBuffer *
+gst_websocket_filler_get(GstWebSocketFiller *filler, GstWebSocketTransceiver *self,
+    GstClockTime pts, GstClockTime duration)
+{
+  GstBuffer *buffer = NULL;
+
+  if (self->frame_size_bytes == 0)
+    return NULL;
+
+  // caps or mode changed: everything prepared so far has the wrong size or content
+  if (filler->size != self->frame_size_bytes || filler->format != self->sample_format ||
+      filler->mode != self->fill_mode) {
+    gst_websocket_filler_clear(filler);
+    filler->size = self->frame_size_bytes;
+    filler->format = self->sample_format;
+    filler->mode = self->fill_mode;
+    for (guint i = 0; i < FILL_BUFFER_COUNT; i++) {
+      filler->buffers[i] = gst_buffer_new_allocate(NULL, filler->size, NULL);
+      gst_websocket_filler_write(filler, filler->buffers[i]);
+    }
+  }
+
+  for (guint i = 0; i < FILL_BUFFER_COUNT; i++) {
+    if (GST_MINI_OBJECT_REFCOUNT_VALUE(filler->buffers[i]) == 1) {
+      buffer = filler->buffers[i];
+      break;
+    }
+  }
+
+  if (!buffer) {
+    // every filler is still downstream, fall back to a one-off frame
+    GST_WS_HOT_LOG(self, "All filler buffers in use, allocating one");
+    buffer = gst_buffer_new_allocate(NULL, filler->size, NULL);
+    gst_websocket_filler_write(filler, buffer);
+    GST_BUFFER_PTS(buffer) = pts;
+    GST_BUFFER_DURATION(buffer) = duration;
+    return buffer;
+  }
+
+  if (filler->mode == GST_WEBSOCKET_FILL_COMFORT_NOISE) {
+    if (!gst_buffer_is_all_memory_writable(buffer)) {
+      GST_WS_HOT_LOG(self, "Filler memory still shared downstream, replacing it");
+      gst_buffer_replace_all_memory(buffer, gst_allocator_alloc(NULL, filler->size, NULL));
+    }
+    gst_websocket_filler_write(filler, buffer);
+  }
+  GST_BUFFER_PTS(buffer) = pts;
+  GST_BUFFER_DURATION(buffer) = duration;
+  return gst_buffer_ref(buffer);
+}
+
+// connected, or reconnecting with queues kept for a resume, in which case the element
+// behaves as if the connection never dropped
+static gboolean
+gst_websocket_transceiver_is_live(GstWebSocketTransceiver *self)
+{
+  return g_atomic_int_get(&self->connected) || g_atomic_int_get(&self->resuming);
+}
+
+// adaptive playout. the target depth follows the jitter estimate, bounded by
+// min-latency-ms and max-latency-ms. after an underrun nothing is played until the
+// queue refills to the target, which turns a series of small gaps into one, and the
+// timeline keeps advancing meanwhile so downstream sees a plain gap. when a burst
+// (TTS commonly arrives at several times realtime) leaves the queue deeper than the
+// target, silent frames are dropped until it is back in range. speech is never cut.
+static GstBuffer *
+gst_websocket_transceiver_playout_pop(GstWebSocketTransceiver *self, gboolean *rebuffering)
+{
+  GstClockTime target = (GstClockTime)g_atomic_int_get(&self->jitter_target_us) * GST_USECOND;
+  GstClockTime frame = self->frame_duration;
+  GstBuffer *buffer;
+
+  if (target == 0)
+    target = MAX(frame, self->min_latency_ms * GST_MSECOND);
+
+  if (*rebuffering) {
+    // once the server is gone nothing will top the queue up, play out what is left
+    if (gst_websocket_transceiver_is_live(self) &&
+        gst_ws_ring_length(self->recv_ring) * frame < target)
+      return NULL;
+    *rebuffering = FALSE;
+    GST_WS_HOT_DEBUG(self, "Playout buffer at %u frames, target %" GST_TIME_FORMAT,
+        gst_ws_ring_length(self->recv_ring), GST_TIME_ARGS(target));
+  }
+
+  buffer = gst_websocket_transceiver_recv_pop(self);
+  if (!buffer) {
+    if (gst_websocket_transceiver_is_live(self)) {
+      GST_WS_HOT_DEBUG(self, "Playout buffer underrun, rebuffering");
+      *rebuffering = TRUE;
+    }
+    return NULL;
+  }
+
+  while (gst_ws_ring_length(self->recv_ring) * frame > target + frame &&
+         !gst_websocket_buffer_get_mark(buffer) &&
+         gst_ws_audio_buffer_is_silent(self->sample_format, buffer, SILENCE_THRESHOLD)) {
+    GstBuffer *next = gst_websocket_transceiver_recv_pop(self);
+    if (!next)
+      break;
+    gst_buffer_unref(buffer);
+    buffer = next;
+    gst_ws_stat_add(&self->silence_trimmed, 1);
+  }
+
+  return buffer;
+}
+
+// next buffer to play, or NULL when there is none (or playout is paused). marks are
+// consumed here: reaching one means everything queued before it has been pushed. without
+// rebuffering the adaptive playout buffer is bypassed and the queue played as it is.
+static GstBuffer *
+gst_websocket_transceiver_next_buffer(GstWebSocketTransceiver *self, gboolean *rebuffering)
+{
+  GstBuffer *buffer;
+  const gchar *mark;
+
+  if (g_atomic_int_get(&self->playout_paused))
+    return NULL;
+
+  for (;;) {
+    if (rebuffering && self->jitter_mode == GST_WEBSOCKET_JITTER_ADAPTIVE)
+      buffer = gst_websocket_transceiver_playout_pop(self, rebuffering);
+    else
+      buffer = gst_websocket_transceiver_recv_pop(self);
+
+    if (!buffer)
+      return NULL;
+
+    if (gst_websocket_transceiver_is_stale(self, buffer)) {
+      gst_websocket_transceiver_count_dropped(self, &self->stale_frames, GST_WS_TRACE_RECV,
+          1, gst_buffer_get_size(buffer));
+      gst_buffer_unref(buffer);
+      continue;
+    }
+
+    if (!(mark = gst_websocket_buffer_get_mark(buffer)))
+      return buffer;
+
+    GST_DEBUG_OBJECT(self, "Reached mark '%s'", mark);
+    gst_websocket_transceiver_post_mark(self, mark);
+    gst_buffer_unref(buffer);
+  }
+}
+
+// clock time that stream time takes to play at speed
+static inline GstClockTime
+gst_websocket_transceiver_pace(GstClockTime stream_time, gdouble speed)
+{
+  return speed == 1.0 ? stream_time : (GstClockTime)(stream_time / speed);
+}
+
+// offline, an empty queue means the server has not produced the audio yet, not that it
+// is late. nothing is filled and the timeline stands still until more arrives, so the
+// output holds exactly what the server sent. a scaled schedule resumes from now instead
+// of catching up on the wait.
+static void
+gst_websocket_transceiver_wait_for_data(GstWebSocketTransceiver *self, GstClock *clock,
+    gdouble speed)
+{
+  gint64 wait_until = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
+
+  // while paused there is no signal to wait for, only the timeout
+  g_mutex_lock(&self->queue_lock);
+  if ((gst_ws_ring_length(self->recv_ring) == 0 || g_atomic_int_get(&self->playout_paused)) &&
+      self->output_thread_running) {
+    g_atomic_int_set(&self->recv_waiting, 1);
+    g_cond_wait_until(&self->queue_cond, &self->queue_lock, wait_until);
+    g_atomic_int_set(&self->recv_waiting, 0);
+  }
+  g_mutex_unlock(&self->queue_lock);
+
+  g_mutex_lock(&self->output_lock);
+  if (self->first_timestamp_set) {
+    GstClockTime now = gst_clock_get_time(clock);
+    GstClockTime elapsed = gst_websocket_transceiver_pace(self->next_timestamp, speed);
+
+    if (now > self->base_timestamp + elapsed)
+      self->base_timestamp = now - elapsed;
+  }
+  g_mutex_unlock(&self->output_lock);
+}
+
+// waits on the pipeline clock until deadline. every deadline is derived from the base
+// time and the sample count, never from the previous wait, so neither rounding nor a
+// pipeline clock running at a different rate than the system clock (network, PTP)
+// accumulates into drift. when the thread wakes more than a frame late (a stall, a
+// suspended VM) the schedule is moved forward instead of pushing the backlog in a
+// burst, and the next buffer is marked DISCONT. returns FALSE when the thread must stop.
+static gboolean
+gst_websocket_transceiver_wait_clock(GstWebSocketTransceiver *self, GstClock *clock,
+    GstClockTime deadline, gboolean *discont)
+{
+  GstClockID id;
+  GstClockReturn cret;
+  GstClockTimeDiff lateness = 0;
+  guint64 switches;
+
+  g_mutex_lock(&self->output_lock);
+  if (!self->output_thread_running) {
+    g_mutex_unlock(&self->output_lock);
+    return FALSE;
+  }
+  // reinit refuses an id that belongs to another clock, after a clock change
+  if (self->clock_id && !gst_clock_single_shot_id_reinit(clock, self->clock_id, deadline)) {
+    gst_clock_id_unref(self->clock_id);
+    self->clock_id = NULL;
+  }
+  if (!self->clock_id)
+    self->clock_id = gst_clock_new_single_shot_id(clock, deadline);
+  id = self->clock_id;
+  g_mutex_unlock(&self->output_lock);
+
+  // the id stays alive until this thread frees it on exit, so no extra ref is needed
+  cret = gst_clock_id_wait(id, &lateness);
+  if (cret == GST_CLOCK_UNSCHEDULED || !self->output_thread_running)
+    return FALSE;
+
+  // a rising count next to the lateness means the thread is kept waiting for a core
+  switches = gst_ws_sched_preemptions();
+  gst_ws_stat_add(&self->output_preemptions, switches - self->output_switches);
+  self->output_switches = switches;
+
+  gst_ws_histogram_record(&self->output_lateness,
+      cret == GST_CLOCK_EARLY && lateness > 0 ? (guint64)lateness / GST_USECOND : 0);
+
+  if (cret == GST_CLOCK_EARLY && lateness > 0) {
+    gst_ws_stat_add(&self->late_frames, 1);
+    gst_ws_stat_max(&self->max_lateness, (guint64)lateness);
+    gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_LATE,
+        (guint32)MIN((guint64)lateness / GST_USECOND, G_MAXUINT32), 0);
+
+    if ((GstClockTime)lateness > self->frame_duration) {
+      GST_WARNING_OBJECT(self, "Output %" GST_TIME_FORMAT " behind schedule, resyncing",
+          GST_TIME_ARGS(lateness));
+      g_mutex_lock(&self->output_lock);
+      self->base_timestamp += lateness;
+      g_mutex_unlock(&self->output_lock);
+      *discont = TRUE;
+    }
+  }
+
+  return TRUE;
+}
+
+// moves the output timeline forward by size bytes of audio and returns their duration.
+// timestamps are computed from the running sample count rather than by summing
+// per-buffer durations, so rounding never accumulates and a short final frame gets
+// exactly the duration of the samples it holds. called with output_lock held.
+static GstClockTime
+gst_websocket_transceiver_advance_timeline(GstWebSocketTransceiver *self, gsize size,
+    GstClockTime *pts)
+{
+  guint bpf = self->bytes_per_sample * self->channels;
+  GstClockTime start;
+
+  if (bpf == 0 || self->sample_rate == 0 || size == 0) {
+    if (pts)
+      *pts = self->base_timestamp + self->next_timestamp;
+    self->next_timestamp += self->frame_duration;
+    return self->frame_duration;
+  }
+
+  start = self->next_timestamp;
+  self->output_offset += size / bpf;
+  self->next_timestamp = gst_util_uint64_scale_int(self->output_offset, GST_SECOND,
+      self->sample_rate);
+
+  if (pts)
+    *pts = self->base_timestamp + start;
+  return self->next_timestamp - start;
+}
+
+typedef struct
+{
+  guint64 tid;
+  gint priority;
+} GstWebSocketRtkitRequest;
+
+static void
+gst_websocket_transceiver_rtkit_thread(GTask *task, gpointer source, gpointer task_data,
+    GCancellable *cancellable)
+{
+  GstWebSocketTransceiver *self = source;
+  GstWebSocketRtkitRequest *request = task_data;
+  gboolean realtime = gst_ws_sched_rtkit(G_OBJECT(self), request->tid, request->priority);
+
+  // a thread that already stopped has reported FALSE, and must keep doing so
+  if (realtime && self->output_thread_running)
+    g_atomic_int_set(&self->output_realtime, TRUE);
+  g_task_return_boolean(task, realtime);
+}
+
+// rtkit answers over D-Bus, which may take seconds. the output thread hands the request
+// to a GLib worker and starts playing meanwhile, at normal priority until rtkit is done.
+static void
+gst_websocket_transceiver_request_rtkit(GstWebSocketTransceiver *self, guint64 tid,
+    gint priority)
+{
+  GTask *task = g_task_new(self, NULL, NULL, NULL);
+  GstWebSocketRtkitRequest *request = g_new(GstWebSocketRtkitRequest, 1);
+
+  request->tid = tid;
+  request->priority = priority;
+  g_task_set_task_data(task, request, g_free);
+  g_task_run_in_thread(task, gst_websocket_transceiver_rtkit_thread);
+  g_object_unref(task);
+}
+
+static gpointer
+gst_websocket_transceiver_output_thread(gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+  GstClock *clock;
+  GstClockTime next_output_time;
+  GstClockTime duration;
+  GstClockTime pts;
+  gboolean discont = FALSE;
+  GstWebSocketFiller filler_state = { { NULL, }, 0, GST_WS_SAMPLE_FORMAT_UNKNOWN,
+      GST_WEBSOCKET_FILL_NONE, 0x2545f491 };
+  guint64 rtkit_tid;
+
+  GST_DEBUG_OBJECT(self, "Output thread started");
+  g_atomic_int_set(&self->output_realtime, gst_ws_sched_apply(G_OBJECT(self),
+      (gint)self->output_thread_priority, self->output_thread_cpus, &rtkit_tid));
+  if (rtkit_tid)
+    gst_websocket_transceiver_request_rtkit(self, rtkit_tid,
+        (gint)self->output_thread_priority);
+  self->output_switches = gst_ws_sched_preemptions();
+
+  gchar *stream_id = gst_pad_create_stream_id(self->srcpad, GST_ELEMENT(self), "websocket");
+  gst_pad_push_event(self->srcpad, gst_event_new_stream_start(stream_id));
+  g_free(stream_id);
+
+  gboolean caps_pushed = FALSE;
+  gboolean segment_pushed = FALSE;
+  gboolean timing_initialized = FALSE;
+  GstWebSocketPacing pacing = self->pacing;
+  gdouble speed = pacing == GST_WEBSOCKET_PACING_SCALED ? self->pacing_speed : 1.0;
+  // a playout buffer absorbs network jitter against the clock, offline it only delays
+  gboolean initial_buffering = (pacing == GST_WEBSOCKET_PACING_REALTIME &&
+      self->jitter_mode == GST_WEBSOCKET_JITTER_FIXED && self->initial_buffer_count > 0);
+  gboolean rebuffering = (pacing == GST_WEBSOCKET_PACING_REALTIME &&
+      self->jitter_mode == GST_WEBSOCKET_JITTER_ADAPTIVE);
+  // underrun tracking: the last slot played audio (of played_epoch), or ran dry on it
+  gboolean playing = FALSE;
+  gboolean starving = FALSE;
+  gint played_epoch = 0;
+
+  clock = NULL;
+
+  while (self->output_thread_running) {
+    GstBuffer *buffer = NULL;
+    GstFlowReturn ret;
+    gint epoch;
+    gsize size;
+
+    if (!timing_initialized) {
+      clock = gst_element_get_clock(GST_ELEMENT(self));
+      if (clock) {
+        g_mutex_lock(&self->output_lock);
+        self->base_timestamp = gst_clock_get_time(clock);
+        self->next_timestamp = 0;
+        self->output_offset = 0;
+        self->first_timestamp_set = TRUE;
+        g_mutex_unlock(&self->output_lock);
+        timing_initialized = TRUE;
+        GST_DEBUG_OBJECT(self, "Timing initialized, base_timestamp: %" GST_TIME_FORMAT,
+            GST_TIME_ARGS(self->base_timestamp));
+      } else {
+        gint64 wait_until = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
+        g_mutex_lock(&self->output_lock);
+        g_cond_wait_until(&self->output_cond, &self->output_lock, wait_until);
+        g_mutex_unlock(&self->output_lock);
+        continue;
+      }
+    }
+
+    // wait for initial buffering: accumulate N buffers before starting playback to avoid
+    // audio underruns and clicks at stream start. network jitter can cause gaps if we
+    // start playing immediately, so we build a small buffer reservoir first.
+    if (initial_buffering && self->initial_buffer_count > 0) {
+      g_mutex_lock(&self->queue_lock);
+      guint queue_len = gst_ws_ring_length(self->recv_ring);
+
+      if (queue_len < self->initial_buffer_count) {
+        GST_DEBUG_OBJECT(self, "Initial buffering: %u/%u buffers",
+            queue_len, self->initial_buffer_count);
+        gint64 wait_until = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
+        g_atomic_int_set(&self->recv_waiting, 1);
+        g_cond_wait_until(&self->queue_cond, &self->queue_lock, wait_until);
+        g_atomic_int_set(&self->recv_waiting, 0);
+        g_mutex_unlock(&self->queue_lock);
+        continue;
+      } else {
+        initial_buffering = FALSE;
+        GST_INFO_OBJECT(self, "Initial buffering complete, starting playback with %u buffers",
+            queue_len);
+        g_mutex_unlock(&self->queue_lock);
+      }
+    }
+
+    if (!caps_pushed) {
+      g_mutex_lock(&self->state_lock);
+      if (!self->caps_ready && self->output_thread_running) {
+        gint64 wait_until = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
+        g_cond_wait_until(&self->caps_cond, &self->state_lock, wait_until);
+      }
+      g_mutex_unlock(&self->state_lock);
+
+      GstCaps *caps = gst_pad_get_current_caps(self->srcpad);
+      if (caps) {
+        gst_pad_push_event(self->srcpad, gst_event_new_caps(caps));
+        gst_caps_unref(caps);
+        caps_pushed = TRUE;
+        GST_DEBUG_OBJECT(self, "Caps event pushed");
+      } else {
+        continue;
+      }
+    }
+
+    gboolean force_segment = FALSE;
+    g_mutex_lock(&self->output_lock);
+    if (self->need_segment) {
+        force_segment = TRUE;
+        self->need_segment = FALSE;
+    }
+    g_mutex_unlock(&self->output_lock);
+
+    if ((!segment_pushed || force_segment) && caps_pushed) {
+      GstSegment segment;
+      gst_segment_init(&segment, GST_FORMAT_TIME);
+      gst_pad_push_event(self->srcpad, gst_event_new_segment(&segment));
+      segment_pushed = TRUE;
+      GST_DEBUG_OBJECT(self, "Segment event pushed");
+    }
+
+    g_mutex_lock(&self->state_lock);
+    if (self->eos_sent) {
+      g_mutex_unlock(&self->state_lock);
+      GST_INFO_OBJECT(self, "EOS sent, stopping output thread");
+      break;
+    }
+    g_mutex_unlock(&self->state_lock);
+
+    // paced output: sleep until the pipeline clock reaches the next frame time. this
+    // ensures we push buffers at the actual playback rate rather than as fast as they
+    // arrive from the network. without pacing, downstream would receive bursts of data
+    // that could overflow buffers or cause timing issues with audio sinks. scaled pacing
+    // runs the same schedule on a faster clock, the timestamps stay in stream time.
+    g_mutex_lock(&self->output_lock);
+    if (!self->first_timestamp_set) {
+      // a flush restarted the timeline, restart the schedule from now as well
+      self->base_timestamp = gst_clock_get_time(clock);
+      self->first_timestamp_set = TRUE;
+    }
+    next_output_time = self->base_timestamp +
+        gst_websocket_transceiver_pace(self->frame_duration + self->next_timestamp, speed);
+    g_mutex_unlock(&self->output_lock);
+
+    if (pacing != GST_WEBSOCKET_PACING_NONE &&
+        !gst_websocket_transceiver_wait_clock(self, clock, next_output_time, &discont))
+      break;
+
+    // a queue the process budget picked is trimmed here as well as on the next enqueue:
+    // the server may have gone quiet after the burst
+    gst_websocket_transceiver_shed(self, &self->output_buffers_dropped);
+
+    // read before popping, so a clear landing in between marks the buffer stale
+    epoch = g_atomic_int_get(&self->barge_in_epoch);
+    gst_ws_gauge_record(&self->recv_queue_depth, gst_ws_ring_length(self->recv_ring));
+    buffer = gst_websocket_transceiver_next_buffer(self,
+        pacing == GST_WEBSOCKET_PACING_REALTIME ? &rebuffering : NULL);
+    if (buffer) {
+      GST_WS_HOT_DEBUG(self, "Popped buffer from queue, %u remaining",
+          gst_ws_ring_length(self->recv_ring));
+      if (GST_WS_TRACING() && GST_BUFFER_OFFSET_END_IS_VALID(buffer))
+        gst_ws_tracer_report(GST_ELEMENT_CAST(self), GST_WS_TRACE_RECV, GST_WS_TRACE_POPPED,
+            gst_buffer_get_size(buffer), MAX(g_get_monotonic_time() -
+                (gint64)GST_BUFFER_OFFSET_END(buffer), 0) * GST_USECOND);
+    }
+
+    // eos handling: only send eos after the queue is fully drained AND the websocket is
+    // disconnected. this ensures all received audio is played before signaling end of
+    // stream. if we're still connected, an empty queue just means we're waiting for more
+    // data from the network.
+    if (!buffer) {
+      gboolean should_send_eos = FALSE;
+
+      g_mutex_lock(&self->state_lock);
+      if (!self->connected && !g_atomic_int_get(&self->resuming) && !self->eos_sent) {
+        self->eos_sent = TRUE;
+        should_send_eos = TRUE;
+      }
+      g_mutex_unlock(&self->state_lock);
+
+      if (should_send_eos) {
+        GST_INFO_OBJECT(self, "Queue drained and WebSocket closed, sending EOS");
+        gst_pad_push_event(self->srcpad, gst_event_new_eos());
+        break;
+      }
+
+      if (pacing != GST_WEBSOCKET_PACING_REALTIME) {
+        gst_websocket_transceiver_wait_for_data(self, clock, speed);
+        continue;
+      }
+
+      // advance timestamps even when queue is empty to maintain timing continuity. if we
+      // don't advance, the next buffer would get an old timestamp causing it to appear
+      // late or be dropped by downstream elements. the gap in audio is acceptable, but
+      // the timeline must keep moving forward.
+      GST_WS_HOT_LOG(self, "No data available, skipping");
+      g_mutex_lock(&self->output_lock);
+      duration = gst_websocket_transceiver_advance_timeline(self, self->frame_size_bytes,
+          &pts);
+      g_mutex_unlock(&self->output_lock);
+
+      // an underrun is the queue running dry while audio plays. a clear or a pause empty
+      // it on purpose, and the silence before the first audio is no underrun either.
+      if (g_atomic_int_get(&self->playout_paused) || epoch != played_epoch) {
+        starving = FALSE;
+      } else if (playing) {
+        gst_ws_stat_add(&self->underruns, 1);
+        gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_UNDERRUN, 0, 0);
+        starving = TRUE;
+      }
+      playing = FALSE;
+      if (starving)
+        gst_ws_stat_add(&self->underrun_time_us, duration / GST_USECOND);
+
+      if (self->fill_mode == GST_WEBSOCKET_FILL_GAP_EVENT) {
+        gst_pad_push_event(self->srcpad, gst_event_new_gap(pts, duration));
+        gst_ws_stat_add(&self->frames_filled, 1);
+      } else if (self->fill_mode != GST_WEBSOCKET_FILL_NONE) {
+        GstBuffer *filler = gst_websocket_filler_get(&filler_state, self, pts, duration);
+        if (filler) {
+          gst_ws_stat_add(&self->frames_filled, 1);
+          ret = gst_pad_push(self->srcpad, filler);
+          if (ret == GST_FLOW_EOS || (ret == GST_FLOW_FLUSHING && !self->output_thread_running))
+            break;
+        }
+      }
+      continue;
+    }
+
+    // last check before the push. output_pushing is raised first, so a clear either
+    // sees it and leaves the report to us, or lands before the check and is caught here.
+    // a stale buffer is dropped before it takes a slot on the timeline.
+    g_atomic_int_set(&self->output_pushing, TRUE);
+    if (g_atomic_int_get(&self->barge_in_epoch) != epoch) {
+      g_atomic_int_set(&self->output_pushing, FALSE);
+      GST_WS_HOT_LOG(self, "Dropping buffer popped before a clear");
+      gst_buffer_unref(buffer);
+      gst_websocket_transceiver_report_barge_in(self);
+      continue;
+    }
+
+    g_mutex_lock(&self->output_lock);
+    duration = gst_websocket_transceiver_advance_timeline(self, gst_buffer_get_size(buffer),
+        &pts);
+    g_mutex_unlock(&self->output_lock);
+
+    buffer = gst_buffer_make_writable(buffer);
+    // the offsets carried the sequence number and the trace stamp while queued, they are
+    // not sample offsets
+    GST_BUFFER_OFFSET(buffer) = GST_BUFFER_OFFSET_NONE;
+    GST_BUFFER_OFFSET_END(buffer) = GST_BUFFER_OFFSET_NONE;
+    GST_BUFFER_PTS(buffer) = pts;
+    GST_BUFFER_DURATION(buffer) = duration;
+    if (discont) {
+      GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DISCONT);
+      discont = FALSE;
+    }
+
+    size = gst_buffer_get_size(buffer);
+    ret = gst_pad_push(self->srcpad, buffer);
+    g_atomic_int_set(&self->output_pushing, FALSE);
+    GST_WS_TRACE(self, GST_WS_TRACE_RECV, GST_WS_TRACE_PUSHED, size, GST_CLOCK_TIME_NONE);
+    playing = TRUE;
+    starving = FALSE;
+    played_epoch = epoch;
+    // a clear during the push: that buffer was the last stale audio to leave
+    if (g_atomic_int_get(&self->barge_in_epoch) != epoch)
+      gst_websocket_transceiver_report_barge_in(self);
+    if (ret != GST_FLOW_OK) {
+      GST_WARNING_OBJECT(self, "Error pushing buffer: %s", gst_flow_get_name(ret));
+      // FLUSHING is expected during barge-in because flush_queue() sends flush events
+      // to downstream. we only stop if we're actually shutting down (thread not running)
+      // or if we get a true EOS from downstream.
+      if ((ret == GST_FLOW_FLUSHING && !self->output_thread_running) || ret == GST_FLOW_EOS) {
+        break;
+      }
+    }
+  }
+
+  g_mutex_lock(&self->output_lock);
+  if (self->clock_id) {
+    gst_clock_id_unref(self->clock_id);
+    self->clock_id = NULL;
+  }
+  g_mutex_unlock(&self->output_lock);
+
+  gst_websocket_filler_clear(&filler_state);
+  if (clock) {
+    gst_object_unref(clock);
+  }
+  g_atomic_int_set(&self->output_realtime, FALSE);
+  GST_DEBUG_OBJECT(self, "Output thread stopped");
+  return NULL;
+}
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+} GstWebSocketMappedBuffer;
+
+static void
+gst_websocket_mapped_buffer_free(gpointer data)
+{
+  GstWebSocketMappedBuffer *mapped = data;
+
+  gst_buffer_unmap(mapped->buffer, &mapped->map);
+  gst_buffer_unref(mapped->buffer);
+  g_free(mapped);
+}
+
+// wraps the buffer's memory in a GBytes that keeps the buffer mapped and alive for as
+// long as the bytes are referenced, so the payload reaches libsoup without a copy on
+// our side. takes ownership of the buffer. buffers spanning several GstMemory blocks
+// are merged by gst_buffer_map, which is the only case that still copies here.
+static GBytes *
+gst_websocket_transceiver_buffer_to_bytes(GstBuffer *buffer)
+{
+  GstWebSocketMappedBuffer *mapped = g_new(GstWebSocketMappedBuffer, 1);
+
+  if (!gst_buffer_map(buffer, &mapped->map, GST_MAP_READ)) {
+    g_free(mapped);
+    gst_buffer_unref(buffer);
+    return NULL;
+  }
+  mapped->buffer = buffer;
+
+  return g_bytes_new_with_free_func(mapped->map.data, mapped->map.size,
+      gst_websocket_mapped_buffer_free, mapped);
+}
+
+// companded audio and Opus packets look like noise to deflate, compressing them would
+// only cost CPU. caps can change on a live connection, so this is decided per message.
+static gboolean
+gst_websocket_transceiver_compress_output(GstWebSocketTransceiver *self)
+{
+  return self->compression &&
+      self->wire_codec == GST_WEBSOCKET_WIRE_CODEC_RAW &&
+      self->wire_sample_format != GST_WS_SAMPLE_FORMAT_MULAW &&
+      self->wire_sample_format != GST_WS_SAMPLE_FORMAT_ALAW;
+}
+
+static gboolean
+gst_websocket_transceiver_is_open(GstWebSocketTransceiver *self)
+{
+  if (self->mux_stream)
+    return gst_ws_mux_stream_is_open(self->mux_stream);
+  return self->transport && gst_ws_transport_is_open(self->transport);
+}
+
+// what a sent message took on the wire: its frame header and, with permessage-deflate,
+// its compressed size. the extension counts every message, so the difference since the
+// last look is this one.
+static void
+gst_websocket_transceiver_count_wire_sent(GstWebSocketTransceiver *self, gsize size)
+{
+  if (self->deflate) {
+    guint64 before = self->compression_stats.out_wire;
+    gst_ws_deflate_get_stats(self->deflate, &self->compression_stats);
+    size = self->compression_stats.out_wire - before;
+  }
+  gst_ws_stat_add(&self->wire_bytes_sent, size + gst_ws_stats_frame_overhead(size, TRUE));
+}
+
+// hands a binary message to the connection, or to the shared connection's scheduler,
+// which may drop older messages of this stream while the socket is congested
+static void
+gst_websocket_transceiver_transmit(GstWebSocketTransceiver *self, GBytes *bytes)
+{
+  if (self->mux_stream) {
+    guint dropped = gst_ws_mux_stream_send(self->mux_stream, g_bytes_ref(bytes));
+    if (dropped > 0)
+      gst_websocket_transceiver_count_dropped(self, &self->ws_buffers_dropped,
+          GST_WS_TRACE_SEND, dropped, 0);
+    return;
+  }
+  gst_ws_transport_send(self->transport, SOUP_WEBSOCKET_DATA_BINARY, bytes);
+}
+
+// sends one message on the open connection, consuming the buffer
+static void
+gst_websocket_transceiver_send_message(GstWebSocketTransceiver *self, GstBuffer *buffer,
+    guint32 seq)
+{
+  GBytes *bytes;
+  gsize size;
+  gsize payload = gst_buffer_get_size(buffer);
+  GstClockTime latency = GST_CLOCK_TIME_NONE;
+
+  // from the chain call to the socket, a batch by its oldest buffer. a replay, which
+  // runs before resuming is cleared, sends again what was measured the first time.
+  if (!g_atomic_int_get(&self->resuming) && GST_BUFFER_OFFSET_END_IS_VALID(buffer)) {
+    gint64 since = MAX(g_get_monotonic_time() - (gint64)GST_BUFFER_OFFSET_END(buffer), 0);
+    gst_ws_histogram_record(&self->send_latency, (guint64)since);
+    latency = since * GST_USECOND;
+  }
+
+  // the header is prepended as its own memory, mapping merges it with the audio. that
+  // is one copy per message, the same the batching path already pays.
+  if (self->framing_active) {
+    GstWsFrameHeader header = {
+      .version = GST_WS_FRAME_VERSION,
+      .type = GST_WS_FRAME_AUDIO,
+      .stream = (guint16)self->mux_stream_id,
+      .seq = seq,
+      .timestamp_us = g_get_real_time(),
+      .length = gst_buffer_get_size(buffer),
+    };
+    guint8 *data = g_malloc(GST_WS_FRAME_HEADER_SIZE);
+
+    gst_ws_frame_header_write(&header, data);
+    buffer = gst_buffer_make_writable(buffer);
+    gst_buffer_prepend_memory(buffer, gst_memory_new_wrapped(0, data,
+        GST_WS_FRAME_HEADER_SIZE, 0, GST_WS_FRAME_HEADER_SIZE, data, g_free));
+  }
+
+  bytes = gst_websocket_transceiver_buffer_to_bytes(buffer);
+  if (!bytes)
+    return;
+
+  size = g_bytes_get_size(bytes);
+  GST_WS_HOT_LOG(self, "Sending %zu bytes over WebSocket", size);
+
+  // the only remaining copy is libsoup building the masked frame, or compressing it
+  if (self->deflate)
+    gst_ws_deflate_set_enabled(self->deflate, gst_websocket_transceiver_compress_output(self));
+  gst_websocket_transceiver_transmit(self, bytes);
+  gst_websocket_transceiver_count_wire_sent(self, size);
+
+  gst_ws_stat_add(&self->bytes_sent, size);
+  gst_ws_stat_add(&self->buffers_sent, 1);
+  gst_ws_stat_add(&self->payload_bytes_sent, payload);
+  GST_WS_TRACE(self, GST_WS_TRACE_SEND, GST_WS_TRACE_SENT, size, latency);
+  gst_websocket_transceiver_flight(self, GST_WS_FLIGHT_SENT, (guint32)size, seq);
+
+  g_bytes_unref(bytes);
+}
+
+// audio duration of an outbound buffer. the size is exact for every supported format and
+// also holds for batches, whose duration field only covers their first buffer. Opus
+// packets are never batched and carry their duration.
+static GstClockTime
+gst_websocket_transceiver_send_duration(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  guint bpf = self->wire_bpf;
+
+  if (self->wire_codec == GST_WEBSOCKET_WIRE_CODEC_OPUS)
+    return GST_CLOCK_TIME_IS_VALID(GST_BUFFER_DURATION(buffer)) ?
+        GST_BUFFER_DURATION(buffer) : 0;
+  if (bpf > 0 && self->wire_sample_rate > 0)
+    return gst_util_uint64_scale(gst_buffer_get_size(buffer) / bpf, GST_SECOND,
+        self->wire_sample_rate);
+  return GST_CLOCK_TIME_IS_VALID(GST_BUFFER_DURATION(buffer)) ? GST_BUFFER_DURATION(buffer) : 0;
+}
+
+// appends a buffer to the replay history and trims it to replay-buffer-ms. trimmed
+// buffers that were never sent are lost for good and count as dropped.
+static void
+gst_websocket_transceiver_retain_for_replay(GstWebSocketTransceiver *self,
+    GstBuffer *buffer)
+{
+  GstClockTime limit = self->replay_buffer_ms * GST_MSECOND;
+
+  g_queue_push_tail(&self->replay_queue, buffer);
+  self->replay_duration += gst_websocket_transceiver_send_duration(self, buffer);
+
+  while (self->replay_duration > limit && self->replay_queue.length > 1) {
+    GstBuffer *oldest = g_queue_pop_head(&self->replay_queue);
+    GstClockTime duration = gst_websocket_transceiver_send_duration(self, oldest);
+
+    self->replay_duration -= MIN(duration, self->replay_duration);
+    if (self->replay_queue.length < self->replay_unsent) {
+      self->replay_unsent--;
+      gst_websocket_transceiver_count_dropped(self, &self->ws_buffers_dropped,
+          GST_WS_TRACE_SEND, 1, gst_buffer_get_size(oldest));
+    }
+    gst_buffer_unref(oldest);
+  }
+}
+
+static void
+gst_websocket_transceiver_clear_replay(GstWebSocketTransceiver *self)
+{
+  if (self->replay_unsent > 0)
+    gst_websocket_transceiver_count_dropped(self, &self->ws_buffers_dropped,
+        GST_WS_TRACE_SEND, self->replay_unsent, 0);
+  g_queue_clear_full(&self->replay_queue, (GDestroyNotify)gst_buffer_unref);
+  g_queue_init(&self->replay_queue);
+  self->replay_duration = 0;
+  self->replay_unsent = 0;
+}
+
+// sends the history on a resumed connection. nothing acknowledges audio, so what was
+// sent just before the drop may or may not have arrived: with framing every buffer goes
+// out again with its original sequence number and the server discards duplicates. raw
+// audio has no sequence number, a server would play it twice, so only the buffers that
+// were never sent go out.
+static void
+gst_websocket_transceiver_replay(GstWebSocketTransceiver *self)
+{
+  GList *l = self->replay_queue.head;
+
+  GST_INFO_OBJECT(self, "Replaying %u buffers (%" GST_TIME_FORMAT ", %u never sent)",
+      self->framing_active ? self->replay_queue.length : self->replay_unsent,
+      GST_TIME_ARGS(self->replay_duration), self->replay_unsent);
+
+  // the unsent buffers are the newest
+  if (!self->framing_active) {
+    for (guint skip = self->replay_queue.length - self->replay_unsent; skip > 0; skip--)
+      l = l->next;
+  }
+  for (; l; l = l->next) {
+    GstBuffer *buffer = l->data;
+
+    gst_websocket_transceiver_send_message(self, gst_buffer_ref(buffer),
+        (guint32)GST_BUFFER_OFFSET(buffer));
+    gst_ws_stat_add(&self->buffers_replayed, 1);
+  }
+  self->replay_unsent = 0;
+}
+
+// outbound control messages travel through the send ring as empty buffers carrying
+// their JSON, so they reach the server in order with the audio around them
+static GQuark
+gst_websocket_control_quark(void)
+{
+  static GQuark quark = 0;
+
+  if (!quark)
+    quark = g_quark_from_static_string("gst-websocket-control");
+  return quark;
+}
+
+static const gchar *
+gst_websocket_buffer_get_control(GstBuffer *buffer)
+{
+  return gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(buffer),
+      gst_websocket_control_quark());
+}
+
+// a control message is sent as a text message, or as a control frame with binary
+// framing. it describes the stream as it is now, so it is neither kept for a replay
+// nor worth sending late: one that finds the connection down is dropped.
+static void
+gst_websocket_transceiver_send_control(GstWebSocketTransceiver *self, const gchar *json)
+{
+  gsize len = strlen(json);
+
+  if (!gst_websocket_transceiver_is_open(self)) {
+    GST_WS_HOT_LOG(self, "WebSocket not open, dropping control message %s", json);
+    return;
+  }
+
+  GST_WS_HOT_DEBUG(self, "Sending control message %s", json);
+  if (self->deflate)
+    gst_ws_deflate_set_enabled(self->deflate, self->compression);
+  if (self->framing_active) {
+    GstWsFrameHeader header = {
+      .version = GST_WS_FRAME_VERSION,
+      .type = GST_WS_FRAME_CONTROL,
+      .stream = (guint16)self->mux_stream_id,
+      .seq = self->send_seq++,
+      .timestamp_us = g_get_real_time(),
+      .length = len,
+    };
+    guint8 *data = g_malloc(GST_WS_FRAME_HEADER_SIZE + len);
+    GBytes *bytes;
+
+    gst_ws_frame_header_write(&header, data);
+    memcpy(data + GST_WS_FRAME_HEADER_SIZE, json, len);
+    bytes = g_bytes_new_take(data, GST_WS_FRAME_HEADER_SIZE + len);
+    gst_websocket_transceiver_transmit(self, bytes);
+    g_bytes_unref(bytes);
+    gst_websocket_transceiver_count_wire_sent(self, GST_WS_FRAME_HEADER_SIZE + len);
+  } else {
+    GBytes *bytes = g_bytes_new(json, len);
+
+    gst_ws_transport_send(self->transport, SOUP_WEBSOCKET_DATA_TEXT, bytes);
+    g_bytes_unref(bytes);
+    gst_websocket_transceiver_count_wire_sent(self, len);
+  }
+}
+
+// WS-thread side of the send path. only this thread touches the transport, so no lock or
+// connection ref is needed per buffer.
+static void
+gst_websocket_transceiver_send_buffer(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  const gchar *control = gst_websocket_buffer_get_control(buffer);
+  gboolean open = gst_websocket_transceiver_is_open(self);
+
+  if (control) {
+    gst_websocket_transceiver_send_control(self, control);
+    gst_buffer_unref(buffer);
+    return;
+  }
+
+  if (!open && (self->replay_buffer_ms == 0 || !g_atomic_int_get(&self->resuming))) {
+    GST_WS_HOT_LOG(self, "WebSocket not open, dropping queued buffer");
+    gst_websocket_transceiver_count_dropped(self, &self->ws_buffers_dropped,
+        GST_WS_TRACE_SEND, 1, gst_buffer_get_size(buffer));
+    gst_buffer_unref(buffer);
+    return;
+  }
+
+  if (self->replay_buffer_ms == 0) {
+    gst_websocket_transceiver_send_message(self, buffer, self->send_seq++);
+    return;
+  }
+
+  // the sequence number is assigned once and kept for a replay. the queued buffer stays
+  // free of the frame header because sending makes a writable copy of it first.
+  buffer = gst_buffer_make_writable(buffer);
+  GST_BUFFER_OFFSET(buffer) = self->send_seq++;
+  if (!open) {
+    self->replay_unsent++;
+    gst_websocket_transceiver_retain_for_replay(self, buffer);
+    return;
+  }
+  gst_websocket_transceiver_retain_for_replay(self, gst_buffer_ref(buffer));
+  gst_websocket_transceiver_send_message(self, buffer, (guint32)GST_BUFFER_OFFSET(buffer));
+}
+
+static void
+gst_websocket_transceiver_clear_batch_timer(GstWebSocketTransceiver *self)
+{
+  if (self->batch_timer) {
+    g_source_destroy(self->batch_timer);
+    g_source_unref(self->batch_timer);
+    self->batch_timer = NULL;
+  }
+}
+
+static void
+gst_websocket_transceiver_flush_batch(GstWebSocketTransceiver *self)
+{
+  GstBuffer *batch = self->batch;
+
+  gst_websocket_transceiver_clear_batch_timer(self);
+  if (!batch)
+    return;
+
+  self->batch = NULL;
+  self->batch_bytes = 0;
+  self->batch_duration = 0;
+
+  // the batch is a list of the original memories, mapping it is the single copy that
+  // turns it into one contiguous frame
+  gst_websocket_transceiver_send_buffer(self, batch);
+}
+
+// drops a pending batch without sending it, for teardown
+static void
+gst_websocket_transceiver_reset_batch(GstWebSocketTransceiver *self)
+{
+  gst_websocket_transceiver_clear_batch_timer(self);
+  if (self->batch) {
+    gst_buffer_unref(self->batch);
+    self->batch = NULL;
+  }
+  self->batch_bytes = 0;
+  self->batch_duration = 0;
+}
+
+static gboolean
+gst_websocket_transceiver_batch_timeout_cb(gpointer user_data)
+{
+  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
+
+  GST_WS_HOT_LOG(self, "Batch latency cap reached, sending %zu bytes", self->batch_bytes);
+  gst_websocket_transceiver_flush_batch(self);
+  return G_SOURCE_REMOVE;
+}
+
+// a batch would merge several Opus packets into one message, which no decoder can split
+static gboolean
+gst_websocket_transceiver_batching_enabled(GstWebSocketTransceiver *self)
+{
+  return (self->send_batch_ms > 0 || self->send_batch_bytes > 0) &&
+      self->wire_codec == GST_WEBSOCKET_WIRE_CODEC_RAW;
 }
 
-static gpointer
-gst_websocket_transceiver_ws_thread(gpointer user_data)
+static gboolean
+gst_websocket_batch_timer_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
 {
-  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
-
-  GST_DEBUG_OBJECT(self, "WebSocket thread started");
-
-  self->context = g_main_context_new();
-  g_main_context_push_thread_default(self->context);
+  return callback(user_data);
+}
 
-  while (self->ws_thread_running && self->reconnect_enabled && (self->max_reconnects == 0 || self->reconnect_count < self->max_reconnects)) {
-    self->session = soup_session_new();
-    self->loop = g_main_loop_new(self->context, FALSE);
+// a source that fires at a monotonic time to the microsecond, set with ready time
+static GSourceFuncs gst_websocket_batch_timer_funcs = {
+  NULL, NULL,
+  gst_websocket_batch_timer_dispatch,
+  NULL, NULL, NULL,
+};
 
-    SoupMessage *msg = soup_message_new(SOUP_METHOD_GET, self->uri);
-    if (!msg) {
-      GST_ERROR_OBJECT(self, "Failed to create SoupMessage for URI: %s", self->uri);
-      g_object_unref(self->session);
-      self->session = NULL;
-      g_main_loop_unref(self->loop);
-      self->loop = NULL;
-      break;
-    }
+// coalesces small upstream buffers (typically 10-20 ms packets) into one frame, which
+// saves a frame header, a masking pass and a syscall per buffer on both ends. a batch
+// is sent when it holds send-batch-ms of audio or send-batch-bytes, and in any case
+// once its first buffer has waited send-batch-max-latency-ms. the wait counts from the
+// chain call, which stamped the buffer, so time spent in the send ring is included.
+static void
+gst_websocket_transceiver_batch_buffer(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  gsize size = gst_buffer_get_size(buffer);
+  GstClockTime duration = GST_BUFFER_DURATION(buffer);
+  guint bpf = self->wire_bpf;
+  gint64 deadline = 0;
 
-    gchar *protocols[] = {NULL};
-    GST_INFO_OBJECT(self, "Connecting to WebSocket URI: %s", self->uri);
-    soup_session_websocket_connect_async(self->session, msg, NULL, protocols, 0,
-        NULL, on_websocket_connected, self);
+  if (!GST_CLOCK_TIME_IS_VALID(duration))
+    duration = (bpf > 0 && self->wire_sample_rate > 0) ?
+        gst_util_uint64_scale(size / bpf, GST_SECOND, self->wire_sample_rate) : 0;
 
-    g_main_loop_run(self->loop);
+  if (self->batch) {
+    self->batch = gst_buffer_append(self->batch, buffer);
+  } else {
+    deadline = (GST_BUFFER_OFFSET_END_IS_VALID(buffer) ?
+        (gint64)GST_BUFFER_OFFSET_END(buffer) : g_get_monotonic_time()) +
+        (gint64)self->send_batch_max_latency_ms * G_TIME_SPAN_MILLISECOND;
+    self->batch = buffer;
+    self->batch_timer = g_source_new(&gst_websocket_batch_timer_funcs, sizeof(GSource));
+    g_source_set_ready_time(self->batch_timer, deadline);
+    g_source_set_callback(self->batch_timer,
+        gst_websocket_transceiver_batch_timeout_cb, self, NULL);
+    g_source_attach(self->batch_timer, self->send_context);
+  }
+  self->batch_bytes += size;
+  self->batch_duration += duration;
+
+  // a first buffer that already waited out the cap in the ring goes at once
+  if ((self->send_batch_ms > 0 && self->batch_duration >= self->send_batch_ms * GST_MSECOND) ||
+      (self->send_batch_bytes > 0 && self->batch_bytes >= self->send_batch_bytes) ||
+      (deadline > 0 && deadline <= g_get_monotonic_time()))
+    gst_websocket_transceiver_flush_batch(self);
+}
 
-    g_main_loop_unref(self->loop);
-    self->loop = NULL;
-    g_object_unref(self->session);
-    self->session = NULL;
+static void
+gst_websocket_transceiver_drain_send_ring(GstWebSocketTransceiver *self)
+{
+  GstBuffer *buffer;
+  guint sent = 0;
+  gboolean batching = gst_websocket_transceiver_batching_enabled(self);
 
-    // cleanup connection safely: we must release state_lock BEFORE calling any soup
-    // methods because soup callbacks (on_websocket_closed, etc.) also acquire state_lock.
-    // holding the lock while calling soup_websocket_connection_close would deadlock if
-    // the close triggers a callback on this same thread.
-    g_mutex_lock(&self->state_lock);
-    if (self->ws_conn) {
-      SoupWebsocketConnection *conn = self->ws_conn;
-      self->ws_conn = NULL;
-      self->connected = FALSE;
-      g_mutex_unlock(&self->state_lock);
-      SoupWebsocketState state = soup_websocket_connection_get_state(conn);
-      if (state == SOUP_WEBSOCKET_STATE_OPEN) {
-        soup_websocket_connection_close(conn, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
-      }
-      g_object_unref(conn);
+  while (sent < SEND_DRAIN_BATCH && (buffer = gst_ws_ring_pop(self->send_ring)) != NULL) {
+    if (batching && !gst_websocket_buffer_get_control(buffer)) {
+      gst_websocket_transceiver_batch_buffer(self, buffer);
     } else {
-      g_mutex_unlock(&self->state_lock);
+      // audio batched before a control message goes out ahead of it
+      if (self->batch)
+        gst_websocket_transceiver_flush_batch(self);
+      gst_websocket_transceiver_send_buffer(self, buffer);
     }
-
-    // backoff for next attempt (skip if shutting down)
-    if (!self->ws_thread_running)
-      break;
-
-    // exponential backoff: first attempt uses initial_reconnect_delay_ms, subsequent
-    // attempts double the delay up to max_backoff_ms ceiling. this prevents hammering
-    // the server during outages while still recovering quickly from brief disconnects.
-    self->reconnect_count++;
-    guint backoff = self->current_backoff_ms > 0 ?
-                    MIN(self->current_backoff_ms * 2, self->max_backoff_ms) : self->initial_reconnect_delay_ms;
-    self->current_backoff_ms = backoff;
-    GST_INFO_OBJECT(self, "Reconnection attempt %u/%u failed, backoff %u ms",
-                    self->reconnect_count, self->max_reconnects, backoff);
-    g_usleep(backoff * G_TIME_SPAN_MILLISECOND);
+    sent++;
+  }
+  if (!batching && self->batch)
+    gst_websocket_transceiver_flush_batch(self);
+
+  // only a producer blocked by the block overflow policy needs to hear about the space
+  if (sent > 0 && g_atomic_int_get(&self->send_waiting)) {
+    g_mutex_lock(&self->send_lock);
+    g_cond_signal(&self->send_cond);
+    g_mutex_unlock(&self->send_lock);
   }
-
-  g_main_context_pop_thread_default(self->context);
-  g_main_context_unref(self->context);
-  self->context = NULL;
-
-  GST_DEBUG_OBJECT(self, "WebSocket thread stopped");
-  return NULL;
 }
 
-static gpointer
-gst_websocket_transceiver_output_thread(gpointer user_data)
+typedef struct
 {
-  GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(user_data);
-  GstClock *clock;
-  GstClockTime next_output_time;
-  GstClockTime now;
-
-  GST_DEBUG_OBJECT(self, "Output thread started");
+  GSource source;
+  GstWebSocketTransceiver *self;
+} GstWebSocketSendSource;
 
-  gchar *stream_id = gst_pad_create_stream_id(self->srcpad, GST_ELEMENT(self), "websocket");
-  gst_pad_push_event(self->srcpad, gst_event_new_stream_start(stream_id));
-  g_free(stream_id);
+// the send source is ready whenever the ring holds buffers. chain wakes the context
+// (an eventfd on Linux) only on the empty -> non-empty transition, after that the
+// source stays ready until the ring is drained.
+static gboolean
+gst_websocket_send_source_prepare(GSource *source, gint *timeout)
+{
+  GstWebSocketSendSource *send_source = (GstWebSocketSendSource *)source;
 
-  gboolean caps_pushed = FALSE;
-  gboolean segment_pushed = FALSE;
-  gboolean timing_initialized = FALSE;
-  gboolean initial_buffering = (self->initial_buffer_count > 0);
+  *timeout = -1;
+  return gst_ws_ring_length(send_source->self->send_ring) > 0;
+}
 
-  clock = NULL;
-  next_output_time = 0;
+static gboolean
+gst_websocket_send_source_check(GSource *source)
+{
+  GstWebSocketSendSource *send_source = (GstWebSocketSendSource *)source;
 
-  while (self->output_thread_running) {
-    GstBuffer *buffer = NULL;
-    GstFlowReturn ret;
+  return gst_ws_ring_length(send_source->self->send_ring) > 0;
+}
 
-    if (!timing_initialized) {
-      clock = gst_element_get_clock(GST_ELEMENT(self));
-      if (clock) {
-        g_mutex_lock(&self->output_lock);
-        self->base_timestamp = gst_clock_get_time(clock);
-        self->next_timestamp = 0;
-        self->first_timestamp_set = TRUE;
-        next_output_time = self->base_timestamp + self->frame_duration;
-        g_mutex_unlock(&self->output_lock);
-        timing_initialized = TRUE;
-        GST_DEBUG_OBJECT(self, "Timing initialized, base_timestamp: %" GST_TIME_FORMAT,
-            GST_TIME_ARGS(self->base_timestamp));
-      } else {
-        gint64 wait_until = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
-        g_mutex_lock(&self->output_lock);
-        g_cond_wait_until(&self->output_cond, &self->output_lock, wait_until);
-        g_mutex_unlock(&self->output_lock);
-        continue;
-      }
-    }
+static gboolean
+gst_websocket_send_source_dispatch(GSource *source, GSourceFunc callback,
+    gpointer user_data)
+{
+  GstWebSocketSendSource *send_source = (GstWebSocketSendSource *)source;
 
-    // wait for initial buffering: accumulate N buffers before starting playback to avoid
-    // audio underruns and clicks at stream start. network jitter can cause gaps if we
-    // start playing immediately, so we build a small buffer reservoir first.
-    if (initial_buffering && self->initial_buffer_count > 0) {
-      g_mutex_lock(&self->queue_lock);
-      guint queue_len = g_queue_get_length(self->recv_queue);
+  gst_websocket_transceiver_drain_send_ring(send_source->self);
+  return G_SOURCE_CONTINUE;
+}
 
-      if (queue_len < self->initial_buffer_count) {
-        GST_DEBUG_OBJECT(self, "Initial buffering: %u/%u buffers",
-            queue_len, self->initial_buffer_count);
-        gint64 wait_until = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
-        g_cond_wait_until(&self->queue_cond, &self->queue_lock, wait_until);
-        g_mutex_unlock(&self->queue_lock);
-        continue;
-      } else {
-        initial_buffering = FALSE;
-        GST_INFO_OBJECT(self, "Initial buffering complete, starting playback with %u buffers",
-            queue_len);
-        g_mutex_unlock(&self->queue_lock);
-      }
-    }
+static GSourceFuncs gst_websocket_send_source_funcs = {
+  gst_websocket_send_source_prepare,
+  gst_websocket_send_source_check,
+  gst_websocket_send_source_dispatch,
+  NULL, NULL, NULL,
+};
 
-    if (!caps_pushed) {
-      g_mutex_lock(&self->state_lock);
-      if (!self->caps_ready && self->output_thread_running) {
-        gint64 wait_until = g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND;
-        g_cond_wait_until(&self->caps_cond, &self->state_lock, wait_until);
-      }
-      g_mutex_unlock(&self->state_lock);
+static GSource *
+gst_websocket_transceiver_send_source_new(GstWebSocketTransceiver *self)
+{
+  GSource *source = g_source_new(&gst_websocket_send_source_funcs,
+      sizeof(GstWebSocketSendSource));
 
-      GstCaps *caps = gst_pad_get_current_caps(self->srcpad);
-      if (caps) {
-        gst_pad_push_event(self->srcpad, gst_event_new_caps(caps));
-        gst_caps_unref(caps);
-        caps_pushed = TRUE;
-        GST_DEBUG_OBJECT(self, "Caps event pushed");
-      } else {
-        continue;
-      }
-    }
+  ((GstWebSocketSendSource *)source)->self = self;
+  g_source_set_name(source, "websocket-send");
+  return source;
+}
 
-    gboolean force_segment = FALSE;
-    g_mutex_lock(&self->output_lock);
-    if (self->need_segment) {
-        force_segment = TRUE;
-        self->need_segment = FALSE;
-    }
-    g_mutex_unlock(&self->output_lock);
+// block overflow policy: wait for the WS thread to drain. waits are sliced so a flush
+// or shutdown (pad deactivation sets FLUSHING before taking the stream lock) is noticed.
+static GstFlowReturn
+gst_websocket_transceiver_wait_send_space(GstWebSocketTransceiver *self, guint limit)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
 
-    if ((!segment_pushed || force_segment) && caps_pushed) {
-      GstSegment segment;
-      gst_segment_init(&segment, GST_FORMAT_TIME);
-      gst_pad_push_event(self->srcpad, gst_event_new_segment(&segment));
-      segment_pushed = TRUE;
-      GST_DEBUG_OBJECT(self, "Segment event pushed");
+  g_mutex_lock(&self->send_lock);
+  g_atomic_int_set(&self->send_waiting, 1);
+  while (gst_ws_ring_length(self->send_ring) >= limit) {
+    if (GST_PAD_IS_FLUSHING(self->sinkpad)) {
+      ret = GST_FLOW_FLUSHING;
+      break;
     }
-
-    g_mutex_lock(&self->state_lock);
-    if (self->eos_sent) {
-      g_mutex_unlock(&self->state_lock);
-      GST_INFO_OBJECT(self, "EOS sent, stopping output thread");
+    if (!gst_websocket_transceiver_is_live(self)) {
+      ret = GST_FLOW_CUSTOM_SUCCESS;
       break;
     }
-    g_mutex_unlock(&self->state_lock);
+    g_cond_wait_until(&self->send_cond, &self->send_lock,
+        g_get_monotonic_time() + 20 * G_TIME_SPAN_MILLISECOND);
+  }
+  g_atomic_int_set(&self->send_waiting, 0);
+  g_mutex_unlock(&self->send_lock);
 
-    // paced output: sleep until the pipeline clock reaches the next frame time. this
-    // ensures we push buffers at the actual playback rate rather than as fast as they
-    // arrive from the network. without pacing, downstream would receive bursts of data
-    // that could overflow buffers or cause timing issues with audio sinks.
-    now = gst_clock_get_time(clock);
-    if (now < next_output_time) {
-      gint64 wait_ns = next_output_time - now;
-      gint64 wait_until = g_get_monotonic_time() + (wait_ns / 1000);
-      g_mutex_lock(&self->output_lock);
-      g_cond_wait_until(&self->output_cond, &self->output_lock, wait_until);
-      g_mutex_unlock(&self->output_lock);
-      if (!self->output_thread_running) {
+  return ret;
+}
+
+// hands one outbound message to the WS thread, applying the send-overflow policy
+static GstFlowReturn
+gst_websocket_transceiver_queue_send(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  guint limit = MIN(self->send_queue_size, gst_ws_ring_capacity(self->send_ring));
+  gboolean was_empty = FALSE;
+
+  if (gst_ws_ring_length(self->send_ring) >= limit) {
+    switch (self->send_overflow) {
+      case GST_WEBSOCKET_OVERFLOW_DROP_NEWEST:
+        GST_WS_HOT_LOG(self, "Send queue full (%u), dropping new buffer", limit);
+        gst_websocket_transceiver_count_dropped(self, &self->buffers_dropped,
+            GST_WS_TRACE_SEND, 1, gst_buffer_get_size(buffer));
+        gst_buffer_unref(buffer);
+        return GST_FLOW_OK;
+
+      case GST_WEBSOCKET_OVERFLOW_BLOCK:
+      {
+        GstFlowReturn ret = gst_websocket_transceiver_wait_send_space(self, limit);
+        if (ret != GST_FLOW_OK) {
+          gst_websocket_transceiver_count_dropped(self, &self->buffers_dropped,
+              GST_WS_TRACE_SEND, 1, gst_buffer_get_size(buffer));
+          gst_buffer_unref(buffer);
+          return ret == GST_FLOW_FLUSHING ? GST_FLOW_FLUSHING : GST_FLOW_OK;
+        }
         break;
       }
-    }
 
-    g_mutex_lock(&self->queue_lock);
-    if (!g_queue_is_empty(self->recv_queue)) {
-      buffer = g_queue_pop_head(self->recv_queue);
-      GST_DEBUG_OBJECT(self, "Popped buffer from queue, %u remaining",
-          g_queue_get_length(self->recv_queue));
+      case GST_WEBSOCKET_OVERFLOW_DROP_OLDEST:
+      default:
+        while (gst_ws_ring_length(self->send_ring) >= limit) {
+          GstBuffer *dropped = gst_ws_ring_pop(self->send_ring);
+          if (dropped) {
+            gst_websocket_transceiver_count_dropped(self, &self->buffers_dropped,
+                GST_WS_TRACE_SEND, 1, gst_buffer_get_size(dropped));
+            gst_buffer_unref(dropped);
+          }
+        }
+        GST_WS_HOT_LOG(self, "Send queue full (%u), dropped oldest buffer", limit);
+        break;
     }
-    g_mutex_unlock(&self->queue_lock);
+  }
 
-    // eos handling: only send eos after the queue is fully drained AND the websocket is
-    // disconnected. this ensures all received audio is played before signaling end of
-    // stream. if we're still connected, an empty queue just means we're waiting for more
-    // data from the network.
-    if (!buffer) {
-      gboolean should_send_eos = FALSE;
+  // the offset end carries the chain time to the WS thread, nothing else on the send
+  // path uses it. making the buffer writable copies no memory.
+  buffer = gst_buffer_make_writable(buffer);
+  GST_BUFFER_OFFSET_END(buffer) = (guint64)self->chain_time_us;
 
-      g_mutex_lock(&self->state_lock);
-      if (!self->connected && !self->eos_sent) {
-        self->eos_sent = TRUE;
-        should_send_eos = TRUE;
-      }
-      g_mutex_unlock(&self->state_lock);
+  // we are the only producer and the length only shrinks concurrently, so this cannot fail
+  gst_ws_ring_push(self->send_ring, buffer, &was_empty);
+  if (was_empty)
+    g_main_context_wakeup(self->send_context);
+  gst_ws_gauge_record(&self->send_queue_depth, gst_ws_ring_length(self->send_ring));
+  GST_WS_TRACE(self, GST_WS_TRACE_SEND, GST_WS_TRACE_QUEUED, gst_buffer_get_size(buffer),
+      GST_CLOCK_TIME_NONE);
 
-      if (should_send_eos) {
-        GST_INFO_OBJECT(self, "Queue drained and WebSocket closed, sending EOS");
-        gst_pad_push_event(self->srcpad, gst_event_new_eos());
-        break;
-      }
+  return GST_FLOW_OK;
+}
 
-      // advance timestamps even when queue is empty to maintain timing continuity. if we
-      // don't advance, the next buffer would get an old timestamp causing it to appear
-      // late or be dropped by downstream elements. the gap in audio is acceptable, but
-      // the timeline must keep moving forward.
-      GST_LOG_OBJECT(self, "No data available, skipping");
-      g_mutex_lock(&self->output_lock);
-      self->next_timestamp += self->frame_duration;
-      g_mutex_unlock(&self->output_lock);
-      next_output_time += self->frame_duration;
+// cuts the PCM into packets and queues each one as its own message. encoding happens
+// here on the streaming thread, so the WS thread's work per message is the same as for
+// raw audio (and far fewer bytes).
+static GstFlowReturn
+gst_websocket_transceiver_encode_and_queue(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  gsize frame_size = gst_ws_opus_encoder_frame_size(self->opus_encoder);
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  gst_adapter_push(self->encode_adapter, buffer);
+  while (ret == GST_FLOW_OK && gst_adapter_available(self->encode_adapter) >= frame_size) {
+    const guint8 *pcm = gst_adapter_map(self->encode_adapter, frame_size);
+    GstBuffer *packet = gst_ws_opus_encoder_encode(self->opus_encoder, pcm);
+
+    gst_adapter_unmap(self->encode_adapter);
+    gst_adapter_flush(self->encode_adapter, frame_size);
+    if (!packet) {
+      gst_websocket_transceiver_count_dropped(self, &self->buffers_dropped,
+          GST_WS_TRACE_SEND, 1, frame_size);
       continue;
     }
+    GST_BUFFER_DURATION(packet) = GST_WS_OPUS_FRAME_MS * GST_MSECOND;
+    ret = gst_websocket_transceiver_queue_send(self, packet);
+  }
 
-    g_mutex_lock(&self->output_lock);
-    GST_BUFFER_PTS(buffer) = self->base_timestamp + self->next_timestamp;
-    GST_BUFFER_DURATION(buffer) = self->frame_duration;
-    self->next_timestamp += self->frame_duration;
-    g_mutex_unlock(&self->output_lock);
+  return ret;
+}
 
-    ret = gst_pad_push(self->srcpad, buffer);
-    if (ret != GST_FLOW_OK) {
-      GST_WARNING_OBJECT(self, "Error pushing buffer: %s", gst_flow_get_name(ret));
-      // FLUSHING is expected during barge-in because flush_queue() sends flush events
-      // to downstream. we only stop if we're actually shutting down (thread not running)
-      // or if we get a true EOS from downstream.
-      if ((ret == GST_FLOW_FLUSHING && !self->output_thread_running) || ret == GST_FLOW_EOS) {
-        break;
+// converts and, with Opus, encodes a buffer for the wire, then queues it
+static GstFlowReturn
+gst_websocket_transceiver_send_audio(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  if (self->send_converter) {
+    buffer = gst_ws_converter_process(self->send_converter, buffer);
+    if (!buffer)
+      return GST_FLOW_OK;
+  }
+  if (self->opus_encoder)
+    return gst_websocket_transceiver_encode_and_queue(self, buffer);
+  return gst_websocket_transceiver_queue_send(self, buffer);
+}
+
+// queues {"type": "silence"} for the WS thread. state is start, continue (the
+// keepalive) or end; duration is the audio suppressed so far in this silence.
+static GstFlowReturn
+gst_websocket_transceiver_queue_silence(GstWebSocketTransceiver *self, const gchar *state)
+{
+  GstBuffer *control = gst_buffer_new();
+
+  gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(control), gst_websocket_control_quark(),
+      g_strdup_printf("{\"type\":\"silence\",\"state\":\"%s\",\"duration_ms\":%"
+          G_GUINT64_FORMAT "}", state, self->vad_silence / GST_MSECOND), g_free);
+  return gst_websocket_transceiver_queue_send(self, control);
+}
+
+static void
+gst_websocket_transceiver_reset_vad(GstWebSocketTransceiver *self)
+{
+  // a stream starts out as speech without hangover, so leading silence is announced
+  self->vad_speech = TRUE;
+  self->vad_hangover_left = 0;
+  self->vad_silence = 0;
+  self->vad_since_keepalive = 0;
+  gst_clear_buffer(&self->vad_preroll);
+}
+
+// voice activity gate in front of the wire. speech goes out, and so does silence for
+// vad-hangover-ms after it. past that a buffer only replaces the previous pre-roll, which
+// counts as suppressed, and the server is told about the silence. at the next onset the
+// pre-roll goes out ahead of the speech, giving back the attack the detector needed a
+// buffer to recognize.
+static GstFlowReturn
+gst_websocket_transceiver_vad_filter(GstWebSocketTransceiver *self, GstBuffer *buffer)
+{
+  guint bpf = self->bytes_per_sample * self->channels;
+  GstClockTime duration = GST_BUFFER_DURATION(buffer);
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (!GST_CLOCK_TIME_IS_VALID(duration))
+    duration = (bpf > 0 && self->sample_rate > 0) ? gst_util_uint64_scale(
+        gst_buffer_get_size(buffer) / bpf, GST_SECOND, self->sample_rate) : 0;
+
+  if (gst_ws_vad_is_speech(&self->vad_state, self->sample_format, self->channels,
+          self->vad_threshold, buffer)) {
+    if (!self->vad_speech) {
+      GST_WS_HOT_LOG(self, "Speech onset after %" GST_TIME_FORMAT " of silence",
+          GST_TIME_ARGS(self->vad_silence));
+      self->vad_speech = TRUE;
+      ret = gst_websocket_transceiver_queue_silence(self, "end");
+      if (ret == GST_FLOW_OK && self->vad_preroll) {
+        ret = gst_websocket_transceiver_send_audio(self, self->vad_preroll);
+        self->vad_preroll = NULL;
       }
     }
+    self->vad_hangover_left = self->vad_hangover_ms * GST_MSECOND;
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref(buffer);
+      return ret;
+    }
+    return gst_websocket_transceiver_send_audio(self, buffer);
+  }
 
-    next_output_time += self->frame_duration;
+  if (self->vad_speech) {
+    if (self->vad_hangover_left > 0) {
+      self->vad_hangover_left -= MIN(duration, self->vad_hangover_left);
+      return gst_websocket_transceiver_send_audio(self, buffer);
+    }
+    self->vad_speech = FALSE;
+    self->vad_silence = 0;
+    self->vad_since_keepalive = 0;
+    ret = gst_websocket_transceiver_queue_silence(self, "start");
+  } else if (self->vad_keepalive_ms > 0 &&
+      self->vad_since_keepalive >= self->vad_keepalive_ms * GST_MSECOND) {
+    self->vad_since_keepalive = 0;
+    ret = gst_websocket_transceiver_queue_silence(self, "continue");
   }
 
-  if (clock) {
-    gst_object_unref(clock);
+  if (self->vad_preroll) {
+    gst_buffer_unref(self->vad_preroll);
+    gst_ws_stat_add(&self->buffers_suppressed, 1);
   }
-  GST_DEBUG_OBJECT(self, "Output thread stopped");
-  return NULL;
+  self->vad_preroll = buffer;
+  self->vad_silence += duration;
+  self->vad_since_keepalive += duration;
+  return ret;
 }
 
-// sink chain: receives audio from upstream and sends it over websocket. returns OK even
-// when not connected (dropping the buffer) because for real-time voice applications,
-// blocking or failing would stall the entire pipeline. stale audio is useless anyway -
-// better to drop it and keep the pipeline flowing so we can send fresh data once reconnected.
+// sink chain: receives audio from upstream and queues it for the WebSocket thread.
+// returns OK even when not connected (dropping the buffer) because for real-time voice
+// applications, blocking or failing would stall the entire pipeline. stale audio is
+// useless anyway - better to drop it and keep the pipeline flowing so we can send
+// fresh data once reconnected. the socket itself is only touched from the WS thread.
 static GstFlowReturn
 gst_websocket_transceiver_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer)
 {
   GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(parent);
-  GstMapInfo map;
-  SoupWebsocketConnection *conn = NULL;
 
-  g_mutex_lock(&self->state_lock);
-  if (!self->connected || !self->ws_conn) {
-    g_mutex_unlock(&self->state_lock);
-    GST_WARNING_OBJECT(self, "WebSocket not connected, dropping buffer");
-    self->buffers_dropped++;
+  self->chain_time_us = g_get_monotonic_time();
+
+  // while a resume is pending the buffer is queued, the WS thread keeps it for the replay
+  if (!gst_websocket_transceiver_is_live(self)) {
+    GST_WS_HOT_LOG(self, "WebSocket not connected, dropping buffer");
+    gst_websocket_transceiver_count_dropped(self, &self->buffers_dropped,
+        GST_WS_TRACE_SEND, 1, gst_buffer_get_size(buffer));
     gst_buffer_unref(buffer);
     return GST_FLOW_OK;
   }
-  conn = g_object_ref(self->ws_conn);
-  g_mutex_unlock(&self->state_lock);
-
-  if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-    GBytes *bytes = g_bytes_new(map.data, map.size);
-
-    GST_LOG_OBJECT(self, "Sending %zu bytes over WebSocket", map.size);
-
-    soup_websocket_connection_send_binary(conn,
-        g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes));
-
-    self->bytes_sent += map.size;
-    self->buffers_sent++;
-
-    g_bytes_unref(bytes);
-    gst_buffer_unmap(buffer, &map);
-  }
 
-  g_object_unref(conn);
-  gst_buffer_unref(buffer);
-  return GST_FLOW_OK;
+  if (self->vad)
+    return gst_websocket_transceiver_vad_filter(self, buffer);
+  return gst_websocket_transceiver_send_audio(self, buffer);
 }
 
 static GstStateChangeReturn
@@ -1060,28 +4685,100 @@ gst_websocket_transceiver_change_state(GstElement *element, GstStateChange trans
 {
   GstWebSocketTransceiver *self = GST_WEBSOCKET_TRANSCEIVER(element);
   GstStateChangeReturn ret;
+  GError *error = NULL;
+  gboolean loopback;
 
   switch (transition) {
     case GST_STATE_CHANGE_NULL_TO_READY:
+      GST_OBJECT_LOCK(self);
+      g_clear_pointer(&self->flight, gst_ws_flight_free);
+      if (self->trace_buffer_size > 0)
+        self->flight = gst_ws_flight_new(self->trace_buffer_size);
+      GST_OBJECT_UNLOCK(self);
       self->reconnect_count = 0;
       self->current_backoff_ms = 0;
-      self->bytes_sent = 0;
-      self->bytes_received = 0;
-      self->buffers_sent = 0;
-      self->buffers_received = 0;
-      self->buffers_dropped = 0;
+      gst_websocket_transceiver_reset_stats(self);
+      g_atomic_int_set(&self->resuming, FALSE);
+      g_atomic_int_set(&self->barge_in_pending, FALSE);
+      self->one_way_delay_us = 0;
+      self->have_one_way_delay = FALSE;
+      g_atomic_int_set(&self->playout_paused, FALSE);
+      gst_ws_jitter_reset(&self->jitter);
+      g_atomic_int_set(&self->jitter_us, 0);
+      g_atomic_int_set(&self->jitter_target_us, 0);
+      GST_OBJECT_LOCK(self);
+      self->posted_latency = GST_CLOCK_TIME_NONE;
+      GST_OBJECT_UNLOCK(self);
       if (!self->uri) {
         GST_ERROR_OBJECT(self, "No Websocket URI set");
         return GST_STATE_CHANGE_FAILURE;
       }
+      if (self->wire_codec == GST_WEBSOCKET_WIRE_CODEC_OPUS && !gst_ws_opus_available()) {
+        GST_ELEMENT_ERROR(self, CORE, MISSING_PLUGIN, ("wire-codec=opus is not available"),
+            ("The plugin was built without libopus"));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      loopback = gst_ws_loopback_is_uri(self->uri);
+      if (loopback && !gst_ws_loopback_check_uri(self->uri, &error)) {
+        GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("Invalid loopback URI %s", self->uri),
+            ("%s", error->message));
+        g_error_free(error);
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      // neither has anything to share or warm up without a socket
+      if (loopback && (self->mux || self->prewarm_connections > 0))
+        GST_WARNING_OBJECT(self, "mux and prewarm-connections do not apply to loopback URIs");
+      if ((self->output_thread_cpus &&
+              !gst_ws_sched_check_cpus(self->output_thread_cpus, &error)) ||
+          (self->ws_thread_cpus && !gst_ws_sched_check_cpus(self->ws_thread_cpus, &error))) {
+        GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("Invalid thread CPU list"),
+            ("%s", error->message));
+        g_error_free(error);
+        return GST_STATE_CHANGE_FAILURE;
+      }
+
+      // one token per READY..NULL session, a reconnect presents the same one again
+      g_free(self->resume_token);
+      self->resume_token = self->replay_buffer_ms > 0 ? g_uuid_string_random() : NULL;
 
       self->ws_thread_running = TRUE;
-      self->ws_thread = g_thread_new("websocket-thread",
-          gst_websocket_transceiver_ws_thread, self);
+      self->send_ring = gst_ws_ring_new(self->send_queue_size);
+      self->recv_ring = gst_ws_ring_new(self->max_queue_size);
+      self->send_source = gst_websocket_transceiver_send_source_new(self);
+      if (self->mux && !loopback) {
+        self->mux_endpoint = gst_ws_mux_acquire(self->uri, self->io_pool_size);
+        self->reactor = gst_ws_reactor_acquire(gst_ws_mux_get_reactor(self->mux_endpoint));
+      } else if (self->io_pool || (self->prewarm_connections > 0 && !loopback)) {
+        // the least loaded reactor, with standby connections of its own
+        self->reactor = gst_ws_reactor_acquire_shared(self->io_pool_size);
+        if (self->prewarm_connections > 0 && !loopback)
+          self->warm = gst_ws_warm_pool_acquire(self->uri,
+              gst_websocket_transceiver_protocols(self), self->prewarm_connections,
+              self->reactor);
+      } else {
+        gchar *name = self->thread_name ? g_strdup_printf("%s-ws", self->thread_name) :
+            g_strdup("websocket-thread");
+
+        self->reactor = gst_ws_reactor_new_private(name);
+        g_free(name);
+      }
+      g_atomic_int_set(&self->ws_realtime, gst_ws_reactor_set_scheduling(self->reactor,
+          (gint)self->ws_thread_priority, self->ws_thread_cpus));
+      // the context outlives every connection so chain can always wake it while streaming
+      self->send_context = gst_ws_reactor_get_context(self->reactor);
+      g_source_attach(self->send_source, self->send_context);
+      g_atomic_int_set(&self->async_pending, self->async_connect);
+      gst_ws_reactor_invoke(self->reactor, gst_websocket_transceiver_start_cb,
+          gst_object_ref(self), gst_object_unref);
+
+      if (self->async_connect) {
+        gst_element_post_message(element, gst_message_new_async_start(GST_OBJECT(self)));
+        break;
+      }
 
       // wait for initial connection, but continue even on timeout. the state change
       // must succeed to allow the pipeline to start - blocking indefinitely would
-      // freeze gst-launch or application startup. the ws_thread will keep trying
+      // freeze gst-launch or application startup. the reactor will keep trying
       // to connect in the background with exponential backoff.
       {
         gint64 end_time = g_get_monotonic_time() + CONNECTION_TIMEOUT_SECONDS * G_TIME_SPAN_SECOND;
@@ -1107,8 +4804,14 @@ gst_websocket_transceiver_change_state(GstElement *element, GstStateChange trans
       g_mutex_unlock(&self->state_lock);
 
       self->output_thread_running = TRUE;
-      self->output_thread = g_thread_new("output-thread",
-          gst_websocket_transceiver_output_thread, self);
+      {
+        gchar *name = self->thread_name ? g_strdup_printf("%s-out", self->thread_name) :
+            g_strdup("output-thread");
+
+        self->output_thread = g_thread_new(name, gst_websocket_transceiver_output_thread,
+            self);
+        g_free(name);
+      }
       break;
 
     default:
@@ -1120,6 +4823,11 @@ gst_websocket_transceiver_change_state(GstElement *element, GstStateChange trans
     return ret;
 
   switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if (self->async_connect)
+        ret = GST_STATE_CHANGE_ASYNC;
+      break;
+
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       ret = GST_STATE_CHANGE_NO_PREROLL;
       break;
@@ -1137,6 +4845,8 @@ gst_websocket_transceiver_change_state(GstElement *element, GstStateChange trans
 
       g_mutex_lock(&self->output_lock);
       g_cond_broadcast(&self->output_cond);
+      if (self->clock_id)
+        gst_clock_id_unschedule(self->clock_id);
       g_mutex_unlock(&self->output_lock);
 
       if (self->output_thread) {
@@ -1146,23 +4856,63 @@ gst_websocket_transceiver_change_state(GstElement *element, GstStateChange trans
 
       self->first_timestamp_set = FALSE;
       self->next_timestamp = 0;
+      self->output_offset = 0;
       self->caps_ready = FALSE;
+      // the sink pad is deactivated, chain cannot be running
+      gst_websocket_transceiver_reset_vad(self);
       break;
 
+    case GST_STATE_CHANGE_NULL_TO_NULL:
+      // set back to NULL while an asynchronous NULL_TO_READY was still pending
+      if (!self->ws_thread_running)
+        break;
+      /* fall through */
     case GST_STATE_CHANGE_READY_TO_NULL:
+      // we hold the state lock, so a pending async-done can no longer be committed
+      g_atomic_int_set(&self->async_pending, FALSE);
       self->ws_thread_running = FALSE;
-      if (self->loop) {
-        g_main_loop_quit(self->loop);
+      // nothing on the reactor sleeps: the stop callback cancels the attempt in flight
+      // and the reconnect timer right away, however long the backoff
+      if (self->reactor) {
+        gst_ws_reactor_invoke_sync(self->reactor, gst_websocket_transceiver_stop_cb,
+            self);
+        gst_ws_reactor_release(self->reactor);
+        self->reactor = NULL;
+        g_atomic_int_set(&self->ws_realtime, FALSE);
+      }
+      // after the reactor has let go of the element, the endpoint may start to linger
+      if (self->warm) {
+        gst_ws_warm_pool_release(self->warm);
+        self->warm = NULL;
+      }
+      // the stop callback has closed the stream, the element is off the shared connection
+      if (self->mux_endpoint) {
+        gst_ws_mux_release(self->mux_endpoint);
+        self->mux_endpoint = NULL;
       }
-      if (self->ws_thread) {
-        g_thread_join(self->ws_thread);
-        self->ws_thread = NULL;
+      if (self->send_source) {
+        g_source_destroy(self->send_source);
+        g_source_unref(self->send_source);
+        self->send_source = NULL;
       }
+      gst_websocket_transceiver_reset_batch(self);
+      self->send_context = NULL;
+      g_clear_pointer(&self->resume_token, g_free);
+      gst_ws_ring_free(self->send_ring, (GDestroyNotify)gst_buffer_unref);
+      self->send_ring = NULL;
 
       g_mutex_lock(&self->queue_lock);
-      g_queue_free_full(self->recv_queue, (GDestroyNotify)gst_buffer_unref);
-      self->recv_queue = g_queue_new();
+      gst_websocket_transceiver_recv_clear(self);
+      gst_ws_ring_free(self->recv_ring, NULL);
+      self->recv_ring = NULL;
+      gst_adapter_clear(self->recv_adapter);
+      gst_websocket_transceiver_free_recv_pool_locked(self);
+      g_clear_pointer(&self->opus_decoder, gst_ws_opus_decoder_free);
+      g_clear_pointer(&self->recv_converter, gst_ws_converter_free);
       g_mutex_unlock(&self->queue_lock);
+      g_clear_pointer(&self->opus_encoder, gst_ws_opus_encoder_free);
+      g_clear_pointer(&self->send_converter, gst_ws_converter_free);
+      gst_adapter_clear(self->encode_adapter);
 
       g_mutex_lock(&self->state_lock);
       self->connected = FALSE;
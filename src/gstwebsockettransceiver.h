@@ -3,8 +3,29 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstpushsrc.h>
+#include <gst/base/gstadapter.h>
 #include <libsoup/soup.h>
 
+#include "gstwsaudio.h"
+#include "gstwsbudget.h"
+#include "gstwscontrol.h"
+#include "gstwsconvert.h"
+#include "gstwsdeflate.h"
+#include "gstwsflight.h"
+#include "gstwsframe.h"
+#include "gstwsjitter.h"
+#include "gstwsloopback.h"
+#include "gstwsmux.h"
+#include "gstwsopus.h"
+#include "gstwsreactor.h"
+#include "gstwsring.h"
+#include "gstwssched.h"
+#include "gstwsstats.h"
+#include "gstwstracer.h"
+#include "gstwstransport.h"
+#include "gstwsvad.h"
+#include "gstwswarm.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_WEBSOCKET_TRANSCEIVER \
@@ -21,6 +42,66 @@ G_BEGIN_DECLS
 typedef struct _GstWebSocketTransceiver GstWebSocketTransceiver;
 typedef struct _GstWebSocketTransceiverClass GstWebSocketTransceiverClass;
 
+typedef enum
+{
+  GST_WEBSOCKET_OVERFLOW_DROP_OLDEST,
+  GST_WEBSOCKET_OVERFLOW_DROP_NEWEST,
+  GST_WEBSOCKET_OVERFLOW_BLOCK,
+} GstWebSocketOverflow;
+
+typedef enum
+{
+  GST_WEBSOCKET_RECV_BUFFER_AUTO,
+  GST_WEBSOCKET_RECV_BUFFER_COPY,
+  GST_WEBSOCKET_RECV_BUFFER_POOL,
+  GST_WEBSOCKET_RECV_BUFFER_WRAP,
+} GstWebSocketRecvBufferMode;
+
+typedef enum
+{
+  GST_WEBSOCKET_JITTER_FIXED,
+  GST_WEBSOCKET_JITTER_ADAPTIVE,
+} GstWebSocketJitterMode;
+
+typedef enum
+{
+  GST_WEBSOCKET_FILL_NONE,
+  GST_WEBSOCKET_FILL_SILENCE,
+  GST_WEBSOCKET_FILL_COMFORT_NOISE,
+  GST_WEBSOCKET_FILL_GAP_EVENT,
+} GstWebSocketFillMode;
+
+typedef enum
+{
+  GST_WEBSOCKET_PACING_REALTIME,
+  GST_WEBSOCKET_PACING_SCALED,
+  GST_WEBSOCKET_PACING_NONE,
+} GstWebSocketPacing;
+
+typedef enum
+{
+  GST_WEBSOCKET_FRAMING_NONE,
+  GST_WEBSOCKET_FRAMING_V1,
+} GstWebSocketFraming;
+
+typedef enum
+{
+  GST_WEBSOCKET_BARGE_IN_FLUSH,
+  GST_WEBSOCKET_BARGE_IN_FAST,
+} GstWebSocketBargeInMode;
+
+typedef enum
+{
+  GST_WEBSOCKET_WIRE_FORMAT_NATIVE,
+  GST_WEBSOCKET_WIRE_FORMAT_S16LE,
+} GstWebSocketWireFormat;
+
+typedef enum
+{
+  GST_WEBSOCKET_WIRE_CODEC_RAW,
+  GST_WEBSOCKET_WIRE_CODEC_OPUS,
+} GstWebSocketWireCodec;
+
 
 struct _GstWebSocketTransceiver
 {
@@ -34,31 +115,91 @@ struct _GstWebSocketTransceiver
   guint channels;
   guint frame_duration_ms;
   guint max_queue_size;
+  guint max_queue_bytes;
+  guint max_queue_time_ms;
   guint initial_buffer_count;
+  // the receive queue's share of the process-wide budget, for the element's lifetime.
+  // every push and pop of recv_ring goes through it so the queued bytes stay exact.
+  GstWsBudget *budget;
 
-  SoupSession *session;
-  SoupWebsocketConnection *ws_conn;
-  GMainContext *context;
-  GMainLoop *loop;
-  GThread *ws_thread;
+  // the connection, libsoup or loopback. WS thread only, swapped under state_lock
+  GstWsTransport *transport;
 
   guint bytes_per_sample;
+  GstWsSampleFormat sample_format;
   guint frame_size_bytes;
   GstClockTime frame_duration;
 
   GstClockTime base_timestamp;
   GstClockTime next_timestamp;
+  // samples pushed since the timeline was last reset, PTS and durations derive from it
+  guint64 output_offset;
   gboolean first_timestamp_set;
   gboolean need_segment;
 
-  GQueue *recv_queue;
+  // received frames: the WS context pushes, the output thread pops, the ring itself
+  // takes no lock. queue_lock guards the adapter, pool, converter and estimator below
+  // and the initial buffering wait. the WS context takes it once per message, not per
+  // frame, and in steady state nothing else does, so it stays uncontended.
+  GstWsRing *recv_ring;
+  gint recv_waiting;
+  // bytes of a partially received frame (protected by queue_lock)
+  GstAdapter *recv_adapter;
   GMutex queue_lock;
 
+  // receive buffer allocation (protected by queue_lock)
+  GstWebSocketRecvBufferMode recv_buffer_mode;
+  GstWebSocketRecvBufferMode recv_buffer_mode_active;
+  GstBufferPool *recv_pool;
+  guint recv_pool_frame_size;
+
+  // playout buffer: the estimator runs on the WS context under queue_lock and publishes
+  // its results atomically for the output thread
+  GstWebSocketJitterMode jitter_mode;
+  guint min_latency_ms;
+  guint max_latency_ms;
+  GstWsJitter jitter;
+  gint jitter_us;
+  gint jitter_target_us;
+  GstWebSocketFillMode fill_mode;
+  // the output thread's schedule, read when it starts. anything but realtime is for
+  // offline use, where there is no listener to keep up with.
+  GstWebSocketPacing pacing;
+  gdouble pacing_speed;
+  // set by a "pause" control message, the output thread plays nothing until "resume"
+  gint playout_paused;
+
+  // binary framing. framing_active and send_seq are only touched from the WS context,
+  // last_recv_seq and the delay estimate are protected by queue_lock. the clear epoch
+  // is published atomically because the output thread checks every frame against it.
+  GstWebSocketFraming framing;
+  gboolean framing_active;
+  guint32 send_seq;
+  guint32 last_recv_seq;
+  gint recv_epoch;
+  gint epoch_set;
+  gint64 one_way_delay_us;
+  gboolean have_one_way_delay;
+
+  // barge-in: every clear bumps barge_in_epoch, and the output thread drops a buffer
+  // popped under an older epoch instead of pushing it. output_pushing tells the WS
+  // thread whether a push may still be carrying stale audio; whoever sees the interrupt
+  // complete first claims barge_in_pending and posts the latency.
+  GstWebSocketBargeInMode barge_in_mode;
+  gint barge_in_epoch;
+  gint barge_in_pending;
+  gint output_pushing;
+  gint64 barge_in_start_us;
+  // min latency last announced with a latency message (protected by the object lock)
+  GstClockTime posted_latency;
+
   GThread *output_thread;
   gboolean output_thread_running;
   gboolean ws_thread_running;
   GMutex output_lock;
   GCond output_cond;
+  // pacing wait on the pipeline clock, unscheduled to wake the output thread early
+  GstClockID clock_id;
 
   gboolean connected;
   gboolean eos_sent;
@@ -74,13 +215,164 @@ struct _GstWebSocketTransceiver
   guint max_reconnects;
   guint reconnect_count;
   guint current_backoff_ms;
+  // with async-connect NULL_TO_READY returns ASYNC; whoever clears async_pending first
+  // (connect result, timeout or READY_TO_NULL) completes or abandons the state change
+  gboolean async_connect;
+  gint async_pending;
+  GSource *async_timeout_source;
+
+  // the connection lives on a reactor: a private one by default, a pooled one with
+  // io-pool. all connect, reconnect and send work runs there as sources.
+  gboolean io_pool;
+  guint io_pool_size;
+  GstWsReactor *reactor;
+  // standby connections: with prewarm-connections set the element runs on the reactor
+  // its endpoint's warm pool is pinned to and takes an open connection from it
+  guint prewarm_connections;
+  GstWsWarmPool *warm;
+  // multiplexing: with mux the element is a stream on its endpoint's shared connection
+  // and runs on the reactor that connection is pinned to. the stream is only touched
+  // there; its id is 0 while the element has none.
+  gboolean mux;
+  GstWsMux *mux_endpoint;
+  GstWsMuxStream *mux_stream;
+  gint mux_stream_id;
+  GCancellable *connect_cancellable;
+  GSource *reconnect_source;
+
+  // outbound path: chain pushes buffers into send_ring, the WS context drains it
+  guint send_queue_size;
+  GstWebSocketOverflow send_overflow;
+  GstWsRing *send_ring;
+  GSource *send_source;
+  GMainContext *send_context;
+  GMutex send_lock;
+  GCond send_cond;
+  gint send_waiting;
+
+  // send coalescing, only touched from the WS context
+  guint send_batch_ms;
+  guint send_batch_bytes;
+  guint send_batch_max_latency_ms;
+  GstBuffer *batch;
+  gsize batch_bytes;
+  GstClockTime batch_duration;
+  GSource *batch_timer;
+
+  // seamless reconnect. the replay queue holds the last replay-buffer-ms of outbound
+  // audio and is only touched from the WS context; its newest replay_unsent entries
+  // were queued while disconnected and never sent. resuming is set from the moment an
+  // established connection drops until it is back or reconnecting gives up, and keeps
+  // chain queueing and the output thread from sending EOS meanwhile.
+  guint replay_buffer_ms;
+  GQueue replay_queue;
+  GstClockTime replay_duration;
+  guint replay_unsent;
+  gchar *resume_token;
+  gint resuming;
 
-  // statistics counters (read-only, reset on NULL->READY)
+  // permessage-deflate. deflate is the extension negotiated on the current connection
+  // and only touched from the WS context, which also mirrors its counters into
+  // compression_stats after every send for the property getter.
+  gboolean compression;
+  guint compression_window_bits;
+  GstWsDeflate *deflate;
+  GstWsDeflateStats compression_stats;
+
+  // what goes over the socket: the caps converted to wire-format and wire-rate, then
+  // optionally Opus encoded. the send side (converter, encoder and its adapter) belongs
+  // to the streaming thread, which also replaces it on caps; the receive side runs on
+  // the WS context and is swapped under queue_lock.
+  GstWebSocketWireFormat wire_format;
+  guint wire_rate;
+  GstWsSampleFormat wire_sample_format;
+  guint wire_sample_rate;
+  guint wire_bpf;
+  GstWsConverter *send_converter;
+  GstWsConverter *recv_converter;
+  GstWebSocketWireCodec wire_codec;
+  GstWsOpusEncoder *opus_encoder;
+  GstAdapter *encode_adapter;
+  GstWsOpusDecoder *opus_decoder;
+
+  // outbound voice activity detection, streaming thread only. vad_speech covers the
+  // hangover after a talk spurt too. of a silent run only its newest buffer is kept, as
+  // pre-roll for the next onset, and the server hears a silence control message instead.
+  gboolean vad;
+  gdouble vad_threshold;
+  guint vad_hangover_ms;
+  guint vad_keepalive_ms;
+  GstWsVad vad_state;
+  gboolean vad_speech;
+  GstClockTime vad_hangover_left;
+  GstClockTime vad_silence;
+  GstClockTime vad_since_keepalive;
+  GstBuffer *vad_preroll;
+
+  // posts the stats structure from the WS context every stats_interval_ms
+  guint stats_interval_ms;
+  GSource *stats_source;
+
+  // flight recorder of trace_buffer_size events, dumped by the dump-trace action signal
+  // and posted as websocket-trace when the connection fails
+  guint trace_buffer_size;
+  GstWsFlight *flight;
+
+  // scheduling of the element's threads, applied by each thread as it starts (the WS
+  // side on NULL->READY, on a reactor that may be shared). the realtime flags say whether
+  // it worked.
+  gchar *thread_name;
+  guint output_thread_priority;
+  gchar *output_thread_cpus;
+  guint ws_thread_priority;
+  gchar *ws_thread_cpus;
+  gint output_realtime;
+  gint ws_realtime;
+
+  // statistics (read-only, reset on NULL->READY), grouped by the one thread that writes
+  // them with the gst_ws_stat helpers. buffers-dropped and stale-frames have a part per
+  // thread. chain_time_us stamps the buffer on its way into the send ring.
+  // streaming thread
+  guint64 buffers_dropped;
+  guint64 buffers_suppressed;
+  GstWsGauge send_queue_depth;
+  gint64 chain_time_us;
+  // WS thread
   guint64 bytes_sent;
   guint64 bytes_received;
   guint64 buffers_sent;
   guint64 buffers_received;
-  guint64 buffers_dropped;
+  guint64 ws_buffers_dropped;
+  guint64 pool_hits;
+  guint64 pool_misses;
+  guint64 ws_stale_frames;
+  guint64 warm_connects;
+  guint64 buffers_replayed;
+  guint64 payload_bytes_sent;
+  guint64 wire_bytes_sent;
+  guint64 wire_bytes_received;
+  GstWsHistogram send_latency;
+  GstWsHistogram interarrival;
+  GstWsHistogram reconnect_time;
+  gint64 last_arrival_us;
+  gint64 disconnected_us;
+  // output thread
+  guint64 silence_trimmed;
+  guint64 frames_filled;
+  guint64 late_frames;
+  guint64 max_lateness;
+  guint64 stale_frames;
+  guint64 output_buffers_dropped;
+  guint64 underruns;
+  guint64 underrun_time_us;
+  GstWsGauge recv_queue_depth;
+  GstWsHistogram output_lateness;
+  // involuntary context switches, and the thread's own count at the last sample
+  guint64 output_preemptions;
+  guint64 output_switches;
+  // whichever thread completes the barge-in
+  guint64 barge_in_latency_us;
+  GstWsHistogram barge_in_latency;
 };
 
 
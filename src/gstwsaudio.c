@@ -0,0 +1,270 @@
+#include "gstwsaudio.h"
+#include <string.h>
+
+GstWsSampleFormat
+gst_ws_sample_format_from_caps(const GstCaps *caps)
+{
+  GstStructure *structure;
+  const gchar *name;
+  const gchar *format;
+
+  if (!caps || gst_caps_get_size(caps) == 0)
+    return GST_WS_SAMPLE_FORMAT_UNKNOWN;
+
+  structure = gst_caps_get_structure(caps, 0);
+  name = gst_structure_get_name(structure);
+
+  if (g_str_equal(name, "audio/x-mulaw"))
+    return GST_WS_SAMPLE_FORMAT_MULAW;
+  if (g_str_equal(name, "audio/x-alaw"))
+    return GST_WS_SAMPLE_FORMAT_ALAW;
+  if (!g_str_equal(name, "audio/x-raw"))
+    return GST_WS_SAMPLE_FORMAT_UNKNOWN;
+
+  format = gst_structure_get_string(structure, "format");
+  if (!format)
+    return GST_WS_SAMPLE_FORMAT_UNKNOWN;
+  if (g_str_equal(format, "S16LE"))
+    return GST_WS_SAMPLE_FORMAT_S16LE;
+  if (g_str_equal(format, "S16BE"))
+    return GST_WS_SAMPLE_FORMAT_S16BE;
+  if (g_str_equal(format, "S32LE"))
+    return GST_WS_SAMPLE_FORMAT_S32LE;
+  if (g_str_equal(format, "S32BE"))
+    return GST_WS_SAMPLE_FORMAT_S32BE;
+  if (g_str_equal(format, "F32LE"))
+    return GST_WS_SAMPLE_FORMAT_F32LE;
+  if (g_str_equal(format, "F32BE"))
+    return GST_WS_SAMPLE_FORMAT_F32BE;
+
+  return GST_WS_SAMPLE_FORMAT_UNKNOWN;
+}
+
+guint
+gst_ws_sample_format_width(GstWsSampleFormat format)
+{
+  switch (format) {
+    case GST_WS_SAMPLE_FORMAT_S16LE:
+    case GST_WS_SAMPLE_FORMAT_S16BE:
+      return 2;
+    case GST_WS_SAMPLE_FORMAT_S32LE:
+    case GST_WS_SAMPLE_FORMAT_S32BE:
+    case GST_WS_SAMPLE_FORMAT_F32LE:
+    case GST_WS_SAMPLE_FORMAT_F32BE:
+      return 4;
+    case GST_WS_SAMPLE_FORMAT_MULAW:
+    case GST_WS_SAMPLE_FORMAT_ALAW:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// G.711 expansion into the 16-bit range
+gint
+gst_ws_mulaw_to_linear(guint8 u)
+{
+  gint t;
+
+  u = ~u;
+  t = ((u & 0x0F) << 3) + 0x84;
+  t <<= (u & 0x70) >> 4;
+  return (u & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+gint
+gst_ws_alaw_to_linear(guint8 a)
+{
+  gint t, seg;
+
+  a ^= 0x55;
+  t = (a & 0x0F) << 4;
+  seg = (a & 0x70) >> 4;
+  if (seg == 0)
+    t += 8;
+  else if (seg == 1)
+    t += 0x108;
+  else
+    t = (t + 0x108) << (seg - 1);
+  return (a & 0x80) ? t : -t;
+}
+
+guint8
+gst_ws_linear_to_mulaw(gint16 pcm)
+{
+  gint sign = pcm < 0 ? 0x80 : 0;
+  gint magnitude = MIN(ABS((gint)pcm), 32635) + 0x84;
+  gint exponent = 7;
+
+  for (gint mask = 0x4000; exponent > 0 && !(magnitude & mask); mask >>= 1)
+    exponent--;
+  return ~(sign | (exponent << 4) | ((magnitude >> (exponent + 3)) & 0x0F));
+}
+
+guint8
+gst_ws_linear_to_alaw(gint16 pcm)
+{
+  gint sign = pcm >= 0 ? 0x80 : 0;
+  gint magnitude = MIN(ABS((gint)pcm), 32767);
+  gint exponent = 7;
+  gint mantissa;
+
+  for (gint mask = 0x4000; exponent > 0 && !(magnitude & mask); mask >>= 1)
+    exponent--;
+  mantissa = (magnitude >> (exponent == 0 ? 4 : exponent + 3)) & 0x0F;
+  return (sign | (exponent << 4) | mantissa) ^ 0x55;
+}
+
+// digital silence in every supported format. G.711 silence is not zero bytes.
+void
+gst_ws_audio_fill_silence(GstWsSampleFormat format, gpointer data, gsize size)
+{
+  switch (format) {
+    case GST_WS_SAMPLE_FORMAT_MULAW:
+      memset(data, 0xFF, size);
+      break;
+    case GST_WS_SAMPLE_FORMAT_ALAW:
+      memset(data, 0xD5, size);
+      break;
+    default:
+      // zero is silence for both integer and IEEE float PCM in either byte order
+      memset(data, 0, size);
+      break;
+  }
+}
+
+// white noise of the given peak amplitude (in [0, 1]) from a cheap LCG. the caller keeps
+// the seed so consecutive frames continue the sequence instead of repeating one frame.
+void
+gst_ws_audio_fill_noise(GstWsSampleFormat format, gpointer data, gsize size,
+    gdouble amplitude, guint32 *seed)
+{
+  guint8 *p = data;
+  guint width = gst_ws_sample_format_width(format);
+  gsize n = width > 0 ? size / width : 0;
+
+  if (width == 0) {
+    gst_ws_audio_fill_silence(format, data, size);
+    return;
+  }
+
+  for (gsize i = 0; i < n; i++) {
+    gdouble v;
+
+    *seed = *seed * 1664525u + 1013904223u;
+    v = ((gint32)*seed / 2147483648.0) * amplitude;
+
+    switch (format) {
+      case GST_WS_SAMPLE_FORMAT_S16LE:
+        GST_WRITE_UINT16_LE(p + i * 2, (guint16)(gint16)(v * 32767.0));
+        break;
+      case GST_WS_SAMPLE_FORMAT_S16BE:
+        GST_WRITE_UINT16_BE(p + i * 2, (guint16)(gint16)(v * 32767.0));
+        break;
+      case GST_WS_SAMPLE_FORMAT_S32LE:
+        GST_WRITE_UINT32_LE(p + i * 4, (guint32)(gint32)(v * 2147483647.0));
+        break;
+      case GST_WS_SAMPLE_FORMAT_S32BE:
+        GST_WRITE_UINT32_BE(p + i * 4, (guint32)(gint32)(v * 2147483647.0));
+        break;
+      case GST_WS_SAMPLE_FORMAT_F32LE:
+        GST_WRITE_FLOAT_LE(p + i * 4, (gfloat)v);
+        break;
+      case GST_WS_SAMPLE_FORMAT_F32BE:
+        GST_WRITE_FLOAT_BE(p + i * 4, (gfloat)v);
+        break;
+      case GST_WS_SAMPLE_FORMAT_MULAW:
+        p[i] = gst_ws_linear_to_mulaw((gint16)(v * 32767.0));
+        break;
+      case GST_WS_SAMPLE_FORMAT_ALAW:
+        p[i] = gst_ws_linear_to_alaw((gint16)(v * 32767.0));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// peak absolute sample value normalized to [0, 1]
+gdouble
+gst_ws_audio_peak(GstWsSampleFormat format, gconstpointer data, gsize size)
+{
+  const guint8 *p = data;
+  guint width = gst_ws_sample_format_width(format);
+  gsize n = width > 0 ? size / width : 0;
+  guint32 peak = 0;
+  gfloat fpeak = 0.0f;
+
+  switch (format) {
+    case GST_WS_SAMPLE_FORMAT_S16LE:
+    case GST_WS_SAMPLE_FORMAT_S16BE:
+      for (gsize i = 0; i < n; i++) {
+        gint16 s = format == GST_WS_SAMPLE_FORMAT_S16LE ?
+            (gint16)GST_READ_UINT16_LE(p + i * 2) : (gint16)GST_READ_UINT16_BE(p + i * 2);
+        guint32 a = ABS((gint32)s);
+        if (a > peak)
+          peak = a;
+      }
+      return peak / 32768.0;
+
+    case GST_WS_SAMPLE_FORMAT_S32LE:
+    case GST_WS_SAMPLE_FORMAT_S32BE:
+      for (gsize i = 0; i < n; i++) {
+        gint32 s = format == GST_WS_SAMPLE_FORMAT_S32LE ?
+            (gint32)GST_READ_UINT32_LE(p + i * 4) : (gint32)GST_READ_UINT32_BE(p + i * 4);
+        guint32 a = s < 0 ? (guint32)(-(gint64)s) : (guint32)s;
+        if (a > peak)
+          peak = a;
+      }
+      return peak / 2147483648.0;
+
+    case GST_WS_SAMPLE_FORMAT_F32LE:
+    case GST_WS_SAMPLE_FORMAT_F32BE:
+      for (gsize i = 0; i < n; i++) {
+        gfloat f = format == GST_WS_SAMPLE_FORMAT_F32LE ?
+            GST_READ_FLOAT_LE(p + i * 4) : GST_READ_FLOAT_BE(p + i * 4);
+        f = f < 0.0f ? -f : f;
+        if (f > fpeak)
+          fpeak = f;
+      }
+      return MIN(fpeak, 1.0f);
+
+    case GST_WS_SAMPLE_FORMAT_MULAW:
+      for (gsize i = 0; i < n; i++) {
+        guint32 a = ABS(gst_ws_mulaw_to_linear(p[i]));
+        if (a > peak)
+          peak = a;
+      }
+      return peak / 32768.0;
+
+    case GST_WS_SAMPLE_FORMAT_ALAW:
+      for (gsize i = 0; i < n; i++) {
+        guint32 a = ABS(gst_ws_alaw_to_linear(p[i]));
+        if (a > peak)
+          peak = a;
+      }
+      return peak / 32768.0;
+
+    default:
+      return 1.0;
+  }
+}
+
+// unknown formats are never reported silent, so callers never drop audio they cannot
+// measure
+gboolean
+gst_ws_audio_buffer_is_silent(GstWsSampleFormat format, GstBuffer *buffer,
+    gdouble threshold)
+{
+  GstMapInfo map;
+  gboolean silent;
+
+  if (format == GST_WS_SAMPLE_FORMAT_UNKNOWN)
+    return FALSE;
+  if (!gst_buffer_map(buffer, &map, GST_MAP_READ))
+    return FALSE;
+
+  silent = gst_ws_audio_peak(format, map.data, map.size) < threshold;
+  gst_buffer_unmap(buffer, &map);
+  return silent;
+}
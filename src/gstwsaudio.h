@@ -0,0 +1,41 @@
+#ifndef __GST_WS_AUDIO_H__
+#define __GST_WS_AUDIO_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// the sample formats the pad templates accept, as a flat enum so the per-sample helpers
+// can switch on it without going through GstAudioInfo
+typedef enum
+{
+  GST_WS_SAMPLE_FORMAT_UNKNOWN,
+  GST_WS_SAMPLE_FORMAT_S16LE,
+  GST_WS_SAMPLE_FORMAT_S16BE,
+  GST_WS_SAMPLE_FORMAT_S32LE,
+  GST_WS_SAMPLE_FORMAT_S32BE,
+  GST_WS_SAMPLE_FORMAT_F32LE,
+  GST_WS_SAMPLE_FORMAT_F32BE,
+  GST_WS_SAMPLE_FORMAT_MULAW,
+  GST_WS_SAMPLE_FORMAT_ALAW,
+} GstWsSampleFormat;
+
+GstWsSampleFormat gst_ws_sample_format_from_caps(const GstCaps *caps);
+guint gst_ws_sample_format_width(GstWsSampleFormat format);
+
+gint gst_ws_mulaw_to_linear(guint8 u);
+gint gst_ws_alaw_to_linear(guint8 a);
+guint8 gst_ws_linear_to_mulaw(gint16 pcm);
+guint8 gst_ws_linear_to_alaw(gint16 pcm);
+
+gdouble gst_ws_audio_peak(GstWsSampleFormat format, gconstpointer data, gsize size);
+gboolean gst_ws_audio_buffer_is_silent(GstWsSampleFormat format, GstBuffer *buffer,
+    gdouble threshold);
+
+void gst_ws_audio_fill_silence(GstWsSampleFormat format, gpointer data, gsize size);
+void gst_ws_audio_fill_noise(GstWsSampleFormat format, gpointer data, gsize size,
+    gdouble amplitude, guint32 *seed);
+
+G_END_DECLS
+
+#endif /* __GST_WS_AUDIO_H__ */
@@ -0,0 +1,200 @@
+#include "gstwsbudget.h"
+
+#include <stdlib.h>
+
+GST_DEBUG_CATEGORY_STATIC(gst_ws_budget_debug);
+#define GST_CAT_DEFAULT gst_ws_budget_debug
+
+struct _GstWsBudget
+{
+  guint64 queued;
+  guint64 shed;
+};
+
+typedef struct
+{
+  GstWsBudget *member;
+  guint64 depth;
+} GstWsBudgetDepth;
+
+// members and the scratch array are protected by lock, the counters are atomic. pending
+// is the sum of what members were asked to shed and have not taken yet.
+static GMutex lock;
+static GPtrArray *members = NULL;
+static GstWsBudgetDepth *depths = NULL;
+static guint depths_size = 0;
+static guint64 limit = 0;
+static guint64 total = 0;
+static guint64 pending = 0;
+
+static void
+gst_ws_budget_init_debug(void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    GST_DEBUG_CATEGORY_INIT(gst_ws_budget_debug, "websockettransceiver-budget",
+        0, "WebSocket Transceiver process-wide queue budget");
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+GstWsBudget *
+gst_ws_budget_join(void)
+{
+  GstWsBudget *budget = g_new0(GstWsBudget, 1);
+
+  gst_ws_budget_init_debug();
+
+  g_mutex_lock(&lock);
+  if (!members)
+    members = g_ptr_array_new();
+  g_ptr_array_add(members, budget);
+  g_mutex_unlock(&lock);
+  return budget;
+}
+
+void
+gst_ws_budget_leave(GstWsBudget *budget)
+{
+  g_mutex_lock(&lock);
+  g_ptr_array_remove_fast(members, budget);
+  if (members->len == 0) {
+    g_clear_pointer(&members, g_ptr_array_unref);
+    g_clear_pointer(&depths, g_free);
+    depths_size = 0;
+  }
+  g_mutex_unlock(&lock);
+
+  __atomic_fetch_sub(&total, __atomic_load_n(&budget->queued, __ATOMIC_RELAXED),
+      __ATOMIC_RELAXED);
+  __atomic_fetch_sub(&pending, __atomic_exchange_n(&budget->shed, 0, __ATOMIC_RELAXED),
+      __ATOMIC_RELAXED);
+  g_free(budget);
+}
+
+void
+gst_ws_budget_set_limit(guint64 bytes)
+{
+  __atomic_store_n(&limit, bytes, __ATOMIC_RELAXED);
+}
+
+guint64
+gst_ws_budget_get_limit(void)
+{
+  return __atomic_load_n(&limit, __ATOMIC_RELAXED);
+}
+
+guint64
+gst_ws_budget_get_total(void)
+{
+  return __atomic_load_n(&total, __ATOMIC_RELAXED);
+}
+
+static gint
+gst_ws_budget_compare_depth(gconstpointer a, gconstpointer b)
+{
+  guint64 depth_a = ((const GstWsBudgetDepth *)a)->depth;
+  guint64 depth_b = ((const GstWsBudgetDepth *)b)->depth;
+
+  return depth_a < depth_b ? 1 : depth_a > depth_b ? -1 : 0;
+}
+
+// lowers the deepest queues to a common level, just enough to cover the excess: if one
+// call holds most of the audio it alone gives up some, otherwise the top few do
+static void
+gst_ws_budget_rebalance(guint64 max)
+{
+  guint64 asked, excess, sum = 0, level = 0;
+  guint n, i;
+
+  g_mutex_lock(&lock);
+  // another member may have rebalanced while this one waited for the lock. what is
+  // already asked for counts, so a burst does not trim the same audio twice.
+  asked = __atomic_load_n(&pending, __ATOMIC_RELAXED);
+  excess = gst_ws_budget_get_total();
+  excess = excess > asked + max - max / 8 ? excess - asked - (max - max / 8) : 0;
+  n = members ? members->len : 0;
+  if (excess == 0 || n == 0) {
+    g_mutex_unlock(&lock);
+    return;
+  }
+
+  if (n > depths_size) {
+    depths_size = MAX(n, depths_size * 2);
+    depths = g_renew(GstWsBudgetDepth, depths, depths_size);
+  }
+  for (i = 0; i < n; i++) {
+    GstWsBudget *member = g_ptr_array_index(members, i);
+    guint64 queued = __atomic_load_n(&member->queued, __ATOMIC_RELAXED);
+    guint64 shed = __atomic_load_n(&member->shed, __ATOMIC_RELAXED);
+
+    depths[i].member = member;
+    depths[i].depth = queued > shed ? queued - shed : 0;
+  }
+
+  qsort(depths, n, sizeof(*depths), gst_ws_budget_compare_depth);
+  for (i = 0; i < n; i++) {
+    guint64 next = i + 1 < n ? depths[i + 1].depth : 0;
+
+    sum += depths[i].depth;
+    if (sum - (i + 1) * next >= excess) {
+      level = (sum - excess) / (i + 1);
+      break;
+    }
+  }
+  for (guint j = 0; j <= i && j < n; j++) {
+    if (depths[j].depth > level) {
+      // pending is raised first. a take racing with this may still see it briefly low,
+      // which only delays the next rebalance
+      __atomic_fetch_add(&pending, depths[j].depth - level, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&depths[j].member->shed, depths[j].depth - level, __ATOMIC_RELAXED);
+    }
+  }
+  GST_DEBUG("Over the budget of %" G_GUINT64_FORMAT " bytes, trimming %u queues to %"
+      G_GUINT64_FORMAT " bytes", max, MIN(i + 1, n), level);
+  g_mutex_unlock(&lock);
+}
+
+void
+gst_ws_budget_add(GstWsBudget *budget, gsize bytes)
+{
+  guint64 max = gst_ws_budget_get_limit();
+  guint64 sum;
+
+  __atomic_fetch_add(&budget->queued, bytes, __ATOMIC_RELAXED);
+  sum = __atomic_add_fetch(&total, bytes, __ATOMIC_RELAXED);
+  if (max == 0 || sum <= max)
+    return;
+
+  // over the limit until the asked for audio is shed. that is no news: only an overrun
+  // net of it, an eighth of the limit after the last rebalance, takes the lock
+  if (sum - MIN(sum, __atomic_load_n(&pending, __ATOMIC_RELAXED)) > max)
+    gst_ws_budget_rebalance(max);
+}
+
+void
+gst_ws_budget_remove(GstWsBudget *budget, gsize bytes)
+{
+  __atomic_fetch_sub(&budget->queued, bytes, __ATOMIC_RELAXED);
+  __atomic_fetch_sub(&total, bytes, __ATOMIC_RELAXED);
+}
+
+guint64
+gst_ws_budget_get_queued(GstWsBudget *budget)
+{
+  return __atomic_load_n(&budget->queued, __ATOMIC_RELAXED);
+}
+
+guint64
+gst_ws_budget_take_shed(GstWsBudget *budget)
+{
+  // the common case is a plain load, the exchange only runs when there is something
+  guint64 shed;
+
+  if (__atomic_load_n(&budget->shed, __ATOMIC_RELAXED) == 0)
+    return 0;
+  shed = __atomic_exchange_n(&budget->shed, 0, __ATOMIC_RELAXED);
+  __atomic_fetch_sub(&pending, shed, __ATOMIC_RELAXED);
+  return shed;
+}
@@ -0,0 +1,34 @@
+#ifndef __GST_WS_BUDGET_H__
+#define __GST_WS_BUDGET_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// process-wide accounting of the audio waiting in receive queues. every element is a
+// member, so a limit set at any time covers all of them. adding and removing bytes is
+// a pair of atomic adds. only when an add takes the process over its limit, net of
+// what members were already asked to shed, are the members scanned, under a lock, and
+// the deepest queues asked to shed bytes until the total is an eighth under the limit.
+// they shed on their own threads, at their next enqueue or output frame, so the limit
+// may be overshot for about a frame.
+typedef struct _GstWsBudget GstWsBudget;
+
+GstWsBudget *gst_ws_budget_join(void);
+// what the member still holds is taken off the total
+void gst_ws_budget_leave(GstWsBudget *budget);
+
+// 0 removes the limit
+void gst_ws_budget_set_limit(guint64 bytes);
+guint64 gst_ws_budget_get_limit(void);
+guint64 gst_ws_budget_get_total(void);
+
+void gst_ws_budget_add(GstWsBudget *budget, gsize bytes);
+void gst_ws_budget_remove(GstWsBudget *budget, gsize bytes);
+guint64 gst_ws_budget_get_queued(GstWsBudget *budget);
+// bytes the member was asked to drop since the last call, oldest audio first
+guint64 gst_ws_budget_take_shed(GstWsBudget *budget);
+
+G_END_DECLS
+
+#endif /* __GST_WS_BUDGET_H__ */
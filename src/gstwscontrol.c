@@ -0,0 +1,200 @@
+#include "gstwscontrol.h"
+#include <string.h>
+
+static const gchar *
+gst_ws_control_skip_ws(const gchar *p, const gchar *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    p++;
+  return p;
+}
+
+// scans a string starting after its opening quote. strings with escapes are left to the
+// full parser, so the slice can be used as is. a raw control character is not JSON.
+static const gchar *
+gst_ws_control_scan_string(const gchar *p, const gchar *end, const gchar **start, gsize *len)
+{
+  const gchar *s = p;
+
+  while (p < end && *p != '"') {
+    if (*p == '\\' || (guchar)*p < 0x20)
+      return NULL;
+    p++;
+  }
+  if (p >= end)
+    return NULL;
+
+  *start = s;
+  *len = p - s;
+  return p + 1;
+}
+
+static const gchar *
+gst_ws_control_scan_digits(const gchar *p, const gchar *end)
+{
+  const gchar *s = p;
+
+  while (p < end && *p >= '0' && *p <= '9')
+    p++;
+  return p > s ? p : NULL;
+}
+
+// scans a number or a literal the way the JSON grammar spells it, returning the end of
+// the value or NULL when it is not one
+static const gchar *
+gst_ws_control_scan_scalar(const gchar *p, const gchar *end)
+{
+  static const gchar *const literals[] = { "true", "false", "null" };
+
+  for (guint i = 0; i < G_N_ELEMENTS(literals); i++) {
+    gsize n = strlen(literals[i]);
+
+    if (*p == literals[i][0])
+      return (gsize)(end - p) >= n && memcmp(p, literals[i], n) == 0 ? p + n : NULL;
+  }
+
+  if (*p == '-')
+    p++;
+  if (p < end && *p == '0')
+    p++;
+  else if (!(p = gst_ws_control_scan_digits(p, end)))
+    return NULL;
+  if (p < end && *p == '.' && !(p = gst_ws_control_scan_digits(p + 1, end)))
+    return NULL;
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    if (p < end && (*p == '+' || *p == '-'))
+      p++;
+    if (!(p = gst_ws_control_scan_digits(p, end)))
+      return NULL;
+  }
+  return p;
+}
+
+static gboolean
+gst_ws_control_key_is(const gchar *key, gsize len, const gchar *name)
+{
+  gsize n = strlen(name);
+  return len == n && memcmp(key, name, n) == 0;
+}
+
+// recognizes flat JSON objects whose values are plain strings or scalars, which is
+// what control messages look like, without allocating. anything else (nesting,
+// escapes, a non-string type) returns FALSE and is handed to json-glib instead, so
+// the fast path never has to be a complete JSON implementation.
+gboolean
+gst_ws_control_scan(const gchar *data, gsize size, GstWsControlFields *fields)
+{
+  const gchar *p = data;
+  const gchar *end = data + size;
+
+  memset(fields, 0, sizeof(*fields));
+
+  p = gst_ws_control_skip_ws(p, end);
+  if (p >= end || *p++ != '{')
+    return FALSE;
+
+  p = gst_ws_control_skip_ws(p, end);
+  if (p < end && *p == '}')
+    return gst_ws_control_skip_ws(p + 1, end) == end;
+
+  while (p < end) {
+    const gchar *key, *value = NULL, *scalar = NULL;
+    gsize key_len, value_len = 0;
+
+    if (*p++ != '"')
+      return FALSE;
+    if (!(p = gst_ws_control_scan_string(p, end, &key, &key_len)))
+      return FALSE;
+
+    p = gst_ws_control_skip_ws(p, end);
+    if (p >= end || *p++ != ':')
+      return FALSE;
+    p = gst_ws_control_skip_ws(p, end);
+    if (p >= end)
+      return FALSE;
+
+    if (*p == '"') {
+      if (!(p = gst_ws_control_scan_string(p + 1, end, &value, &value_len)))
+        return FALSE;
+    } else if (*p == '-' || (*p >= '0' && *p <= '9') || *p == 't' || *p == 'f' || *p == 'n') {
+      // scalars are skipped, apart from the stream id
+      scalar = p;
+      if (!(p = gst_ws_control_scan_scalar(p, end)))
+        return FALSE;
+    } else {
+      return FALSE;
+    }
+
+    if (gst_ws_control_key_is(key, key_len, "type")) {
+      if (!value)
+        return FALSE;
+      fields->type = value;
+      fields->type_len = value_len;
+    } else if (gst_ws_control_key_is(key, key_len, "id")) {
+      if (!value)
+        return FALSE;
+      fields->id = value;
+      fields->id_len = value_len;
+    } else if (gst_ws_control_key_is(key, key_len, "name")) {
+      if (!value)
+        return FALSE;
+      fields->name = value;
+      fields->name_len = value_len;
+    } else if (gst_ws_control_key_is(key, key_len, "stream")) {
+      guint stream = 0;
+
+      if (!scalar || scalar == p || p - scalar > 5)
+        return FALSE;
+      for (const gchar *d = scalar; d < p; d++) {
+        if (*d < '0' || *d > '9')
+          return FALSE;
+        stream = stream * 10 + (guint)(*d - '0');
+      }
+      if (stream > G_MAXUINT16)
+        return FALSE;
+      fields->has_stream = TRUE;
+      fields->stream = stream;
+    }
+
+    p = gst_ws_control_skip_ws(p, end);
+    if (p >= end)
+      return FALSE;
+    if (*p == '}')
+      return gst_ws_control_skip_ws(p + 1, end) == end;
+    if (*p++ != ',')
+      return FALSE;
+    p = gst_ws_control_skip_ws(p, end);
+  }
+
+  return FALSE;
+}
+
+// constant time: the length picks at most one candidate to compare against
+GstWsControlType
+gst_ws_control_type_lookup(const gchar *type, gsize len)
+{
+  if (!type)
+    return GST_WS_CONTROL_UNKNOWN;
+
+  switch (len) {
+    case 4:
+      if (memcmp(type, "mark", 4) == 0)
+        return GST_WS_CONTROL_MARK;
+      break;
+    case 5:
+      if (memcmp(type, "clear", 5) == 0)
+        return GST_WS_CONTROL_CLEAR;
+      if (memcmp(type, "pause", 5) == 0)
+        return GST_WS_CONTROL_PAUSE;
+      break;
+    case 6:
+      if (memcmp(type, "resume", 6) == 0)
+        return GST_WS_CONTROL_RESUME;
+      break;
+    default:
+      break;
+  }
+
+  return GST_WS_CONTROL_UNKNOWN;
+}
@@ -0,0 +1,38 @@
+#ifndef __GST_WS_CONTROL_H__
+#define __GST_WS_CONTROL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_WS_CONTROL_UNKNOWN,
+  GST_WS_CONTROL_CLEAR,
+  GST_WS_CONTROL_MARK,
+  GST_WS_CONTROL_PAUSE,
+  GST_WS_CONTROL_RESUME,
+} GstWsControlType;
+
+// the fields of a control message the element acts on. the strings are not copied and
+// not NUL terminated: they point into the message (or the parser that produced them)
+// and are only valid while it is.
+typedef struct
+{
+  const gchar *type;
+  gsize type_len;
+  const gchar *id;
+  gsize id_len;
+  const gchar *name;
+  gsize name_len;
+  // the stream a message on a multiplexed connection is meant for
+  gboolean has_stream;
+  guint stream;
+} GstWsControlFields;
+
+gboolean gst_ws_control_scan(const gchar *data, gsize size, GstWsControlFields *fields);
+GstWsControlType gst_ws_control_type_lookup(const gchar *type, gsize len);
+
+G_END_DECLS
+
+#endif /* __GST_WS_CONTROL_H__ */
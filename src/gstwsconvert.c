@@ -0,0 +1,607 @@
+#include "gstwsconvert.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define GST_WS_CONVERT_AVX2 1
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define GST_WS_CONVERT_NEON 1
+#endif
+
+// prototype filter length per unit of the larger resampling factor. 16 gives about
+// 60 dB of stopband at a transition of a tenth of the output band, plenty for speech.
+#define GST_WS_RESAMPLER_TAPS 16
+// largest reduced up or down factor, so filters stay a few hundred taps at most
+#define GST_WS_RESAMPLER_MAX_FACTOR 8
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define GST_WS_S16_NATIVE GST_WS_SAMPLE_FORMAT_S16LE
+#define GST_WS_S16_SWAPPED GST_WS_SAMPLE_FORMAT_S16BE
+#define GST_WS_F32_NATIVE GST_WS_SAMPLE_FORMAT_F32LE
+#define GST_WS_F32_SWAPPED GST_WS_SAMPLE_FORMAT_F32BE
+#define GST_WS_READ_FLOAT_SWAPPED GST_READ_FLOAT_BE
+#define GST_WS_WRITE_FLOAT_SWAPPED GST_WRITE_FLOAT_BE
+#else
+#define GST_WS_S16_NATIVE GST_WS_SAMPLE_FORMAT_S16BE
+#define GST_WS_S16_SWAPPED GST_WS_SAMPLE_FORMAT_S16LE
+#define GST_WS_F32_NATIVE GST_WS_SAMPLE_FORMAT_F32BE
+#define GST_WS_F32_SWAPPED GST_WS_SAMPLE_FORMAT_F32LE
+#define GST_WS_READ_FLOAT_SWAPPED GST_READ_FLOAT_LE
+#define GST_WS_WRITE_FLOAT_SWAPPED GST_WRITE_FLOAT_LE
+#endif
+
+static gint16 gst_ws_mulaw_table[256];
+static gint16 gst_ws_alaw_table[256];
+
+// G.711 decoding is a table lookup, encoding stays a per-sample computation since its
+// table would be 64 KiB per law
+static void
+gst_ws_convert_init_tables(void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    for (guint i = 0; i < 256; i++) {
+      gst_ws_mulaw_table[i] = (gint16)gst_ws_mulaw_to_linear(i);
+      gst_ws_alaw_table[i] = (gint16)gst_ws_alaw_to_linear(i);
+    }
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+#ifdef GST_WS_CONVERT_AVX2
+static gboolean
+gst_ws_convert_have_avx2(void)
+{
+  static gint have_avx2 = -1;
+  gint cached = g_atomic_int_get(&have_avx2);
+
+  if (cached < 0) {
+    __builtin_cpu_init();
+    cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+    g_atomic_int_set(&have_avx2, cached);
+  }
+  return cached;
+}
+
+// the AVX2 loops return how many samples they did, the caller finishes the rest
+__attribute__((target("avx2")))
+static gsize
+gst_ws_f32_to_s16_avx2(const guint8 *src, gint16 *dst, gsize n)
+{
+  const __m256 scale = _mm256_set1_ps(32768.0f);
+  const __m256 lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+  gsize i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m256 a = _mm256_loadu_ps((const float *)(src + i * 4));
+    __m256 b = _mm256_loadu_ps((const float *)(src + i * 4 + 32));
+    __m256i packed;
+
+    a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(a, scale), lo), hi);
+    b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(b, scale), lo), hi);
+    // packs works per 128-bit lane, the permute puts the quarters back in order
+    packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+    packed = _mm256_permute4x64_epi64(packed, 0xD8);
+    _mm256_storeu_si256((__m256i *)(dst + i), packed);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static gsize
+gst_ws_s16_to_f32_avx2(const gint16 *src, guint8 *dst, gsize n)
+{
+  const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+  gsize i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+    _mm256_storeu_ps((float *)(dst + i * 4), _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+  }
+  return i;
+}
+#endif
+
+static inline gint16
+gst_ws_float_to_s16(gfloat f)
+{
+  f *= 32768.0f;
+  if (f >= 32767.0f)
+    return 32767;
+  if (f <= -32768.0f)
+    return -32768;
+  return (gint16)(f >= 0.0f ? f + 0.5f : f - 0.5f);
+}
+
+static void
+gst_ws_swap16(const guint8 *src, gint16 *dst, gsize n)
+{
+  gsize i = 0;
+
+#if defined(__SSE2__)
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 2));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8),
+        _mm_srli_epi16(v, 8)));
+  }
+#elif defined(GST_WS_CONVERT_NEON)
+  for (; i + 8 <= n; i += 8)
+    vst1q_s16(dst + i, vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(src + i * 2))));
+#endif
+  for (; i < n; i++) {
+    guint16 v;
+
+    memcpy(&v, src + i * 2, 2);
+    dst[i] = (gint16)GUINT16_SWAP_LE_BE(v);
+  }
+}
+
+static void
+gst_ws_f32_to_s16(const guint8 *src, gint16 *dst, gsize n)
+{
+  gsize i = 0;
+
+#ifdef GST_WS_CONVERT_AVX2
+  if (gst_ws_convert_have_avx2())
+    i = gst_ws_f32_to_s16_avx2(src, dst, n);
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+
+    for (; i + 8 <= n; i += 8) {
+      __m128 a = _mm_loadu_ps((const float *)(src + i * 4));
+      __m128 b = _mm_loadu_ps((const float *)(src + i * 4 + 16));
+
+      // clamped first: cvtps turns out-of-range values into INT_MIN, not a saturation
+      a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(a, scale), lo), hi);
+      b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(b, scale), lo), hi);
+      _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(a),
+          _mm_cvtps_epi32(b)));
+    }
+  }
+#elif defined(GST_WS_CONVERT_NEON)
+  for (; i + 8 <= n; i += 8) {
+    float32x4_t a = vmulq_n_f32(vld1q_f32((const float *)(src + i * 4)), 32768.0f);
+    float32x4_t b = vmulq_n_f32(vld1q_f32((const float *)(src + i * 4 + 16)), 32768.0f);
+
+    // vcvtnq rounds to nearest and saturates, vqmovn saturates again to 16 bits
+    vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)),
+        vqmovn_s32(vcvtnq_s32_f32(b))));
+  }
+#endif
+  for (; i < n; i++) {
+    gfloat f;
+
+    memcpy(&f, src + i * 4, 4);
+    dst[i] = gst_ws_float_to_s16(f);
+  }
+}
+
+static void
+gst_ws_s16_to_f32(const gint16 *src, guint8 *dst, gsize n)
+{
+  gsize i = 0;
+
+#ifdef GST_WS_CONVERT_AVX2
+  if (gst_ws_convert_have_avx2())
+    i = gst_ws_s16_to_f32_avx2(src, dst, n);
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+    for (; i + 8 <= n; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+      // duplicating each sample into both halves and shifting back sign-extends it
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+      _mm_storeu_ps((float *)(dst + i * 4), _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps((float *)(dst + i * 4 + 16), _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+  }
+#elif defined(GST_WS_CONVERT_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v = vld1q_s16(src + i);
+
+    vst1q_f32((float *)(dst + i * 4),
+        vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.0f / 32768.0f));
+    vst1q_f32((float *)(dst + i * 4 + 16),
+        vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.0f / 32768.0f));
+  }
+#endif
+  for (; i < n; i++) {
+    gfloat f = src[i] / 32768.0f;
+
+    memcpy(dst + i * 4, &f, 4);
+  }
+}
+
+void
+gst_ws_convert_to_s16(GstWsSampleFormat format, gconstpointer src, gint16 *dst,
+    gsize samples)
+{
+  const guint8 *p = src;
+
+  gst_ws_convert_init_tables();
+
+  switch (format) {
+    case GST_WS_S16_NATIVE:
+      memcpy(dst, p, samples * 2);
+      break;
+    case GST_WS_S16_SWAPPED:
+      gst_ws_swap16(p, dst, samples);
+      break;
+    case GST_WS_SAMPLE_FORMAT_S32LE:
+      for (gsize i = 0; i < samples; i++)
+        dst[i] = (gint16)((gint32)GST_READ_UINT32_LE(p + i * 4) >> 16);
+      break;
+    case GST_WS_SAMPLE_FORMAT_S32BE:
+      for (gsize i = 0; i < samples; i++)
+        dst[i] = (gint16)((gint32)GST_READ_UINT32_BE(p + i * 4) >> 16);
+      break;
+    case GST_WS_F32_NATIVE:
+      gst_ws_f32_to_s16(p, dst, samples);
+      break;
+    case GST_WS_F32_SWAPPED:
+      for (gsize i = 0; i < samples; i++)
+        dst[i] = gst_ws_float_to_s16(GST_WS_READ_FLOAT_SWAPPED(p + i * 4));
+      break;
+    case GST_WS_SAMPLE_FORMAT_MULAW:
+      for (gsize i = 0; i < samples; i++)
+        dst[i] = gst_ws_mulaw_table[p[i]];
+      break;
+    case GST_WS_SAMPLE_FORMAT_ALAW:
+      for (gsize i = 0; i < samples; i++)
+        dst[i] = gst_ws_alaw_table[p[i]];
+      break;
+    default:
+      memset(dst, 0, samples * 2);
+      break;
+  }
+}
+
+void
+gst_ws_convert_from_s16(GstWsSampleFormat format, const gint16 *src, gpointer dst,
+    gsize samples)
+{
+  guint8 *p = dst;
+
+  switch (format) {
+    case GST_WS_S16_NATIVE:
+      memcpy(p, src, samples * 2);
+      break;
+    case GST_WS_S16_SWAPPED:
+      // the swap is its own inverse
+      gst_ws_swap16((const guint8 *)src, (gint16 *)p, samples);
+      break;
+    case GST_WS_SAMPLE_FORMAT_S32LE:
+      for (gsize i = 0; i < samples; i++)
+        GST_WRITE_UINT32_LE(p + i * 4, (guint32)src[i] << 16);
+      break;
+    case GST_WS_SAMPLE_FORMAT_S32BE:
+      for (gsize i = 0; i < samples; i++)
+        GST_WRITE_UINT32_BE(p + i * 4, (guint32)src[i] << 16);
+      break;
+    case GST_WS_F32_NATIVE:
+      gst_ws_s16_to_f32(src, p, samples);
+      break;
+    case GST_WS_F32_SWAPPED:
+      for (gsize i = 0; i < samples; i++)
+        GST_WS_WRITE_FLOAT_SWAPPED(p + i * 4, src[i] / 32768.0f);
+      break;
+    case GST_WS_SAMPLE_FORMAT_MULAW:
+      for (gsize i = 0; i < samples; i++)
+        p[i] = gst_ws_linear_to_mulaw(src[i]);
+      break;
+    case GST_WS_SAMPLE_FORMAT_ALAW:
+      for (gsize i = 0; i < samples; i++)
+        p[i] = gst_ws_linear_to_alaw(src[i]);
+      break;
+    default:
+      break;
+  }
+}
+
+// output frame n sits at position n * down in the input upsampled by up. its samples are
+// one phase of the prototype filter (position % up) applied to the inputs just before
+// position / up. coefficients are stored reversed per phase, so the dot product walks
+// the input forwards and vectorizes for mono.
+struct _GstWsResampler
+{
+  guint channels;
+  guint up;
+  guint down;
+  guint taps;
+  gfloat *coeffs;
+  // the last taps - 1 input frames of the previous call
+  gint16 *history;
+  gint16 *work;
+  gsize work_frames;
+  // upsampled position of the next output, relative to the next input frame
+  guint64 position;
+};
+
+static guint
+gst_ws_gcd(guint a, guint b)
+{
+  while (b) {
+    guint t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+gboolean
+gst_ws_resampler_supports(guint in_rate, guint out_rate)
+{
+  guint g;
+
+  if (in_rate == 0 || out_rate == 0)
+    return FALSE;
+  g = gst_ws_gcd(in_rate, out_rate);
+  return in_rate / g <= GST_WS_RESAMPLER_MAX_FACTOR &&
+      out_rate / g <= GST_WS_RESAMPLER_MAX_FACTOR;
+}
+
+// Blackman-windowed sinc, cut off a little below the lower of the two Nyquist rates.
+// every phase is normalized to unity gain so DC passes through without ripple.
+GstWsResampler *
+gst_ws_resampler_new(guint in_rate, guint out_rate, guint channels)
+{
+  GstWsResampler *resampler;
+  guint g, factor, length;
+  gdouble cutoff, center;
+
+  g_return_val_if_fail(gst_ws_resampler_supports(in_rate, out_rate), NULL);
+  g_return_val_if_fail(channels > 0, NULL);
+
+  g = gst_ws_gcd(in_rate, out_rate);
+  resampler = g_new0(GstWsResampler, 1);
+  resampler->channels = channels;
+  resampler->up = out_rate / g;
+  resampler->down = in_rate / g;
+  factor = MAX(resampler->up, resampler->down);
+  resampler->taps = (GST_WS_RESAMPLER_TAPS * factor + resampler->up - 1) / resampler->up;
+  length = resampler->taps * resampler->up;
+  resampler->coeffs = g_new0(gfloat, length);
+  resampler->history = g_new0(gint16, (resampler->taps - 1) * channels);
+
+  cutoff = 0.45 / factor;
+  center = (length - 1) / 2.0;
+  for (guint n = 0; n < length; n++) {
+    gdouble x = n - center;
+    gdouble sinc = x == 0.0 ? 2.0 * cutoff : sin(2.0 * G_PI * cutoff * x) / (G_PI * x);
+    gdouble window = length > 1 ? 0.42 - 0.5 * cos(2.0 * G_PI * n / (length - 1)) +
+        0.08 * cos(4.0 * G_PI * n / (length - 1)) : 1.0;
+    guint phase = n % resampler->up, k = n / resampler->up;
+
+    resampler->coeffs[phase * resampler->taps + (resampler->taps - 1 - k)] =
+        (gfloat)(sinc * window);
+  }
+  for (guint phase = 0; phase < resampler->up; phase++) {
+    gfloat *h = resampler->coeffs + phase * resampler->taps;
+    gdouble sum = 0.0;
+
+    for (guint k = 0; k < resampler->taps; k++)
+      sum += h[k];
+    for (guint k = 0; sum != 0.0 && k < resampler->taps; k++)
+      h[k] = (gfloat)(h[k] / sum);
+  }
+
+  return resampler;
+}
+
+void
+gst_ws_resampler_free(GstWsResampler *resampler)
+{
+  if (!resampler)
+    return;
+
+  g_free(resampler->coeffs);
+  g_free(resampler->history);
+  g_free(resampler->work);
+  g_free(resampler);
+}
+
+void
+gst_ws_resampler_reset(GstWsResampler *resampler)
+{
+  memset(resampler->history, 0, (resampler->taps - 1) * resampler->channels * sizeof(gint16));
+  resampler->position = 0;
+}
+
+gsize
+gst_ws_resampler_max_output(GstWsResampler *resampler, gsize in_frames)
+{
+  return ((guint64)in_frames * resampler->up + resampler->down - 1) / resampler->down + 1;
+}
+
+gsize
+gst_ws_resampler_process(GstWsResampler *resampler, const gint16 *in, gsize in_frames,
+    gint16 *out)
+{
+  guint channels = resampler->channels, taps = resampler->taps;
+  gsize history = taps - 1;
+  gsize needed = history + in_frames, produced = 0;
+  guint64 end = (guint64)in_frames * resampler->up, t;
+
+  if (needed > resampler->work_frames) {
+    resampler->work = g_renew(gint16, resampler->work, needed * channels);
+    resampler->work_frames = needed;
+  }
+  memcpy(resampler->work, resampler->history, history * channels * sizeof(gint16));
+  memcpy(resampler->work + history * channels, in, in_frames * channels * sizeof(gint16));
+
+  for (t = resampler->position; t < end; t += resampler->down) {
+    const gfloat *h = resampler->coeffs + (t % resampler->up) * taps;
+    // the oldest of the taps input frames this output depends on
+    const gint16 *x = resampler->work + (t / resampler->up) * channels;
+
+    for (guint c = 0; c < channels; c++) {
+      gfloat acc = 0.0f;
+
+      for (guint k = 0; k < taps; k++)
+        acc += h[k] * x[k * channels + c];
+      acc = CLAMP(acc, -32768.0f, 32767.0f);
+      out[produced * channels + c] = (gint16)(acc >= 0.0f ? acc + 0.5f : acc - 0.5f);
+    }
+    produced++;
+  }
+
+  resampler->position = t - end;
+  memcpy(resampler->history, resampler->work + in_frames * channels,
+      history * channels * sizeof(gint16));
+  return produced;
+}
+
+struct _GstWsConverter
+{
+  GstWsSampleFormat in_format;
+  GstWsSampleFormat out_format;
+  guint in_width;
+  guint out_width;
+  guint channels;
+  guint out_rate;
+  GstWsResampler *resampler;
+  // scratch space, grown to the largest buffer seen and then reused
+  gint16 *pcm;
+  gsize pcm_samples;
+  gint16 *resampled;
+  gsize resampled_samples;
+  // a partial input frame left over from the previous buffer, at most 2 x 4 bytes
+  guint8 stash[8];
+  guint stash_len;
+};
+
+GstWsConverter *
+gst_ws_converter_new(GstWsSampleFormat in_format, guint in_rate,
+    GstWsSampleFormat out_format, guint out_rate, guint channels, GError **error)
+{
+  GstWsConverter *converter;
+
+  if (gst_ws_sample_format_width(in_format) == 0 ||
+      gst_ws_sample_format_width(out_format) == 0 || channels < 1 || channels > 2) {
+    g_set_error(error, GST_STREAM_ERROR, GST_STREAM_ERROR_FORMAT,
+        "Cannot convert this audio format for the wire");
+    return NULL;
+  }
+  if (in_rate != out_rate && !gst_ws_resampler_supports(in_rate, out_rate)) {
+    g_set_error(error, GST_STREAM_ERROR, GST_STREAM_ERROR_FORMAT,
+        "Cannot resample %u Hz to %u Hz, the rates must be in a small integer ratio",
+        in_rate, out_rate);
+    return NULL;
+  }
+
+  converter = g_new0(GstWsConverter, 1);
+  converter->in_format = in_format;
+  converter->out_format = out_format;
+  converter->in_width = gst_ws_sample_format_width(in_format);
+  converter->out_width = gst_ws_sample_format_width(out_format);
+  converter->channels = channels;
+  converter->out_rate = out_rate;
+  if (in_rate != out_rate)
+    converter->resampler = gst_ws_resampler_new(in_rate, out_rate, channels);
+  return converter;
+}
+
+void
+gst_ws_converter_free(GstWsConverter *converter)
+{
+  if (!converter)
+    return;
+
+  gst_ws_resampler_free(converter->resampler);
+  g_free(converter->pcm);
+  g_free(converter->resampled);
+  g_free(converter);
+}
+
+void
+gst_ws_converter_reset(GstWsConverter *converter)
+{
+  converter->stash_len = 0;
+  if (converter->resampler)
+    gst_ws_resampler_reset(converter->resampler);
+}
+
+GstBuffer *
+gst_ws_converter_process(GstWsConverter *converter, GstBuffer *buffer)
+{
+  guint in_bpf = converter->in_width * converter->channels;
+  GstClockTime pts = GST_BUFFER_PTS(buffer);
+  GstMapInfo map;
+  const guint8 *data;
+  guint8 *joined = NULL;
+  gsize size, frames, out_frames;
+  const gint16 *pcm;
+  GstBuffer *out;
+
+  if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    gst_buffer_unref(buffer);
+    return NULL;
+  }
+
+  data = map.data;
+  size = map.size;
+  if (converter->stash_len > 0) {
+    joined = g_malloc(converter->stash_len + size);
+    memcpy(joined, converter->stash, converter->stash_len);
+    memcpy(joined + converter->stash_len, map.data, size);
+    data = joined;
+    size += converter->stash_len;
+  }
+
+  frames = size / in_bpf;
+  converter->stash_len = size - frames * in_bpf;
+  memcpy(converter->stash, data + frames * in_bpf, converter->stash_len);
+
+  if (frames * converter->channels > converter->pcm_samples) {
+    converter->pcm_samples = frames * converter->channels;
+    converter->pcm = g_renew(gint16, converter->pcm, converter->pcm_samples);
+  }
+  gst_ws_convert_to_s16(converter->in_format, data, converter->pcm,
+      frames * converter->channels);
+
+  gst_buffer_unmap(buffer, &map);
+  gst_buffer_unref(buffer);
+  g_free(joined);
+
+  pcm = converter->pcm;
+  out_frames = frames;
+  if (converter->resampler) {
+    gsize max = gst_ws_resampler_max_output(converter->resampler, frames) * converter->channels;
+
+    if (max > converter->resampled_samples) {
+      converter->resampled_samples = max;
+      converter->resampled = g_renew(gint16, converter->resampled, max);
+    }
+    out_frames = gst_ws_resampler_process(converter->resampler, converter->pcm, frames,
+        converter->resampled);
+    pcm = converter->resampled;
+  }
+  if (out_frames == 0)
+    return NULL;
+
+  out = gst_buffer_new_allocate(NULL, out_frames * converter->channels * converter->out_width,
+      NULL);
+  gst_buffer_map(out, &map, GST_MAP_WRITE);
+  gst_ws_convert_from_s16(converter->out_format, pcm, map.data,
+      out_frames * converter->channels);
+  gst_buffer_unmap(out, &map);
+
+  GST_BUFFER_PTS(out) = pts;
+  GST_BUFFER_DURATION(out) = gst_util_uint64_scale(out_frames, GST_SECOND,
+      converter->out_rate);
+  return out;
+}
@@ -0,0 +1,49 @@
+#ifndef __GST_WS_CONVERT_H__
+#define __GST_WS_CONVERT_H__
+
+#include <gst/gst.h>
+
+#include "gstwsaudio.h"
+
+G_BEGIN_DECLS
+
+// sample format and rate conversion between the pads and the wire, for wire-format and
+// wire-rate. every conversion goes through interleaved S16 in host byte order: the
+// kernels convert to and from it (vectorized where the target has SSE2, AVX2 or NEON),
+// and the resampler works on it. float audio is therefore carried at 16-bit precision,
+// which is what the wire formats offer anyway.
+void gst_ws_convert_to_s16(GstWsSampleFormat format, gconstpointer src, gint16 *dst,
+    gsize samples);
+void gst_ws_convert_from_s16(GstWsSampleFormat format, const gint16 *src, gpointer dst,
+    gsize samples);
+
+// polyphase FIR resampler for rates in a small integer ratio, such as any two of 8, 16,
+// 24, 32 and 48 kHz. it keeps the filter history across calls, so a stream can be fed
+// in pieces of any size.
+typedef struct _GstWsResampler GstWsResampler;
+
+gboolean gst_ws_resampler_supports(guint in_rate, guint out_rate);
+GstWsResampler *gst_ws_resampler_new(guint in_rate, guint out_rate, guint channels);
+void gst_ws_resampler_free(GstWsResampler *resampler);
+void gst_ws_resampler_reset(GstWsResampler *resampler);
+// upper bound of the frames one call produces from in_frames
+gsize gst_ws_resampler_max_output(GstWsResampler *resampler, gsize in_frames);
+gsize gst_ws_resampler_process(GstWsResampler *resampler, const gint16 *in,
+    gsize in_frames, gint16 *out);
+
+// one direction of the conversion. used from one thread at a time.
+typedef struct _GstWsConverter GstWsConverter;
+
+GstWsConverter *gst_ws_converter_new(GstWsSampleFormat in_format, guint in_rate,
+    GstWsSampleFormat out_format, guint out_rate, guint channels, GError **error);
+void gst_ws_converter_free(GstWsConverter *converter);
+// converts a buffer, keeping its PTS and setting the duration of the output. a trailing
+// partial sample is held back for the next call. returns NULL when nothing came out.
+GstBuffer *gst_ws_converter_process(GstWsConverter *converter, GstBuffer *buffer);
+// forgets the held back partial sample and the resampler state, for a stream that starts
+// over and must not continue the old one
+void gst_ws_converter_reset(GstWsConverter *converter);
+
+G_END_DECLS
+
+#endif /* __GST_WS_CONVERT_H__ */
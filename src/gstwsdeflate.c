@@ -0,0 +1,360 @@
+#include "gstwsdeflate.h"
+
+#include <string.h>
+#include <zlib.h>
+
+GST_DEBUG_CATEGORY_STATIC(gst_ws_deflate_debug);
+#define GST_CAT_DEFAULT gst_ws_deflate_debug
+
+// upper bound of an inflated message, so a small compressed message cannot expand into
+// an arbitrary amount of memory
+#define MAX_INFLATED_SIZE (16 * 1024 * 1024)
+#define INFLATE_CHUNK 4096
+
+// every message compressed with a sync flush ends in this empty stored block, which
+// RFC 7692 has the sender strip and the receiver put back
+static const guint8 deflate_trailer[4] = { 0x00, 0x00, 0xff, 0xff };
+
+struct _GstWsDeflate
+{
+  SoupWebsocketExtension parent;
+
+  // outgoing: window wanted by the element and the largest one the server accepts
+  gboolean enabled;
+  guint window_bits;
+  guint peer_window_bits;
+  gboolean reset_output;
+  z_stream deflater;
+  gboolean deflater_ready;
+
+  // incoming
+  gboolean reset_input;
+  gboolean inflating;
+  z_stream inflater;
+  gboolean inflater_ready;
+
+  GstWsDeflateStats stats;
+};
+
+struct _GstWsDeflateClass
+{
+  SoupWebsocketExtensionClass parent_class;
+};
+
+G_DEFINE_TYPE(GstWsDeflate, gst_ws_deflate, SOUP_TYPE_WEBSOCKET_EXTENSION);
+
+static void
+gst_ws_deflate_init(GstWsDeflate *self)
+{
+  self->enabled = TRUE;
+  self->window_bits = GST_WS_DEFLATE_MAX_WINDOW_BITS;
+  self->peer_window_bits = GST_WS_DEFLATE_MAX_WINDOW_BITS;
+}
+
+static void
+gst_ws_deflate_finalize(GObject *object)
+{
+  GstWsDeflate *self = GST_WS_DEFLATE(object);
+
+  if (self->deflater_ready)
+    deflateEnd(&self->deflater);
+  if (self->inflater_ready)
+    inflateEnd(&self->inflater);
+
+  G_OBJECT_CLASS(gst_ws_deflate_parent_class)->finalize(object);
+}
+
+static gboolean
+gst_ws_deflate_parse_window_bits(const gchar *value, guint *window_bits)
+{
+  guint64 bits;
+
+  // RFC 7692 allows 8, which zlib cannot produce for raw streams; 9 is always acceptable
+  // in its place because a window may be smaller than the limit
+  if (!value || !g_ascii_string_to_unsigned(value, 10, 8, 15, &bits, NULL))
+    return FALSE;
+  *window_bits = MAX((guint)bits, GST_WS_DEFLATE_MIN_WINDOW_BITS);
+  return TRUE;
+}
+
+// the server's answer to our offer. the element only ever acts as a client.
+static gboolean
+gst_ws_deflate_configure(SoupWebsocketExtension *extension,
+    SoupWebsocketConnectionType connection_type, GHashTable *params, GError **error)
+{
+  GstWsDeflate *self = GST_WS_DEFLATE(extension);
+  GHashTableIter iter;
+  gpointer key, value;
+
+  if (connection_type != SOUP_WEBSOCKET_CONNECTION_CLIENT) {
+    g_set_error_literal(error, SOUP_WEBSOCKET_ERROR, SOUP_WEBSOCKET_CLOSE_PROTOCOL_ERROR,
+        "permessage-deflate is only implemented for clients");
+    return FALSE;
+  }
+  if (!params)
+    return TRUE;
+
+  g_hash_table_iter_init(&iter, params);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    guint bits;
+
+    if (g_str_equal(key, "client_no_context_takeover")) {
+      self->reset_output = TRUE;
+    } else if (g_str_equal(key, "server_no_context_takeover")) {
+      self->reset_input = TRUE;
+    } else if (g_str_equal(key, "client_max_window_bits")) {
+      if (!gst_ws_deflate_parse_window_bits(value, &bits))
+        goto invalid;
+      self->peer_window_bits = bits;
+    } else if (g_str_equal(key, "server_max_window_bits")) {
+      // incoming messages are inflated with the largest window, which reads any smaller one
+      if (!gst_ws_deflate_parse_window_bits(value, &bits))
+        goto invalid;
+    } else {
+      goto invalid;
+    }
+  }
+  return TRUE;
+
+invalid:
+  g_set_error(error, SOUP_WEBSOCKET_ERROR, SOUP_WEBSOCKET_CLOSE_PROTOCOL_ERROR,
+      "Invalid permessage-deflate parameter %s", (const gchar *)key);
+  return FALSE;
+}
+
+// any window the server wants to limit us to is fine, the element picks its own below it
+static gchar *
+gst_ws_deflate_get_request_params(SoupWebsocketExtension *extension G_GNUC_UNUSED)
+{
+  return g_strdup("; client_max_window_bits");
+}
+
+static GBytes *
+gst_ws_deflate_process_outgoing_message(SoupWebsocketExtension *extension, guint8 *header,
+    GBytes *payload, GError **error)
+{
+  GstWsDeflate *self = GST_WS_DEFLATE(extension);
+  gsize size;
+  const guint8 *data = g_bytes_get_data(payload, &size);
+  guint8 *out;
+  gsize capacity, len;
+
+  if (!self->enabled) {
+    self->stats.out_raw += size;
+    self->stats.out_wire += size;
+    return payload;
+  }
+
+  if (!self->deflater_ready) {
+    guint bits = MIN(self->window_bits, self->peer_window_bits);
+
+    memset(&self->deflater, 0, sizeof(self->deflater));
+    // real-time audio gains little from the slower levels, the fastest keeps the
+    // reactor free for the other connections on it
+    if (deflateInit2(&self->deflater, Z_BEST_SPEED, Z_DEFLATED, -(gint)bits, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK) {
+      g_set_error_literal(error, SOUP_WEBSOCKET_ERROR, SOUP_WEBSOCKET_CLOSE_PROTOCOL_ERROR,
+          "Failed to initialize permessage-deflate compression");
+      g_bytes_unref(payload);
+      return NULL;
+    }
+    self->deflater_ready = TRUE;
+    GST_DEBUG("Compressing outgoing messages with a %u bit window", bits);
+  }
+
+  capacity = deflateBound(&self->deflater, size) + sizeof(deflate_trailer) + 8;
+  out = g_malloc(capacity);
+  self->deflater.next_in = (Bytef *)data;
+  self->deflater.avail_in = size;
+  self->deflater.next_out = out;
+  self->deflater.avail_out = capacity;
+
+  // a sync flush emits everything without ending the stream, so later messages can
+  // refer back into this one unless the server asked for no context takeover
+  do {
+    if (self->deflater.avail_out == 0) {
+      gsize used = capacity;
+      capacity *= 2;
+      out = g_realloc(out, capacity);
+      self->deflater.next_out = out + used;
+      self->deflater.avail_out = capacity - used;
+    }
+    if (deflate(&self->deflater, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+      g_free(out);
+      g_set_error_literal(error, SOUP_WEBSOCKET_ERROR, SOUP_WEBSOCKET_CLOSE_PROTOCOL_ERROR,
+          "permessage-deflate compression failed");
+      g_bytes_unref(payload);
+      return NULL;
+    }
+  } while (self->deflater.avail_out == 0);
+
+  len = capacity - self->deflater.avail_out;
+  if (len >= sizeof(deflate_trailer) &&
+      memcmp(out + len - sizeof(deflate_trailer), deflate_trailer, sizeof(deflate_trailer)) == 0)
+    len -= sizeof(deflate_trailer);
+  // an empty message compresses to nothing once the trailer is gone, RFC 7692 sends a
+  // single empty block instead
+  if (len == 0)
+    out[len++] = 0x00;
+
+  if (self->reset_output)
+    deflateReset(&self->deflater);
+
+  self->stats.out_raw += size;
+  self->stats.out_wire += len;
+  header[0] |= 0x40;
+
+  g_bytes_unref(payload);
+  return g_bytes_new_take(out, len);
+}
+
+static gboolean
+gst_ws_deflate_inflate(GstWsDeflate *self, const guint8 *data, gsize size, GByteArray *out)
+{
+  z_stream *z = &self->inflater;
+
+  z->next_in = (Bytef *)data;
+  z->avail_in = size;
+
+  do {
+    guint used = out->len;
+    gint ret;
+
+    if (used + INFLATE_CHUNK > MAX_INFLATED_SIZE)
+      return FALSE;
+    g_byte_array_set_size(out, used + INFLATE_CHUNK);
+    z->next_out = out->data + used;
+    z->avail_out = INFLATE_CHUNK;
+
+    ret = inflate(z, Z_SYNC_FLUSH);
+    g_byte_array_set_size(out, used + INFLATE_CHUNK - z->avail_out);
+
+    // a sender may end its stream with a final block, the next message starts a new one
+    if (ret == Z_STREAM_END) {
+      inflateReset(z);
+      continue;
+    }
+    if (ret == Z_BUF_ERROR)
+      break;
+    if (ret != Z_OK)
+      return FALSE;
+  } while (z->avail_in > 0 || z->avail_out == 0);
+
+  return TRUE;
+}
+
+static GBytes *
+gst_ws_deflate_process_incoming_message(SoupWebsocketExtension *extension, guint8 *header,
+    GBytes *payload, GError **error)
+{
+  GstWsDeflate *self = GST_WS_DEFLATE(extension);
+  gboolean fin = (header[0] & 0x80) != 0;
+  gboolean continuation = (header[0] & 0x0f) == 0;
+  gsize size;
+  const guint8 *data;
+  GByteArray *out;
+
+  // only the first frame of a message carries RSV1, its continuations follow it
+  if (!(header[0] & 0x40) && !(continuation && self->inflating)) {
+    g_bytes_get_data(payload, &size);
+    self->stats.in_raw += size;
+    self->stats.in_wire += size;
+    return payload;
+  }
+  header[0] &= ~0x40;
+  self->inflating = !fin;
+
+  if (!self->inflater_ready) {
+    memset(&self->inflater, 0, sizeof(self->inflater));
+    if (inflateInit2(&self->inflater, -GST_WS_DEFLATE_MAX_WINDOW_BITS) != Z_OK) {
+      g_set_error_literal(error, SOUP_WEBSOCKET_ERROR, SOUP_WEBSOCKET_CLOSE_PROTOCOL_ERROR,
+          "Failed to initialize permessage-deflate decompression");
+      g_bytes_unref(payload);
+      return NULL;
+    }
+    self->inflater_ready = TRUE;
+  }
+
+  data = g_bytes_get_data(payload, &size);
+  out = g_byte_array_sized_new(MIN(size * 4 + INFLATE_CHUNK, MAX_INFLATED_SIZE));
+  if (!gst_ws_deflate_inflate(self, data, size, out) ||
+      (fin && !gst_ws_deflate_inflate(self, deflate_trailer, sizeof(deflate_trailer), out))) {
+    g_byte_array_unref(out);
+    g_set_error_literal(error, SOUP_WEBSOCKET_ERROR, SOUP_WEBSOCKET_CLOSE_BAD_DATA,
+        "Invalid or oversized permessage-deflate data");
+    g_bytes_unref(payload);
+    return NULL;
+  }
+
+  if (fin && self->reset_input)
+    inflateReset(&self->inflater);
+
+  self->stats.in_wire += size;
+  self->stats.in_raw += out->len;
+
+  g_bytes_unref(payload);
+  return g_byte_array_free_to_bytes(out);
+}
+
+static void
+gst_ws_deflate_class_init(GstWsDeflateClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  SoupWebsocketExtensionClass *extension_class = SOUP_WEBSOCKET_EXTENSION_CLASS(klass);
+
+  gobject_class->finalize = gst_ws_deflate_finalize;
+
+  extension_class->name = "permessage-deflate";
+  extension_class->configure = gst_ws_deflate_configure;
+  extension_class->get_request_params = gst_ws_deflate_get_request_params;
+  extension_class->process_outgoing_message = gst_ws_deflate_process_outgoing_message;
+  extension_class->process_incoming_message = gst_ws_deflate_process_incoming_message;
+
+  GST_DEBUG_CATEGORY_INIT(gst_ws_deflate_debug, "websockettransceiver-deflate", 0,
+      "WebSocket Transceiver permessage-deflate");
+}
+
+void
+gst_ws_deflate_install(SoupSession *session)
+{
+  if (!soup_session_has_feature(session, SOUP_TYPE_WEBSOCKET_EXTENSION_MANAGER))
+    soup_session_add_feature_by_type(session, SOUP_TYPE_WEBSOCKET_EXTENSION_MANAGER);
+  // two extensions of the same name cannot both be offered
+  soup_session_remove_feature_by_type(session, SOUP_TYPE_WEBSOCKET_EXTENSION_DEFLATE);
+  soup_session_add_feature_by_type(session, GST_TYPE_WS_DEFLATE);
+}
+
+GstWsDeflate *
+gst_ws_deflate_find(SoupWebsocketConnection *conn)
+{
+  for (GList *l = soup_websocket_connection_get_extensions(conn); l; l = l->next) {
+    if (GST_IS_WS_DEFLATE(l->data))
+      return l->data;
+  }
+  return NULL;
+}
+
+void
+gst_ws_deflate_set_window_bits(GstWsDeflate *deflate, guint window_bits)
+{
+  g_return_if_fail(GST_IS_WS_DEFLATE(deflate));
+
+  deflate->window_bits = CLAMP(window_bits, GST_WS_DEFLATE_MIN_WINDOW_BITS,
+      GST_WS_DEFLATE_MAX_WINDOW_BITS);
+}
+
+void
+gst_ws_deflate_set_enabled(GstWsDeflate *deflate, gboolean enabled)
+{
+  g_return_if_fail(GST_IS_WS_DEFLATE(deflate));
+
+  deflate->enabled = enabled;
+}
+
+void
+gst_ws_deflate_get_stats(GstWsDeflate *deflate, GstWsDeflateStats *stats)
+{
+  g_return_if_fail(GST_IS_WS_DEFLATE(deflate));
+
+  *stats = deflate->stats;
+}
@@ -0,0 +1,52 @@
+#ifndef __GST_WS_DEFLATE_H__
+#define __GST_WS_DEFLATE_H__
+
+#include <gst/gst.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+// permessage-deflate (RFC 7692) as a libsoup extension. it takes the place of libsoup's
+// own implementation on the element's sessions, because the element needs what that one
+// does not expose: its own compression window, byte counts before and after compression,
+// and switching compression of outgoing messages off per connection (an uncompressed
+// message is always valid on a deflate connection). incoming messages are inflated
+// whenever the peer compressed them.
+#define GST_WS_DEFLATE_MIN_WINDOW_BITS 9
+#define GST_WS_DEFLATE_MAX_WINDOW_BITS 15
+
+#define GST_TYPE_WS_DEFLATE (gst_ws_deflate_get_type())
+#define GST_WS_DEFLATE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_WS_DEFLATE, GstWsDeflate))
+#define GST_IS_WS_DEFLATE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_WS_DEFLATE))
+
+typedef struct _GstWsDeflate GstWsDeflate;
+typedef struct _GstWsDeflateClass GstWsDeflateClass;
+
+// bytes before (raw) and after (wire) compression, outgoing and incoming
+typedef struct
+{
+  guint64 out_raw;
+  guint64 out_wire;
+  guint64 in_raw;
+  guint64 in_wire;
+} GstWsDeflateStats;
+
+GType gst_ws_deflate_get_type(void);
+
+// replaces libsoup's permessage-deflate on a session. call from the session's thread.
+void gst_ws_deflate_install(SoupSession *session);
+
+// the extension negotiated on a connection, or NULL
+GstWsDeflate *gst_ws_deflate_find(SoupWebsocketConnection *conn);
+
+// all of these run on the connection's thread. the window can only be narrowed before
+// the first compressed message, later calls keep the window in use.
+void gst_ws_deflate_set_window_bits(GstWsDeflate *deflate, guint window_bits);
+void gst_ws_deflate_set_enabled(GstWsDeflate *deflate, gboolean enabled);
+void gst_ws_deflate_get_stats(GstWsDeflate *deflate, GstWsDeflateStats *stats);
+
+G_END_DECLS
+
+#endif /* __GST_WS_DEFLATE_H__ */
@@ -0,0 +1,93 @@
+#include "gstwsflight.h"
+
+typedef struct
+{
+  // claim number + 1 once the record is complete, 0 while it is being written
+  guint seq;
+  guint32 event;
+  guint32 a;
+  gint64 time_us;
+  guint64 b;
+} GstWsFlightRecord;
+
+struct _GstWsFlight
+{
+  gint head;
+  guint mask;
+  GstWsFlightRecord *records;
+};
+
+static const gchar *const event_names[] = {
+  "connected", "disconnected", "error", "received", "control", "sent", "dropped",
+  "clear", "underrun", "late",
+};
+
+GstWsFlight *
+gst_ws_flight_new(guint records)
+{
+  GstWsFlight *flight = g_new0(GstWsFlight, 1);
+  guint size = 1;
+
+  while (size < records && size < (1u << 20))
+    size <<= 1;
+  flight->mask = size - 1;
+  flight->records = g_new0(GstWsFlightRecord, size);
+  return flight;
+}
+
+void
+gst_ws_flight_free(GstWsFlight *flight)
+{
+  g_free(flight->records);
+  g_free(flight);
+}
+
+guint
+gst_ws_flight_size(GstWsFlight *flight)
+{
+  return flight->mask + 1;
+}
+
+void
+gst_ws_flight_record(GstWsFlight *flight, GstWsFlightEvent event, guint32 a, guint64 b)
+{
+  guint claim = (guint)g_atomic_int_add(&flight->head, 1);
+  GstWsFlightRecord *record = &flight->records[claim & flight->mask];
+
+  // the zero marks the slot as in flux for a concurrent dump, the final store publishes
+  g_atomic_int_set((gint *)&record->seq, 0);
+  record->event = event;
+  record->a = a;
+  record->b = b;
+  record->time_us = g_get_monotonic_time();
+  g_atomic_int_set((gint *)&record->seq, (gint)(claim + 1));
+}
+
+gchar *
+gst_ws_flight_dump(GstWsFlight *flight)
+{
+  GString *out = g_string_new(NULL);
+  guint head = (guint)g_atomic_int_get(&flight->head);
+  guint size = flight->mask + 1;
+  guint first = head > size ? head - size : 0;
+  gint64 now = g_get_monotonic_time();
+
+  for (guint claim = first; claim != head; claim++) {
+    GstWsFlightRecord *record = &flight->records[claim & flight->mask];
+    GstWsFlightRecord copy;
+
+    if ((guint)g_atomic_int_get((gint *)&record->seq) != claim + 1)
+      continue;
+    copy = *record;
+    // a writer that lapped the ring meanwhile may have torn the copy
+    if ((guint)g_atomic_int_get((gint *)&record->seq) != claim + 1 ||
+        copy.event >= G_N_ELEMENTS(event_names))
+      continue;
+
+    g_string_append_printf(out, "-%" G_GINT64_FORMAT ".%06" G_GINT64_FORMAT " %s a=%u b=%"
+        G_GUINT64_FORMAT "\n", (now - copy.time_us) / G_USEC_PER_SEC,
+        (now - copy.time_us) % G_USEC_PER_SEC, event_names[copy.event], copy.a, copy.b);
+  }
+
+  return g_string_free(out, FALSE);
+}
@@ -0,0 +1,53 @@
+#ifndef __GST_WS_FLIGHT_H__
+#define __GST_WS_FLIGHT_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// per-buffer logging on the audio paths. built with -Dhot_path_logging=false these are
+// empty, arguments included, so a release build pays neither the category check nor
+// the formatting per frame. what is worth keeping goes to the flight recorder below.
+#ifndef GST_WS_HOT_PATH_LOGGING
+#define GST_WS_HOT_PATH_LOGGING 1
+#endif
+
+#if GST_WS_HOT_PATH_LOGGING
+#define GST_WS_HOT_DEBUG(obj, ...) GST_DEBUG_OBJECT(obj, __VA_ARGS__)
+#define GST_WS_HOT_LOG(obj, ...) GST_LOG_OBJECT(obj, __VA_ARGS__)
+#else
+#define GST_WS_HOT_DEBUG(obj, ...) G_STMT_START { } G_STMT_END
+#define GST_WS_HOT_LOG(obj, ...) G_STMT_START { } G_STMT_END
+#endif
+
+// a fixed ring of binary event records, always cheap enough to leave on: recording is
+// a slot claimed with one atomic add and four stores, nothing is formatted until the
+// ring is dumped. any thread may record, the oldest records are overwritten.
+typedef enum
+{
+  GST_WS_FLIGHT_CONNECTED,     // a = reconnect count, b = resumed
+  GST_WS_FLIGHT_DISCONNECTED,  // a = close code
+  GST_WS_FLIGHT_ERROR,
+  GST_WS_FLIGHT_RECEIVED,      // a = bytes, b = sequence number
+  GST_WS_FLIGHT_CONTROL,       // a = bytes
+  GST_WS_FLIGHT_SENT,          // a = bytes, b = sequence number
+  GST_WS_FLIGHT_DROPPED,       // a = buffers, b = 0 outbound, 1 inbound
+  GST_WS_FLIGHT_CLEAR,         // a = barge-in epoch, b = sequence number of the clear
+  GST_WS_FLIGHT_UNDERRUN,      // the receive queue ran dry while audio played
+  GST_WS_FLIGHT_LATE,          // a = lateness in us
+} GstWsFlightEvent;
+
+typedef struct _GstWsFlight GstWsFlight;
+
+// the size is rounded up to a power of two
+GstWsFlight *gst_ws_flight_new(guint records);
+void gst_ws_flight_free(GstWsFlight *flight);
+guint gst_ws_flight_size(GstWsFlight *flight);
+void gst_ws_flight_record(GstWsFlight *flight, GstWsFlightEvent event, guint32 a, guint64 b);
+// one line per record, oldest first, times in seconds before the dump. records being
+// written while the dump runs are left out.
+gchar *gst_ws_flight_dump(GstWsFlight *flight);
+
+G_END_DECLS
+
+#endif /* __GST_WS_FLIGHT_H__ */
@@ -0,0 +1,33 @@
+#include "gstwsframe.h"
+
+void
+gst_ws_frame_header_write(const GstWsFrameHeader *header, guint8 *data)
+{
+  GST_WRITE_UINT8(data, header->version);
+  GST_WRITE_UINT8(data + 1, header->type);
+  GST_WRITE_UINT16_BE(data + 2, header->stream);
+  GST_WRITE_UINT32_BE(data + 4, header->seq);
+  GST_WRITE_UINT64_BE(data + 8, (guint64)header->timestamp_us);
+  GST_WRITE_UINT32_BE(data + 16, header->length);
+}
+
+// rejects anything that is not a complete version 1 frame. the payload length must
+// match the message exactly, a WebSocket message carries exactly one frame.
+gboolean
+gst_ws_frame_header_parse(const guint8 *data, gsize size, GstWsFrameHeader *header)
+{
+  if (size < GST_WS_FRAME_HEADER_SIZE)
+    return FALSE;
+
+  header->version = GST_READ_UINT8(data);
+  header->type = GST_READ_UINT8(data + 1);
+  header->stream = GST_READ_UINT16_BE(data + 2);
+  header->seq = GST_READ_UINT32_BE(data + 4);
+  header->timestamp_us = (gint64)GST_READ_UINT64_BE(data + 8);
+  header->length = GST_READ_UINT32_BE(data + 16);
+
+  if (header->version != GST_WS_FRAME_VERSION)
+    return FALSE;
+
+  return header->length == size - GST_WS_FRAME_HEADER_SIZE;
+}
@@ -0,0 +1,53 @@
+#ifndef __GST_WS_FRAME_H__
+#define __GST_WS_FRAME_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// optional binary framing, used when the server accepts GST_WS_FRAME_SUBPROTOCOL. every
+// binary message starts with a fixed header, all fields big endian:
+//
+//   0       1       2               4               8                      16              20
+//   | ver   | type  | stream        | sequence      | sender time (us)     | payload length |
+//
+// audio and control messages share one sequence space per direction, so a control
+// message is ordered against the audio around it. the stream id tells the streams of a
+// multiplexed connection (GST_WS_FRAME_MUX_SUBPROTOCOL) apart, and is 0 otherwise.
+#define GST_WS_FRAME_SUBPROTOCOL "gst-websocket-frame.v1"
+#define GST_WS_FRAME_MUX_SUBPROTOCOL "gst-websocket-mux.v1"
+#define GST_WS_FRAME_VERSION 1
+#define GST_WS_FRAME_HEADER_SIZE 20
+
+typedef enum
+{
+  // payload is raw audio in the negotiated caps
+  GST_WS_FRAME_AUDIO = 0,
+  // payload is a JSON control message, as in a text frame
+  GST_WS_FRAME_CONTROL = 1,
+} GstWsFrameType;
+
+typedef struct
+{
+  guint8 version;
+  guint8 type;
+  guint16 stream;
+  guint32 seq;
+  // sender wall clock (g_get_real_time), only comparable with synchronized clocks
+  gint64 timestamp_us;
+  guint32 length;
+} GstWsFrameHeader;
+
+void gst_ws_frame_header_write(const GstWsFrameHeader *header, guint8 *data);
+gboolean gst_ws_frame_header_parse(const guint8 *data, gsize size, GstWsFrameHeader *header);
+
+// serial number comparison, so ordering survives the sequence wrapping around
+static inline gboolean
+gst_ws_frame_seq_before(guint32 a, guint32 b)
+{
+  return (gint32)(a - b) < 0;
+}
+
+G_END_DECLS
+
+#endif /* __GST_WS_FRAME_H__ */
@@ -0,0 +1,59 @@
+#include "gstwsjitter.h"
+
+// how many jitter estimates of headroom the playout buffer keeps on top of one frame.
+// three covers the vast majority of arrivals for roughly gaussian delay variation.
+#define GST_WS_JITTER_TARGET_FACTOR 3
+// lateness past which the server is taken to have paused rather than the network to
+// have stalled. the queue has run dry long before, so there is nothing to smooth.
+#define GST_WS_JITTER_IDLE_GAP (250 * GST_MSECOND)
+
+void
+gst_ws_jitter_reset(GstWsJitter *jitter)
+{
+  jitter->have_previous = FALSE;
+  jitter->previous_transit = 0;
+  jitter->spurt_transit = 0;
+  jitter->media_position = 0;
+  jitter->jitter = 0.0;
+}
+
+// arrival_us is the wall clock time the message arrived, duration the audio it carries.
+// a TTS server pauses between turns and sends each turn faster than realtime, neither of
+// which a playout buffer has to absorb. audio ahead of the spurt's schedule is clamped to
+// it, so a burst adds nothing, and the first message after a pause re-anchors.
+void
+gst_ws_jitter_update(GstWsJitter *jitter, gint64 arrival_us, GstClockTime duration)
+{
+  gint64 transit = arrival_us * 1000 - (gint64)jitter->media_position;
+
+  if (!jitter->have_previous ||
+      transit - jitter->spurt_transit > (gint64)GST_WS_JITTER_IDLE_GAP) {
+    jitter->spurt_transit = transit;
+  } else {
+    gint64 d;
+
+    transit = MAX(transit, jitter->spurt_transit);
+    d = transit - jitter->previous_transit;
+    jitter->jitter += ((gdouble)ABS(d) - jitter->jitter) / 16.0;
+  }
+
+  jitter->previous_transit = transit;
+  jitter->have_previous = TRUE;
+  jitter->media_position += duration;
+}
+
+GstClockTime
+gst_ws_jitter_get(const GstWsJitter *jitter)
+{
+  return (GstClockTime)jitter->jitter;
+}
+
+GstClockTime
+gst_ws_jitter_target(const GstWsJitter *jitter, GstClockTime frame_duration,
+    GstClockTime min_latency, GstClockTime max_latency)
+{
+  GstClockTime target = frame_duration +
+      GST_WS_JITTER_TARGET_FACTOR * gst_ws_jitter_get(jitter);
+
+  return CLAMP(target, min_latency, MAX(min_latency, max_latency));
+}
@@ -0,0 +1,32 @@
+#ifndef __GST_WS_JITTER_H__
+#define __GST_WS_JITTER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// interarrival jitter estimator after RFC 3550 section 6.4.1. the media clock is the
+// running duration of the audio received, so the estimate measures how irregularly
+// the server delivers audio relative to its own playback rate. the media clock only
+// runs while audio arrives, so the estimate is anchored per talk spurt: audio that
+// arrives ahead of the spurt's schedule counts as on time, and audio more than
+// GST_WS_JITTER_IDLE_GAP behind it starts a new spurt.
+typedef struct
+{
+  gboolean have_previous;
+  gint64 previous_transit;
+  // transit of the first message of the current talk spurt
+  gint64 spurt_transit;
+  GstClockTime media_position;
+  gdouble jitter;
+} GstWsJitter;
+
+void gst_ws_jitter_reset(GstWsJitter *jitter);
+void gst_ws_jitter_update(GstWsJitter *jitter, gint64 arrival_us, GstClockTime duration);
+GstClockTime gst_ws_jitter_get(const GstWsJitter *jitter);
+GstClockTime gst_ws_jitter_target(const GstWsJitter *jitter, GstClockTime frame_duration,
+    GstClockTime min_latency, GstClockTime max_latency);
+
+G_END_DECLS
+
+#endif /* __GST_WS_JITTER_H__ */
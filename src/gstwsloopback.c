@@ -0,0 +1,375 @@
+#include "gstwsloopback.h"
+
+#include <string.h>
+
+#include "gstwsframe.h"
+#include "gstwsring.h"
+
+// messages on their way in either direction, like a socket buffer. a full queue loses
+// the message.
+#define LOOPBACK_QUEUE_SIZE 1024
+#define CLEAR_MESSAGE "{\"type\":\"clear\"}"
+
+typedef struct
+{
+  gint64 delay_us;
+  gint64 jitter_us;
+  gdouble loss;
+  guint32 seed;
+  gint64 clear_us;
+  guint64 close_after;
+} GstWsLoopbackParams;
+
+typedef struct
+{
+  gint64 due_us;
+  gint type;
+  GBytes *message;
+} GstWsLoopbackPacket;
+
+// the source carries the whole network state, so a transport closed from one of its
+// own callbacks leaves the dispatch running on memory that is still there
+typedef struct
+{
+  GSource source;
+  // NULL once the transport is closed
+  GstWsTransport *transport;
+  GstWsLoopbackParams params;
+  // one sequence per use, so what the nth message draws does not depend on how sends,
+  // echoes and clears interleave in time
+  GRand *loss_rand;
+  GRand *outbound_rand;
+  GRand *inbound_rand;
+  GRand *clear_rand;
+  gboolean framed;
+  gint64 next_clear_us;
+  guint64 echoed;
+  gboolean closed;
+
+  // element -> peer and peer -> element, both in order of delivery. the head is popped
+  // ahead of its time so the next deadline is known.
+  GstWsRing *outbound;
+  GstWsRing *inbound;
+  GstWsLoopbackPacket *outbound_head;
+  GstWsLoopbackPacket *inbound_head;
+  gint64 outbound_last_us;
+  gint64 inbound_last_us;
+} GstWsLoopbackSource;
+
+typedef struct
+{
+  GstWsTransport parent;
+  GstWsLoopbackSource *source;
+} GstWsLoopback;
+
+static gboolean
+gst_ws_loopback_parse(const gchar *uri, GstWsLoopbackParams *params, GError **error)
+{
+  const gchar *query;
+  gchar **pairs;
+  gboolean ok = TRUE;
+
+  memset(params, 0, sizeof(*params));
+  params->seed = 1;
+
+  if (!gst_ws_loopback_is_uri(uri)) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Not a %s:// URI",
+        GST_WS_LOOPBACK_SCHEME);
+    return FALSE;
+  }
+  query = strchr(uri, '?');
+  if (!query)
+    return TRUE;
+
+  pairs = g_strsplit(query + 1, "&", -1);
+  for (gchar **pair = pairs; ok && *pair; pair++) {
+    gchar *value = strchr(*pair, '=');
+    gchar *end = NULL;
+    gdouble number = 0;
+
+    if (**pair == '\0')
+      continue;
+    if (value) {
+      *value++ = '\0';
+      number = g_ascii_strtod(value, &end);
+    }
+    if (!value || end == value || *end != '\0' || number < 0) {
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+          "Loopback parameter %s needs a number of at least 0", *pair);
+      ok = FALSE;
+    } else if (g_str_equal(*pair, "delay-ms")) {
+      params->delay_us = (gint64)(number * 1000);
+    } else if (g_str_equal(*pair, "jitter-ms")) {
+      params->jitter_us = (gint64)(number * 1000);
+    } else if (g_str_equal(*pair, "loss") && number <= 1) {
+      params->loss = number;
+    } else if (g_str_equal(*pair, "seed") && number <= G_MAXUINT32) {
+      params->seed = (guint32)number;
+    } else if (g_str_equal(*pair, "clear-ms")) {
+      params->clear_us = (gint64)(number * 1000);
+    } else if (g_str_equal(*pair, "close-after")) {
+      params->close_after = (guint64)number;
+    } else {
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+          "Unknown or out of range loopback parameter %s", *pair);
+      ok = FALSE;
+    }
+  }
+  g_strfreev(pairs);
+  return ok;
+}
+
+gboolean
+gst_ws_loopback_is_uri(const gchar *uri)
+{
+  return uri && g_str_has_prefix(uri, GST_WS_LOOPBACK_SCHEME "://");
+}
+
+gboolean
+gst_ws_loopback_check_uri(const gchar *uri, GError **error)
+{
+  GstWsLoopbackParams params;
+
+  return gst_ws_loopback_parse(uri, &params, error);
+}
+
+static GRand *
+gst_ws_loopback_rand_new(guint32 seed, guint32 stream)
+{
+  const guint32 key[] = { seed, stream };
+
+  return g_rand_new_with_seed_array(key, G_N_ELEMENTS(key));
+}
+
+static void
+gst_ws_loopback_packet_free(GstWsLoopbackPacket *packet)
+{
+  g_bytes_unref(packet->message);
+  g_free(packet);
+}
+
+// one direction's delivery time. jitter never reorders, a message waits for the one
+// before it, as over TCP.
+static gint64
+gst_ws_loopback_due(GstWsLoopbackSource *source, GRand *rand, gint64 *last_us,
+    gint64 sent_us)
+{
+  gint64 due = sent_us + source->params.delay_us;
+
+  if (source->params.jitter_us > 0)
+    due += (gint64)(g_rand_double(rand) * source->params.jitter_us);
+  *last_us = MAX(*last_us, due);
+  return *last_us;
+}
+
+static void
+gst_ws_loopback_queue(GstWsRing *ring, GstWsLoopbackPacket *packet)
+{
+  if (!gst_ws_ring_push(ring, packet, NULL))
+    gst_ws_loopback_packet_free(packet);
+}
+
+static GstWsLoopbackPacket *
+gst_ws_loopback_peek(GstWsRing *ring, GstWsLoopbackPacket **head)
+{
+  if (!*head)
+    *head = gst_ws_ring_pop(ring);
+  return *head;
+}
+
+static void
+gst_ws_loopback_reschedule(GstWsLoopbackSource *source)
+{
+  GstWsLoopbackPacket *out = gst_ws_loopback_peek(source->outbound, &source->outbound_head);
+  GstWsLoopbackPacket *in = gst_ws_loopback_peek(source->inbound, &source->inbound_head);
+  gint64 ready = source->params.clear_us > 0 ? source->next_clear_us : G_MAXINT64;
+
+  if (out)
+    ready = MIN(ready, out->due_us);
+  if (in)
+    ready = MIN(ready, in->due_us);
+  g_source_set_ready_time(&source->source, ready == G_MAXINT64 ? -1 : ready);
+}
+
+// the peer sends back what it gets, apart from text and control frames
+static gboolean
+gst_ws_loopback_echoes(GstWsLoopbackSource *source, GstWsLoopbackPacket *packet)
+{
+  GstWsFrameHeader header;
+  gsize size;
+  const guint8 *data;
+
+  if (packet->type != SOUP_WEBSOCKET_DATA_BINARY)
+    return FALSE;
+  if (!source->framed)
+    return TRUE;
+  data = g_bytes_get_data(packet->message, &size);
+  return gst_ws_frame_header_parse(data, size, &header) && header.type == GST_WS_FRAME_AUDIO;
+}
+
+static gboolean
+gst_ws_loopback_dispatch(GSource *gsource, GSourceFunc callback, gpointer user_data)
+{
+  GstWsLoopbackSource *source = (GstWsLoopbackSource *)gsource;
+  gint64 now = g_get_monotonic_time();
+  GstWsLoopbackPacket *packet;
+
+  (void)callback;
+  (void)user_data;
+
+  while ((packet = gst_ws_loopback_peek(source->outbound, &source->outbound_head)) &&
+         packet->due_us <= now) {
+    source->outbound_head = NULL;
+    if (!gst_ws_loopback_echoes(source, packet)) {
+      gst_ws_loopback_packet_free(packet);
+      continue;
+    }
+    packet->due_us = gst_ws_loopback_due(source, source->inbound_rand,
+        &source->inbound_last_us, packet->due_us);
+    gst_ws_loopback_queue(source->inbound, packet);
+  }
+
+  if (source->params.clear_us > 0 && now >= source->next_clear_us) {
+    packet = g_new0(GstWsLoopbackPacket, 1);
+    packet->type = SOUP_WEBSOCKET_DATA_TEXT;
+    packet->message = g_bytes_new_static(CLEAR_MESSAGE, strlen(CLEAR_MESSAGE));
+    packet->due_us = gst_ws_loopback_due(source, source->clear_rand,
+        &source->inbound_last_us, now);
+    gst_ws_loopback_queue(source->inbound, packet);
+    source->next_clear_us = MAX(source->next_clear_us + source->params.clear_us, now);
+  }
+
+  while ((packet = gst_ws_loopback_peek(source->inbound, &source->inbound_head)) &&
+         packet->due_us <= now) {
+    GstWsTransport *transport = source->transport;
+
+    source->inbound_head = NULL;
+    transport->callbacks->message(transport, packet->type, packet->message,
+        transport->user_data);
+    if (source->transport && packet->type == SOUP_WEBSOCKET_DATA_BINARY &&
+        ++source->echoed == source->params.close_after) {
+      // the peer hangs up cleanly, like a server done with the session
+      source->closed = TRUE;
+      transport->callbacks->closed(transport, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL,
+          transport->user_data);
+    }
+    gst_ws_loopback_packet_free(packet);
+    if (!source->transport || source->closed)
+      return G_SOURCE_REMOVE;
+  }
+
+  gst_ws_loopback_reschedule(source);
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gst_ws_loopback_finalize(GSource *gsource)
+{
+  GstWsLoopbackSource *source = (GstWsLoopbackSource *)gsource;
+
+  g_clear_pointer(&source->outbound_head, gst_ws_loopback_packet_free);
+  g_clear_pointer(&source->inbound_head, gst_ws_loopback_packet_free);
+  gst_ws_ring_free(source->outbound, (GDestroyNotify)gst_ws_loopback_packet_free);
+  gst_ws_ring_free(source->inbound, (GDestroyNotify)gst_ws_loopback_packet_free);
+  g_rand_free(source->loss_rand);
+  g_rand_free(source->outbound_rand);
+  g_rand_free(source->inbound_rand);
+  g_rand_free(source->clear_rand);
+}
+
+static GSourceFuncs gst_ws_loopback_source_funcs = {
+  NULL,
+  NULL,
+  gst_ws_loopback_dispatch,
+  gst_ws_loopback_finalize,
+  NULL,
+  NULL,
+};
+
+static gboolean
+gst_ws_loopback_is_open(GstWsTransport *transport)
+{
+  return !((GstWsLoopback *)transport)->source->closed;
+}
+
+static void
+gst_ws_loopback_send(GstWsTransport *transport, gint type, GBytes *message)
+{
+  GstWsLoopbackSource *source = ((GstWsLoopback *)transport)->source;
+  GstWsLoopbackPacket *packet;
+
+  if (source->closed)
+    return;
+  // drawn for every message, so the sequence depends on the traffic alone
+  if (g_rand_double(source->loss_rand) < source->params.loss)
+    return;
+
+  packet = g_new0(GstWsLoopbackPacket, 1);
+  packet->type = type;
+  packet->message = g_bytes_ref(message);
+  packet->due_us = gst_ws_loopback_due(source, source->outbound_rand,
+      &source->outbound_last_us, g_get_monotonic_time());
+  gst_ws_loopback_queue(source->outbound, packet);
+  gst_ws_loopback_reschedule(source);
+}
+
+static const gchar *
+gst_ws_loopback_get_protocol(GstWsTransport *transport)
+{
+  return ((GstWsLoopback *)transport)->source->framed ? GST_WS_FRAME_SUBPROTOCOL : NULL;
+}
+
+static void
+gst_ws_loopback_close(GstWsTransport *transport)
+{
+  GstWsLoopback *loopback = (GstWsLoopback *)transport;
+
+  loopback->source->transport = NULL;
+  g_source_destroy(&loopback->source->source);
+  g_source_unref(&loopback->source->source);
+  g_free(loopback);
+}
+
+static const GstWsTransportFuncs gst_ws_loopback_funcs = {
+  gst_ws_loopback_is_open,
+  gst_ws_loopback_send,
+  gst_ws_loopback_get_protocol,
+  gst_ws_loopback_close,
+};
+
+GstWsTransport *
+gst_ws_loopback_new(const gchar *uri, gchar **protocols, GMainContext *context,
+    const GstWsTransportCallbacks *callbacks, gpointer user_data, GError **error)
+{
+  GstWsLoopbackParams params;
+  GstWsLoopback *loopback;
+  GstWsLoopbackSource *source;
+
+  if (!gst_ws_loopback_parse(uri, &params, error))
+    return NULL;
+
+  loopback = g_new0(GstWsLoopback, 1);
+  loopback->parent.funcs = &gst_ws_loopback_funcs;
+  loopback->parent.callbacks = callbacks;
+  loopback->parent.user_data = user_data;
+
+  source = (GstWsLoopbackSource *)g_source_new(&gst_ws_loopback_source_funcs,
+      sizeof(GstWsLoopbackSource));
+  source->transport = &loopback->parent;
+  source->params = params;
+  source->loss_rand = gst_ws_loopback_rand_new(params.seed, 0);
+  source->outbound_rand = gst_ws_loopback_rand_new(params.seed, 1);
+  source->inbound_rand = gst_ws_loopback_rand_new(params.seed, 2);
+  source->clear_rand = gst_ws_loopback_rand_new(params.seed, 3);
+  source->framed = protocols && g_strv_contains((const gchar *const *)protocols,
+      GST_WS_FRAME_SUBPROTOCOL);
+  source->outbound = gst_ws_ring_new(LOOPBACK_QUEUE_SIZE);
+  source->inbound = gst_ws_ring_new(LOOPBACK_QUEUE_SIZE);
+  source->next_clear_us = g_get_monotonic_time() + params.clear_us;
+  loopback->source = source;
+
+  g_source_set_name(&source->source, "websocket-loopback");
+  gst_ws_loopback_reschedule(source);
+  g_source_attach(&source->source, context);
+  return &loopback->parent;
+}
@@ -0,0 +1,36 @@
+#ifndef __GST_WS_LOOPBACK_H__
+#define __GST_WS_LOOPBACK_H__
+
+#include <gst/gst.h>
+
+#include "gstwstransport.h"
+
+G_BEGIN_DECLS
+
+// an in-memory transport for loopback:// URIs. the peer is an echo: audio comes back
+// as sent, frame header included, while text and control frames are not echoed. there
+// is no socket, no handshake and no other thread, so a run is repeatable on one core.
+// the URI query sets the network model, e.g.
+//   loopback://?delay-ms=20&jitter-ms=5&loss=0.01&seed=7&clear-ms=1000&close-after=500
+// delay-ms    one-way delay, each direction (default 0)
+// jitter-ms   extra one-way delay, uniform in [0, jitter-ms] (default 0). messages
+//             keep their order, as over TCP, so jitter shows up as bunching.
+// loss        probability that the peer never sees a message (default 0)
+// seed        of the jitter and loss sequence (default 1)
+// clear-ms    the peer sends {"type":"clear"} this often (default 0 = never)
+// close-after the peer closes normally (1000) once it has echoed this many binary
+//             messages (default 0 = never)
+#define GST_WS_LOOPBACK_SCHEME "loopback"
+
+gboolean gst_ws_loopback_is_uri(const gchar *uri);
+gboolean gst_ws_loopback_check_uri(const gchar *uri, GError **error);
+
+// callbacks are dispatched on context. of the offered protocols the peer accepts binary
+// framing only.
+GstWsTransport *gst_ws_loopback_new(const gchar *uri, gchar **protocols,
+    GMainContext *context, const GstWsTransportCallbacks *callbacks, gpointer user_data,
+    GError **error);
+
+G_END_DECLS
+
+#endif /* __GST_WS_LOOPBACK_H__ */
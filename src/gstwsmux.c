@@ -0,0 +1,655 @@
+#include "gstwsmux.h"
+#include "gstwscontrol.h"
+#include "gstwsflight.h"
+#include "gstwsframe.h"
+
+#include <json-glib/json-glib.h>
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC(gst_ws_mux_debug);
+#define GST_CAT_DEFAULT gst_ws_mux_debug
+
+#define INITIAL_RETRY_MS 1000
+#define MAX_RETRY_MS 30000
+// credit a queued stream gets per round, a bit more than one 20 ms frame of 48 kHz
+// 16-bit mono. larger messages wait until their stream has saved up enough credit.
+#define QUANTUM_BYTES 2048
+// sent per dispatch before the reactor's other sources get a turn
+#define DISPATCH_BYTES (64 * 1024)
+// what one stream may have waiting while the socket is congested. past it the oldest
+// messages are dropped, like the element's own drop-oldest queue.
+#define STREAM_QUEUE_BYTES (256 * 1024)
+// control message a server sends in a stream's control frame to end only that stream
+#define STREAM_CLOSE_TYPE "stream-close"
+
+struct _GstWsMuxStream
+{
+  GstWsMux *mux;
+  guint16 id;
+  GstWsMuxStreamCallbacks callbacks;
+  gpointer user_data;
+
+  // GBytes waiting for the socket, and the deficit round robin state
+  GQueue queue;
+  gsize queued_bytes;
+  gsize deficit;
+  gboolean active;
+  gboolean ended;
+};
+
+struct _GstWsMux
+{
+  gint refcount;
+  gchar *uri;
+  GstWsReactor *reactor;
+
+  // protected by mux_lock
+  guint users;
+
+  // reactor thread only
+  SoupWebsocketConnection *conn;
+  GHashTable *streams;
+  guint16 next_id;
+  // streams with queued messages, in round robin order
+  GQueue active;
+  GSource *send_source;
+  GSource *writable_source;
+  GSource *retry_source;
+  GCancellable *cancellable;
+  gboolean connecting;
+  guint retry_ms;
+  gboolean stopped;
+};
+
+typedef struct
+{
+  GSource source;
+  GstWsMux *mux;
+} GstWsMuxSendSource;
+
+static GMutex mux_lock;
+static GHashTable *endpoints = NULL;
+
+static void gst_ws_mux_connect(GstWsMux *mux);
+
+static void
+gst_ws_mux_init_debug(void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    GST_DEBUG_CATEGORY_INIT(gst_ws_mux_debug, "websockettransceiver-mux",
+        0, "WebSocket Transceiver multiplexed connections");
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+static GstWsMux *
+gst_ws_mux_ref(GstWsMux *mux)
+{
+  g_atomic_int_inc(&mux->refcount);
+  return mux;
+}
+
+static void
+gst_ws_mux_unref(gpointer data)
+{
+  GstWsMux *mux = data;
+
+  if (!g_atomic_int_dec_and_test(&mux->refcount))
+    return;
+
+  g_clear_object(&mux->cancellable);
+  g_hash_table_unref(mux->streams);
+  g_free(mux->uri);
+  g_free(mux);
+}
+
+static void
+gst_ws_mux_clear_source(GSource **source)
+{
+  if (*source) {
+    g_source_destroy(*source);
+    g_source_unref(*source);
+    *source = NULL;
+  }
+}
+
+// a snapshot, so callbacks may close their stream while the others are notified
+static GList *
+gst_ws_mux_streams(GstWsMux *mux)
+{
+  return g_hash_table_get_values(mux->streams);
+}
+
+static void
+gst_ws_mux_stream_drop_queue(GstWsMuxStream *stream)
+{
+  g_queue_clear_full(&stream->queue, (GDestroyNotify)g_bytes_unref);
+  stream->queued_bytes = 0;
+  stream->deficit = 0;
+  if (stream->active) {
+    g_queue_remove(&stream->mux->active, stream);
+    stream->active = FALSE;
+  }
+}
+
+static gboolean
+gst_ws_mux_writable_cb(GObject *pollable, gpointer user_data)
+{
+  GstWsMux *mux = user_data;
+  (void)pollable;
+
+  // the send source is ready again from the next iteration
+  g_source_unref(mux->writable_source);
+  mux->writable_source = NULL;
+  return G_SOURCE_REMOVE;
+}
+
+// libsoup queues whatever it is given, so fairness only means something if messages
+// are held back while the socket is full. without a pollable stream the dispatch
+// budget is all there is.
+static gboolean
+gst_ws_mux_socket_writable(GstWsMux *mux)
+{
+  GOutputStream *output =
+      g_io_stream_get_output_stream(soup_websocket_connection_get_io_stream(mux->conn));
+
+  if (!G_IS_POLLABLE_OUTPUT_STREAM(output) ||
+      g_pollable_output_stream_is_writable(G_POLLABLE_OUTPUT_STREAM(output)))
+    return TRUE;
+
+  mux->writable_source =
+      g_pollable_output_stream_create_source(G_POLLABLE_OUTPUT_STREAM(output), NULL);
+  g_source_set_callback(mux->writable_source, G_SOURCE_FUNC(gst_ws_mux_writable_cb), mux,
+      NULL);
+  g_source_attach(mux->writable_source, gst_ws_reactor_get_context(mux->reactor));
+  return FALSE;
+}
+
+// one dispatch of deficit round robin. every stream at the head of the active list gets
+// QUANTUM_BYTES of credit and sends messages while it has enough, then goes to the
+// back if it still has some queued. a stream that runs empty loses its leftover credit,
+// so being quiet for a while does not buy a burst later.
+static void
+gst_ws_mux_schedule(GstWsMux *mux)
+{
+  gsize budget = DISPATCH_BYTES;
+  GstWsMuxStream *stream;
+
+  while (budget > 0 && mux->conn && gst_ws_mux_socket_writable(mux) &&
+      (stream = g_queue_pop_head(&mux->active)) != NULL) {
+    GBytes *message;
+
+    stream->deficit += QUANTUM_BYTES;
+    while (mux->conn && (message = g_queue_peek_head(&stream->queue)) != NULL &&
+        g_bytes_get_size(message) <= stream->deficit) {
+      gsize size = g_bytes_get_size(message);
+
+      g_queue_pop_head(&stream->queue);
+      stream->deficit -= size;
+      stream->queued_bytes -= size;
+      budget = size >= budget ? 0 : budget - size;
+      soup_websocket_connection_send_message(mux->conn, SOUP_WEBSOCKET_DATA_BINARY,
+          message);
+      g_bytes_unref(message);
+    }
+
+    if (g_queue_is_empty(&stream->queue)) {
+      stream->deficit = 0;
+      stream->active = FALSE;
+    } else {
+      g_queue_push_tail(&mux->active, stream);
+    }
+  }
+}
+
+static gboolean
+gst_ws_mux_send_source_prepare(GSource *source, gint *timeout)
+{
+  GstWsMux *mux = ((GstWsMuxSendSource *)source)->mux;
+
+  *timeout = -1;
+  return mux->conn && !mux->writable_source && !g_queue_is_empty(&mux->active);
+}
+
+static gboolean
+gst_ws_mux_send_source_check(GSource *source)
+{
+  return gst_ws_mux_send_source_prepare(source, &(gint){ 0 });
+}
+
+static gboolean
+gst_ws_mux_send_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+  (void)callback;
+  (void)user_data;
+
+  gst_ws_mux_schedule(((GstWsMuxSendSource *)source)->mux);
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs gst_ws_mux_send_source_funcs = {
+  gst_ws_mux_send_source_prepare,
+  gst_ws_mux_send_source_check,
+  gst_ws_mux_send_source_dispatch,
+  NULL,
+  NULL,
+  NULL,
+};
+
+static gboolean
+gst_ws_mux_retry_cb(gpointer user_data)
+{
+  GstWsMux *mux = user_data;
+
+  g_source_unref(mux->retry_source);
+  mux->retry_source = NULL;
+  gst_ws_mux_connect(mux);
+  return G_SOURCE_REMOVE;
+}
+
+// the backoff of standby connections: the streams keep waiting for the shared
+// connection rather than each reconnecting on its own
+static void
+gst_ws_mux_schedule_retry(GstWsMux *mux)
+{
+  if (mux->stopped || mux->retry_source || g_hash_table_size(mux->streams) == 0)
+    return;
+
+  mux->retry_ms = mux->retry_ms > 0 ? MIN(mux->retry_ms * 2, MAX_RETRY_MS) : INITIAL_RETRY_MS;
+  GST_INFO("Reconnecting multiplexed connection to %s in %u ms", mux->uri, mux->retry_ms);
+  mux->retry_source = g_timeout_source_new(mux->retry_ms);
+  g_source_set_callback(mux->retry_source, gst_ws_mux_retry_cb, mux, NULL);
+  g_source_attach(mux->retry_source, gst_ws_reactor_get_context(mux->reactor));
+}
+
+static gboolean
+gst_ws_mux_is_stream_close(const guint8 *payload, gsize size)
+{
+  GstWsControlFields fields;
+
+  return gst_ws_control_scan((const gchar *)payload, size, &fields) &&
+      fields.type_len == strlen(STREAM_CLOSE_TYPE) &&
+      strncmp(fields.type, STREAM_CLOSE_TYPE, fields.type_len) == 0;
+}
+
+// the "stream" field of a text message, 0 (never a stream id) for none. the scanner
+// takes what control messages usually look like, json-glib the rest.
+static guint
+gst_ws_mux_text_stream(const gchar *data, gsize size)
+{
+  GstWsControlFields fields;
+  JsonParser *parser;
+  JsonNode *root;
+  gint64 stream = 0;
+
+  if (gst_ws_control_scan(data, size, &fields))
+    return fields.has_stream ? fields.stream : 0;
+
+  parser = json_parser_new();
+  if (json_parser_load_from_data(parser, data, size, NULL) &&
+      (root = json_parser_get_root(parser)) && JSON_NODE_HOLDS_OBJECT(root))
+    stream = json_object_get_int_member_with_default(json_node_get_object(root), "stream", 0);
+  g_object_unref(parser);
+  return stream > 0 && stream <= G_MAXUINT16 ? (guint)stream : 0;
+}
+
+static void
+on_mux_message(SoupWebsocketConnection *conn, gint type, GBytes *message, gpointer user_data)
+{
+  GstWsMux *mux = user_data;
+  GstWsMuxStream *stream;
+  GstWsFrameHeader header;
+  const guint8 *data;
+  gsize size;
+  (void)conn;
+
+  data = g_bytes_get_data(message, &size);
+  if (type == SOUP_WEBSOCKET_DATA_TEXT) {
+    guint id = gst_ws_mux_text_stream((const gchar *)data, size);
+
+    stream = id ? g_hash_table_lookup(mux->streams, GUINT_TO_POINTER(id)) : NULL;
+    if (!stream || stream->ended) {
+      GST_WARNING("Dropping text message for %s stream %u on %s: %.*s",
+          id ? "unknown" : "no", id, mux->uri, (int)MIN(size, 256), (const gchar *)data);
+      return;
+    }
+    stream->callbacks.message(stream, type, message, stream->user_data);
+    return;
+  }
+
+  if (!gst_ws_frame_header_parse(data, size, &header)) {
+    GST_WARNING("Dropping malformed %zu byte message on %s", size, mux->uri);
+    return;
+  }
+  stream = g_hash_table_lookup(mux->streams, GUINT_TO_POINTER(header.stream));
+  if (!stream || stream->ended) {
+    GST_WS_HOT_LOG(NULL, "Dropping message for unknown stream %u", header.stream);
+    return;
+  }
+
+  if (header.type == GST_WS_FRAME_CONTROL &&
+      gst_ws_mux_is_stream_close(data + GST_WS_FRAME_HEADER_SIZE, header.length)) {
+    GST_INFO("Stream %u on %s closed by the server", stream->id, mux->uri);
+    stream->ended = TRUE;
+    gst_ws_mux_stream_drop_queue(stream);
+    stream->callbacks.closed(stream, SOUP_WEBSOCKET_CLOSE_NORMAL, STREAM_CLOSE_TYPE, TRUE,
+        stream->user_data);
+    return;
+  }
+
+  stream->callbacks.message(stream, type, message, stream->user_data);
+}
+
+static void
+on_mux_closed(SoupWebsocketConnection *conn, gpointer user_data)
+{
+  GstWsMux *mux = user_data;
+  guint close_code = soup_websocket_connection_get_close_code(conn);
+  gchar *reason = g_strdup(soup_websocket_connection_get_close_data(conn));
+  GList *streams, *l;
+
+  GST_WARNING("Multiplexed connection to %s closed (code: %u)", mux->uri, close_code);
+  g_signal_handlers_disconnect_by_data(conn, mux);
+  g_clear_object(&mux->conn);
+  gst_ws_mux_clear_source(&mux->writable_source);
+
+  // queued audio belongs to a connection that is gone, as with a private connection
+  streams = gst_ws_mux_streams(mux);
+  for (l = streams; l; l = l->next) {
+    GstWsMuxStream *stream = l->data;
+
+    gst_ws_mux_stream_drop_queue(stream);
+    if (!stream->ended)
+      stream->callbacks.closed(stream, close_code, reason, FALSE, stream->user_data);
+  }
+  g_list_free(streams);
+  g_free(reason);
+
+  gst_ws_mux_schedule_retry(mux);
+}
+
+static void
+on_mux_error(SoupWebsocketConnection *conn, GError *error, gpointer user_data)
+{
+  GstWsMux *mux = user_data;
+  (void)conn;
+
+  GST_WARNING("Multiplexed connection to %s: %s", mux->uri, error ? error->message : "unknown");
+}
+
+static void
+on_mux_connected(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  GstWsMux *mux = user_data;
+  SoupWebsocketConnection *conn;
+  GError *error = NULL;
+  GList *streams, *l;
+
+  conn = soup_session_websocket_connect_finish(SOUP_SESSION(source), res, &error);
+  mux->connecting = FALSE;
+
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    g_error_free(error);
+    gst_ws_mux_unref(mux);
+    return;
+  }
+  if (error || !conn) {
+    GST_WARNING("Multiplexed connection to %s failed: %s", mux->uri,
+        error ? error->message : "unknown");
+    g_clear_error(&error);
+    gst_ws_mux_schedule_retry(mux);
+    gst_ws_mux_unref(mux);
+    return;
+  }
+  if (mux->stopped) {
+    soup_websocket_connection_close(conn, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+    g_object_unref(conn);
+    gst_ws_mux_unref(mux);
+    return;
+  }
+  // stream ids only mean something to a server that took the subprotocol
+  if (g_strcmp0(soup_websocket_connection_get_protocol(conn),
+          GST_WS_FRAME_MUX_SUBPROTOCOL) != 0) {
+    GST_ERROR("Server at %s declined %s, cannot multiplex", mux->uri,
+        GST_WS_FRAME_MUX_SUBPROTOCOL);
+    soup_websocket_connection_close(conn, SOUP_WEBSOCKET_CLOSE_POLICY_VIOLATION, NULL);
+    g_object_unref(conn);
+    gst_ws_mux_schedule_retry(mux);
+    gst_ws_mux_unref(mux);
+    return;
+  }
+
+  GST_INFO("Multiplexed connection to %s open, %u streams", mux->uri,
+      g_hash_table_size(mux->streams));
+  mux->retry_ms = 0;
+  mux->conn = conn;
+  g_signal_connect(conn, "message", G_CALLBACK(on_mux_message), mux);
+  g_signal_connect(conn, "closed", G_CALLBACK(on_mux_closed), mux);
+  g_signal_connect(conn, "error", G_CALLBACK(on_mux_error), mux);
+
+  streams = gst_ws_mux_streams(mux);
+  for (l = streams; l; l = l->next) {
+    GstWsMuxStream *stream = l->data;
+
+    if (!stream->ended)
+      stream->callbacks.opened(stream, stream->user_data);
+  }
+  g_list_free(streams);
+  gst_ws_mux_unref(mux);
+}
+
+// connects while streams are waiting for it. no extensions are offered: what a stream
+// could compress is decided per message, and one setting has to fit all of them.
+static void
+gst_ws_mux_connect(GstWsMux *mux)
+{
+  static gchar *protocols[] = { (gchar *)GST_WS_FRAME_MUX_SUBPROTOCOL, NULL };
+  SoupMessage *msg;
+
+  if (mux->stopped || mux->conn || mux->connecting || mux->retry_source ||
+      g_hash_table_size(mux->streams) == 0)
+    return;
+
+  msg = soup_message_new(SOUP_METHOD_GET, mux->uri);
+  if (!msg) {
+    GST_ERROR("Failed to create SoupMessage for URI: %s", mux->uri);
+    return;
+  }
+  soup_message_disable_feature(msg, SOUP_TYPE_WEBSOCKET_EXTENSION_MANAGER);
+
+  GST_INFO("Opening multiplexed connection to %s", mux->uri);
+  mux->connecting = TRUE;
+  soup_session_websocket_connect_async(gst_ws_reactor_get_session(mux->reactor), msg, NULL,
+      protocols, 0, mux->cancellable, on_mux_connected, gst_ws_mux_ref(mux));
+  g_object_unref(msg);
+}
+
+// runs on the reactor thread once the endpoint has been removed from the table. its
+// elements closed their streams before releasing it.
+static gboolean
+gst_ws_mux_stop_cb(gpointer user_data)
+{
+  GstWsMux *mux = user_data;
+
+  mux->stopped = TRUE;
+  g_cancellable_cancel(mux->cancellable);
+  gst_ws_mux_clear_source(&mux->retry_source);
+  gst_ws_mux_clear_source(&mux->writable_source);
+  gst_ws_mux_clear_source(&mux->send_source);
+
+  if (mux->conn) {
+    g_signal_handlers_disconnect_by_data(mux->conn, mux);
+    if (soup_websocket_connection_get_state(mux->conn) == SOUP_WEBSOCKET_STATE_OPEN)
+      soup_websocket_connection_close(mux->conn, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+    g_clear_object(&mux->conn);
+  }
+
+  GST_INFO("Multiplexed connection to %s stopped", mux->uri);
+  gst_ws_reactor_release(mux->reactor);
+  mux->reactor = NULL;
+  return G_SOURCE_REMOVE;
+}
+
+GstWsMux *
+gst_ws_mux_acquire(const gchar *uri, guint io_pool_size)
+{
+  GstWsMux *mux;
+
+  g_return_val_if_fail(uri != NULL, NULL);
+
+  gst_ws_mux_init_debug();
+
+  g_mutex_lock(&mux_lock);
+
+  if (!endpoints)
+    endpoints = g_hash_table_new(g_str_hash, g_str_equal);
+
+  mux = g_hash_table_lookup(endpoints, uri);
+  if (!mux) {
+    mux = g_new0(GstWsMux, 1);
+    mux->refcount = 1;
+    mux->uri = g_strdup(uri);
+    mux->reactor = gst_ws_reactor_acquire_shared(io_pool_size);
+    mux->streams = g_hash_table_new(g_direct_hash, g_direct_equal);
+    mux->next_id = 1;
+    g_queue_init(&mux->active);
+    mux->cancellable = g_cancellable_new();
+    mux->send_source = g_source_new(&gst_ws_mux_send_source_funcs,
+        sizeof(GstWsMuxSendSource));
+    ((GstWsMuxSendSource *)mux->send_source)->mux = mux;
+    g_source_attach(mux->send_source, gst_ws_reactor_get_context(mux->reactor));
+    g_hash_table_insert(endpoints, mux->uri, mux);
+    GST_INFO("Multiplexing streams to %s", uri);
+  }
+  mux->users++;
+
+  g_mutex_unlock(&mux_lock);
+
+  return mux;
+}
+
+void
+gst_ws_mux_release(GstWsMux *mux)
+{
+  gboolean last;
+
+  g_return_if_fail(mux != NULL);
+
+  g_mutex_lock(&mux_lock);
+  last = --mux->users == 0;
+  if (last) {
+    g_hash_table_remove(endpoints, mux->uri);
+    if (g_hash_table_size(endpoints) == 0) {
+      g_hash_table_unref(endpoints);
+      endpoints = NULL;
+    }
+  }
+  g_mutex_unlock(&mux_lock);
+
+  // the table's reference goes with the stop callback
+  if (last)
+    gst_ws_reactor_invoke(mux->reactor, gst_ws_mux_stop_cb, mux, gst_ws_mux_unref);
+}
+
+GstWsReactor *
+gst_ws_mux_get_reactor(GstWsMux *mux)
+{
+  return mux->reactor;
+}
+
+GstWsMuxStream *
+gst_ws_mux_stream_open(GstWsMux *mux, const GstWsMuxStreamCallbacks *callbacks,
+    gpointer user_data)
+{
+  GstWsMuxStream *stream;
+  guint tries;
+
+  // 0 is the connection itself, ids of closed streams are taken again eventually
+  for (tries = 0; tries < G_MAXUINT16; tries++) {
+    guint16 id = mux->next_id;
+
+    mux->next_id = mux->next_id == G_MAXUINT16 ? 1 : mux->next_id + 1;
+    if (!g_hash_table_contains(mux->streams, GUINT_TO_POINTER(id))) {
+      stream = g_new0(GstWsMuxStream, 1);
+      stream->mux = mux;
+      stream->id = id;
+      stream->callbacks = *callbacks;
+      stream->user_data = user_data;
+      g_queue_init(&stream->queue);
+      g_hash_table_insert(mux->streams, GUINT_TO_POINTER(id), stream);
+      GST_DEBUG("Stream %u on %s opened", id, mux->uri);
+
+      if (mux->conn)
+        callbacks->opened(stream, user_data);
+      else
+        gst_ws_mux_connect(mux);
+      return stream;
+    }
+  }
+
+  GST_ERROR("No stream id left on %s", mux->uri);
+  return NULL;
+}
+
+void
+gst_ws_mux_stream_close(GstWsMuxStream *stream)
+{
+  GstWsMux *mux = stream->mux;
+  GBytes *message;
+
+  GST_DEBUG("Stream %u on %s closed", stream->id, mux->uri);
+  // what the stream queued last, its own stream-close typically, still goes out. it
+  // skips the round robin, a closing stream has no share to wait for any more.
+  while (mux->conn && (message = g_queue_pop_head(&stream->queue)) != NULL) {
+    soup_websocket_connection_send_message(mux->conn, SOUP_WEBSOCKET_DATA_BINARY, message);
+    g_bytes_unref(message);
+  }
+  gst_ws_mux_stream_drop_queue(stream);
+  g_hash_table_remove(mux->streams, GUINT_TO_POINTER(stream->id));
+  g_free(stream);
+}
+
+guint16
+gst_ws_mux_stream_get_id(GstWsMuxStream *stream)
+{
+  return stream->id;
+}
+
+gboolean
+gst_ws_mux_stream_is_open(GstWsMuxStream *stream)
+{
+  return stream->mux->conn && !stream->ended &&
+      soup_websocket_connection_get_state(stream->mux->conn) == SOUP_WEBSOCKET_STATE_OPEN;
+}
+
+guint
+gst_ws_mux_stream_send(GstWsMuxStream *stream, GBytes *message)
+{
+  guint dropped = 0;
+
+  if (!gst_ws_mux_stream_is_open(stream)) {
+    g_bytes_unref(message);
+    return 1;
+  }
+
+  g_queue_push_tail(&stream->queue, message);
+  stream->queued_bytes += g_bytes_get_size(message);
+  while (stream->queued_bytes > STREAM_QUEUE_BYTES && stream->queue.length > 1) {
+    GBytes *oldest = g_queue_pop_head(&stream->queue);
+
+    stream->queued_bytes -= g_bytes_get_size(oldest);
+    g_bytes_unref(oldest);
+    dropped++;
+  }
+  if (dropped > 0)
+    GST_WS_HOT_LOG(NULL, "Stream %u congested, dropped %u queued messages",
+        stream->id, dropped);
+
+  if (!stream->active) {
+    stream->active = TRUE;
+    g_queue_push_tail(&stream->mux->active, stream);
+  }
+  return dropped;
+}
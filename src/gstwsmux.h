@@ -0,0 +1,54 @@
+#ifndef __GST_WS_MUX_H__
+#define __GST_WS_MUX_H__
+
+#include <gst/gst.h>
+#include <libsoup/soup.h>
+
+#include "gstwsreactor.h"
+
+G_BEGIN_DECLS
+
+// one WebSocket per endpoint shared by the elements of a process, each as a stream of
+// its own. binary messages are framed (gstwsframe.h) and carry the stream id, so the
+// demux hands every frame to its stream, control frames like a per-stream clear
+// included. a text message goes to the stream named in its "stream" field, one without
+// is dropped: a clear for one call must not interrupt the others. like standby
+// connections the endpoint is pinned to one shared reactor, its elements run there too.
+//
+// outbound messages wait in per-stream queues until the socket can take them, and are
+// sent in deficit round robin, so a stream with large or many messages gets its share
+// of the connection and no more.
+typedef struct _GstWsMux GstWsMux;
+typedef struct _GstWsMuxStream GstWsMuxStream;
+
+typedef struct
+{
+  // the shared connection is open, again after a reconnect
+  void (*opened)(GstWsMuxStream *stream, gpointer user_data);
+  // a complete message, frame header included for binary messages
+  void (*message)(GstWsMuxStream *stream, gint type, GBytes *message, gpointer user_data);
+  // the shared connection went away, it is reopened while streams are left. ended means
+  // the server closed only this stream, which will not open again.
+  void (*closed)(GstWsMuxStream *stream, guint close_code, const gchar *reason,
+      gboolean ended, gpointer user_data);
+} GstWsMuxStreamCallbacks;
+
+GstWsMux *gst_ws_mux_acquire(const gchar *uri, guint io_pool_size);
+void gst_ws_mux_release(GstWsMux *mux);
+
+GstWsReactor *gst_ws_mux_get_reactor(GstWsMux *mux);
+
+// everything below runs on the reactor thread. opened is called from within
+// gst_ws_mux_stream_open when the connection is already up.
+GstWsMuxStream *gst_ws_mux_stream_open(GstWsMux *mux, const GstWsMuxStreamCallbacks *callbacks,
+    gpointer user_data);
+// sends what the stream still has queued and frees it
+void gst_ws_mux_stream_close(GstWsMuxStream *stream);
+guint16 gst_ws_mux_stream_get_id(GstWsMuxStream *stream);
+gboolean gst_ws_mux_stream_is_open(GstWsMuxStream *stream);
+// takes the message, returns how many queued messages were dropped to make room
+guint gst_ws_mux_stream_send(GstWsMuxStream *stream, GBytes *message);
+
+G_END_DECLS
+
+#endif /* __GST_WS_MUX_H__ */
@@ -0,0 +1,306 @@
+#include "gstwsopus.h"
+
+#ifdef HAVE_OPUS
+#include <opus/opus.h>
+
+GST_DEBUG_CATEGORY_STATIC(gst_ws_opus_debug);
+#define GST_CAT_DEFAULT gst_ws_opus_debug
+
+// RFC 6716 recommends 1275 bytes as the upper bound of a single frame packet
+#define GST_WS_OPUS_MAX_PACKET 1275
+// the longest packet a peer may send, 120 ms
+#define GST_WS_OPUS_MAX_PACKET_MS 120
+
+struct _GstWsOpusEncoder
+{
+  OpusEncoder *encoder;
+  gboolean is_float;
+  guint channels;
+  guint frame_samples;
+  gsize frame_size;
+};
+
+struct _GstWsOpusDecoder
+{
+  OpusDecoder *decoder;
+  gboolean is_float;
+  guint channels;
+  guint bytes_per_frame;
+  guint max_samples;
+};
+
+static void
+gst_ws_opus_init_debug(void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    GST_DEBUG_CATEGORY_INIT(gst_ws_opus_debug, "websockettransceiver-opus",
+        0, "WebSocket Transceiver Opus wire codec");
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+// Opus takes native-endian samples, the other byte order would need a swap on every
+// sample in both directions
+static gboolean
+gst_ws_opus_format_is_float(GstWsSampleFormat format, gboolean *is_float)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  GstWsSampleFormat s16 = GST_WS_SAMPLE_FORMAT_S16LE, f32 = GST_WS_SAMPLE_FORMAT_F32LE;
+#else
+  GstWsSampleFormat s16 = GST_WS_SAMPLE_FORMAT_S16BE, f32 = GST_WS_SAMPLE_FORMAT_F32BE;
+#endif
+
+  if (format != s16 && format != f32)
+    return FALSE;
+  *is_float = format == f32;
+  return TRUE;
+}
+
+gboolean
+gst_ws_opus_available(void)
+{
+  return TRUE;
+}
+
+gboolean
+gst_ws_opus_supports(GstWsSampleFormat format, guint rate, guint channels)
+{
+  gboolean is_float;
+
+  if (!gst_ws_opus_format_is_float(format, &is_float))
+    return FALSE;
+  if (channels < 1 || channels > 2)
+    return FALSE;
+  return rate == 8000 || rate == 12000 || rate == 16000 || rate == 24000 || rate == 48000;
+}
+
+static gboolean
+gst_ws_opus_check(GstWsSampleFormat format, guint rate, guint channels, GError **error)
+{
+  gst_ws_opus_init_debug();
+  if (gst_ws_opus_supports(format, rate, channels))
+    return TRUE;
+
+  g_set_error(error, GST_STREAM_ERROR, GST_STREAM_ERROR_FORMAT,
+      "Opus needs native-endian S16 or F32 at 8, 12, 16, 24 or 48 kHz with 1 or 2 "
+      "channels, got %u Hz with %u channels", rate, channels);
+  return FALSE;
+}
+
+GstWsOpusEncoder *
+gst_ws_opus_encoder_new(GstWsSampleFormat format, guint rate, guint channels,
+    GError **error)
+{
+  GstWsOpusEncoder *encoder;
+  int err = OPUS_OK;
+
+  if (!gst_ws_opus_check(format, rate, channels, error))
+    return NULL;
+
+  encoder = g_new0(GstWsOpusEncoder, 1);
+  // VOIP favours speech intelligibility, the bitrate is left to libopus' automatic
+  // choice, around 20 kbps for 16 kHz mono
+  encoder->encoder = opus_encoder_create(rate, channels, OPUS_APPLICATION_VOIP, &err);
+  if (err != OPUS_OK) {
+    g_set_error(error, GST_LIBRARY_ERROR, GST_LIBRARY_ERROR_INIT,
+        "Failed to create Opus encoder: %s", opus_strerror(err));
+    g_free(encoder);
+    return NULL;
+  }
+  gst_ws_opus_format_is_float(format, &encoder->is_float);
+  encoder->channels = channels;
+  encoder->frame_samples = rate * GST_WS_OPUS_FRAME_MS / 1000;
+  encoder->frame_size = encoder->frame_samples * channels *
+      (encoder->is_float ? sizeof(float) : sizeof(opus_int16));
+  return encoder;
+}
+
+void
+gst_ws_opus_encoder_free(GstWsOpusEncoder *encoder)
+{
+  if (!encoder)
+    return;
+
+  opus_encoder_destroy(encoder->encoder);
+  g_free(encoder);
+}
+
+gsize
+gst_ws_opus_encoder_frame_size(GstWsOpusEncoder *encoder)
+{
+  return encoder->frame_size;
+}
+
+GstBuffer *
+gst_ws_opus_encoder_encode(GstWsOpusEncoder *encoder, gconstpointer pcm)
+{
+  guint8 *packet = g_malloc(GST_WS_OPUS_MAX_PACKET);
+  opus_int32 size;
+
+  if (encoder->is_float)
+    size = opus_encode_float(encoder->encoder, pcm, encoder->frame_samples, packet,
+        GST_WS_OPUS_MAX_PACKET);
+  else
+    size = opus_encode(encoder->encoder, pcm, encoder->frame_samples, packet,
+        GST_WS_OPUS_MAX_PACKET);
+
+  if (size <= 0) {
+    GST_WARNING("Opus encoding failed: %s", opus_strerror(size));
+    g_free(packet);
+    return NULL;
+  }
+
+  return gst_buffer_new_wrapped_full(0, packet, GST_WS_OPUS_MAX_PACKET, 0, size, packet,
+      g_free);
+}
+
+GstWsOpusDecoder *
+gst_ws_opus_decoder_new(GstWsSampleFormat format, guint rate, guint channels,
+    GError **error)
+{
+  GstWsOpusDecoder *decoder;
+  int err = OPUS_OK;
+
+  if (!gst_ws_opus_check(format, rate, channels, error))
+    return NULL;
+
+  decoder = g_new0(GstWsOpusDecoder, 1);
+  decoder->decoder = opus_decoder_create(rate, channels, &err);
+  if (err != OPUS_OK) {
+    g_set_error(error, GST_LIBRARY_ERROR, GST_LIBRARY_ERROR_INIT,
+        "Failed to create Opus decoder: %s", opus_strerror(err));
+    g_free(decoder);
+    return NULL;
+  }
+  gst_ws_opus_format_is_float(format, &decoder->is_float);
+  decoder->channels = channels;
+  decoder->bytes_per_frame = channels * (decoder->is_float ? sizeof(float) : sizeof(opus_int16));
+  decoder->max_samples = rate * GST_WS_OPUS_MAX_PACKET_MS / 1000;
+  return decoder;
+}
+
+void
+gst_ws_opus_decoder_free(GstWsOpusDecoder *decoder)
+{
+  if (!decoder)
+    return;
+
+  opus_decoder_destroy(decoder->decoder);
+  g_free(decoder);
+}
+
+// the output buffer is sized for the longest packet and shrunk to what was decoded,
+// which costs a little memory per frame but no second pass over the packet
+GstBuffer *
+gst_ws_opus_decoder_decode(GstWsOpusDecoder *decoder, gconstpointer packet, gsize size)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  int samples;
+
+  if (size == 0 || size > G_MAXINT32)
+    return NULL;
+
+  buffer = gst_buffer_new_allocate(NULL, decoder->max_samples * decoder->bytes_per_frame,
+      NULL);
+  gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+  if (decoder->is_float)
+    samples = opus_decode_float(decoder->decoder, packet, size, (float *)map.data,
+        decoder->max_samples, 0);
+  else
+    samples = opus_decode(decoder->decoder, packet, size, (opus_int16 *)map.data,
+        decoder->max_samples, 0);
+  gst_buffer_unmap(buffer, &map);
+
+  if (samples < 0) {
+    GST_WARNING("Dropping undecodable Opus packet: %s", opus_strerror(samples));
+    gst_buffer_unref(buffer);
+    return NULL;
+  }
+
+  gst_buffer_set_size(buffer, (gssize)samples * decoder->bytes_per_frame);
+  return buffer;
+}
+
+#else
+
+// built without libopus: wire-codec=opus is refused when the element starts, these only
+// keep the element linking
+gboolean
+gst_ws_opus_available(void)
+{
+  return FALSE;
+}
+
+gboolean
+gst_ws_opus_supports(GstWsSampleFormat format, guint rate, guint channels)
+{
+  (void)format;
+  (void)rate;
+  (void)channels;
+  return FALSE;
+}
+
+GstWsOpusEncoder *
+gst_ws_opus_encoder_new(GstWsSampleFormat format, guint rate, guint channels,
+    GError **error)
+{
+  (void)format;
+  (void)rate;
+  (void)channels;
+  g_set_error(error, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN,
+      "Built without Opus support");
+  return NULL;
+}
+
+void
+gst_ws_opus_encoder_free(GstWsOpusEncoder *encoder)
+{
+  (void)encoder;
+}
+
+gsize
+gst_ws_opus_encoder_frame_size(GstWsOpusEncoder *encoder)
+{
+  (void)encoder;
+  return 0;
+}
+
+GstBuffer *
+gst_ws_opus_encoder_encode(GstWsOpusEncoder *encoder, gconstpointer pcm)
+{
+  (void)encoder;
+  (void)pcm;
+  return NULL;
+}
+
+GstWsOpusDecoder *
+gst_ws_opus_decoder_new(GstWsSampleFormat format, guint rate, guint channels,
+    GError **error)
+{
+  (void)format;
+  (void)rate;
+  (void)channels;
+  g_set_error(error, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN,
+      "Built without Opus support");
+  return NULL;
+}
+
+void
+gst_ws_opus_decoder_free(GstWsOpusDecoder *decoder)
+{
+  (void)decoder;
+}
+
+GstBuffer *
+gst_ws_opus_decoder_decode(GstWsOpusDecoder *decoder, gconstpointer packet, gsize size)
+{
+  (void)decoder;
+  (void)packet;
+  (void)size;
+  return NULL;
+}
+
+#endif /* HAVE_OPUS */
@@ -0,0 +1,40 @@
+#ifndef __GST_WS_OPUS_H__
+#define __GST_WS_OPUS_H__
+
+#include <gst/gst.h>
+
+#include "gstwsaudio.h"
+
+G_BEGIN_DECLS
+
+// Opus on the WebSocket leg, used with wire-codec=opus. every binary message carries
+// exactly one packet of GST_WS_OPUS_FRAME_MS. the codec runs on PCM in host byte order,
+// S16 or F32, at one of the rates Opus supports natively, so no conversion or resampling
+// happens here. without libopus at build time (HAVE_OPUS unset) nothing is available.
+#define GST_WS_OPUS_FRAME_MS 20
+
+typedef struct _GstWsOpusEncoder GstWsOpusEncoder;
+typedef struct _GstWsOpusDecoder GstWsOpusDecoder;
+
+gboolean gst_ws_opus_available(void);
+gboolean gst_ws_opus_supports(GstWsSampleFormat format, guint rate, guint channels);
+
+// the encoder and decoder are independent, each is used from one thread at a time
+GstWsOpusEncoder *gst_ws_opus_encoder_new(GstWsSampleFormat format, guint rate,
+    guint channels, GError **error);
+void gst_ws_opus_encoder_free(GstWsOpusEncoder *encoder);
+// PCM bytes that make up one packet
+gsize gst_ws_opus_encoder_frame_size(GstWsOpusEncoder *encoder);
+// encodes exactly one packet worth of PCM, NULL on error
+GstBuffer *gst_ws_opus_encoder_encode(GstWsOpusEncoder *encoder, gconstpointer pcm);
+
+GstWsOpusDecoder *gst_ws_opus_decoder_new(GstWsSampleFormat format, guint rate,
+    guint channels, GError **error);
+void gst_ws_opus_decoder_free(GstWsOpusDecoder *decoder);
+// decodes one packet into PCM in the decoder's format, NULL for a corrupt packet
+GstBuffer *gst_ws_opus_decoder_decode(GstWsOpusDecoder *decoder, gconstpointer packet,
+    gsize size);
+
+G_END_DECLS
+
+#endif /* __GST_WS_OPUS_H__ */
@@ -0,0 +1,361 @@
+#include "gstwsreactor.h"
+#include "gstwsdeflate.h"
+#include "gstwssched.h"
+
+GST_DEBUG_CATEGORY_STATIC(gst_ws_reactor_debug);
+#define GST_CAT_DEFAULT gst_ws_reactor_debug
+
+#define MAX_AUTO_POOL_SIZE 4
+
+struct _GstWsReactor
+{
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  SoupSession *session;
+
+  // number of elements currently assigned to this reactor (protected by pool_lock)
+  guint users;
+  // owned by a single element instead of the shared pool
+  gboolean is_private;
+
+  GMutex lock;
+  GCond cond;
+  gboolean ready;
+
+  // what elements asked of the thread so far, the highest priority wins and the first
+  // CPU list sticks (protected by lock)
+  gint priority;
+  gchar *cpus;
+  gboolean realtime;
+};
+
+typedef struct
+{
+  GstWsReactor *reactor;
+  gint priority;
+  const gchar *cpus;
+  guint64 rtkit_tid;
+} GstWsReactorScheduling;
+
+typedef struct
+{
+  GSourceFunc func;
+  gpointer data;
+  GMutex lock;
+  GCond cond;
+  gboolean done;
+} GstWsReactorInvokeSync;
+
+// the shared pool is created on first use and torn down when its last user leaves,
+// so processes that never enable io-pool never pay for the extra threads.
+static GMutex pool_lock;
+static GstWsReactor **pool = NULL;
+static guint pool_len = 0;
+static guint pool_users = 0;
+
+static void
+gst_ws_reactor_init_debug(void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    GST_DEBUG_CATEGORY_INIT(gst_ws_reactor_debug, "websockettransceiver-reactor",
+        0, "WebSocket Transceiver shared I/O reactor");
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+static gpointer
+gst_ws_reactor_thread(gpointer user_data)
+{
+  GstWsReactor *reactor = user_data;
+
+  g_main_context_push_thread_default(reactor->context);
+
+  // the session must be created with the reactor context as thread default so its
+  // internal sources (DNS, TLS, idle connection cleanup) are attached to this thread
+  reactor->session = soup_session_new();
+  gst_ws_deflate_install(reactor->session);
+
+  g_mutex_lock(&reactor->lock);
+  reactor->ready = TRUE;
+  g_cond_signal(&reactor->cond);
+  g_mutex_unlock(&reactor->lock);
+
+  GST_DEBUG("Reactor %p running", reactor);
+  g_main_loop_run(reactor->loop);
+
+  g_object_unref(reactor->session);
+  reactor->session = NULL;
+
+  g_main_context_pop_thread_default(reactor->context);
+  GST_DEBUG("Reactor %p stopped", reactor);
+  return NULL;
+}
+
+static GstWsReactor *
+gst_ws_reactor_new(const gchar *thread_name)
+{
+  GstWsReactor *reactor = g_new0(GstWsReactor, 1);
+
+  g_mutex_init(&reactor->lock);
+  g_cond_init(&reactor->cond);
+  reactor->context = g_main_context_new();
+  reactor->loop = g_main_loop_new(reactor->context, FALSE);
+  reactor->thread = g_thread_new(thread_name, gst_ws_reactor_thread, reactor);
+
+  g_mutex_lock(&reactor->lock);
+  while (!reactor->ready)
+    g_cond_wait(&reactor->cond, &reactor->lock);
+  g_mutex_unlock(&reactor->lock);
+
+  return reactor;
+}
+
+static gboolean
+gst_ws_reactor_quit_cb(gpointer user_data)
+{
+  GstWsReactor *reactor = user_data;
+
+  g_main_loop_quit(reactor->loop);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gst_ws_reactor_free(GstWsReactor *reactor)
+{
+  // quit from inside the loop so any sources already queued (closing handshakes,
+  // cancelled connects) get dispatched before the thread exits
+  gst_ws_reactor_invoke(reactor, gst_ws_reactor_quit_cb, reactor, NULL);
+  g_thread_join(reactor->thread);
+
+  g_main_loop_unref(reactor->loop);
+  g_main_context_unref(reactor->context);
+  g_mutex_clear(&reactor->lock);
+  g_cond_clear(&reactor->cond);
+  g_free(reactor->cpus);
+  g_free(reactor);
+}
+
+static gboolean
+gst_ws_reactor_pool_owns_current_thread(void)
+{
+  for (guint i = 0; i < pool_len; i++) {
+    if (g_main_context_is_owner(pool[i]->context))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+GstWsReactor *
+gst_ws_reactor_acquire_shared(guint pool_size)
+{
+  GstWsReactor *reactor;
+
+  gst_ws_reactor_init_debug();
+
+  g_mutex_lock(&pool_lock);
+
+  if (!pool) {
+    pool_len = pool_size > 0 ? pool_size : MIN(g_get_num_processors(), MAX_AUTO_POOL_SIZE);
+    pool = g_new0(GstWsReactor *, pool_len);
+    for (guint i = 0; i < pool_len; i++) {
+      gchar *name = g_strdup_printf("ws-reactor-%u", i);
+      pool[i] = gst_ws_reactor_new(name);
+      g_free(name);
+    }
+    GST_INFO("Started shared WebSocket I/O pool with %u reactor threads", pool_len);
+  } else if (pool_size > 0 && pool_size != pool_len) {
+    GST_WARNING("Shared I/O pool already running with %u threads, ignoring io-pool-size=%u",
+        pool_len, pool_size);
+  }
+
+  // least-loaded placement: connections are long lived (one per call), so balancing
+  // by user count keeps the per-thread message rate even without any migration
+  reactor = pool[0];
+  for (guint i = 1; i < pool_len; i++) {
+    if (pool[i]->users < reactor->users)
+      reactor = pool[i];
+  }
+  reactor->users++;
+  pool_users++;
+
+  g_mutex_unlock(&pool_lock);
+
+  return reactor;
+}
+
+// a reactor of its own, for elements that do not share threads. it runs the same
+// timer driven connect and reconnect code as a pooled one.
+GstWsReactor *
+gst_ws_reactor_new_private(const gchar *thread_name)
+{
+  GstWsReactor *reactor;
+
+  gst_ws_reactor_init_debug();
+
+  reactor = gst_ws_reactor_new(thread_name);
+  reactor->is_private = TRUE;
+  reactor->users = 1;
+  return reactor;
+}
+
+void
+gst_ws_reactor_release(GstWsReactor *reactor)
+{
+  g_return_if_fail(reactor != NULL);
+
+  if (reactor->is_private) {
+    g_return_if_fail(!g_main_context_is_owner(reactor->context));
+    gst_ws_reactor_free(reactor);
+    return;
+  }
+
+  g_mutex_lock(&pool_lock);
+
+  reactor->users--;
+  pool_users--;
+
+  // a reactor thread cannot join itself, so if the last user leaves from inside a
+  // reactor callback the pool is simply kept alive for the next user
+  if (pool_users == 0 && !gst_ws_reactor_pool_owns_current_thread()) {
+    for (guint i = 0; i < pool_len; i++)
+      gst_ws_reactor_free(pool[i]);
+    g_free(pool);
+    pool = NULL;
+    pool_len = 0;
+    GST_INFO("Shared WebSocket I/O pool stopped");
+  }
+
+  g_mutex_unlock(&pool_lock);
+}
+
+// another user reference on a reactor that is already running, for callers that must
+// land on one particular reactor rather than the least loaded one
+GstWsReactor *
+gst_ws_reactor_acquire(GstWsReactor *reactor)
+{
+  g_return_val_if_fail(reactor != NULL, NULL);
+  g_return_val_if_fail(!reactor->is_private, NULL);
+
+  g_mutex_lock(&pool_lock);
+  reactor->users++;
+  pool_users++;
+  g_mutex_unlock(&pool_lock);
+
+  return reactor;
+}
+
+static gboolean
+gst_ws_reactor_set_scheduling_cb(gpointer user_data)
+{
+  GstWsReactorScheduling *scheduling = user_data;
+
+  scheduling->reactor->realtime = gst_ws_sched_apply(NULL, scheduling->priority,
+      scheduling->cpus, &scheduling->rtkit_tid);
+  return G_SOURCE_REMOVE;
+}
+
+// a shared reactor serves elements that may ask for different things. raising the
+// priority for one of them raises it for all, which is what a real-time call needs from
+// the thread its audio passes through anyway. a second CPU list would move the others,
+// so it is ignored. rtkit is asked from the calling thread, the reactor thread is not
+// held up by D-Bus while it serves other elements.
+gboolean
+gst_ws_reactor_set_scheduling(GstWsReactor *reactor, gint priority, const gchar *cpus)
+{
+  GstWsReactorScheduling scheduling = { reactor, 0, NULL, 0 };
+  gboolean realtime;
+
+  g_return_val_if_fail(reactor != NULL, FALSE);
+
+  g_mutex_lock(&reactor->lock);
+  if (priority > reactor->priority) {
+    reactor->priority = priority;
+    scheduling.priority = priority;
+  }
+  if (cpus && !reactor->cpus) {
+    reactor->cpus = g_strdup(cpus);
+    scheduling.cpus = reactor->cpus;
+  } else if (cpus && g_strcmp0(cpus, reactor->cpus) != 0) {
+    GST_WARNING("Reactor %p already bound to CPUs %s, ignoring %s", reactor, reactor->cpus,
+        cpus);
+  }
+  if (scheduling.priority > 0 || scheduling.cpus)
+    gst_ws_reactor_invoke_sync(reactor, gst_ws_reactor_set_scheduling_cb, &scheduling);
+  if (scheduling.rtkit_tid)
+    reactor->realtime = gst_ws_sched_rtkit(NULL, scheduling.rtkit_tid, scheduling.priority);
+  realtime = reactor->realtime;
+  g_mutex_unlock(&reactor->lock);
+
+  return realtime;
+}
+
+GMainContext *
+gst_ws_reactor_get_context(GstWsReactor *reactor)
+{
+  return reactor->context;
+}
+
+SoupSession *
+gst_ws_reactor_get_session(GstWsReactor *reactor)
+{
+  return reactor->session;
+}
+
+void
+gst_ws_reactor_invoke(GstWsReactor *reactor, GSourceFunc func, gpointer data,
+    GDestroyNotify notify)
+{
+  g_main_context_invoke_full(reactor->context, G_PRIORITY_DEFAULT, func, data, notify);
+}
+
+static gboolean
+gst_ws_reactor_invoke_sync_cb(gpointer user_data)
+{
+  GstWsReactorInvokeSync *invoke = user_data;
+
+  invoke->func(invoke->data);
+
+  g_mutex_lock(&invoke->lock);
+  invoke->done = TRUE;
+  g_cond_signal(&invoke->cond);
+  g_mutex_unlock(&invoke->lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+// runs func on the reactor thread and waits for it to return. used for teardown, where
+// the caller must know that no callback for its connection can still be running.
+void
+gst_ws_reactor_invoke_sync(GstWsReactor *reactor, GSourceFunc func, gpointer data)
+{
+  GstWsReactorInvokeSync invoke;
+  GSource *source;
+
+  if (g_main_context_is_owner(reactor->context)) {
+    func(data);
+    return;
+  }
+
+  invoke.func = func;
+  invoke.data = data;
+  invoke.done = FALSE;
+  g_mutex_init(&invoke.lock);
+  g_cond_init(&invoke.cond);
+
+  source = g_idle_source_new();
+  g_source_set_priority(source, G_PRIORITY_HIGH);
+  g_source_set_callback(source, gst_ws_reactor_invoke_sync_cb, &invoke, NULL);
+  g_source_attach(source, reactor->context);
+  g_source_unref(source);
+
+  g_mutex_lock(&invoke.lock);
+  while (!invoke.done)
+    g_cond_wait(&invoke.cond, &invoke.lock);
+  g_mutex_unlock(&invoke.lock);
+
+  g_mutex_clear(&invoke.lock);
+  g_cond_clear(&invoke.cond);
+}
@@ -0,0 +1,33 @@
+#ifndef __GST_WS_REACTOR_H__
+#define __GST_WS_REACTOR_H__
+
+#include <gst/gst.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+// a reactor is one thread running one GMainContext with one SoupSession. all
+// connections registered on a reactor have their soup callbacks dispatched from that
+// thread, so many elements can share a handful of threads instead of owning one each.
+typedef struct _GstWsReactor GstWsReactor;
+
+GstWsReactor *gst_ws_reactor_acquire_shared(guint pool_size);
+GstWsReactor *gst_ws_reactor_new_private(const gchar *thread_name);
+GstWsReactor *gst_ws_reactor_acquire(GstWsReactor *reactor);
+void gst_ws_reactor_release(GstWsReactor *reactor);
+
+// moves the reactor thread to SCHED_FIFO at priority and binds it to cpus, as far as
+// the reactor allows (see gstwssched.h). returns whether the thread runs real-time.
+gboolean gst_ws_reactor_set_scheduling(GstWsReactor *reactor, gint priority,
+    const gchar *cpus);
+
+GMainContext *gst_ws_reactor_get_context(GstWsReactor *reactor);
+SoupSession *gst_ws_reactor_get_session(GstWsReactor *reactor);
+
+void gst_ws_reactor_invoke(GstWsReactor *reactor, GSourceFunc func, gpointer data,
+    GDestroyNotify notify);
+void gst_ws_reactor_invoke_sync(GstWsReactor *reactor, GSourceFunc func, gpointer data);
+
+G_END_DECLS
+
+#endif /* __GST_WS_REACTOR_H__ */
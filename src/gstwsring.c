@@ -0,0 +1,102 @@
+#include "gstwsring.h"
+
+#define GST_WS_RING_CACHE_LINE 64
+
+// indices are free-running 32-bit counters, wrapping is harmless because the capacity
+// is a power of two and only their difference is ever used. head and tail sit on
+// separate cache lines so the producer and consumer do not bounce one line between
+// cores on every operation.
+struct _GstWsRing
+{
+  gint head;
+  guint8 head_pad[GST_WS_RING_CACHE_LINE - sizeof(gint)];
+  gint tail;
+  guint8 tail_pad[GST_WS_RING_CACHE_LINE - sizeof(gint)];
+  guint mask;
+  gpointer *slots;
+};
+
+GstWsRing *
+gst_ws_ring_new(guint min_capacity)
+{
+  GstWsRing *ring = g_new0(GstWsRing, 1);
+  guint capacity = 1;
+
+  while (capacity < min_capacity)
+    capacity <<= 1;
+
+  ring->mask = capacity - 1;
+  ring->slots = g_new0(gpointer, capacity);
+  return ring;
+}
+
+void
+gst_ws_ring_free(GstWsRing *ring, GDestroyNotify free_func)
+{
+  gpointer item;
+
+  if (!ring)
+    return;
+
+  while ((item = gst_ws_ring_pop(ring)) != NULL) {
+    if (free_func)
+      free_func(item);
+  }
+
+  g_free(ring->slots);
+  g_free(ring);
+}
+
+// producer only. returns FALSE when the ring is full; was_empty (optional) tells the
+// caller whether this push made the ring non-empty, so wakeups can be limited to
+// that transition.
+gboolean
+gst_ws_ring_push(GstWsRing *ring, gpointer item, gboolean *was_empty)
+{
+  guint head = (guint) g_atomic_int_get(&ring->head);
+  guint tail = (guint) g_atomic_int_get(&ring->tail);
+
+  if (head - tail > ring->mask)
+    return FALSE;
+
+  g_atomic_pointer_set(&ring->slots[head & ring->mask], item);
+  g_atomic_int_set(&ring->head, (gint) (head + 1));
+
+  if (was_empty)
+    *was_empty = (head == tail);
+  return TRUE;
+}
+
+// safe from any thread. the slot is read before the tail CAS: if another thread popped
+// (or the producer reused the slot) in between, the CAS fails and the read is retried.
+gpointer
+gst_ws_ring_pop(GstWsRing *ring)
+{
+  for (;;) {
+    guint tail = (guint) g_atomic_int_get(&ring->tail);
+    guint head = (guint) g_atomic_int_get(&ring->head);
+    gpointer item;
+
+    if (head == tail)
+      return NULL;
+
+    item = g_atomic_pointer_get(&ring->slots[tail & ring->mask]);
+    if (g_atomic_int_compare_and_exchange(&ring->tail, (gint) tail, (gint) (tail + 1)))
+      return item;
+  }
+}
+
+guint
+gst_ws_ring_length(GstWsRing *ring)
+{
+  guint tail = (guint) g_atomic_int_get(&ring->tail);
+  guint head = (guint) g_atomic_int_get(&ring->head);
+
+  return head - tail;
+}
+
+guint
+gst_ws_ring_capacity(GstWsRing *ring)
+{
+  return ring->mask + 1;
+}
@@ -0,0 +1,24 @@
+#ifndef __GST_WS_RING_H__
+#define __GST_WS_RING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// fixed-capacity lock-free ring of pointers. there is exactly one producer, but pops
+// advance the tail with a CAS so any thread may pop: that is what lets the producer
+// implement drop-oldest (or a flush) without a lock while the consumer keeps reading.
+typedef struct _GstWsRing GstWsRing;
+
+GstWsRing *gst_ws_ring_new(guint min_capacity);
+void gst_ws_ring_free(GstWsRing *ring, GDestroyNotify free_func);
+
+gboolean gst_ws_ring_push(GstWsRing *ring, gpointer item, gboolean *was_empty);
+gpointer gst_ws_ring_pop(GstWsRing *ring);
+
+guint gst_ws_ring_length(GstWsRing *ring);
+guint gst_ws_ring_capacity(GstWsRing *ring);
+
+G_END_DECLS
+
+#endif /* __GST_WS_RING_H__ */
@@ -0,0 +1,266 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "gstwssched.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+GST_DEBUG_CATEGORY_STATIC(gst_ws_sched_debug);
+#define GST_CAT_DEFAULT gst_ws_sched_debug
+
+// as many as the glibc cpu_set_t holds
+#define MAX_CPUS 1024
+
+#define RTKIT_SERVICE "org.freedesktop.RealtimeKit1"
+#define RTKIT_PATH "/org/freedesktop/RealtimeKit1"
+
+typedef struct
+{
+  guint8 bits[MAX_CPUS / 8];
+} GstWsCpuMask;
+
+static void
+gst_ws_sched_init_debug(void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    GST_DEBUG_CATEGORY_INIT(gst_ws_sched_debug, "websockettransceiver-sched",
+        0, "WebSocket Transceiver thread scheduling");
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+static gboolean
+gst_ws_sched_parse_cpus(const gchar *cpus, GstWsCpuMask *mask, GError **error)
+{
+  gchar **items = g_strsplit(cpus, ",", -1);
+  gboolean ok = items[0] != NULL;
+
+  memset(mask, 0, sizeof(*mask));
+  for (gchar **item = items; ok && *item; item++) {
+    gchar *end;
+    guint64 first, last;
+
+    first = g_ascii_strtoull(*item, &end, 10);
+    ok = end != *item;
+    last = first;
+    if (ok && *end == '-') {
+      gchar *start = end + 1;
+
+      last = g_ascii_strtoull(start, &end, 10);
+      ok = end != start;
+    }
+    ok = ok && *end == '\0' && first <= last && last < MAX_CPUS;
+    for (guint64 cpu = first; ok && cpu <= last; cpu++)
+      mask->bits[cpu / 8] |= 1 << (cpu % 8);
+  }
+  g_strfreev(items);
+
+  if (!ok)
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid CPU list \"%s\", expected e.g. \"2\" or \"0-3,6\"", cpus);
+  return ok;
+}
+
+gboolean
+gst_ws_sched_check_cpus(const gchar *cpus, GError **error)
+{
+  GstWsCpuMask mask;
+
+  return gst_ws_sched_parse_cpus(cpus, &mask, error);
+}
+
+#ifdef __linux__
+
+static gboolean
+gst_ws_sched_is_realtime(void)
+{
+  struct sched_param param;
+  gint policy;
+
+  return pthread_getschedparam(pthread_self(), &policy, &param) == 0 &&
+      (policy == SCHED_FIFO || policy == SCHED_RR);
+}
+
+static GVariant *
+gst_ws_sched_rtkit_property(GDBusConnection *bus, const gchar *name, GError **error)
+{
+  GVariant *reply, *value;
+
+  reply = g_dbus_connection_call_sync(bus, RTKIT_SERVICE, RTKIT_PATH,
+      "org.freedesktop.DBus.Properties", "Get",
+      g_variant_new("(ss)", RTKIT_SERVICE, name), G_VARIANT_TYPE("(v)"),
+      G_DBUS_CALL_FLAGS_NONE, 1000, NULL, error);
+  if (!reply)
+    return NULL;
+  g_variant_get(reply, "(v)", &value);
+  g_variant_unref(reply);
+  return value;
+}
+
+// the unprivileged way. rtkit only hands out priorities up to MaxRealtimePriority and
+// only to processes that cap their real-time CPU time, so a runaway thread gets SIGXCPU
+// instead of locking up the machine. the cap is process wide, which is why it is only
+// set where there was none. rtkit checks the soft limit, which is put back if the
+// request fails. the hard limit cannot be raised again, so it is only lowered once the
+// thread is real-time.
+static gboolean
+gst_ws_sched_rtkit_request(guint64 tid, gint priority, GError **error)
+{
+  GDBusConnection *bus;
+  GVariant *value, *reply;
+  struct rlimit limit, previous;
+  gboolean capped = FALSE;
+
+  bus = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, error);
+  if (!bus)
+    return FALSE;
+
+  value = gst_ws_sched_rtkit_property(bus, "MaxRealtimePriority", NULL);
+  if (value) {
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_INT32) &&
+        g_variant_get_int32(value) < priority) {
+      GST_INFO("rtkit allows priorities up to %d, not %d", g_variant_get_int32(value),
+          priority);
+      priority = g_variant_get_int32(value);
+    }
+    g_variant_unref(value);
+  }
+  value = gst_ws_sched_rtkit_property(bus, "RTTimeUSecMax", NULL);
+  if (value) {
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_INT64) &&
+        getrlimit(RLIMIT_RTTIME, &previous) == 0 && previous.rlim_max == RLIM_INFINITY) {
+      limit = previous;
+      limit.rlim_cur = (rlim_t)g_variant_get_int64(value);
+      capped = setrlimit(RLIMIT_RTTIME, &limit) == 0;
+    }
+    g_variant_unref(value);
+  }
+
+  reply = g_dbus_connection_call_sync(bus, RTKIT_SERVICE, RTKIT_PATH, RTKIT_SERVICE,
+      "MakeThreadRealtime", g_variant_new("(tu)", tid, (guint32)priority), NULL,
+      G_DBUS_CALL_FLAGS_NONE, 1000, NULL, error);
+  g_object_unref(bus);
+  if (capped) {
+    if (reply)
+      limit.rlim_max = limit.rlim_cur;
+    setrlimit(RLIMIT_RTTIME, reply ? &limit : &previous);
+  }
+  if (!reply)
+    return FALSE;
+  g_variant_unref(reply);
+  return TRUE;
+}
+
+gboolean
+gst_ws_sched_apply(GObject *obj, gint priority, const gchar *cpus, guint64 *rtkit_tid)
+{
+  gst_ws_sched_init_debug();
+
+  *rtkit_tid = 0;
+
+  if (cpus) {
+    GstWsCpuMask mask;
+    cpu_set_t set;
+    gint err;
+
+    CPU_ZERO(&set);
+    if (gst_ws_sched_parse_cpus(cpus, &mask, NULL)) {
+      for (guint cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (mask.bits[cpu / 8] & (1 << (cpu % 8)))
+          CPU_SET(cpu, &set);
+      }
+    }
+    err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0)
+      GST_WARNING_OBJECT(obj, "Could not bind thread to CPUs %s: %s", cpus, g_strerror(err));
+    else
+      GST_INFO_OBJECT(obj, "Thread bound to CPUs %s", cpus);
+  }
+
+  if (priority > 0) {
+    struct sched_param param = { 0, };
+    gint err;
+
+    param.sched_priority = MIN(priority, sched_get_priority_max(SCHED_FIFO));
+    err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err == 0) {
+      GST_INFO_OBJECT(obj, "Thread runs SCHED_FIFO at priority %d", param.sched_priority);
+    } else if (err == EPERM) {
+      GST_DEBUG_OBJECT(obj, "Not allowed to set SCHED_FIFO, leaving it to rtkit");
+      *rtkit_tid = (guint64)syscall(SYS_gettid);
+    } else {
+      GST_WARNING_OBJECT(obj, "Could not make thread real-time at priority %d: %s",
+          priority, g_strerror(err));
+    }
+  }
+
+  return gst_ws_sched_is_realtime();
+}
+
+gboolean
+gst_ws_sched_rtkit(GObject *obj, guint64 tid, gint priority)
+{
+  GError *error = NULL;
+
+  gst_ws_sched_init_debug();
+
+  if (!gst_ws_sched_rtkit_request(tid, priority, &error)) {
+    GST_WARNING_OBJECT(obj, "Could not make thread %" G_GUINT64_FORMAT
+        " real-time at priority %d: rtkit: %s", tid, priority, error->message);
+    g_clear_error(&error);
+    return FALSE;
+  }
+  GST_INFO_OBJECT(obj, "Thread %" G_GUINT64_FORMAT " made real-time by rtkit", tid);
+  return TRUE;
+}
+
+guint64
+gst_ws_sched_preemptions(void)
+{
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_THREAD, &usage) != 0)
+    return 0;
+  return (guint64)usage.ru_nivcsw;
+}
+
+#else
+
+gboolean
+gst_ws_sched_apply(GObject *obj, gint priority, const gchar *cpus, guint64 *rtkit_tid)
+{
+  gst_ws_sched_init_debug();
+
+  *rtkit_tid = 0;
+  if (priority > 0 || cpus)
+    GST_WARNING_OBJECT(obj, "Thread priority and CPU affinity are only supported on Linux");
+  return FALSE;
+}
+
+gboolean
+gst_ws_sched_rtkit(GObject *obj, guint64 tid, gint priority)
+{
+  return FALSE;
+}
+
+guint64
+gst_ws_sched_preemptions(void)
+{
+  return 0;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __GST_WS_SCHED_H__
+#define __GST_WS_SCHED_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// scheduling of the element's own threads. a thread that paces audio sleeps almost all
+// the time, but when it wakes it has to run now, not after the encoder on the same core
+// used up its slice. SCHED_FIFO gets it that, through rtkit where the process is not
+// allowed to ask the kernel itself.
+#define GST_WS_SCHED_MAX_PRIORITY 99
+
+// a CPU list as in taskset and cpuset, e.g. "2" or "0-3,6"
+gboolean gst_ws_sched_check_cpus(const gchar *cpus, GError **error);
+// applies to the calling thread, without blocking. a priority of 0 and NULL cpus leave
+// that part as it is. returns whether the thread now runs SCHED_FIFO, what failed is
+// logged against obj. where only rtkit may grant it, *rtkit_tid is set to the thread id
+// to pass to gst_ws_sched_rtkit(), otherwise to 0.
+gboolean gst_ws_sched_apply(GObject *obj, gint priority, const gchar *cpus,
+    guint64 *rtkit_tid);
+// asks rtkit to make thread tid SCHED_FIFO. this is a few D-Bus round trips of up to a
+// second each, so it is called from a thread that may block, never a streaming one.
+gboolean gst_ws_sched_rtkit(GObject *obj, guint64 tid, gint priority);
+// involuntary context switches of the calling thread so far, 0 where unsupported
+guint64 gst_ws_sched_preemptions(void);
+
+G_END_DECLS
+
+#endif /* __GST_WS_SCHED_H__ */
@@ -0,0 +1,160 @@
+#include "gstwsstats.h"
+
+#include <string.h>
+
+static guint
+gst_ws_histogram_bucket(guint64 value_us)
+{
+  guint bucket;
+
+  if (value_us < 2)
+    return 0;
+  bucket = 63 - (guint)__builtin_clzll(value_us);
+  return MIN(bucket, GST_WS_HISTOGRAM_BUCKETS - 1);
+}
+
+void
+gst_ws_histogram_reset(GstWsHistogram *histogram)
+{
+  memset(histogram, 0, sizeof(*histogram));
+}
+
+void
+gst_ws_histogram_record(GstWsHistogram *histogram, guint64 value_us)
+{
+  gst_ws_stat_add(&histogram->buckets[gst_ws_histogram_bucket(value_us)], 1);
+  gst_ws_stat_add(&histogram->count, 1);
+  gst_ws_stat_add(&histogram->sum, value_us);
+  gst_ws_stat_max(&histogram->max, value_us);
+}
+
+void
+gst_ws_histogram_record_shared(GstWsHistogram *histogram, guint64 value_us)
+{
+  guint64 max = gst_ws_stat_get(&histogram->max);
+
+  __atomic_fetch_add(&histogram->buckets[gst_ws_histogram_bucket(value_us)], 1,
+      __ATOMIC_RELAXED);
+  __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&histogram->sum, value_us, __ATOMIC_RELAXED);
+  while (value_us > max && !__atomic_compare_exchange_n(&histogram->max, &max, value_us,
+          TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static guint64
+gst_ws_histogram_percentile(const guint64 *buckets, guint64 total, guint64 max, guint pct)
+{
+  guint64 seen = 0;
+  guint i;
+
+  if (total == 0)
+    return 0;
+
+  for (i = 0; i < GST_WS_HISTOGRAM_BUCKETS - 1; i++) {
+    seen += buckets[i];
+    if (seen * 100 >= total * pct)
+      return MIN(G_GUINT64_CONSTANT(2) << i, max);
+  }
+  return max;
+}
+
+void
+gst_ws_histogram_to_structure(const GstWsHistogram *histogram, GstStructure *s,
+    const gchar *name)
+{
+  guint64 buckets[GST_WS_HISTOGRAM_BUCKETS];
+  guint64 total = 0, count, sum, max;
+  GValue array = G_VALUE_INIT;
+  GValue value = G_VALUE_INIT;
+  gchar *field;
+  guint i;
+
+  // the fields are read one by one while the writer goes on, so the percentiles come
+  // from the bucket snapshot alone, which always agrees with itself
+  g_value_init(&array, GST_TYPE_ARRAY);
+  g_value_init(&value, G_TYPE_UINT64);
+  for (i = 0; i < GST_WS_HISTOGRAM_BUCKETS; i++) {
+    buckets[i] = gst_ws_stat_get(&histogram->buckets[i]);
+    total += buckets[i];
+    g_value_set_uint64(&value, buckets[i]);
+    gst_value_array_append_value(&array, &value);
+  }
+  g_value_unset(&value);
+  count = gst_ws_stat_get(&histogram->count);
+  sum = gst_ws_stat_get(&histogram->sum);
+  max = gst_ws_stat_get(&histogram->max);
+
+  field = g_strconcat(name, "-count", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64, count, NULL);
+  g_free(field);
+  field = g_strconcat(name, "-mean-us", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64, count > 0 ? sum / count : 0, NULL);
+  g_free(field);
+  field = g_strconcat(name, "-p50-us", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64,
+      gst_ws_histogram_percentile(buckets, total, max, 50), NULL);
+  g_free(field);
+  field = g_strconcat(name, "-p90-us", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64,
+      gst_ws_histogram_percentile(buckets, total, max, 90), NULL);
+  g_free(field);
+  field = g_strconcat(name, "-p99-us", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64,
+      gst_ws_histogram_percentile(buckets, total, max, 99), NULL);
+  g_free(field);
+  field = g_strconcat(name, "-max-us", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64, max, NULL);
+  g_free(field);
+  field = g_strconcat(name, "-buckets", NULL);
+  gst_structure_take_value(s, field, &array);
+  g_free(field);
+}
+
+void
+gst_ws_gauge_reset(GstWsGauge *gauge)
+{
+  memset(gauge, 0, sizeof(*gauge));
+}
+
+void
+gst_ws_gauge_record(GstWsGauge *gauge, guint64 value)
+{
+  guint64 samples = gst_ws_stat_get(&gauge->samples);
+
+  if (samples == 0 || value < gst_ws_stat_get(&gauge->min))
+    gst_ws_stat_set(&gauge->min, value);
+  gst_ws_stat_max(&gauge->max, value);
+  gst_ws_stat_add(&gauge->sum, value);
+  gst_ws_stat_set(&gauge->samples, samples + 1);
+}
+
+void
+gst_ws_gauge_to_structure(const GstWsGauge *gauge, GstStructure *s, const gchar *name)
+{
+  guint64 samples = gst_ws_stat_get(&gauge->samples);
+  guint64 sum = gst_ws_stat_get(&gauge->sum);
+  gchar *field;
+
+  field = g_strconcat(name, "-min", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64, gst_ws_stat_get(&gauge->min), NULL);
+  g_free(field);
+  field = g_strconcat(name, "-avg", NULL);
+  gst_structure_set(s, field, G_TYPE_DOUBLE,
+      samples > 0 ? (gdouble)sum / (gdouble)samples : 0.0, NULL);
+  g_free(field);
+  field = g_strconcat(name, "-max", NULL);
+  gst_structure_set(s, field, G_TYPE_UINT64, gst_ws_stat_get(&gauge->max), NULL);
+  g_free(field);
+}
+
+gsize
+gst_ws_stats_frame_overhead(gsize payload, gboolean masked)
+{
+  gsize overhead = 2;
+
+  if (payload > G_MAXUINT16)
+    overhead += 8;
+  else if (payload > 125)
+    overhead += 2;
+  return overhead + (masked ? 4 : 0);
+}
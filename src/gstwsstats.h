@@ -0,0 +1,81 @@
+#ifndef __GST_WS_STATS_H__
+#define __GST_WS_STATS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// statistics written by one thread and read by any. a counter has a single writer, which
+// updates it with a relaxed load and store instead of a locked read-modify-write, so the
+// hot paths pay what a plain increment costs and a reader never sees a torn 64 bit value,
+// not even on 32 bit targets. a reader takes no lock either, polling all of them is a few
+// hundred loads. a counter two threads contribute to is kept once per thread and the
+// parts are added up when it is read.
+static inline guint64
+gst_ws_stat_get(const guint64 *stat)
+{
+  return __atomic_load_n(stat, __ATOMIC_RELAXED);
+}
+
+static inline void
+gst_ws_stat_set(guint64 *stat, guint64 value)
+{
+  __atomic_store_n(stat, value, __ATOMIC_RELAXED);
+}
+
+static inline void
+gst_ws_stat_add(guint64 *stat, guint64 value)
+{
+  gst_ws_stat_set(stat, gst_ws_stat_get(stat) + value);
+}
+
+static inline void
+gst_ws_stat_max(guint64 *stat, guint64 value)
+{
+  if (value > gst_ws_stat_get(stat))
+    gst_ws_stat_set(stat, value);
+}
+
+// log2 buckets of microseconds. bucket 0 holds everything below 2 us, bucket i the
+// values from 2^i us up to 2^(i+1), the last one everything from about 8 s on.
+#define GST_WS_HISTOGRAM_BUCKETS 24
+
+typedef struct
+{
+  guint64 buckets[GST_WS_HISTOGRAM_BUCKETS];
+  guint64 count;
+  guint64 sum;
+  guint64 max;
+} GstWsHistogram;
+
+// min, average and max of a sampled level, like a queue depth
+typedef struct
+{
+  guint64 min;
+  guint64 max;
+  guint64 sum;
+  guint64 samples;
+} GstWsGauge;
+
+// resets only run while no thread writes, from state changes
+void gst_ws_histogram_reset(GstWsHistogram *histogram);
+void gst_ws_histogram_record(GstWsHistogram *histogram, guint64 value_us);
+// for the rare histogram without a single writer, with atomic read-modify-writes
+void gst_ws_histogram_record_shared(GstWsHistogram *histogram, guint64 value_us);
+// adds <name>-count, -mean-us, -p50-us, -p90-us, -p99-us, -max-us and <name>-buckets, the
+// bucket counts as an array. percentiles are the upper edge of their bucket, capped at max.
+void gst_ws_histogram_to_structure(const GstWsHistogram *histogram, GstStructure *s,
+    const gchar *name);
+
+void gst_ws_gauge_reset(GstWsGauge *gauge);
+void gst_ws_gauge_record(GstWsGauge *gauge, guint64 value);
+// adds <name>-min, <name>-avg and <name>-max
+void gst_ws_gauge_to_structure(const GstWsGauge *gauge, GstStructure *s, const gchar *name);
+
+// bytes a WebSocket frame header adds to a payload, the mask key included for the
+// frames a client sends
+gsize gst_ws_stats_frame_overhead(gsize payload, gboolean masked);
+
+G_END_DECLS
+
+#endif /* __GST_WS_STATS_H__ */
@@ -0,0 +1,90 @@
+#include "gstwstracer.h"
+
+gint _gst_ws_tracers = 0;
+
+static GstTracerRecord *tr_stage;
+
+static const gchar *const stage_names[] = {
+  "received", "queued", "dropped", "popped", "pushed", "sent",
+};
+
+struct _GstWsTracer
+{
+  GstTracer parent;
+};
+
+struct _GstWsTracerClass
+{
+  GstTracerClass parent_class;
+};
+
+G_DEFINE_TYPE(GstWsTracer, gst_ws_tracer, GST_TYPE_TRACER);
+
+static void
+gst_ws_tracer_init(GstWsTracer *self)
+{
+  (void)self;
+  g_atomic_int_inc(&_gst_ws_tracers);
+}
+
+static void
+gst_ws_tracer_finalize(GObject *object)
+{
+  (void)g_atomic_int_dec_and_test(&_gst_ws_tracers);
+  G_OBJECT_CLASS(gst_ws_tracer_parent_class)->finalize(object);
+}
+
+static void
+gst_ws_tracer_class_init(GstWsTracerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  gobject_class->finalize = gst_ws_tracer_finalize;
+
+  tr_stage = gst_tracer_record_new("websocket-stage.class",
+      "element", GST_TYPE_STRUCTURE, gst_structure_new("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_ELEMENT,
+          NULL),
+      "direction", GST_TYPE_STRUCTURE, gst_structure_new("value",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "description", G_TYPE_STRING, "send or recv",
+          NULL),
+      "stage", GST_TYPE_STRUCTURE, gst_structure_new("value",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "description", G_TYPE_STRING,
+          "received, queued, dropped, popped, pushed or sent",
+          NULL),
+      "bytes", GST_TYPE_STRUCTURE, gst_structure_new("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "size of the message or frame, 0 if unknown",
+          "min", G_TYPE_UINT64, G_GUINT64_CONSTANT(0),
+          "max", G_TYPE_UINT64, G_MAXUINT64,
+          NULL),
+      "latency", GST_TYPE_STRUCTURE, gst_structure_new("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING,
+          "ns spent before this stage, from the chain call (sent) or in the receive "
+          "queue (popped), GST_CLOCK_TIME_NONE elsewhere",
+          "min", G_TYPE_UINT64, G_GUINT64_CONSTANT(0),
+          "max", G_TYPE_UINT64, G_MAXUINT64,
+          NULL),
+      "ts", GST_TYPE_STRUCTURE, gst_structure_new("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "ts when the stage was reached",
+          "min", G_TYPE_UINT64, G_GUINT64_CONSTANT(0),
+          "max", G_TYPE_UINT64, G_MAXUINT64,
+          NULL),
+      NULL);
+  GST_OBJECT_FLAG_SET(tr_stage, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+}
+
+void
+gst_ws_tracer_report(GstElement *element, GstWsTraceDirection direction,
+    GstWsTraceStage stage, guint64 bytes, GstClockTime latency)
+{
+  // an instance always exists before the first report, and with it the record
+  gst_tracer_record_log(tr_stage, GST_OBJECT_NAME(element),
+      direction == GST_WS_TRACE_SEND ? "send" : "recv", stage_names[stage], bytes,
+      (guint64)latency, (guint64)gst_util_get_timestamp());
+}
@@ -0,0 +1,57 @@
+#ifndef __GST_WS_TRACER_H__
+#define __GST_WS_TRACER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// the "websocket" tracer, enabled with GST_TRACERS=websocket. the element reports where
+// its buffers are at the points below, and the tracer logs each of them as a
+// websocket-stage record (shown with GST_DEBUG=GST_TRACER:7), so per-stage timing can be
+// taken from a production run without any of the element's own debug logging. while no
+// tracer instance exists a report is one atomic load and a branch.
+typedef enum
+{
+  GST_WS_TRACE_RECEIVED,  // a message arrived from the server
+  GST_WS_TRACE_QUEUED,    // entered the send or receive ring
+  GST_WS_TRACE_DROPPED,   // left without being sent or played
+  GST_WS_TRACE_POPPED,    // the output thread took a frame from the receive ring
+  GST_WS_TRACE_PUSHED,    // a frame went downstream
+  GST_WS_TRACE_SENT,      // a message was handed to the socket
+} GstWsTraceStage;
+
+typedef enum
+{
+  GST_WS_TRACE_SEND,
+  GST_WS_TRACE_RECV,
+} GstWsTraceDirection;
+
+#define GST_TYPE_WS_TRACER (gst_ws_tracer_get_type())
+#define GST_WS_TRACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_WS_TRACER, GstWsTracer))
+#define GST_IS_WS_TRACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_WS_TRACER))
+
+typedef struct _GstWsTracer GstWsTracer;
+typedef struct _GstWsTracerClass GstWsTracerClass;
+
+GType gst_ws_tracer_get_type(void);
+
+// live tracer instances, only gst_ws_tracer touches it
+extern gint _gst_ws_tracers;
+
+#define GST_WS_TRACING() G_UNLIKELY(g_atomic_int_get(&_gst_ws_tracers) > 0)
+
+// latency is what the stage knows about time spent before it, GST_CLOCK_TIME_NONE
+// otherwise: the chain call for sent, the wait in the receive ring for popped
+#define GST_WS_TRACE(element, direction, stage, bytes, latency) G_STMT_START { \
+  if (GST_WS_TRACING()) \
+    gst_ws_tracer_report(GST_ELEMENT_CAST(element), direction, stage, bytes, latency); \
+} G_STMT_END
+
+void gst_ws_tracer_report(GstElement *element, GstWsTraceDirection direction,
+    GstWsTraceStage stage, guint64 bytes, GstClockTime latency);
+
+G_END_DECLS
+
+#endif /* __GST_WS_TRACER_H__ */
@@ -0,0 +1,125 @@
+#include "gstwstransport.h"
+
+typedef struct
+{
+  GstWsTransport parent;
+  SoupWebsocketConnection *conn;
+} GstWsSoupTransport;
+
+static void
+on_soup_message(SoupWebsocketConnection *conn, gint type, GBytes *message,
+    gpointer user_data)
+{
+  GstWsTransport *transport = user_data;
+
+  (void)conn;
+  transport->callbacks->message(transport, type, message, transport->user_data);
+}
+
+static void
+on_soup_error(SoupWebsocketConnection *conn, GError *error, gpointer user_data)
+{
+  GstWsTransport *transport = user_data;
+
+  (void)conn;
+  transport->callbacks->error(transport, error, transport->user_data);
+}
+
+static void
+on_soup_closed(SoupWebsocketConnection *conn, gpointer user_data)
+{
+  GstWsTransport *transport = user_data;
+
+  transport->callbacks->closed(transport, soup_websocket_connection_get_close_code(conn),
+      soup_websocket_connection_get_close_data(conn), transport->user_data);
+}
+
+static gboolean
+gst_ws_soup_transport_is_open(GstWsTransport *transport)
+{
+  GstWsSoupTransport *soup = (GstWsSoupTransport *)transport;
+
+  return soup_websocket_connection_get_state(soup->conn) == SOUP_WEBSOCKET_STATE_OPEN;
+}
+
+static void
+gst_ws_soup_transport_send(GstWsTransport *transport, gint type, GBytes *message)
+{
+  soup_websocket_connection_send_message(((GstWsSoupTransport *)transport)->conn, type,
+      message);
+}
+
+static const gchar *
+gst_ws_soup_transport_get_protocol(GstWsTransport *transport)
+{
+  return soup_websocket_connection_get_protocol(((GstWsSoupTransport *)transport)->conn);
+}
+
+// the emission in progress, if any, holds its own ref on the connection
+static void
+gst_ws_soup_transport_close(GstWsTransport *transport)
+{
+  GstWsSoupTransport *soup = (GstWsSoupTransport *)transport;
+
+  g_signal_handlers_disconnect_by_data(soup->conn, soup);
+  if (soup_websocket_connection_get_state(soup->conn) == SOUP_WEBSOCKET_STATE_OPEN)
+    soup_websocket_connection_close(soup->conn, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+  g_object_unref(soup->conn);
+  g_free(soup);
+}
+
+static const GstWsTransportFuncs gst_ws_soup_transport_funcs = {
+  gst_ws_soup_transport_is_open,
+  gst_ws_soup_transport_send,
+  gst_ws_soup_transport_get_protocol,
+  gst_ws_soup_transport_close,
+};
+
+GstWsTransport *
+gst_ws_transport_new_soup(SoupWebsocketConnection *conn,
+    const GstWsTransportCallbacks *callbacks, gpointer user_data)
+{
+  GstWsSoupTransport *soup = g_new0(GstWsSoupTransport, 1);
+
+  soup->parent.funcs = &gst_ws_soup_transport_funcs;
+  soup->parent.callbacks = callbacks;
+  soup->parent.user_data = user_data;
+  soup->conn = conn;
+
+  g_signal_connect(conn, "message", G_CALLBACK(on_soup_message), soup);
+  g_signal_connect(conn, "error", G_CALLBACK(on_soup_error), soup);
+  g_signal_connect(conn, "closed", G_CALLBACK(on_soup_closed), soup);
+  return &soup->parent;
+}
+
+SoupWebsocketConnection *
+gst_ws_transport_get_connection(GstWsTransport *transport)
+{
+  if (transport->funcs != &gst_ws_soup_transport_funcs)
+    return NULL;
+  return ((GstWsSoupTransport *)transport)->conn;
+}
+
+gboolean
+gst_ws_transport_is_open(GstWsTransport *transport)
+{
+  return transport->funcs->is_open(transport);
+}
+
+void
+gst_ws_transport_send(GstWsTransport *transport, gint type, GBytes *message)
+{
+  transport->funcs->send(transport, type, message);
+}
+
+const gchar *
+gst_ws_transport_get_protocol(GstWsTransport *transport)
+{
+  return transport->funcs->get_protocol(transport);
+}
+
+void
+gst_ws_transport_close(GstWsTransport *transport)
+{
+  transport->funcs->close(transport);
+}
@@ -0,0 +1,55 @@
+#ifndef __GST_WS_TRANSPORT_H__
+#define __GST_WS_TRANSPORT_H__
+
+#include <gst/gst.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+// the connection under the element: a libsoup WebSocket, or the in-memory loopback of
+// gstwsloopback.h. everything runs on the reactor thread the transport was created on,
+// callbacks included, and a callback may close the transport it is called for.
+typedef struct _GstWsTransport GstWsTransport;
+
+typedef struct
+{
+  // a complete message, type is a SoupWebsocketDataType
+  void (*message)(GstWsTransport *transport, gint type, GBytes *message, gpointer user_data);
+  void (*error)(GstWsTransport *transport, const GError *error, gpointer user_data);
+  // the peer or the network ended the connection
+  void (*closed)(GstWsTransport *transport, guint close_code, const gchar *reason,
+      gpointer user_data);
+} GstWsTransportCallbacks;
+
+// what an implementation provides. close also frees, no callback follows it.
+typedef struct
+{
+  gboolean (*is_open)(GstWsTransport *transport);
+  void (*send)(GstWsTransport *transport, gint type, GBytes *message);
+  const gchar *(*get_protocol)(GstWsTransport *transport);
+  void (*close)(GstWsTransport *transport);
+} GstWsTransportFuncs;
+
+// implementations start with this
+struct _GstWsTransport
+{
+  const GstWsTransportFuncs *funcs;
+  const GstWsTransportCallbacks *callbacks;
+  gpointer user_data;
+};
+
+// takes the ref on an open connection
+GstWsTransport *gst_ws_transport_new_soup(SoupWebsocketConnection *conn,
+    const GstWsTransportCallbacks *callbacks, gpointer user_data);
+// the libsoup connection, NULL for other transports
+SoupWebsocketConnection *gst_ws_transport_get_connection(GstWsTransport *transport);
+
+gboolean gst_ws_transport_is_open(GstWsTransport *transport);
+void gst_ws_transport_send(GstWsTransport *transport, gint type, GBytes *message);
+// the negotiated subprotocol, NULL for none
+const gchar *gst_ws_transport_get_protocol(GstWsTransport *transport);
+void gst_ws_transport_close(GstWsTransport *transport);
+
+G_END_DECLS
+
+#endif /* __GST_WS_TRANSPORT_H__ */
@@ -0,0 +1,131 @@
+#include "gstwsvad.h"
+#include "gstwsconvert.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define GST_WS_VAD_NEON 1
+#endif
+
+void
+gst_ws_vad_init(GstWsVad *vad)
+{
+  vad->scratch = NULL;
+  vad->scratch_samples = 0;
+}
+
+void
+gst_ws_vad_clear(GstWsVad *vad)
+{
+  g_free(vad->scratch);
+  gst_ws_vad_init(vad);
+}
+
+// the vector loops only handle mono, where neighbouring samples belong to the same
+// channel. they return how far they got, the scalar loop finishes.
+static gsize
+gst_ws_vad_measure_mono_simd(const gint16 *pcm, gsize samples, guint64 *energy,
+    guint64 *crossings)
+{
+  gsize i = 0;
+
+#if defined(__SSE2__)
+  __m128i sum = _mm_setzero_si128(), zero = _mm_setzero_si128();
+  guint64 lanes[2];
+
+  // each vector compares 8 samples with their successors, so the last sample of the
+  // buffer is left to the scalar loop
+  for (; i + 9 <= samples; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pcm + i));
+    __m128i next = _mm_loadu_si128((const __m128i *)(pcm + i + 1));
+    // halved first, so a pair of full-scale squares still fits the 32-bit madd lanes
+    __m128i half = _mm_srai_epi16(v, 1);
+    __m128i squares = _mm_madd_epi16(half, half);
+    __m128i flips = _mm_srai_epi16(_mm_xor_si128(v, next), 15);
+
+    sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(squares, zero));
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(squares, zero));
+    *crossings += __builtin_popcount(_mm_movemask_epi8(flips)) / 2;
+  }
+  _mm_storeu_si128((__m128i *)lanes, sum);
+  *energy += (lanes[0] + lanes[1]) * 4;
+#elif defined(GST_WS_VAD_NEON)
+  int64x2_t sum = vdupq_n_s64(0);
+
+  for (; i + 9 <= samples; i += 8) {
+    int16x8_t v = vld1q_s16(pcm + i);
+    int16x8_t next = vld1q_s16(pcm + i + 1);
+    uint16x8_t flips = vshrq_n_u16(vreinterpretq_u16_s16(veorq_s16(v, next)), 15);
+
+    sum = vpadalq_s32(sum, vmull_s16(vget_low_s16(v), vget_low_s16(v)));
+    sum = vpadalq_s32(sum, vmull_s16(vget_high_s16(v), vget_high_s16(v)));
+    *crossings += vaddvq_u16(flips);
+  }
+  *energy += (guint64)vaddvq_s64(sum);
+#endif
+
+  return i;
+}
+
+void
+gst_ws_vad_measure(const gint16 *pcm, gsize samples, guint channels, gdouble *rms,
+    gdouble *zcr)
+{
+  guint64 energy = 0, crossings = 0;
+  gsize i = 0;
+
+  if (samples == 0 || channels == 0) {
+    *rms = 0.0;
+    *zcr = 0.0;
+    return;
+  }
+
+  if (channels == 1)
+    i = gst_ws_vad_measure_mono_simd(pcm, samples, &energy, &crossings);
+  for (; i < samples; i++) {
+    energy += (gint64)pcm[i] * pcm[i];
+    if (i % channels == 0 && i + channels < samples && (pcm[i] ^ pcm[i + channels]) < 0)
+      crossings++;
+  }
+
+  *rms = sqrt((gdouble)energy / samples) / 32768.0;
+  *zcr = samples > channels ? (gdouble)crossings / (samples / channels) : 0.0;
+}
+
+gboolean
+gst_ws_vad_is_speech(GstWsVad *vad, GstWsSampleFormat format, guint channels,
+    gdouble threshold, GstBuffer *buffer)
+{
+  guint width = gst_ws_sample_format_width(format);
+  GstMapInfo map;
+  const gint16 *pcm;
+  gsize samples;
+  gdouble rms, zcr;
+
+  if (width == 0 || channels == 0 || !gst_buffer_map(buffer, &map, GST_MAP_READ))
+    return TRUE;
+
+  samples = map.size / width;
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  if (format == GST_WS_SAMPLE_FORMAT_S16LE && ((guintptr)map.data & 1) == 0) {
+#else
+  if (format == GST_WS_SAMPLE_FORMAT_S16BE && ((guintptr)map.data & 1) == 0) {
+#endif
+    pcm = (const gint16 *)map.data;
+  } else {
+    if (samples > vad->scratch_samples) {
+      vad->scratch_samples = samples;
+      vad->scratch = g_renew(gint16, vad->scratch, samples);
+    }
+    gst_ws_convert_to_s16(format, map.data, vad->scratch, samples);
+    pcm = vad->scratch;
+  }
+
+  gst_ws_vad_measure(pcm, samples, channels, &rms, &zcr);
+  gst_buffer_unmap(buffer, &map);
+
+  return rms >= threshold || (rms >= threshold / 2 && zcr >= GST_WS_VAD_FRICATIVE_ZCR);
+}
@@ -0,0 +1,36 @@
+#ifndef __GST_WS_VAD_H__
+#define __GST_WS_VAD_H__
+
+#include <gst/gst.h>
+
+#include "gstwsaudio.h"
+
+G_BEGIN_DECLS
+
+// energy and zero-crossing voice activity detection for the send path. a buffer is
+// speech when its RMS level reaches the threshold, or half of it with a zero-crossing
+// rate typical of unvoiced consonants (s, f, sh), which carry little energy. the
+// measurement runs on S16, vectorized with SSE2 or NEON; other formats are converted
+// first.
+#define GST_WS_VAD_FRICATIVE_ZCR 0.3
+
+typedef struct
+{
+  // S16 copy of the buffer for formats that need converting, reused between buffers
+  gint16 *scratch;
+  gsize scratch_samples;
+} GstWsVad;
+
+void gst_ws_vad_init(GstWsVad *vad);
+void gst_ws_vad_clear(GstWsVad *vad);
+
+// rms in [0, 1] of full scale, zcr as crossings per sample of the first channel
+void gst_ws_vad_measure(const gint16 *pcm, gsize samples, guint channels, gdouble *rms,
+    gdouble *zcr);
+// unknown formats always count as speech, so nothing is suppressed that was not measured
+gboolean gst_ws_vad_is_speech(GstWsVad *vad, GstWsSampleFormat format, guint channels,
+    gdouble threshold, GstBuffer *buffer);
+
+G_END_DECLS
+
+#endif /* __GST_WS_VAD_H__ */
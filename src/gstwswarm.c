@@ -0,0 +1,334 @@
+#include "gstwswarm.h"
+
+GST_DEBUG_CATEGORY_STATIC(gst_ws_warm_debug);
+#define GST_CAT_DEFAULT gst_ws_warm_debug
+
+// how long an endpoint keeps its standby connections after its last element left,
+// enough to bridge the gap between one call ending and the next one starting
+#define LINGER_MS 60000
+#define INITIAL_RETRY_MS 1000
+#define MAX_RETRY_MS 30000
+// keeps NAT bindings of idle sockets alive and notices servers that went away
+#define KEEPALIVE_SECONDS 15
+
+struct _GstWsWarmPool
+{
+  gint refcount;
+  gchar *key;
+  gchar *uri;
+  gchar **protocols;
+  GstWsReactor *reactor;
+
+  // protected by warm_lock
+  guint users;
+  guint depth;
+  gint64 last_release;
+  gboolean removed;
+
+  // reactor thread only
+  GQueue idle;
+  guint pending;
+  guint retry_ms;
+  GSource *retry_source;
+  GCancellable *cancellable;
+  gboolean stopped;
+};
+
+static GMutex warm_lock;
+static GHashTable *endpoints = NULL;
+
+static void gst_ws_warm_pool_refill(GstWsWarmPool *pool);
+
+static void
+gst_ws_warm_init_debug(void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    GST_DEBUG_CATEGORY_INIT(gst_ws_warm_debug, "websockettransceiver-warm",
+        0, "WebSocket Transceiver standby connections");
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+static GstWsWarmPool *
+gst_ws_warm_pool_ref(GstWsWarmPool *pool)
+{
+  g_atomic_int_inc(&pool->refcount);
+  return pool;
+}
+
+static void
+gst_ws_warm_pool_unref(gpointer data)
+{
+  GstWsWarmPool *pool = data;
+
+  if (!g_atomic_int_dec_and_test(&pool->refcount))
+    return;
+
+  g_clear_object(&pool->cancellable);
+  g_strfreev(pool->protocols);
+  g_free(pool->uri);
+  g_free(pool->key);
+  g_free(pool);
+}
+
+static void
+on_warm_closed(SoupWebsocketConnection *conn, gpointer user_data)
+{
+  GstWsWarmPool *pool = user_data;
+
+  GST_DEBUG("Standby connection to %s closed by the server", pool->uri);
+  g_signal_handlers_disconnect_by_data(conn, pool);
+  g_queue_remove(&pool->idle, conn);
+  g_object_unref(conn);
+
+  gst_ws_warm_pool_refill(pool);
+}
+
+static gboolean
+gst_ws_warm_pool_retry_cb(gpointer user_data)
+{
+  GstWsWarmPool *pool = user_data;
+
+  g_source_unref(pool->retry_source);
+  pool->retry_source = NULL;
+  gst_ws_warm_pool_refill(pool);
+  return G_SOURCE_REMOVE;
+}
+
+// a failed attempt is retried with exponential backoff, like element reconnects, so an
+// endpoint that is down is not hammered by its standby pool
+static void
+gst_ws_warm_pool_schedule_retry(GstWsWarmPool *pool)
+{
+  if (pool->stopped || pool->retry_source)
+    return;
+
+  pool->retry_ms = pool->retry_ms > 0 ? MIN(pool->retry_ms * 2, MAX_RETRY_MS) : INITIAL_RETRY_MS;
+  pool->retry_source = g_timeout_source_new(pool->retry_ms);
+  g_source_set_callback(pool->retry_source, gst_ws_warm_pool_retry_cb, pool, NULL);
+  g_source_attach(pool->retry_source, gst_ws_reactor_get_context(pool->reactor));
+}
+
+static void
+on_warm_connected(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  GstWsWarmPool *pool = user_data;
+  SoupWebsocketConnection *conn;
+  GError *error = NULL;
+
+  conn = soup_session_websocket_connect_finish(SOUP_SESSION(source), res, &error);
+  pool->pending--;
+
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    g_error_free(error);
+  } else if (error || !conn) {
+    GST_WARNING("Standby connection to %s failed: %s", pool->uri,
+        error ? error->message : "unknown");
+    g_clear_error(&error);
+    gst_ws_warm_pool_schedule_retry(pool);
+  } else if (pool->stopped) {
+    soup_websocket_connection_close(conn, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+    g_object_unref(conn);
+  } else {
+    pool->retry_ms = 0;
+    soup_websocket_connection_set_keepalive_interval(conn, KEEPALIVE_SECONDS);
+    g_signal_connect(conn, "closed", G_CALLBACK(on_warm_closed), pool);
+    g_queue_push_tail(&pool->idle, conn);
+    GST_DEBUG("Standby connection to %s ready, %u idle", pool->uri, pool->idle.length);
+  }
+
+  gst_ws_warm_pool_unref(pool);
+}
+
+// runs on the reactor thread. tops the idle set up to depth, counting attempts that
+// are still in flight
+static void
+gst_ws_warm_pool_refill(GstWsWarmPool *pool)
+{
+  guint depth;
+
+  if (pool->stopped || pool->retry_source)
+    return;
+
+  g_mutex_lock(&warm_lock);
+  depth = pool->depth;
+  g_mutex_unlock(&warm_lock);
+
+  while (pool->idle.length + pool->pending < depth) {
+    SoupMessage *msg = soup_message_new(SOUP_METHOD_GET, pool->uri);
+    if (!msg) {
+      GST_ERROR("Failed to create SoupMessage for URI: %s", pool->uri);
+      return;
+    }
+
+    pool->pending++;
+    soup_session_websocket_connect_async(gst_ws_reactor_get_session(pool->reactor), msg,
+        NULL, pool->protocols, 0, pool->cancellable, on_warm_connected,
+        gst_ws_warm_pool_ref(pool));
+    g_object_unref(msg);
+  }
+}
+
+static gboolean
+gst_ws_warm_pool_refill_cb(gpointer user_data)
+{
+  gst_ws_warm_pool_refill(user_data);
+  return G_SOURCE_REMOVE;
+}
+
+// runs on the reactor thread once the endpoint has been removed from the table
+static void
+gst_ws_warm_pool_stop(GstWsWarmPool *pool)
+{
+  SoupWebsocketConnection *conn;
+
+  pool->stopped = TRUE;
+  g_cancellable_cancel(pool->cancellable);
+
+  if (pool->retry_source) {
+    g_source_destroy(pool->retry_source);
+    g_source_unref(pool->retry_source);
+    pool->retry_source = NULL;
+  }
+
+  while ((conn = g_queue_pop_head(&pool->idle)) != NULL) {
+    g_signal_handlers_disconnect_by_data(conn, pool);
+    if (soup_websocket_connection_get_state(conn) == SOUP_WEBSOCKET_STATE_OPEN)
+      soup_websocket_connection_close(conn, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+    g_object_unref(conn);
+  }
+
+  GST_INFO("Standby connections to %s stopped", pool->uri);
+  gst_ws_reactor_release(pool->reactor);
+  pool->reactor = NULL;
+}
+
+// every release schedules one of these. only the one firing a full linger period after
+// the latest release finds the endpoint idle for long enough and tears it down.
+static gboolean
+gst_ws_warm_pool_linger_cb(gpointer user_data)
+{
+  GstWsWarmPool *pool = user_data;
+
+  g_mutex_lock(&warm_lock);
+  if (pool->removed || pool->users > 0 ||
+      g_get_monotonic_time() - pool->last_release < LINGER_MS * G_TIME_SPAN_MILLISECOND) {
+    g_mutex_unlock(&warm_lock);
+    return G_SOURCE_REMOVE;
+  }
+
+  pool->removed = TRUE;
+  g_hash_table_remove(endpoints, pool->key);
+  if (g_hash_table_size(endpoints) == 0) {
+    g_hash_table_unref(endpoints);
+    endpoints = NULL;
+  }
+  g_mutex_unlock(&warm_lock);
+
+  gst_ws_warm_pool_stop(pool);
+  // the table's reference
+  gst_ws_warm_pool_unref(pool);
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gst_ws_warm_pool_linger_start_cb(gpointer user_data)
+{
+  GstWsWarmPool *pool = user_data;
+  GSource *source = g_timeout_source_new(LINGER_MS);
+
+  g_source_set_callback(source, gst_ws_warm_pool_linger_cb, gst_ws_warm_pool_ref(pool),
+      gst_ws_warm_pool_unref);
+  g_source_attach(source, gst_ws_reactor_get_context(pool->reactor));
+  g_source_unref(source);
+  return G_SOURCE_REMOVE;
+}
+
+GstWsWarmPool *
+gst_ws_warm_pool_acquire(const gchar *uri, gchar **protocols, guint depth,
+    GstWsReactor *reactor)
+{
+  GstWsWarmPool *pool;
+  gchar *joined, *key;
+
+  g_return_val_if_fail(uri != NULL, NULL);
+  g_return_val_if_fail(reactor != NULL, NULL);
+
+  gst_ws_warm_init_debug();
+
+  joined = g_strjoinv(",", protocols);
+  key = g_strdup_printf("%s %s %p", uri, joined, (gpointer)reactor);
+  g_free(joined);
+
+  g_mutex_lock(&warm_lock);
+
+  if (!endpoints)
+    endpoints = g_hash_table_new(g_str_hash, g_str_equal);
+
+  pool = g_hash_table_lookup(endpoints, key);
+  if (!pool) {
+    pool = g_new0(GstWsWarmPool, 1);
+    pool->refcount = 1;
+    pool->key = key;
+    pool->uri = g_strdup(uri);
+    pool->protocols = g_strdupv(protocols);
+    pool->reactor = gst_ws_reactor_acquire(reactor);
+    pool->cancellable = g_cancellable_new();
+    g_queue_init(&pool->idle);
+    g_hash_table_insert(endpoints, pool->key, pool);
+    GST_INFO("Keeping standby connections to %s on reactor %p", uri, (gpointer)reactor);
+  } else {
+    g_free(key);
+  }
+
+  pool->users++;
+  pool->depth = MAX(pool->depth, depth);
+
+  g_mutex_unlock(&warm_lock);
+
+  gst_ws_reactor_invoke(pool->reactor, gst_ws_warm_pool_refill_cb,
+      gst_ws_warm_pool_ref(pool), gst_ws_warm_pool_unref);
+
+  return pool;
+}
+
+void
+gst_ws_warm_pool_release(GstWsWarmPool *pool)
+{
+  gboolean idle;
+
+  g_return_if_fail(pool != NULL);
+
+  g_mutex_lock(&warm_lock);
+  pool->users--;
+  idle = pool->users == 0;
+  if (idle)
+    pool->last_release = g_get_monotonic_time();
+  g_mutex_unlock(&warm_lock);
+
+  if (idle) {
+    gst_ws_reactor_invoke(pool->reactor, gst_ws_warm_pool_linger_start_cb,
+        gst_ws_warm_pool_ref(pool), gst_ws_warm_pool_unref);
+  }
+}
+
+SoupWebsocketConnection *
+gst_ws_warm_pool_take(GstWsWarmPool *pool)
+{
+  SoupWebsocketConnection *conn;
+
+  while ((conn = g_queue_pop_head(&pool->idle)) != NULL) {
+    g_signal_handlers_disconnect_by_data(conn, pool);
+    if (soup_websocket_connection_get_state(conn) == SOUP_WEBSOCKET_STATE_OPEN) {
+      // the element runs its own liveness handling, hand it over as a fresh one
+      soup_websocket_connection_set_keepalive_interval(conn, 0);
+      break;
+    }
+    g_object_unref(conn);
+  }
+
+  gst_ws_warm_pool_refill(pool);
+  return conn;
+}
@@ -0,0 +1,28 @@
+#ifndef __GST_WS_WARM_H__
+#define __GST_WS_WARM_H__
+
+#include <gst/gst.h>
+#include <libsoup/soup.h>
+
+#include "gstwsreactor.h"
+
+G_BEGIN_DECLS
+
+// process-wide standby connections, already upgraded, kept per endpoint (URI plus
+// offered subprotocols) and reactor. a SoupWebsocketConnection dispatches on the
+// context it was created on and cannot move, so each reactor an element picked keeps
+// standby connections of its own, and many calls to one backend still spread over the
+// reactors.
+typedef struct _GstWsWarmPool GstWsWarmPool;
+
+// the standby connections of uri on reactor, the one the caller runs on
+GstWsWarmPool *gst_ws_warm_pool_acquire(const gchar *uri, gchar **protocols, guint depth,
+    GstWsReactor *reactor);
+void gst_ws_warm_pool_release(GstWsWarmPool *pool);
+
+// reactor thread only. returns an open connection or NULL, and starts a replacement
+SoupWebsocketConnection *gst_ws_warm_pool_take(GstWsWarmPool *pool);
+
+G_END_DECLS
+
+#endif /* __GST_WS_WARM_H__ */
@@ -73,109 +73,1552 @@ GST_START_TEST(test_properties_set_get)
 }
 GST_END_TEST;
 
+GST_START_TEST(test_io_pool_properties)
+{
+  GstElement *element;
+  gboolean io_pool;
+  guint io_pool_size;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "io-pool", &io_pool, "io-pool-size", &io_pool_size, NULL);
+  fail_unless(io_pool == FALSE, "Shared I/O pool should be opt-in");
+  fail_unless_equals_int(io_pool_size, 0);
+
+  g_object_set(element, "io-pool", TRUE, "io-pool-size", 2, NULL);
+  g_object_get(element, "io-pool", &io_pool, "io-pool-size", &io_pool_size, NULL);
+  fail_unless(io_pool == TRUE);
+  fail_unless_equals_int(io_pool_size, 2);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prewarm_property)
+{
+  GstElement *element;
+  guint prewarm;
+  guint64 warm_connects;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "prewarm-connections", &prewarm, "warm-connects", &warm_connects,
+      NULL);
+  fail_unless_equals_int(prewarm, 0);
+  fail_unless_equals_uint64(warm_connects, 0);
+
+  g_object_set(element, "prewarm-connections", 2, NULL);
+  g_object_get(element, "prewarm-connections", &prewarm, NULL);
+  fail_unless_equals_int(prewarm, 2);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_send_queue_properties)
+{
+  GstElement *element;
+  guint send_queue_size;
+  gint send_overflow;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "send-queue-size", &send_queue_size, NULL);
+  fail_unless_equals_int(send_queue_size, 32);
+
+  gst_util_set_object_arg(G_OBJECT(element), "send-overflow", "block");
+  g_object_get(element, "send-overflow", &send_overflow, NULL);
+  fail_unless_equals_int(send_overflow, 2);
+
+  gst_util_set_object_arg(G_OBJECT(element), "send-overflow", "drop-newest");
+  g_object_get(element, "send-overflow", &send_overflow, NULL);
+  fail_unless_equals_int(send_overflow, 1);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_send_batch_properties)
+{
+  GstElement *element;
+  guint batch_ms, batch_bytes, max_latency_ms;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "send-batch-ms", &batch_ms, "send-batch-bytes", &batch_bytes,
+      "send-batch-max-latency-ms", &max_latency_ms, NULL);
+  fail_unless_equals_int(batch_ms, 0);
+  fail_unless_equals_int(batch_bytes, 0);
+  fail_unless_equals_int(max_latency_ms, 60);
+
+  g_object_set(element, "send-batch-ms", 40, "send-batch-bytes", 1280,
+      "send-batch-max-latency-ms", 50, NULL);
+  g_object_get(element, "send-batch-ms", &batch_ms, "send-batch-bytes", &batch_bytes,
+      "send-batch-max-latency-ms", &max_latency_ms, NULL);
+  fail_unless_equals_int(batch_ms, 40);
+  fail_unless_equals_int(batch_bytes, 1280);
+  fail_unless_equals_int(max_latency_ms, 50);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_recv_buffer_properties)
+{
+  GstElement *element;
+  gint mode;
+  guint64 pool_hits, pool_misses;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "recv-buffer-mode", &mode, "pool-hits", &pool_hits,
+      "pool-misses", &pool_misses, NULL);
+  fail_unless_equals_int(mode, 0);
+  fail_unless_equals_uint64(pool_hits, 0);
+  fail_unless_equals_uint64(pool_misses, 0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "recv-buffer-mode", "wrap");
+  g_object_get(element, "recv-buffer-mode", &mode, NULL);
+  fail_unless_equals_int(mode, 3);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_jitter_properties)
+{
+  GstElement *element;
+  gint mode;
+  guint min_latency, max_latency, jitter;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "jitter-mode", &mode, "min-latency-ms", &min_latency,
+      "max-latency-ms", &max_latency, "jitter-ms", &jitter, NULL);
+  fail_unless_equals_int(mode, 0);
+  fail_unless_equals_int(min_latency, 40);
+  fail_unless_equals_int(max_latency, 500);
+  fail_unless_equals_int(jitter, 0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "jitter-mode", "adaptive");
+  g_object_set(element, "min-latency-ms", 60, "max-latency-ms", 1000, NULL);
+  g_object_get(element, "jitter-mode", &mode, "min-latency-ms", &min_latency,
+      "max-latency-ms", &max_latency, NULL);
+  fail_unless_equals_int(mode, 1);
+  fail_unless_equals_int(min_latency, 60);
+  fail_unless_equals_int(max_latency, 1000);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_fill_mode_property)
+{
+  GstElement *element;
+  gint mode;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "fill-mode", &mode, NULL);
+  fail_unless_equals_int(mode, 0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "fill-mode", "comfort-noise");
+  g_object_get(element, "fill-mode", &mode, NULL);
+  fail_unless_equals_int(mode, 2);
+
+  gst_util_set_object_arg(G_OBJECT(element), "fill-mode", "gap-event");
+  g_object_get(element, "fill-mode", &mode, NULL);
+  fail_unless_equals_int(mode, 3);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_pacing_properties)
+{
+  GstElement *element;
+  gint pacing;
+  gdouble speed;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "pacing", &pacing, "pacing-speed", &speed, NULL);
+  fail_unless_equals_int(pacing, 0);
+  fail_unless(speed == 2.0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "scaled");
+  g_object_set(element, "pacing-speed", 8.0, NULL);
+  g_object_get(element, "pacing", &pacing, "pacing-speed", &speed, NULL);
+  fail_unless_equals_int(pacing, 1);
+  fail_unless(speed == 8.0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "as-fast-as-possible");
+  g_object_get(element, "pacing", &pacing, NULL);
+  fail_unless_equals_int(pacing, 2);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_framing_properties)
+{
+  GstElement *element;
+  gint framing;
+  gboolean active;
+  guint64 stale;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "framing", &framing, "framing-active", &active,
+      "stale-frames", &stale, NULL);
+  fail_unless_equals_int(framing, 0);
+  fail_unless(!active);
+  fail_unless_equals_uint64(stale, 0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "framing", "v1");
+  g_object_get(element, "framing", &framing, "framing-active", &active, NULL);
+  fail_unless_equals_int(framing, 1);
+  // nothing is negotiated until a server accepts the subprotocol
+  fail_unless(!active);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_async_connect_property)
+{
+  GstElement *element;
+  gboolean async_connect;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "async-connect", &async_connect, NULL);
+  fail_unless(!async_connect);
+
+  g_object_set(element, "async-connect", TRUE, NULL);
+  g_object_get(element, "async-connect", &async_connect, NULL);
+  fail_unless(async_connect);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_replay_properties)
+{
+  GstElement *element;
+  guint replay_ms;
+  guint64 replayed;
+  gchar *token;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "replay-buffer-ms", &replay_ms, "buffers-replayed", &replayed,
+      "resume-token", &token, NULL);
+  fail_unless_equals_int(replay_ms, 0);
+  fail_unless_equals_uint64(replayed, 0);
+  fail_unless(token == NULL);
+
+  g_object_set(element, "replay-buffer-ms", 300, NULL);
+  g_object_get(element, "replay-buffer-ms", &replay_ms, NULL);
+  fail_unless_equals_int(replay_ms, 300);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_compression_properties)
+{
+  GstElement *element;
+  gboolean compression;
+  guint window_bits;
+  gdouble ratio;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "compression", &compression, "compression-window-bits", &window_bits,
+      "compression-ratio", &ratio, NULL);
+  fail_unless(!compression);
+  fail_unless_equals_int(window_bits, 15);
+  fail_unless(ratio == 0.0);
+
+  g_object_set(element, "compression", TRUE, "compression-window-bits", 9, NULL);
+  g_object_get(element, "compression", &compression, "compression-window-bits", &window_bits,
+      NULL);
+  fail_unless(compression);
+  fail_unless_equals_int(window_bits, 9);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_wire_format_properties)
+{
+  GstElement *element;
+  gint format;
+  guint rate;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "wire-format", &format, "wire-rate", &rate, NULL);
+  fail_unless_equals_int(format, 0);
+  fail_unless_equals_int(rate, 0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "wire-format", "s16le");
+  g_object_set(element, "wire-rate", 24000, NULL);
+  g_object_get(element, "wire-format", &format, "wire-rate", &rate, NULL);
+  fail_unless_equals_int(format, 1);
+  fail_unless_equals_int(rate, 24000);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_vad_properties)
+{
+  GstElement *element;
+  gboolean vad;
+  gdouble threshold;
+  guint hangover, keepalive;
+  guint64 suppressed;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "vad", &vad, "vad-threshold", &threshold,
+      "vad-hangover-ms", &hangover, "vad-keepalive-ms", &keepalive,
+      "buffers-suppressed", &suppressed, NULL);
+  fail_unless(!vad);
+  fail_unless(threshold > 0.0 && threshold < 0.1);
+  fail_unless_equals_int(hangover, 300);
+  fail_unless_equals_int(keepalive, 1000);
+  fail_unless_equals_uint64(suppressed, 0);
+
+  g_object_set(element, "vad", TRUE, "vad-threshold", 0.05, "vad-hangover-ms", 0,
+      "vad-keepalive-ms", 0, NULL);
+  g_object_get(element, "vad", &vad, "vad-threshold", &threshold,
+      "vad-hangover-ms", &hangover, "vad-keepalive-ms", &keepalive, NULL);
+  fail_unless(vad);
+  fail_unless(threshold == 0.05);
+  fail_unless_equals_int(hangover, 0);
+  fail_unless_equals_int(keepalive, 0);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_mux_property)
+{
+  GstElement *element;
+  gboolean mux;
+  guint id;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "mux", &mux, "mux-stream-id", &id, NULL);
+  fail_unless(!mux);
+  fail_unless_equals_int(id, 0);
+
+  g_object_set(element, "mux", TRUE, NULL);
+  g_object_get(element, "mux", &mux, NULL);
+  fail_unless(mux);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_wire_codec_property)
+{
+  GstElement *element;
+  gint codec;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "wire-codec", &codec, NULL);
+  fail_unless_equals_int(codec, 0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "wire-codec", "opus");
+  g_object_get(element, "wire-codec", &codec, NULL);
+  fail_unless_equals_int(codec, 1);
+
+#ifndef HAVE_OPUS
+  // without libopus the element refuses to start rather than sending raw audio
+  g_object_set(element, "uri", "ws://127.0.0.1:1", NULL);
+  fail_unless(gst_element_set_state(element, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  gst_element_set_state(element, GST_STATE_NULL);
+#endif
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_barge_in_mode_property)
+{
+  GstElement *element;
+  gint mode;
+  guint64 latency;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "barge-in-mode", &mode, "barge-in-latency-us", &latency, NULL);
+  fail_unless_equals_int(mode, 0);
+  fail_unless_equals_uint64(latency, 0);
+
+  gst_util_set_object_arg(G_OBJECT(element), "barge-in-mode", "fast");
+  g_object_get(element, "barge-in-mode", &mode, NULL);
+  fail_unless_equals_int(mode, 1);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_scheduling_stats)
+{
+  GstElement *element;
+  guint64 late_frames, max_lateness;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "late-frames", &late_frames, "max-lateness-us", &max_lateness, NULL);
+  fail_unless_equals_uint64(late_frames, 0);
+  fail_unless_equals_uint64(max_lateness, 0);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+// a downstream that stalls once, the way a blocked sink or a descheduled thread would
+static GstFlowReturn
+stall_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  gint *count = g_object_get_data(G_OBJECT(pad), "stall-count");
+
+  if (g_atomic_int_add(count, 1) == 2)
+    g_usleep(100000);
+  gst_buffer_unref(buffer);
+  return GST_FLOW_OK;
+}
+
+// the frame after the stall wakes past its deadline and is counted as late
+GST_START_TEST(test_late_frame_stats)
+{
+  GstElement *element;
+  GstPad *sink_pad, *src_pad, *stall_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GstClock *clock;
+  GstStructure *stats;
+  guint64 late_frames = 0, max_lateness, count, max;
+  gint pushed = 0;
+  gint64 start;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "fill-mode", "silence");
+
+  stall_pad = gst_pad_new("stall", GST_PAD_SINK);
+  g_object_set_data(G_OBJECT(stall_pad), "stall-count", &pushed);
+  gst_pad_set_chain_function(stall_pad, stall_chain);
+  gst_pad_set_active(stall_pad, TRUE);
+  src_pad = gst_element_get_static_pad(element, "src");
+  fail_unless(gst_pad_link(src_pad, stall_pad) == GST_PAD_LINK_OK);
+  sink_pad = gst_element_get_static_pad(element, "sink");
+
+  clock = gst_system_clock_obtain();
+  gst_element_set_clock(element, clock);
+  gst_element_set_base_time(element, gst_clock_get_time(clock));
+  gst_element_set_state(element, GST_STATE_PLAYING);
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_stream_start("test")));
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_caps(caps)));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_segment(&segment)));
+
+  start = g_get_monotonic_time();
+  while (late_frames == 0 && g_get_monotonic_time() - start < 5 * G_USEC_PER_SEC) {
+    g_usleep(10000);
+    g_object_get(element, "late-frames", &late_frames, NULL);
+  }
+  g_object_get(element, "max-lateness-us", &max_lateness, "stats", &stats, NULL);
+  gst_element_set_state(element, GST_STATE_NULL);
+
+  fail_unless(late_frames > 0, "The stall was not counted");
+  // the stall overran the next slot by about 80 ms
+  fail_unless(max_lateness >= 50000, "Max lateness %" G_GUINT64_FORMAT " us", max_lateness);
+  fail_unless(gst_structure_get_uint64(stats, "output-lateness-count", &count));
+  fail_unless(gst_structure_get_uint64(stats, "output-lateness-max-us", &max));
+  fail_unless(count >= late_frames);
+  fail_unless(max >= 50000, "Histogram max %" G_GUINT64_FORMAT " us", max);
+
+  gst_structure_free(stats);
+  gst_caps_unref(caps);
+  gst_object_unref(sink_pad);
+  gst_object_unref(src_pad);
+  gst_object_unref(stall_pad);
+  gst_object_unref(clock);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_thread_properties)
+{
+  GstElement *element;
+  GstStateChangeReturn ret;
+  GstStructure *stats;
+  gchar *name, *cpus;
+  guint output_priority, ws_priority;
+  gboolean realtime;
+  guint64 preemptions;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element,
+      "thread-name", &name,
+      "output-thread-priority", &output_priority,
+      "output-thread-cpus", &cpus,
+      "ws-thread-priority", &ws_priority,
+      NULL);
+  fail_unless(name == NULL);
+  fail_unless(cpus == NULL);
+  fail_unless_equals_int(output_priority, 0);
+  fail_unless_equals_int(ws_priority, 0);
+
+  g_object_set(element,
+      "thread-name", "call1",
+      "output-thread-priority", 20,
+      "output-thread-cpus", "0-3,6",
+      "ws-thread-priority", 10,
+      "ws-thread-cpus", "1",
+      NULL);
+  g_object_get(element,
+      "thread-name", &name,
+      "output-thread-priority", &output_priority,
+      "output-thread-cpus", &cpus,
+      "ws-thread-priority", &ws_priority,
+      NULL);
+  fail_unless_equals_string(name, "call1");
+  fail_unless_equals_string(cpus, "0-3,6");
+  fail_unless_equals_int(output_priority, 20);
+  fail_unless_equals_int(ws_priority, 10);
+  g_free(name);
+  g_free(cpus);
+
+  g_object_get(element, "stats", &stats, NULL);
+  fail_unless(gst_structure_get_boolean(stats, "output-thread-realtime", &realtime));
+  fail_unless(!realtime);
+  fail_unless(gst_structure_get_boolean(stats, "ws-thread-realtime", &realtime));
+  fail_unless(!realtime);
+  fail_unless(gst_structure_get_uint64(stats, "output-thread-preemptions", &preemptions));
+  fail_unless_equals_uint64(preemptions, 0);
+  gst_structure_free(stats);
+
+  // checked before any thread starts
+  g_object_set(element, "uri", "ws://127.0.0.1:1", "ws-thread-cpus", "3-1", NULL);
+  ret = gst_element_set_state(element, GST_STATE_READY);
+  fail_unless(ret == GST_STATE_CHANGE_FAILURE, "Invalid CPU list should fail");
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_stats_structure)
+{
+  GstElement *element;
+  GstStructure *stats;
+  const GValue *buckets;
+  guint64 value;
+  guint interval;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "stats", &stats, NULL);
+  fail_unless(stats != NULL);
+  fail_unless(gst_structure_has_name(stats, "websocket-stats"));
+  fail_unless(gst_structure_get_uint64(stats, "buffers-sent", &value));
+  fail_unless_equals_uint64(value, 0);
+  fail_unless(gst_structure_get_uint64(stats, "wire-bytes-sent", &value));
+  fail_unless(gst_structure_get_uint64(stats, "underruns", &value));
+  fail_unless(gst_structure_get_uint64(stats, "send-latency-count", &value));
+  fail_unless_equals_uint64(value, 0);
+  fail_unless(gst_structure_get_uint64(stats, "output-lateness-p99-us", &value));
+  fail_unless(gst_structure_get_uint64(stats, "reconnect-time-max-us", &value));
+  fail_unless(gst_structure_has_field(stats, "recv-queue-depth-avg"));
+  buckets = gst_structure_get_value(stats, "barge-in-latency-buckets");
+  fail_unless(buckets != NULL && GST_VALUE_HOLDS_ARRAY(buckets));
+  fail_unless_equals_int(gst_value_array_get_size(buckets), 24);
+  gst_structure_free(stats);
+
+  g_object_get(element, "stats-interval-ms", &interval, NULL);
+  fail_unless_equals_int(interval, 0);
+  g_object_set(element, "stats-interval-ms", 1000, NULL);
+  g_object_get(element, "stats-interval-ms", &interval, NULL);
+  fail_unless_equals_int(interval, 1000);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_tracer_registered)
+{
+  GstPluginFeature *feature;
+
+  feature = gst_registry_find_feature(gst_registry_get(), "websocket",
+      GST_TYPE_TRACER_FACTORY);
+  fail_unless(feature != NULL);
+  gst_object_unref(feature);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_trace_buffer)
+{
+  GstElement *element;
+  guint size;
+  gchar *dump = NULL;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_get(element, "trace-buffer-size", &size, NULL);
+  fail_unless_equals_int(size, 0);
+  // nothing is recorded while disabled
+  g_signal_emit_by_name(element, "dump-trace", &dump);
+  fail_unless(dump == NULL);
+
+  g_object_set(element, "trace-buffer-size", 256, NULL);
+  g_object_get(element, "trace-buffer-size", &size, NULL);
+  fail_unless_equals_int(size, 256);
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_latency_query)
+{
+  GstElement *element;
+  GstPad *src_pad;
+  GstQuery *query;
+  gboolean live;
+  GstClockTime min_latency, max_latency;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+  g_object_set(element, "frame-duration-ms", 20, "initial-buffer-count", 3, NULL);
+
+  src_pad = gst_element_get_static_pad(element, "src");
+
+  // fixed mode: one frame of pacing plus the initial reservoir
+  query = gst_query_new_latency();
+  fail_unless(gst_pad_query(src_pad, query));
+  gst_query_parse_latency(query, &live, &min_latency, &max_latency);
+  fail_unless(live);
+  fail_unless_equals_uint64(min_latency, 80 * GST_MSECOND);
+  fail_unless_equals_uint64(max_latency, 80 * GST_MSECOND);
+  gst_query_unref(query);
+
+  // adaptive mode starts at min-latency-ms rounded up to frames, bounded by max-latency-ms
+  gst_util_set_object_arg(G_OBJECT(element), "jitter-mode", "adaptive");
+  g_object_set(element, "min-latency-ms", 50, "max-latency-ms", 200, NULL);
+  query = gst_query_new_latency();
+  fail_unless(gst_pad_query(src_pad, query));
+  gst_query_parse_latency(query, &live, &min_latency, &max_latency);
+  fail_unless_equals_uint64(min_latency, 80 * GST_MSECOND);
+  fail_unless_equals_uint64(max_latency, 220 * GST_MSECOND);
+  gst_query_unref(query);
+
+  gst_object_unref(src_pad);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
 GST_START_TEST(test_pads_exist)
 {
   GstElement *element;
-  GstPad *sink_pad, *src_pad;
+  GstPad *sink_pad, *src_pad;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  fail_unless(sink_pad != NULL, "Element should have a sink pad");
+  fail_unless(GST_PAD_IS_SINK(sink_pad), "Sink pad should be a sink");
+
+  src_pad = gst_element_get_static_pad(element, "src");
+  fail_unless(src_pad != NULL, "Element should have a src pad");
+  fail_unless(GST_PAD_IS_SRC(src_pad), "Src pad should be a source");
+
+  gst_object_unref(sink_pad);
+  gst_object_unref(src_pad);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_sink_pad_caps)
+{
+  GstElement *element;
+  GstPad *sink_pad;
+  GstCaps *caps, *template_caps;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  fail_unless(sink_pad != NULL);
+
+  template_caps = gst_pad_get_pad_template_caps(sink_pad);
+  fail_unless(template_caps != NULL, "Sink pad should have template caps");
+  fail_unless(!gst_caps_is_empty(template_caps), "Template caps should not be empty");
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      NULL);
+
+  fail_unless(gst_caps_can_intersect(template_caps, caps),
+      "Sink should accept S16LE audio");
+
+  gst_caps_unref(caps);
+  gst_caps_unref(template_caps);
+  gst_object_unref(sink_pad);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_src_pad_caps)
+{
+  GstElement *element;
+  GstPad *src_pad;
+  GstCaps *caps, *template_caps;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  src_pad = gst_element_get_static_pad(element, "src");
+  fail_unless(src_pad != NULL);
+
+  template_caps = gst_pad_get_pad_template_caps(src_pad);
+  fail_unless(template_caps != NULL, "Src pad should have template caps");
+  fail_unless(!gst_caps_is_empty(template_caps), "Template caps should not be empty");
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      NULL);
+
+  fail_unless(gst_caps_can_intersect(template_caps, caps),
+      "Src should output S16LE audio");
+
+  gst_caps_unref(caps);
+  gst_caps_unref(template_caps);
+  gst_object_unref(src_pad);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_state_change_no_uri)
+{
+  GstElement *element;
+  GstStateChangeReturn ret;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  ret = gst_element_set_state(element, GST_STATE_READY);
+  fail_unless(ret == GST_STATE_CHANGE_FAILURE,
+      "State change to READY without URI should fail");
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_loopback_invalid_uri)
+{
+  GstElement *element;
+  GstStateChangeReturn ret;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_set(element, "uri", "loopback://?delay-ms=10&bandwidth=1", NULL);
+  ret = gst_element_set_state(element, GST_STATE_READY);
+  fail_unless(ret == GST_STATE_CHANGE_FAILURE,
+      "Unknown loopback parameter should fail");
+
+  g_object_set(element, "uri", "loopback://?loss=2", NULL);
+  ret = gst_element_set_state(element, GST_STATE_READY);
+  fail_unless(ret == GST_STATE_CHANGE_FAILURE,
+      "Loss above 1 should fail");
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+// the loopback needs no server, so the whole round trip runs here
+GST_START_TEST(test_loopback_echo)
+{
+  GstElement *element;
+  GstPad *sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GstStateChangeReturn ret;
+  guint64 sent = 0, received = 0;
+  gint i;
 
   element = gst_element_factory_make("websockettransceiver", NULL);
   fail_unless(element != NULL);
 
+  g_object_set(element,
+      "uri", "loopback://?delay-ms=10&seed=3",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      NULL);
+
   sink_pad = gst_element_get_static_pad(element, "sink");
-  fail_unless(sink_pad != NULL, "Element should have a sink pad");
-  fail_unless(GST_PAD_IS_SINK(sink_pad), "Sink pad should be a sink");
+  fail_unless(sink_pad != NULL);
 
-  src_pad = gst_element_get_static_pad(element, "src");
-  fail_unless(src_pad != NULL, "Element should have a src pad");
-  fail_unless(GST_PAD_IS_SRC(src_pad), "Src pad should be a source");
+  ret = gst_element_set_state(element, GST_STATE_PLAYING);
+  fail_unless(ret == GST_STATE_CHANGE_SUCCESS || ret == GST_STATE_CHANGE_NO_PREROLL,
+      "State change should succeed (got %d)", ret);
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_stream_start("test")));
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_caps(caps)));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_segment(&segment)));
 
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+
+    gst_buffer_memset(buffer, 0, 0x10, 640);
+    GST_BUFFER_PTS(buffer) = i * 20 * GST_MSECOND;
+    GST_BUFFER_DURATION(buffer) = 20 * GST_MSECOND;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+  }
+
+  for (i = 0; i < 100 && received == 0; i++) {
+    g_usleep(10000);
+    g_object_get(element, "buffers-received", &received, NULL);
+  }
+  g_object_get(element, "buffers-sent", &sent, NULL);
+  fail_unless(sent > 0, "Nothing was sent");
+  fail_unless(received > 0, "Nothing came back from the loopback");
+
+  gst_caps_unref(caps);
   gst_object_unref(sink_pad);
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+typedef struct
+{
+  GMutex lock;
+  gsize bytes;
+  GstClockTime next_pts;
+  gboolean contiguous;
+  gboolean eos;
+  gsize eos_bytes;
+  guint buffers;
+  gsize max_size;
+} DrainState;
+
+static GstFlowReturn
+drain_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  DrainState *state = g_object_get_data(G_OBJECT(pad), "drain-state");
+
+  g_mutex_lock(&state->lock);
+  if (GST_BUFFER_PTS(buffer) != state->next_pts)
+    state->contiguous = FALSE;
+  state->next_pts = GST_BUFFER_PTS(buffer) + GST_BUFFER_DURATION(buffer);
+  state->bytes += gst_buffer_get_size(buffer);
+  state->buffers++;
+  state->max_size = MAX(state->max_size, gst_buffer_get_size(buffer));
+  g_mutex_unlock(&state->lock);
+  gst_buffer_unref(buffer);
+  return GST_FLOW_OK;
+}
+
+static gboolean
+drain_event(GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  DrainState *state = g_object_get_data(G_OBJECT(pad), "drain-state");
+
+  if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
+    g_mutex_lock(&state->lock);
+    state->eos = TRUE;
+    state->eos_bytes = state->bytes;
+    g_mutex_unlock(&state->lock);
+  }
+  gst_event_unref(event);
+  return TRUE;
+}
+
+// links a drain pad to the element's source pad, starts it on the system clock and
+// sends count buffers of size bytes of 16 kHz mono S16, returning when the last one is
+// queued
+static GstPad *
+drain_element_start_sized(GstElement *element, DrainState *state, gint count, gsize size)
+{
+  GstPad *sink_pad, *src_pad, *drain_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GstClock *clock;
+
+  drain_pad = gst_pad_new("drain", GST_PAD_SINK);
+  g_object_set_data(G_OBJECT(drain_pad), "drain-state", state);
+  gst_pad_set_chain_function(drain_pad, drain_chain);
+  gst_pad_set_event_function(drain_pad, drain_event);
+  gst_pad_set_active(drain_pad, TRUE);
+  src_pad = gst_element_get_static_pad(element, "src");
+  fail_unless(gst_pad_link(src_pad, drain_pad) == GST_PAD_LINK_OK);
   gst_object_unref(src_pad);
+  sink_pad = gst_element_get_static_pad(element, "sink");
+
+  clock = gst_system_clock_obtain();
+  gst_element_set_clock(element, clock);
+  gst_element_set_base_time(element, gst_clock_get_time(clock));
+  gst_object_unref(clock);
+  gst_element_set_state(element, GST_STATE_PLAYING);
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_stream_start("test")));
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_caps(caps)));
+  gst_caps_unref(caps);
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_segment(&segment)));
+
+  for (gint i = 0; i < count; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, size, NULL);
+
+    gst_buffer_memset(buffer, 0, 0x10, size);
+    GST_BUFFER_PTS(buffer) = gst_util_uint64_scale(i * size, GST_SECOND, 32000);
+    GST_BUFFER_DURATION(buffer) = gst_util_uint64_scale(size, GST_SECOND, 32000);
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+  }
+  gst_object_unref(sink_pad);
+  return drain_pad;
+}
+
+static GstPad *
+drain_element_start(GstElement *element, DrainState *state, gint count)
+{
+  return drain_element_start_sized(element, state, count, 640);
+}
+
+static gsize
+drain_state_wait(DrainState *state, gsize bytes, gint64 timeout_us)
+{
+  gint64 start = g_get_monotonic_time();
+  gsize got = 0;
+
+  while (g_get_monotonic_time() - start < timeout_us) {
+    g_mutex_lock(&state->lock);
+    got = state->bytes;
+    g_mutex_unlock(&state->lock);
+    if (got >= bytes)
+      break;
+    g_usleep(5000);
+  }
+  return got;
+}
+
+// pacing=scaled plays a second of audio in a quarter of a second, with the timestamps
+// of a second of audio
+GST_START_TEST(test_loopback_scaled_pacing)
+{
+  GstElement *element;
+  GstPad *drain_pad;
+  DrainState state = { { 0, }, 0, 0, TRUE, FALSE, 0, 0, 0 };
+  gint64 start, elapsed;
+
+  g_mutex_init(&state.lock);
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "pacing-speed", 4.0,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "scaled");
+
+  start = g_get_monotonic_time();
+  drain_pad = drain_element_start(element, &state, 50);
+  fail_unless_equals_int(drain_state_wait(&state, 50 * 640, 5 * G_USEC_PER_SEC), 50 * 640);
+  elapsed = g_get_monotonic_time() - start;
+
+  // a frame less than the schedule, the first one plays at once
+  fail_unless(elapsed >= 200 * 1000, "Scaled pacing took only %" G_GINT64_FORMAT " us",
+      elapsed);
+  fail_unless(elapsed < 700 * 1000, "Scaled pacing took %" G_GINT64_FORMAT " us", elapsed);
+  fail_unless(state.contiguous, "Timestamps have gaps");
+  fail_unless_equals_uint64(state.next_pts, GST_SECOND);
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(drain_pad);
   gst_object_unref(element);
+  g_mutex_clear(&state.lock);
 }
 GST_END_TEST;
 
-GST_START_TEST(test_sink_pad_caps)
+static guint64
+wait_for_sent(GstElement *element, guint64 count, gint64 timeout_us)
+{
+  gint64 start = g_get_monotonic_time();
+  guint64 sent = 0;
+
+  while (sent < count && g_get_monotonic_time() - start < timeout_us) {
+    g_usleep(2000);
+    g_object_get(element, "buffers-sent", &sent, NULL);
+  }
+  return sent;
+}
+
+// ten 20 ms buffers leave as two 100 ms messages, and come back as all the audio
+GST_START_TEST(test_loopback_send_batch)
 {
   GstElement *element;
-  GstPad *sink_pad;
-  GstCaps *caps, *template_caps;
+  GstPad *drain_pad;
+  DrainState state = { { 0, }, 0, 0, TRUE, FALSE, 0, 0, 0 };
+  guint64 sent;
+
+  g_mutex_init(&state.lock);
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "send-batch-ms", 100,
+      "send-batch-max-latency-ms", 1000,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "as-fast-as-possible");
+
+  drain_pad = drain_element_start(element, &state, 10);
+  fail_unless_equals_int(drain_state_wait(&state, 10 * 640, 5 * G_USEC_PER_SEC), 10 * 640);
+  g_object_get(element, "buffers-sent", &sent, NULL);
+  fail_unless_equals_uint64(sent, 2);
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(drain_pad);
+  gst_object_unref(element);
+  g_mutex_clear(&state.lock);
+}
+GST_END_TEST;
+
+// a batch that never fills is sent once its first buffer has waited the cap, counted
+// from when it reached the sink pad
+GST_START_TEST(test_loopback_send_batch_latency_cap)
+{
+  GstElement *element;
+  GstPad *drain_pad;
+  DrainState state = { { 0, }, 0, 0, TRUE, FALSE, 0, 0, 0 };
+  gint64 start, elapsed;
+
+  g_mutex_init(&state.lock);
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "send-batch-ms", 1000,
+      "send-batch-max-latency-ms", 100,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "as-fast-as-possible");
+
+  start = g_get_monotonic_time();
+  drain_pad = drain_element_start(element, &state, 3);
+  fail_unless_equals_uint64(wait_for_sent(element, 1, 5 * G_USEC_PER_SEC), 1);
+  elapsed = g_get_monotonic_time() - start;
+  fail_unless(elapsed >= 90 * 1000, "Batch sent after %" G_GINT64_FORMAT " us", elapsed);
+  fail_unless(elapsed < 400 * 1000, "Batch sent after %" G_GINT64_FORMAT " us", elapsed);
+  fail_unless_equals_int(drain_state_wait(&state, 3 * 640, 5 * G_USEC_PER_SEC), 3 * 640);
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(drain_pad);
+  gst_object_unref(element);
+  g_mutex_clear(&state.lock);
+}
+GST_END_TEST;
+
+// messages that are not a whole number of frames are cut into frames on the receive
+// path, with the remainder carried into the next message
+GST_START_TEST(test_loopback_receive_rechunk)
+{
+  GstElement *element;
+  GstPad *drain_pad;
+  DrainState state = { { 0, }, 0, 0, TRUE, FALSE, 0, 0, 0 };
+
+  g_mutex_init(&state.lock);
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "as-fast-as-possible");
+
+  // 32 messages of 1000 bytes are 50 frames of 640
+  drain_pad = drain_element_start_sized(element, &state, 32, 1000);
+  fail_unless_equals_int(drain_state_wait(&state, 32 * 1000, 5 * G_USEC_PER_SEC), 32000);
+
+  g_mutex_lock(&state.lock);
+  fail_unless_equals_int(state.buffers, 50);
+  fail_unless_equals_int(state.max_size, 640);
+  fail_unless(state.contiguous, "Timestamps have gaps");
+  fail_unless_equals_uint64(state.next_pts, GST_SECOND);
+  g_mutex_unlock(&state.lock);
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(drain_pad);
+  gst_object_unref(element);
+  g_mutex_clear(&state.lock);
+}
+GST_END_TEST;
+
+// after the peer hangs up, everything it sent is played before EOS
+GST_START_TEST(test_loopback_eos_after_drain)
+{
+  GstElement *element;
+  GstPad *drain_pad;
+  DrainState state = { { 0, }, 0, 0, TRUE, FALSE, 0, 0, 0 };
+  gint64 start;
+  gboolean eos = FALSE;
+
+  g_mutex_init(&state.lock);
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+
+  g_object_set(element,
+      "uri", "loopback://?close-after=25",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "reconnect-enabled", FALSE,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "as-fast-as-possible");
+
+  drain_pad = drain_element_start(element, &state, 25);
+  start = g_get_monotonic_time();
+  while (!eos && g_get_monotonic_time() - start < 5 * G_USEC_PER_SEC) {
+    g_usleep(5000);
+    g_mutex_lock(&state.lock);
+    eos = state.eos;
+    g_mutex_unlock(&state.lock);
+  }
+
+  fail_unless(eos, "No EOS after the peer closed");
+  fail_unless_equals_int(state.eos_bytes, 25 * 640);
+  fail_unless(state.contiguous, "Timestamps have gaps");
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(drain_pad);
+  gst_object_unref(element);
+  g_mutex_clear(&state.lock);
+}
+GST_END_TEST;
 
+// a second of audio through the loopback comes back well within a second, with the
+// timestamps of a second of audio
+GST_START_TEST(test_loopback_fast_drain)
+{
+  GstElement *element;
+  GstPad *sink_pad, *src_pad, *drain_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GstClock *clock;
+  DrainState state = { { 0, }, 0, 0, TRUE, FALSE, 0, 0, 0 };
+  gint64 start;
+  gsize bytes = 0;
+  gint i;
+
+  g_mutex_init(&state.lock);
   element = gst_element_factory_make("websockettransceiver", NULL);
   fail_unless(element != NULL);
 
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "pacing", "as-fast-as-possible");
+
+  drain_pad = gst_pad_new("drain", GST_PAD_SINK);
+  g_object_set_data(G_OBJECT(drain_pad), "drain-state", &state);
+  gst_pad_set_chain_function(drain_pad, drain_chain);
+  gst_pad_set_active(drain_pad, TRUE);
+  src_pad = gst_element_get_static_pad(element, "src");
+  fail_unless(gst_pad_link(src_pad, drain_pad) == GST_PAD_LINK_OK);
   sink_pad = gst_element_get_static_pad(element, "sink");
-  fail_unless(sink_pad != NULL);
 
-  template_caps = gst_pad_get_pad_template_caps(sink_pad);
-  fail_unless(template_caps != NULL, "Sink pad should have template caps");
-  fail_unless(!gst_caps_is_empty(template_caps), "Template caps should not be empty");
+  clock = gst_system_clock_obtain();
+  gst_element_set_clock(element, clock);
+  gst_element_set_base_time(element, gst_clock_get_time(clock));
+  gst_element_set_state(element, GST_STATE_PLAYING);
 
   caps = gst_caps_new_simple("audio/x-raw",
       "format", G_TYPE_STRING, "S16LE",
       "rate", G_TYPE_INT, 16000,
       "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
       NULL);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_stream_start("test")));
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_caps(caps)));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_segment(&segment)));
 
-  fail_unless(gst_caps_can_intersect(template_caps, caps),
-      "Sink should accept S16LE audio");
+  start = g_get_monotonic_time();
+  for (i = 0; i < 50; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+
+    gst_buffer_memset(buffer, 0, 0x10, 640);
+    GST_BUFFER_PTS(buffer) = i * 20 * GST_MSECOND;
+    GST_BUFFER_DURATION(buffer) = 20 * GST_MSECOND;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+  }
+  while (bytes < 50 * 640 && g_get_monotonic_time() - start < 5 * G_USEC_PER_SEC) {
+    g_usleep(5000);
+    g_mutex_lock(&state.lock);
+    bytes = state.bytes;
+    g_mutex_unlock(&state.lock);
+  }
+  fail_unless_equals_int(bytes, 50 * 640);
+  fail_unless(g_get_monotonic_time() - start < 800 * 1000,
+      "Draining took %" G_GINT64_FORMAT " us", g_get_monotonic_time() - start);
+  fail_unless(state.contiguous, "Timestamps have gaps");
+  fail_unless_equals_uint64(state.next_pts, GST_SECOND);
 
+  gst_element_set_state(element, GST_STATE_NULL);
   gst_caps_unref(caps);
-  gst_caps_unref(template_caps);
   gst_object_unref(sink_pad);
+  gst_object_unref(src_pad);
+  gst_object_unref(drain_pad);
+  gst_object_unref(clock);
   gst_object_unref(element);
+  g_mutex_clear(&state.lock);
 }
 GST_END_TEST;
 
-GST_START_TEST(test_src_pad_caps)
+typedef struct
+{
+  GMutex lock;
+  GPtrArray *held;
+  GPtrArray *snapshots;
+} RetainState;
+
+// keeps a sub-buffer of every frame, the way an encoder holding a look-ahead would,
+// along with a copy of what the frame held when it arrived
+static GstFlowReturn
+retain_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  RetainState *state = g_object_get_data(G_OBJECT(pad), "retain-state");
+  GstMapInfo map;
+
+  g_mutex_lock(&state->lock);
+  if (state->held->len < 16 && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    g_ptr_array_add(state->snapshots, g_bytes_new(map.data, map.size));
+    gst_buffer_unmap(buffer, &map);
+    g_ptr_array_add(state->held, gst_buffer_copy_region(buffer, GST_BUFFER_COPY_ALL, 0,
+        gst_buffer_get_size(buffer)));
+  }
+  g_mutex_unlock(&state->lock);
+  gst_buffer_unref(buffer);
+  return GST_FLOW_OK;
+}
+
+// recycled comfort noise frames must not rewrite audio downstream still holds
+GST_START_TEST(test_comfort_noise_shared_memory)
 {
   GstElement *element;
-  GstPad *src_pad;
-  GstCaps *caps, *template_caps;
+  GstPad *sink_pad, *src_pad, *retain_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GstClock *clock;
+  RetainState state = { { 0, }, NULL, NULL };
+  guint held = 0, i;
+  gint64 start;
 
+  g_mutex_init(&state.lock);
+  state.held = g_ptr_array_new_with_free_func((GDestroyNotify)gst_buffer_unref);
+  state.snapshots = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
   element = gst_element_factory_make("websockettransceiver", NULL);
   fail_unless(element != NULL);
 
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 10,
+      "initial-buffer-count", 0,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "fill-mode", "comfort-noise");
+
+  retain_pad = gst_pad_new("retain", GST_PAD_SINK);
+  g_object_set_data(G_OBJECT(retain_pad), "retain-state", &state);
+  gst_pad_set_chain_function(retain_pad, retain_chain);
+  gst_pad_set_active(retain_pad, TRUE);
   src_pad = gst_element_get_static_pad(element, "src");
-  fail_unless(src_pad != NULL);
+  fail_unless(gst_pad_link(src_pad, retain_pad) == GST_PAD_LINK_OK);
+  sink_pad = gst_element_get_static_pad(element, "sink");
 
-  template_caps = gst_pad_get_pad_template_caps(src_pad);
-  fail_unless(template_caps != NULL, "Src pad should have template caps");
-  fail_unless(!gst_caps_is_empty(template_caps), "Template caps should not be empty");
+  clock = gst_system_clock_obtain();
+  gst_element_set_clock(element, clock);
+  gst_element_set_base_time(element, gst_clock_get_time(clock));
+  gst_element_set_state(element, GST_STATE_PLAYING);
 
   caps = gst_caps_new_simple("audio/x-raw",
       "format", G_TYPE_STRING, "S16LE",
       "rate", G_TYPE_INT, 16000,
       "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
       NULL);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_stream_start("test")));
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_caps(caps)));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  fail_unless(gst_pad_send_event(sink_pad, gst_event_new_segment(&segment)));
 
-  fail_unless(gst_caps_can_intersect(template_caps, caps),
-      "Src should output S16LE audio");
+  // nothing is sent, so every frame pushed is a filler
+  start = g_get_monotonic_time();
+  while (held < 16 && g_get_monotonic_time() - start < 5 * G_USEC_PER_SEC) {
+    g_usleep(10000);
+    g_mutex_lock(&state.lock);
+    held = state.held->len;
+    g_mutex_unlock(&state.lock);
+  }
+  gst_element_set_state(element, GST_STATE_NULL);
+
+  fail_unless_equals_int(held, 16);
+  for (i = 0; i < held; i++) {
+    GstBuffer *buffer = g_ptr_array_index(state.held, i);
+    gsize size;
+    gconstpointer data = g_bytes_get_data(g_ptr_array_index(state.snapshots, i), &size);
+
+    fail_unless_equals_int(gst_buffer_get_size(buffer), size);
+    fail_unless(gst_buffer_memcmp(buffer, 0, data, size) == 0,
+        "Filler %u was rewritten while downstream held it", i);
+  }
 
+  g_ptr_array_unref(state.held);
+  g_ptr_array_unref(state.snapshots);
   gst_caps_unref(caps);
-  gst_caps_unref(template_caps);
+  gst_object_unref(sink_pad);
   gst_object_unref(src_pad);
+  gst_object_unref(retain_pad);
+  gst_object_unref(clock);
   gst_object_unref(element);
+  g_mutex_clear(&state.lock);
 }
 GST_END_TEST;
 
-GST_START_TEST(test_state_change_no_uri)
+GST_START_TEST(test_queue_limit_properties)
 {
-  GstElement *element;
-  GstStateChangeReturn ret;
+  GstElement *element, *other;
+  guint bytes, time_ms;
+  guint64 budget;
 
   element = gst_element_factory_make("websockettransceiver", NULL);
+  other = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL && other != NULL);
+
+  g_object_get(element, "max-queue-bytes", &bytes, "max-queue-time-ms", &time_ms,
+      "process-max-queue-bytes", &budget, NULL);
+  fail_unless_equals_int(bytes, 0);
+  fail_unless_equals_int(time_ms, 0);
+  fail_unless_equals_uint64(budget, 0);
+
+  g_object_set(element, "max-queue-bytes", 64000, "max-queue-time-ms", 2000,
+      "process-max-queue-bytes", G_GUINT64_CONSTANT(1) << 30, NULL);
+  g_object_get(element, "max-queue-bytes", &bytes, "max-queue-time-ms", &time_ms, NULL);
+  fail_unless_equals_int(bytes, 64000);
+  fail_unless_equals_int(time_ms, 2000);
+  // the budget belongs to the process, not to the element it was set on
+  g_object_get(other, "process-max-queue-bytes", &budget, NULL);
+  fail_unless_equals_uint64(budget, G_GUINT64_CONSTANT(1) << 30);
+
+  g_object_set(other, "process-max-queue-bytes", G_GUINT64_CONSTANT(0), NULL);
+  gst_object_unref(other);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+// an element in PAUSED has no clock, so its output thread never drains the queue and
+// whatever the loopback echoes stays queued
+static GstElement *
+queue_element_new(GstPad **sink_pad)
+{
+  GstElement *element = gst_element_factory_make("websockettransceiver", NULL);
+  GstCaps *caps;
+  GstSegment segment;
+
   fail_unless(element != NULL);
+  g_object_set(element,
+      "uri", "loopback://",
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      NULL);
+  *sink_pad = gst_element_get_static_pad(element, "sink");
+  gst_element_set_state(element, GST_STATE_PAUSED);
 
-  ret = gst_element_set_state(element, GST_STATE_READY);
-  fail_unless(ret == GST_STATE_CHANGE_FAILURE,
-      "State change to READY without URI should fail");
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  fail_unless(gst_pad_send_event(*sink_pad, gst_event_new_stream_start("test")));
+  fail_unless(gst_pad_send_event(*sink_pad, gst_event_new_caps(caps)));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  fail_unless(gst_pad_send_event(*sink_pad, gst_event_new_segment(&segment)));
+  gst_caps_unref(caps);
+  return element;
+}
+
+// pushes count frames of 640 bytes and waits until all of them came back
+static void
+queue_element_push(GstElement *element, GstPad *sink_pad, gint count)
+{
+  guint64 received = 0;
+
+  for (gint i = 0; i < count; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+
+    gst_buffer_memset(buffer, 0, 0x10, 640);
+    GST_BUFFER_PTS(buffer) = i * 20 * GST_MSECOND;
+    GST_BUFFER_DURATION(buffer) = 20 * GST_MSECOND;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+  }
+  for (gint i = 0; i < 200 && received < (guint64)count; i++) {
+    g_usleep(10000);
+    g_object_get(element, "buffers-received", &received, NULL);
+  }
+  fail_unless_equals_uint64(received, count);
+}
+
+static guint64
+queue_element_stat(GstElement *element, const gchar *field)
+{
+  GstStructure *stats;
+  guint64 value = 0;
+
+  g_object_get(element, "stats", &stats, NULL);
+  fail_unless(gst_structure_get_uint64(stats, field, &value));
+  gst_structure_free(stats);
+  return value;
+}
+
+GST_START_TEST(test_queue_time_limit)
+{
+  GstElement *element;
+  GstPad *sink_pad;
+  guint64 dropped;
+
+  element = queue_element_new(&sink_pad);
+  // five frames of 16 kHz mono S16
+  g_object_set(element, "max-queue-time-ms", 100, NULL);
+  queue_element_push(element, sink_pad, 20);
 
+  fail_unless_equals_uint64(queue_element_stat(element, "recv-queue-bytes"), 5 * 640);
+  g_object_get(element, "buffers-dropped", &dropped, NULL);
+  fail_unless_equals_uint64(dropped, 15);
+
+  gst_object_unref(sink_pad);
   gst_element_set_state(element, GST_STATE_NULL);
   gst_object_unref(element);
 }
 GST_END_TEST;
 
+GST_START_TEST(test_process_queue_budget)
+{
+  GstElement *small, *deep;
+  GstPad *small_pad, *deep_pad;
+  guint64 dropped;
+
+  small = queue_element_new(&small_pad);
+  deep = queue_element_new(&deep_pad);
+  g_object_set(small, "process-max-queue-bytes", G_GUINT64_CONSTANT(10 * 640), NULL);
+
+  queue_element_push(small, small_pad, 4);
+  queue_element_push(deep, deep_pad, 20);
+
+  // the deep queue pays for the overrun, trimmed at its next enqueue each time
+  fail_unless(queue_element_stat(deep, "recv-queue-bytes") <= 10 * 640);
+  g_object_get(deep, "buffers-dropped", &dropped, NULL);
+  fail_unless(dropped > 0);
+  fail_unless_equals_uint64(queue_element_stat(small, "recv-queue-bytes"), 4 * 640);
+  g_object_get(small, "buffers-dropped", &dropped, NULL);
+  fail_unless_equals_uint64(dropped, 0);
+  fail_unless(queue_element_stat(small, "process-queue-bytes") <= 11 * 640);
+
+  g_object_set(small, "process-max-queue-bytes", G_GUINT64_CONSTANT(0), NULL);
+  gst_object_unref(small_pad);
+  gst_object_unref(deep_pad);
+  gst_element_set_state(small, GST_STATE_NULL);
+  gst_element_set_state(deep, GST_STATE_NULL);
+  gst_object_unref(small);
+  gst_object_unref(deep);
+}
+GST_END_TEST;
+
 GST_START_TEST(test_is_live_source)
 {
   GstElement *element;
@@ -216,6 +1659,30 @@ websockettransceiver_suite(void)
   suite_add_tcase(s, tc_properties);
   tcase_add_test(tc_properties, test_properties_default);
   tcase_add_test(tc_properties, test_properties_set_get);
+  tcase_add_test(tc_properties, test_io_pool_properties);
+  tcase_add_test(tc_properties, test_prewarm_property);
+  tcase_add_test(tc_properties, test_send_queue_properties);
+  tcase_add_test(tc_properties, test_send_batch_properties);
+  tcase_add_test(tc_properties, test_recv_buffer_properties);
+  tcase_add_test(tc_properties, test_queue_limit_properties);
+  tcase_add_test(tc_properties, test_jitter_properties);
+  tcase_add_test(tc_properties, test_fill_mode_property);
+  tcase_add_test(tc_properties, test_pacing_properties);
+  tcase_add_test(tc_properties, test_framing_properties);
+  tcase_add_test(tc_properties, test_barge_in_mode_property);
+  tcase_add_test(tc_properties, test_async_connect_property);
+  tcase_add_test(tc_properties, test_replay_properties);
+  tcase_add_test(tc_properties, test_compression_properties);
+  tcase_add_test(tc_properties, test_wire_format_properties);
+  tcase_add_test(tc_properties, test_wire_codec_property);
+  tcase_add_test(tc_properties, test_vad_properties);
+  tcase_add_test(tc_properties, test_mux_property);
+  tcase_add_test(tc_properties, test_latency_query);
+  tcase_add_test(tc_properties, test_scheduling_stats);
+  tcase_add_test(tc_properties, test_thread_properties);
+  tcase_add_test(tc_properties, test_stats_structure);
+  tcase_add_test(tc_properties, test_tracer_registered);
+  tcase_add_test(tc_properties, test_trace_buffer);
 
   suite_add_tcase(s, tc_pads);
   tcase_add_test(tc_pads, test_pads_exist);
@@ -225,6 +1692,18 @@ websockettransceiver_suite(void)
   suite_add_tcase(s, tc_state);
   tcase_add_test(tc_state, test_state_change_no_uri);
   tcase_add_test(tc_state, test_is_live_source);
+  tcase_add_test(tc_state, test_loopback_invalid_uri);
+  tcase_add_test(tc_state, test_loopback_echo);
+  tcase_add_test(tc_state, test_loopback_fast_drain);
+  tcase_add_test(tc_state, test_loopback_scaled_pacing);
+  tcase_add_test(tc_state, test_loopback_receive_rechunk);
+  tcase_add_test(tc_state, test_loopback_send_batch);
+  tcase_add_test(tc_state, test_loopback_send_batch_latency_cap);
+  tcase_add_test(tc_state, test_loopback_eos_after_drain);
+  tcase_add_test(tc_state, test_comfort_noise_shared_memory);
+  tcase_add_test(tc_state, test_late_frame_stats);
+  tcase_add_test(tc_state, test_queue_time_limit);
+  tcase_add_test(tc_state, test_process_queue_budget);
 
   return s;
 }
@@ -144,6 +144,253 @@ GST_START_TEST(test_send_multiple_buffers)
 }
 GST_END_TEST;
 
+GST_START_TEST(test_io_pool_shared_reactor)
+{
+  GstElement *elements[2];
+  GstCaps *caps;
+  GstSegment segment;
+  gint i;
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+
+  for (i = 0; i < 2; i++) {
+    elements[i] = gst_element_factory_make("websockettransceiver", NULL);
+    fail_unless(elements[i] != NULL);
+    g_object_set(elements[i],
+        "uri", TEST_WS_URI,
+        "frame-duration-ms", 20,
+        "io-pool", TRUE,
+        "io-pool-size", 1,
+        NULL);
+    gst_element_set_state(elements[i], GST_STATE_PLAYING);
+  }
+  g_usleep(1000000);
+
+  for (i = 0; i < 2; i++) {
+    GstPad *sink_pad = gst_element_get_static_pad(elements[i], "sink");
+    guint64 buffers_sent = 0;
+
+    gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+    gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+    gst_segment_init(&segment, GST_FORMAT_TIME);
+    gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+    fail_unless(gst_pad_chain(sink_pad, gst_buffer_new_allocate(NULL, 640, NULL)) == GST_FLOW_OK);
+    g_usleep(100000);
+
+    g_object_get(elements[i], "buffers-sent", &buffers_sent, NULL);
+    fail_unless(buffers_sent == 1, "Element %d should be connected through the shared reactor", i);
+    gst_object_unref(sink_pad);
+  }
+
+  for (i = 0; i < 2; i++) {
+    gst_element_set_state(elements[i], GST_STATE_NULL);
+    gst_object_unref(elements[i]);
+  }
+  gst_caps_unref(caps);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_mux_streams)
+{
+  GstElement *elements[2];
+  GstCaps *caps;
+  GstSegment segment;
+  guint ids[2];
+  gint i;
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+
+  for (i = 0; i < 2; i++) {
+    elements[i] = gst_element_factory_make("websockettransceiver", NULL);
+    fail_unless(elements[i] != NULL);
+    g_object_set(elements[i],
+        "uri", TEST_WS_URI,
+        "frame-duration-ms", 20,
+        "mux", TRUE,
+        NULL);
+    gst_element_set_state(elements[i], GST_STATE_PLAYING);
+  }
+  g_usleep(1000000);
+
+  for (i = 0; i < 2; i++) {
+    GstPad *sink_pad = gst_element_get_static_pad(elements[i], "sink");
+    gboolean active = FALSE;
+
+    g_object_get(elements[i], "mux-stream-id", &ids[i], "framing-active", &active, NULL);
+    fail_unless(ids[i] != 0, "Element %d should have a stream on the shared connection", i);
+    fail_unless(active);
+
+    gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+    gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+    gst_segment_init(&segment, GST_FORMAT_TIME);
+    gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+    fail_unless(gst_pad_chain(sink_pad, gst_buffer_new_allocate(NULL, 640, NULL)) == GST_FLOW_OK);
+    gst_object_unref(sink_pad);
+  }
+  fail_unless(ids[0] != ids[1]);
+  g_usleep(300000);
+
+  // the stub echoes frames with their stream id, so each element gets back its own
+  // audio and not the other one's
+  for (i = 0; i < 2; i++) {
+    guint64 buffers_sent = 0, buffers_received = 0;
+
+    g_object_get(elements[i], "buffers-sent", &buffers_sent,
+        "buffers-received", &buffers_received, NULL);
+    fail_unless_equals_uint64(buffers_sent, 1);
+    fail_unless_equals_uint64(buffers_received, 1);
+  }
+
+  for (i = 0; i < 2; i++) {
+    gst_element_set_state(elements[i], GST_STATE_NULL);
+    gst_object_unref(elements[i]);
+  }
+  gst_caps_unref(caps);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_mux_text_routing)
+{
+  GstElement *pipelines[2], *elements[2];
+  guint ids[2];
+  gint i;
+
+  for (i = 0; i < 2; i++) {
+    GstElement *fakesink = gst_element_factory_make("fakesink", NULL);
+
+    pipelines[i] = gst_pipeline_new(NULL);
+    elements[i] = gst_element_factory_make("websockettransceiver", NULL);
+    fail_unless(elements[i] != NULL && fakesink != NULL);
+    gst_bin_add_many(GST_BIN(pipelines[i]), elements[i], fakesink, NULL);
+    fail_unless(gst_element_link(elements[i], fakesink));
+    g_object_set(elements[i],
+        "uri", TEST_WS_URI,
+        "frame-duration-ms", 20,
+        "initial-buffer-count", 0,
+        "mux", TRUE,
+        NULL);
+    g_object_set(fakesink, "sync", FALSE, NULL);
+    gst_element_set_state(pipelines[i], GST_STATE_PLAYING);
+  }
+  g_usleep(1000000);
+
+  // the stub answers each stream-open with a mark for that stream and an untagged one,
+  // which must reach nobody
+  for (i = 0; i < 2; i++) {
+    GstBus *bus = gst_element_get_bus(pipelines[i]);
+    GstMessage *msg;
+    gchar *expected;
+    gint marks = 0;
+
+    g_object_get(elements[i], "mux-stream-id", &ids[i], NULL);
+    fail_unless(ids[i] != 0);
+    expected = g_strdup_printf("stream-%u", ids[i]);
+    while ((msg = gst_bus_timed_pop_filtered(bus, 500 * GST_MSECOND,
+                GST_MESSAGE_ELEMENT)) != NULL) {
+      const GstStructure *s = gst_message_get_structure(msg);
+
+      if (gst_structure_has_name(s, "websocket-mark")) {
+        fail_unless_equals_string(gst_structure_get_string(s, "name"), expected);
+        marks++;
+      }
+      gst_message_unref(msg);
+    }
+    fail_unless_equals_int(marks, 1);
+    g_free(expected);
+    gst_object_unref(bus);
+  }
+  fail_unless(ids[0] != ids[1]);
+
+  for (i = 0; i < 2; i++) {
+    gst_element_set_state(pipelines[i], GST_STATE_NULL);
+    gst_object_unref(pipelines[i]);
+  }
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prewarm_connections)
+{
+  GstElement *first, *second;
+  guint64 warm_connects = 0;
+
+  // the first element of an endpoint connects itself while the standby pool fills
+  first = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(first != NULL);
+  g_object_set(first, "uri", TEST_WS_URI, "prewarm-connections", 1, NULL);
+  fail_unless(gst_element_set_state(first, GST_STATE_READY) == GST_STATE_CHANGE_SUCCESS);
+  g_object_get(first, "warm-connects", &warm_connects, NULL);
+  fail_unless_equals_uint64(warm_connects, 0);
+  gst_element_set_state(first, GST_STATE_NULL);
+  gst_object_unref(first);
+
+  g_usleep(500000);
+
+  // the next call on the same endpoint takes the standby connection
+  second = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(second != NULL);
+  g_object_set(second, "uri", TEST_WS_URI, "prewarm-connections", 1, NULL);
+  fail_unless(gst_element_set_state(second, GST_STATE_READY) == GST_STATE_CHANGE_SUCCESS);
+  g_object_get(second, "warm-connects", &warm_connects, NULL);
+  fail_unless_equals_uint64(warm_connects, 1);
+  gst_element_set_state(second, GST_STATE_NULL);
+  gst_object_unref(second);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_async_connect)
+{
+  GstElement *element;
+  GstState state;
+
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+  g_object_set(element, "uri", TEST_WS_URI, "async-connect", TRUE, NULL);
+
+  // the connection, not the 5 s fallback timeout, completes the state change
+  fail_unless(gst_element_set_state(element, GST_STATE_READY) == GST_STATE_CHANGE_ASYNC);
+  fail_unless(gst_element_get_state(element, &state, NULL, 3 * GST_SECOND) ==
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_int(state, GST_STATE_READY);
+
+  gst_element_set_state(element, GST_STATE_NULL);
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_shutdown_during_backoff)
+{
+  GstElement *element;
+  gint64 start;
+
+  // nothing listens on port 1, so the element sits in its reconnect backoff
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fail_unless(element != NULL);
+  g_object_set(element, "uri", "ws://127.0.0.1:1", "async-connect", TRUE,
+      "initial-reconnect-delay-ms", 5000, "max-backoff-ms", 60000, NULL);
+
+  fail_unless(gst_element_set_state(element, GST_STATE_READY) == GST_STATE_CHANGE_ASYNC);
+  g_usleep(200000);
+
+  start = g_get_monotonic_time();
+  gst_element_set_state(element, GST_STATE_NULL);
+  fail_unless(g_get_monotonic_time() - start < 500 * G_TIME_SPAN_MILLISECOND,
+      "Shutdown waited for the reconnect backoff");
+
+  gst_object_unref(element);
+}
+GST_END_TEST;
+
 static GstPadProbeReturn
 buffer_counter_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
 {
@@ -248,6 +495,1042 @@ GST_START_TEST(test_barge_in_clear)
 }
 GST_END_TEST;
 
+typedef struct
+{
+  gint count;
+  gint bad_size;
+  gint bad_duration;
+} FrameCheck;
+
+static GstPadProbeReturn
+frame_check_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  FrameCheck *check = (FrameCheck *) user_data;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  g_atomic_int_inc(&check->count);
+  if (gst_buffer_get_size(buffer) != 640)
+    g_atomic_int_inc(&check->bad_size);
+  if (GST_BUFFER_DURATION(buffer) != 20 * GST_MSECOND)
+    g_atomic_int_inc(&check->bad_duration);
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST(test_receive_rechunked_frames)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad, *fs_sink_pad;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GstSegment segment;
+  FrameCheck check = { 0, 0, 0 };
+  guint64 pool_hits;
+  gint mode;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      NULL);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  fs_sink_pad = gst_element_get_static_pad(fakesink, "sink");
+  gst_pad_add_probe(fs_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, frame_check_probe, &check, NULL);
+  gst_object_unref(fs_sink_pad);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // one 100 ms message comes back from the echo server and must leave as five 20 ms frames
+  buffer = gst_buffer_new_allocate(NULL, 3200, NULL);
+  gst_buffer_memset(buffer, 0, 0, 3200);
+  fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+  g_usleep(500000);
+
+  fail_unless_equals_int(g_atomic_int_get(&check.count), 5);
+  fail_unless_equals_int(g_atomic_int_get(&check.bad_size), 0);
+  fail_unless_equals_int(g_atomic_int_get(&check.bad_duration), 0);
+
+  // auto mode cuts frames into pooled buffers once caps give it a frame size
+  g_object_get(element, "active-recv-buffer-mode", &mode, "pool-hits", &pool_hits, NULL);
+  fail_unless_equals_int(mode, 2);
+  fail_unless_equals_uint64(pool_hits, 5);
+
+  gst_caps_unref(caps);
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_fill_mode_silence)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad, *fs_sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  gint buffer_count = 0;
+  guint64 frames_filled;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "sample-rate", 8000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "fill-mode", "silence");
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  fs_sink_pad = gst_element_get_static_pad(fakesink, "sink");
+  gst_pad_add_probe(fs_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, buffer_counter_probe, &buffer_count, NULL);
+  gst_object_unref(fs_sink_pad);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  caps = gst_caps_new_simple("audio/x-mulaw",
+      "rate", G_TYPE_INT, 8000,
+      "channels", G_TYPE_INT, 1,
+      NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // nothing is sent, so everything downstream sees is filler
+  g_usleep(500000);
+
+  g_object_get(element, "frames-filled", &frames_filled, NULL);
+  fail_unless(frames_filled > 0, "Underruns should have been filled");
+  fail_unless(g_atomic_int_get(&buffer_count) > 0, "Filler frames should reach downstream");
+
+  gst_caps_unref(caps);
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_control_mark)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad;
+  GstBus *bus;
+  GstMessage *msg;
+  GstCaps *caps;
+  GstSegment segment;
+  gboolean mark_seen = FALSE;
+  gint i;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      NULL);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // the stub server answers the 5th binary message with {"type":"mark","name":"after-5"}
+  for (i = 0; i < 5; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    gst_pad_chain(sink_pad, buffer);
+    g_usleep(50000);
+  }
+
+  bus = gst_element_get_bus(pipeline);
+  while (!mark_seen &&
+         (msg = gst_bus_timed_pop_filtered(bus, 2 * GST_SECOND, GST_MESSAGE_ELEMENT)) != NULL) {
+    const GstStructure *s = gst_message_get_structure(msg);
+    if (gst_structure_has_name(s, "websocket-mark")) {
+      fail_unless_equals_string(gst_structure_get_string(s, "name"), "after-5");
+      mark_seen = TRUE;
+    }
+    gst_message_unref(msg);
+  }
+  gst_object_unref(bus);
+
+  fail_unless(mark_seen, "Mark should be posted once the audio before it is played");
+
+  gst_caps_unref(caps);
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_binary_framing)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad, *fs_sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  FrameCheck check = { 0, 0, 0 };
+  gboolean active;
+  gint i;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "framing", "v1");
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  fs_sink_pad = gst_element_get_static_pad(fakesink, "sink");
+  gst_pad_add_probe(fs_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, frame_check_probe, &check, NULL);
+  gst_object_unref(fs_sink_pad);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  // the stub server accepts the framing subprotocol and echoes frames verbatim
+  g_object_get(element, "framing-active", &active, NULL);
+  fail_unless(active, "Server should have accepted binary framing");
+
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // stay below the third message, which the stub server answers with a clear
+  for (i = 0; i < 2; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(50000);
+  }
+  g_usleep(300000);
+
+  // the header is stripped again on receive, downstream sees plain 20 ms frames
+  fail_unless(g_atomic_int_get(&check.count) >= 2, "Echoed frames should be played");
+  fail_unless_equals_int(g_atomic_int_get(&check.bad_size), 0);
+
+  gst_caps_unref(caps);
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_barge_in_fast)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad;
+  GstBus *bus;
+  GstMessage *msg;
+  GstCaps *caps;
+  GstSegment segment;
+  gboolean reported = FALSE;
+  guint64 latency = 0;
+  gint i;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "barge-in-mode", "fast");
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // the stub server answers the 3rd binary message with a clear
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(50000);
+  }
+
+  bus = gst_element_get_bus(pipeline);
+  while (!reported &&
+         (msg = gst_bus_timed_pop_filtered(bus, 2 * GST_SECOND, GST_MESSAGE_ELEMENT)) != NULL) {
+    const GstStructure *s = gst_message_get_structure(msg);
+    if (gst_structure_has_name(s, "websocket-barge-in")) {
+      fail_unless_equals_string(gst_structure_get_string(s, "mode"), "fast");
+      fail_unless(gst_structure_get_uint64(s, "latency-us", &latency));
+      reported = TRUE;
+    }
+    gst_message_unref(msg);
+  }
+  gst_object_unref(bus);
+
+  fail_unless(reported, "Barge-in latency should be posted on the bus");
+  // without a downstream flush the interrupt is bounded by one push, not a frame
+  fail_unless(latency < 20 * 1000, "Fast barge-in took %" G_GUINT64_FORMAT " us", latency);
+
+  gst_caps_unref(caps);
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+// sends six buffers to a server that drops the first connection after the 2nd of them
+// and returns buffers-replayed. resumed says how the reconnect went, eos whether the
+// stream ended meanwhile.
+static guint64
+run_reconnect(const gchar *uri, const gchar *framing, gboolean *resumed, gboolean *eos)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad;
+  GstBus *bus;
+  GstMessage *msg;
+  GstCaps *caps;
+  GstSegment segment;
+  gboolean reconnected = FALSE;
+  guint64 replayed = 0;
+  gchar *token = NULL;
+  gint i;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", uri,
+      "sample-rate", 16000,
+      "channels", 1,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      "initial-reconnect-delay-ms", 100,
+      "replay-buffer-ms", 500,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "framing", framing);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  g_object_get(element, "resume-token", &token, NULL);
+  fail_unless(token != NULL, "A resume token should be generated");
+  g_free(token);
+
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  for (i = 0; i < 6; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(50000);
+  }
+
+  *resumed = FALSE;
+  *eos = FALSE;
+  bus = gst_element_get_bus(pipeline);
+  while (!reconnected && (msg = gst_bus_timed_pop_filtered(bus, 2 * GST_SECOND,
+              GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS)) != NULL) {
+    const GstStructure *s = gst_message_get_structure(msg);
+    guint count = 0;
+
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+      *eos = TRUE;
+    } else if (gst_structure_has_name(s, "websocket-connected") &&
+        gst_structure_get_uint(s, "reconnect-count", &count) && count > 0) {
+      gst_structure_get_boolean(s, "resumed", resumed);
+      reconnected = TRUE;
+    }
+    gst_message_unref(msg);
+  }
+  gst_object_unref(bus);
+  fail_unless(reconnected, "The element should reconnect");
+
+  g_object_get(element, "buffers-replayed", &replayed, NULL);
+
+  gst_caps_unref(caps);
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+  return replayed;
+}
+
+GST_START_TEST(test_replay_on_reconnect)
+{
+  gboolean resumed, eos;
+  guint64 replayed;
+
+  // the stub server drops the first connection of a token after its 2nd binary message
+  replayed = run_reconnect(TEST_WS_URI, "v1", &resumed, &eos);
+
+  fail_if(eos, "A blip must not end the stream");
+  fail_unless(resumed, "The reconnect should resume the session");
+  fail_unless(replayed >= 2, "Sent audio should be replayed, got %" G_GUINT64_FORMAT,
+      replayed);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_replay_raw_unsent_only)
+{
+  gboolean resumed, eos;
+  guint64 replayed;
+
+  // without sequence numbers the server cannot discard what it already got
+  replayed = run_reconnect(TEST_WS_URI, "none", &resumed, &eos);
+
+  fail_if(eos, "A blip must not end the stream");
+  fail_unless(resumed, "The reconnect should resume the session");
+  fail_unless(replayed <= 4, "Audio sent before the drop must not be replayed, got %"
+      G_GUINT64_FORMAT, replayed);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_normal_close_not_resumed)
+{
+  gboolean resumed, eos;
+  guint64 replayed;
+
+  replayed = run_reconnect(TEST_WS_URI "/close-normal", "v1", &resumed, &eos);
+
+  fail_if(resumed, "A session the server closed must not be resumed");
+  fail_unless_equals_uint64(replayed, 0);
+}
+GST_END_TEST;
+
+// sends two 20 ms buffers of silence with compression on and returns the send ratio
+static gdouble
+run_compression(GstCaps *caps, FrameCheck *check)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad, *fs_sink_pad;
+  GstSegment segment;
+  gdouble ratio = 0;
+  gint i;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      "compression", TRUE,
+      "compression-window-bits", 10,
+      NULL);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  fs_sink_pad = gst_element_get_static_pad(fakesink, "sink");
+  gst_pad_add_probe(fs_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, frame_check_probe, check, NULL);
+  gst_object_unref(fs_sink_pad);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // stay below the third message, which the stub server answers with a clear
+  for (i = 0; i < 2; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    gst_buffer_memset(buffer, 0, 0, 640);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(50000);
+  }
+  g_usleep(300000);
+
+  g_object_get(element, "compression-ratio", &ratio, NULL);
+
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+  return ratio;
+}
+
+GST_START_TEST(test_compression)
+{
+  FrameCheck check = { 0, 0, 0 };
+  GstCaps *caps;
+  gdouble ratio;
+
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  ratio = run_compression(caps, &check);
+  gst_caps_unref(caps);
+
+  // the stub server negotiates permessage-deflate and echoes compressed frames back
+  fail_unless(ratio > 2.0, "Silence should compress, ratio %f", ratio);
+  fail_unless(g_atomic_int_get(&check.count) >= 2, "Echoed frames should be inflated and played");
+  fail_unless_equals_int(g_atomic_int_get(&check.bad_size), 0);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_compression_skips_mulaw)
+{
+  FrameCheck check = { 0, 0, 0 };
+  GstCaps *caps;
+  gdouble ratio;
+
+  caps = gst_caps_new_simple("audio/x-mulaw",
+      "rate", G_TYPE_INT, 32000,
+      "channels", G_TYPE_INT, 1,
+      NULL);
+  ratio = run_compression(caps, &check);
+  gst_caps_unref(caps);
+
+  // negotiated but bypassed: every byte goes on the wire as is
+  fail_unless(ratio == 1.0, "mu-law should be sent uncompressed, ratio %f", ratio);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_wire_format_conversion)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad, *fs_sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  FrameCheck check = { 0, 0, 0 };
+  guint64 bytes_sent = 0;
+  gint i, n;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      "wire-rate", 16000,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "wire-format", "s16le");
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  fs_sink_pad = gst_element_get_static_pad(fakesink, "sink");
+  gst_pad_add_probe(fs_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, frame_check_probe, &check, NULL);
+  gst_object_unref(fs_sink_pad);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "F32LE",
+      "rate", G_TYPE_INT, 48000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_caps_unref(caps);
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // two 20 ms buffers of 48 kHz float, below the stub server's clear on the third
+  for (i = 0; i < 2; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 960 * sizeof(gfloat), NULL);
+    GstMapInfo map;
+    gfloat *samples;
+
+    gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+    samples = (gfloat *) map.data;
+    for (n = 0; n < 960; n++)
+      samples[n] = ((i * 960 + n) % 96) / 96.0f - 0.5f;
+    gst_buffer_unmap(buffer, &map);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(50000);
+  }
+  g_usleep(300000);
+
+  // 20 ms of 16 kHz S16LE is 640 bytes, against 3840 for the caps format
+  g_object_get(element, "bytes-sent", &bytes_sent, NULL);
+  fail_unless_equals_uint64(bytes_sent, 2 * 640);
+
+  // the echo is converted back, so downstream gets 20 ms frames of 48 kHz float: 3840
+  // bytes each, none of them the 640 bytes of the wire
+  fail_unless(g_atomic_int_get(&check.count) >= 2, "Echoed audio should be played");
+  fail_unless_equals_int(g_atomic_int_get(&check.bad_duration), 0);
+  fail_unless_equals_int(g_atomic_int_get(&check.bad_size), g_atomic_int_get(&check.count));
+
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_vad_suppresses_silence)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  guint64 buffers_sent = 0, buffers_suppressed = 0, bytes_sent = 0;
+  gint i, n;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      "vad", TRUE,
+      "vad-hangover-ms", 0,
+      NULL);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_caps_unref(caps);
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // speech, four buffers of digital silence, speech again. without hangover the first
+  // silent buffer is already held back, the last one goes out as pre-roll of the onset.
+  for (i = 0; i < 6; i++) {
+    gboolean loud = (i == 0 || i == 5);
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    GstMapInfo map;
+    gint16 *samples;
+
+    gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+    samples = (gint16 *) map.data;
+    for (n = 0; n < 320; n++)
+      samples[n] = loud ? ((n % 32) - 16) * 1024 : 0;
+    gst_buffer_unmap(buffer, &map);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(20000);
+  }
+  g_usleep(300000);
+
+  g_object_get(element, "buffers-sent", &buffers_sent,
+      "buffers-suppressed", &buffers_suppressed, "bytes-sent", &bytes_sent, NULL);
+  fail_unless_equals_uint64(buffers_suppressed, 3);
+  fail_unless_equals_uint64(buffers_sent, 3);
+  // the silence start and end messages are not audio and not counted
+  fail_unless_equals_uint64(bytes_sent, 3 * 640);
+
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_stats_messages)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstBus *bus;
+  GstMessage *msg;
+  guint seen = 0;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element, "uri", TEST_WS_URI, "stats-interval-ms", 100, NULL);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus(pipeline);
+  while (seen < 2 &&
+         (msg = gst_bus_timed_pop_filtered(bus, 2 * GST_SECOND, GST_MESSAGE_ELEMENT)) != NULL) {
+    const GstStructure *s = gst_message_get_structure(msg);
+    if (gst_structure_has_name(s, "websocket-stats")) {
+      fail_unless(gst_structure_has_field(s, "send-latency-p99-us"));
+      seen++;
+    }
+    gst_message_unref(msg);
+  }
+  gst_object_unref(bus);
+
+  fail_unless_equals_int(seen, 2);
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_stats_structure_counts)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GstStructure *stats;
+  guint64 count = 0, payload = 0, wire = 0, received = 0, lateness = 0;
+  gint i;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      NULL);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_caps_unref(caps);
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  for (i = 0; i < 5; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    gst_buffer_memset(buffer, 0, 0, 640);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(20000);
+  }
+  g_usleep(300000);
+
+  g_object_get(element, "stats", &stats, NULL);
+  fail_unless(stats != NULL);
+  fail_unless(gst_structure_get_uint64(stats, "send-latency-count", &count));
+  fail_unless_equals_uint64(count, 5);
+  fail_unless(gst_structure_get_uint64(stats, "payload-bytes-sent", &payload));
+  fail_unless_equals_uint64(payload, 5 * 640);
+  // every frame pays at least a header and the mask key on top of the audio
+  fail_unless(gst_structure_get_uint64(stats, "wire-bytes-sent", &wire));
+  fail_unless(wire >= payload + 5 * 8);
+  // the stub echoes the audio back
+  fail_unless(gst_structure_get_uint64(stats, "wire-bytes-received", &received));
+  fail_unless(received > 0);
+  fail_unless(gst_structure_get_uint64(stats, "output-lateness-count", &lateness));
+  fail_unless(lateness > 0);
+  gst_structure_free(stats);
+
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_trace_dump)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  gchar *dump = NULL;
+  gint i;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "frame-duration-ms", 20,
+      "trace-buffer-size", 64,
+      NULL);
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_caps_unref(caps);
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    gst_buffer_memset(buffer, 0, 0, 640);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+  }
+  g_usleep(300000);
+
+  g_signal_emit_by_name(element, "dump-trace", &dump);
+  fail_unless(dump != NULL);
+  fail_unless(strstr(dump, " connected ") != NULL);
+  fail_unless(strstr(dump, " sent a=640 ") != NULL);
+  // the stub echoes the audio back
+  fail_unless(strstr(dump, " received ") != NULL);
+  g_free(dump);
+
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+
+#ifdef HAVE_OPUS
+GST_START_TEST(test_opus_wire_codec)
+{
+  GstElement *pipeline, *element, *fakesink;
+  GstPad *sink_pad, *fs_sink_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  FrameCheck check = { 0, 0, 0 };
+  guint64 bytes_sent = 0, buffers_sent = 0;
+  gint i, n;
+
+  pipeline = gst_pipeline_new("test-pipeline");
+  element = gst_element_factory_make("websockettransceiver", NULL);
+  fakesink = gst_element_factory_make("fakesink", NULL);
+  fail_unless(element != NULL);
+  fail_unless(fakesink != NULL);
+
+  gst_bin_add_many(GST_BIN(pipeline), element, fakesink, NULL);
+  fail_unless(gst_element_link(element, fakesink));
+
+  g_object_set(element,
+      "uri", TEST_WS_URI,
+      "frame-duration-ms", 20,
+      "initial-buffer-count", 0,
+      NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "wire-codec", "opus");
+  g_object_set(fakesink, "sync", FALSE, NULL);
+
+  fs_sink_pad = gst_element_get_static_pad(fakesink, "sink");
+  gst_pad_add_probe(fs_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, frame_check_probe, &check, NULL);
+  gst_object_unref(fs_sink_pad);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  g_usleep(1000000);
+
+  sink_pad = gst_element_get_static_pad(element, "sink");
+  gst_pad_send_event(sink_pad, gst_event_new_stream_start("test"));
+  caps = gst_caps_new_simple("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "rate", G_TYPE_INT, 16000,
+      "channels", G_TYPE_INT, 1,
+      "layout", G_TYPE_STRING, "interleaved",
+      NULL);
+  gst_pad_send_event(sink_pad, gst_event_new_caps(caps));
+  gst_caps_unref(caps);
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(sink_pad, gst_event_new_segment(&segment));
+
+  // a 444 Hz sawtooth in two 20 ms buffers, one packet each. the stub server answers the
+  // third message with a clear, so the test stays below it.
+  for (i = 0; i < 2; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, 640, NULL);
+    GstMapInfo map;
+    gint16 *samples;
+
+    gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+    samples = (gint16 *) map.data;
+    for (n = 0; n < 320; n++)
+      samples[n] = (gint16) (((i * 320 + n) % 36) * 400 - 7200);
+    gst_buffer_unmap(buffer, &map);
+    GST_BUFFER_PTS(buffer) = i * GST_MSECOND * 20;
+    GST_BUFFER_DURATION(buffer) = GST_MSECOND * 20;
+    fail_unless(gst_pad_chain(sink_pad, buffer) == GST_FLOW_OK);
+    g_usleep(50000);
+  }
+  g_usleep(300000);
+
+  g_object_get(element, "bytes-sent", &bytes_sent, "buffers-sent", &buffers_sent, NULL);
+  fail_unless_equals_uint64(buffers_sent, 2);
+  fail_unless(bytes_sent < 2 * 640 / 4, "Opus should shrink 1280 bytes of PCM, sent %"
+      G_GUINT64_FORMAT, bytes_sent);
+
+  // the echoed packets are decoded back into 20 ms of S16LE each
+  fail_unless(g_atomic_int_get(&check.count) >= 2, "Echoed packets should be played");
+  fail_unless_equals_int(g_atomic_int_get(&check.bad_size), 0);
+
+  gst_object_unref(sink_pad);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+GST_END_TEST;
+#endif
+
 static Suite *
 websockettransceiver_harness_suite(void)
 {
@@ -261,6 +1544,30 @@ websockettransceiver_harness_suite(void)
   tcase_add_test(tc, test_send_data);
   tcase_add_test(tc, test_send_multiple_buffers);
   tcase_add_test(tc, test_barge_in_clear);
+  tcase_add_test(tc, test_io_pool_shared_reactor);
+  tcase_add_test(tc, test_prewarm_connections);
+  tcase_add_test(tc, test_receive_rechunked_frames);
+  tcase_add_test(tc, test_fill_mode_silence);
+  tcase_add_test(tc, test_control_mark);
+  tcase_add_test(tc, test_binary_framing);
+  tcase_add_test(tc, test_barge_in_fast);
+  tcase_add_test(tc, test_async_connect);
+  tcase_add_test(tc, test_shutdown_during_backoff);
+  tcase_add_test(tc, test_replay_on_reconnect);
+  tcase_add_test(tc, test_replay_raw_unsent_only);
+  tcase_add_test(tc, test_normal_close_not_resumed);
+  tcase_add_test(tc, test_compression);
+  tcase_add_test(tc, test_compression_skips_mulaw);
+  tcase_add_test(tc, test_wire_format_conversion);
+  tcase_add_test(tc, test_vad_suppresses_silence);
+  tcase_add_test(tc, test_stats_structure_counts);
+  tcase_add_test(tc, test_stats_messages);
+  tcase_add_test(tc, test_trace_dump);
+  tcase_add_test(tc, test_mux_streams);
+  tcase_add_test(tc, test_mux_text_routing);
+#ifdef HAVE_OPUS
+  tcase_add_test(tc, test_opus_wire_codec);
+#endif
 
   return s;
 }
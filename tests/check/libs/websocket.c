@@ -0,0 +1,404 @@
+#include <gst/check/gstcheck.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "gstwscontrol.h"
+#include "gstwsconvert.h"
+#include "gstwsjitter.h"
+
+#define FRAME (20 * GST_MSECOND)
+
+// count frames of one turn, sent spacing_us apart starting at start_us
+static gint64
+feed_turn(GstWsJitter *jitter, gint64 start_us, gint count, gint64 spacing_us)
+{
+  for (gint i = 0; i < count; i++)
+    gst_ws_jitter_update(jitter, start_us + i * spacing_us, FRAME);
+  return start_us + count * spacing_us;
+}
+
+GST_START_TEST(test_jitter_bursty_turns)
+{
+  GstWsJitter jitter;
+  gint64 now = 1000000;
+
+  gst_ws_jitter_reset(&jitter);
+  // 2 s turns sent twenty times faster than realtime, with 3 s of silence between them,
+  // and one turn that arrives while the one before is still playing
+  now = feed_turn(&jitter, now, 100, 1000) + 3 * G_USEC_PER_SEC;
+  now = feed_turn(&jitter, now, 100, 1000) + 500000;
+  now = feed_turn(&jitter, now, 100, 1000) + 5 * G_USEC_PER_SEC;
+  feed_turn(&jitter, now, 100, 1000);
+
+  fail_unless_equals_uint64(gst_ws_jitter_get(&jitter), 0);
+  fail_unless_equals_uint64(gst_ws_jitter_target(&jitter, FRAME, 40 * GST_MSECOND,
+          500 * GST_MSECOND), 40 * GST_MSECOND);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_jitter_realtime_turns)
+{
+  GstWsJitter jitter;
+  gint64 now = 1000000;
+
+  gst_ws_jitter_reset(&jitter);
+  // paced turns with pauses in between settle at no jitter
+  now = feed_turn(&jitter, now, 100, 20000) + 2 * G_USEC_PER_SEC;
+  feed_turn(&jitter, now, 100, 20000);
+
+  fail_unless_equals_uint64(gst_ws_jitter_get(&jitter), 0);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_jitter_late_frames)
+{
+  GstWsJitter jitter;
+
+  gst_ws_jitter_reset(&jitter);
+  // every other frame 10 ms late is jitter the buffer has to cover
+  for (gint i = 0; i < 200; i++)
+    gst_ws_jitter_update(&jitter, 1000000 + i * 20000 + (i % 2) * 10000, FRAME);
+
+  fail_unless(gst_ws_jitter_get(&jitter) > 9 * GST_MSECOND);
+  fail_unless(gst_ws_jitter_get(&jitter) <= 10 * GST_MSECOND);
+  fail_unless(gst_ws_jitter_target(&jitter, FRAME, 40 * GST_MSECOND,
+          500 * GST_MSECOND) > 40 * GST_MSECOND);
+}
+GST_END_TEST;
+
+// the scalar conversions the vector kernels have to agree with
+static gint16
+reference_f32_to_s16(gfloat f)
+{
+  f *= 32768.0f;
+  if (f >= 32767.0f)
+    return 32767;
+  if (f <= -32768.0f)
+    return -32768;
+  return (gint16)(f >= 0.0f ? f + 0.5f : f - 0.5f);
+}
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define F32_NATIVE GST_WS_SAMPLE_FORMAT_F32LE
+#define S16_NATIVE GST_WS_SAMPLE_FORMAT_S16LE
+#define S16_SWAPPED GST_WS_SAMPLE_FORMAT_S16BE
+#else
+#define F32_NATIVE GST_WS_SAMPLE_FORMAT_F32BE
+#define S16_NATIVE GST_WS_SAMPLE_FORMAT_S16BE
+#define S16_SWAPPED GST_WS_SAMPLE_FORMAT_S16LE
+#endif
+
+#define KERNEL_SAMPLES 71
+
+// every length up to a few vector widths, so both the vector loops and the scalar tails
+// run, on unaligned memory
+GST_START_TEST(test_convert_kernels_match_scalar)
+{
+  guint8 *raw = g_malloc(KERNEL_SAMPLES * 4 + 1), *floats = raw + 1;
+  guint8 *swapped = g_malloc(KERNEL_SAMPLES * 2);
+  gint16 s16[KERNEL_SAMPLES], out[KERNEL_SAMPLES];
+  guint8 back[KERNEL_SAMPLES * 4];
+  GRand *rand = g_rand_new_with_seed(5);
+
+  for (gsize i = 0; i < KERNEL_SAMPLES; i++) {
+    // a quarter step off the integers, so no sample is a rounding tie
+    gfloat f = (g_rand_int_range(rand, -32768, 32768) + 0.25f) / 32768.0f;
+
+    if (i % 13 == 0)
+      f = i % 2 ? 1.5f : -3.0f;
+    memcpy(floats + i * 4, &f, 4);
+    s16[i] = (gint16)g_rand_int_range(rand, -32768, 32768);
+    swapped[i * 2] = (guint8)((guint16)s16[i] >> 8);
+    swapped[i * 2 + 1] = (guint8)(s16[i] & 0xFF);
+  }
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+  for (gsize i = 0; i < KERNEL_SAMPLES; i++) {
+    guint8 t = swapped[i * 2];
+
+    swapped[i * 2] = swapped[i * 2 + 1];
+    swapped[i * 2 + 1] = t;
+  }
+#endif
+
+  for (gsize n = 0; n <= KERNEL_SAMPLES; n++) {
+    gst_ws_convert_to_s16(F32_NATIVE, floats, out, n);
+    for (gsize i = 0; i < n; i++) {
+      gfloat f;
+
+      memcpy(&f, floats + i * 4, 4);
+      fail_unless_equals_int(out[i], reference_f32_to_s16(f));
+    }
+
+    gst_ws_convert_from_s16(F32_NATIVE, s16, back, n);
+    for (gsize i = 0; i < n; i++) {
+      gfloat f;
+
+      memcpy(&f, back + i * 4, 4);
+      fail_unless(f == s16[i] / 32768.0f, "sample %zu of %zu", i, n);
+    }
+
+    gst_ws_convert_to_s16(S16_SWAPPED, swapped, out, n);
+    for (gsize i = 0; i < n; i++)
+      fail_unless_equals_int(out[i], s16[i]);
+  }
+
+  g_rand_free(rand);
+  g_free(swapped);
+  g_free(raw);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_convert_g711_round_trip)
+{
+  guint8 codes[256], back[256];
+  gint16 pcm[256];
+
+  for (guint i = 0; i < 256; i++)
+    codes[i] = (guint8)i;
+
+  gst_ws_convert_to_s16(GST_WS_SAMPLE_FORMAT_ALAW, codes, pcm, 256);
+  gst_ws_convert_from_s16(GST_WS_SAMPLE_FORMAT_ALAW, pcm, back, 256);
+  for (guint i = 0; i < 256; i++)
+    fail_unless_equals_int(back[i], codes[i]);
+
+  gst_ws_convert_to_s16(GST_WS_SAMPLE_FORMAT_MULAW, codes, pcm, 256);
+  gst_ws_convert_from_s16(GST_WS_SAMPLE_FORMAT_MULAW, pcm, back, 256);
+  for (guint i = 0; i < 256; i++) {
+    // mu-law has a negative zero, it comes back as the positive one
+    fail_unless_equals_int(back[i], i == 0x7F ? 0xFF : codes[i]);
+  }
+}
+GST_END_TEST;
+
+#define RESAMPLE_FRAMES 4800
+
+static gint16 *
+resample_input(void)
+{
+  gint16 *in = g_new(gint16, RESAMPLE_FRAMES);
+
+  for (gsize i = 0; i < RESAMPLE_FRAMES; i++)
+    in[i] = (gint16)(8000.0 * sin(2.0 * G_PI * 440.0 * i / 16000.0));
+  return in;
+}
+
+// the output of one call must not depend on how the input was cut into pieces
+static void
+check_resampler_chunks(guint in_rate, guint out_rate, gsize expected)
+{
+  static const gsize chunks[] = { 1, 7, 160, 33, 2, 320, 3 };
+  GstWsResampler *whole = gst_ws_resampler_new(in_rate, out_rate, 1);
+  GstWsResampler *pieces = gst_ws_resampler_new(in_rate, out_rate, 1);
+  gint16 *in = resample_input();
+  gsize max = gst_ws_resampler_max_output(whole, RESAMPLE_FRAMES);
+  gint16 *a = g_new(gint16, max), *b = g_new(gint16, max);
+  gsize produced_a, produced_b = 0, offset = 0;
+
+  produced_a = gst_ws_resampler_process(whole, in, RESAMPLE_FRAMES, a);
+  fail_unless_equals_uint64(produced_a, expected);
+
+  for (guint c = 0; offset < RESAMPLE_FRAMES; c++) {
+    gsize n = MIN(chunks[c % G_N_ELEMENTS(chunks)], RESAMPLE_FRAMES - offset);
+
+    produced_b += gst_ws_resampler_process(pieces, in + offset, n, b + produced_b);
+    offset += n;
+  }
+  fail_unless_equals_uint64(produced_b, produced_a);
+  fail_unless(memcmp(a, b, produced_a * sizeof(gint16)) == 0);
+
+  g_free(a);
+  g_free(b);
+  g_free(in);
+  gst_ws_resampler_free(whole);
+  gst_ws_resampler_free(pieces);
+}
+
+GST_START_TEST(test_resampler_length_and_continuity)
+{
+  check_resampler_chunks(16000, 48000, RESAMPLE_FRAMES * 3);
+  check_resampler_chunks(48000, 16000, RESAMPLE_FRAMES / 3);
+  check_resampler_chunks(16000, 24000, RESAMPLE_FRAMES * 3 / 2);
+  check_resampler_chunks(24000, 16000, RESAMPLE_FRAMES * 2 / 3);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_resampler_reset)
+{
+  GstWsResampler *fresh = gst_ws_resampler_new(16000, 8000, 1);
+  GstWsResampler *reused = gst_ws_resampler_new(16000, 8000, 1);
+  gint16 *in = resample_input();
+  gint16 a[RESAMPLE_FRAMES], b[RESAMPLE_FRAMES];
+  gsize produced_a, produced_b;
+
+  // an odd count leaves the phase mid-way between two outputs
+  gst_ws_resampler_process(reused, in, 161, b);
+  gst_ws_resampler_reset(reused);
+
+  produced_a = gst_ws_resampler_process(fresh, in + 1000, 320, a);
+  produced_b = gst_ws_resampler_process(reused, in + 1000, 320, b);
+  fail_unless_equals_uint64(produced_b, produced_a);
+  fail_unless(memcmp(a, b, produced_a * sizeof(gint16)) == 0);
+
+  g_free(in);
+  gst_ws_resampler_free(fresh);
+  gst_ws_resampler_free(reused);
+}
+GST_END_TEST;
+
+// a partial sample held back from before the reset must not shift the next buffer
+GST_START_TEST(test_converter_reset)
+{
+  GstWsConverter *fresh, *reused;
+  GstBuffer *in, *a, *b;
+  GstMapInfo map;
+  guint8 odd[3] = { 0x10, 0x20, 0x30 };
+
+  fresh = gst_ws_converter_new(S16_NATIVE, 16000, F32_NATIVE, 16000, 1, NULL);
+  reused = gst_ws_converter_new(S16_NATIVE, 16000, F32_NATIVE, 16000, 1, NULL);
+  fail_unless(fresh != NULL && reused != NULL);
+
+  in = gst_buffer_new_memdup(odd, sizeof(odd));
+  a = gst_ws_converter_process(reused, in);
+  fail_unless_equals_uint64(gst_buffer_get_size(a), 4);
+  gst_buffer_unref(a);
+  gst_ws_converter_reset(reused);
+
+  in = gst_buffer_new_allocate(NULL, 640, NULL);
+  gst_buffer_memset(in, 0, 0x11, 640);
+  a = gst_ws_converter_process(fresh, gst_buffer_ref(in));
+  b = gst_ws_converter_process(reused, in);
+  fail_unless(a != NULL && b != NULL);
+  fail_unless_equals_uint64(gst_buffer_get_size(b), gst_buffer_get_size(a));
+  fail_unless(gst_buffer_map(a, &map, GST_MAP_READ));
+  fail_unless(gst_buffer_memcmp(b, 0, map.data, map.size) == 0);
+  gst_buffer_unmap(a, &map);
+
+  gst_buffer_unref(a);
+  gst_buffer_unref(b);
+  gst_ws_converter_free(fresh);
+  gst_ws_converter_free(reused);
+}
+GST_END_TEST;
+
+typedef struct
+{
+  const gchar *json;
+  gboolean scanned;
+  const gchar *type;
+  const gchar *name;
+  gint stream;
+} ControlCase;
+
+// FALSE hands the message to json-glib: for escapes and nesting that is the fallback,
+// for malformed input json-glib rejects it in turn
+static const ControlCase control_cases[] = {
+  { "{}", TRUE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\"}", TRUE, "clear", NULL, -1 },
+  { " {\"type\" : \"mark\", \"name\": \"m1\"}\n", TRUE, "mark", "m1", -1 },
+  { "{\"type\":\"mark\",\"name\":\"a\",\"stream\":3}", TRUE, "mark", "a", 3 },
+  { "{\"type\":\"pause\",\"at\":-1.5e+3,\"final\":true,\"x\":null}", TRUE, "pause", NULL,
+    -1 },
+  { "{\"type\":\"resume\",\"n\":0}", TRUE, "resume", NULL, -1 },
+  // escaped
+  { "{\"type\":\"mark\",\"name\":\"a\\\"b\"}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"mark\",\"name\":\"\\u00e9\"}", FALSE, NULL, NULL, -1 },
+  // nested
+  { "{\"type\":\"mark\",\"mark\":{\"name\":\"a\"}}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"ids\":[1,2]}", FALSE, NULL, NULL, -1 },
+  // malformed
+  { "", FALSE, NULL, NULL, -1 },
+  { "{", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\"", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\"} x", FALSE, NULL, NULL, -1 },
+  { "{\"type\" \"clear\"}", FALSE, NULL, NULL, -1 },
+  { "{type:\"clear\"}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":clear}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"n\":tru}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"n\":nulls}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"n\":01}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"n\":1.}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"n\":-}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"n\":1e}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"clear\",\"n\":1-2}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":\"mark\",\"name\":\"a\tb\"}", FALSE, NULL, NULL, -1 },
+  { "{\"type\":1}", FALSE, NULL, NULL, -1 },
+  { "{\"stream\":\"3\"}", FALSE, NULL, NULL, -1 },
+  { "{\"stream\":-3}", FALSE, NULL, NULL, -1 },
+  { "{\"stream\":70000}", FALSE, NULL, NULL, -1 },
+};
+
+static void
+check_control_field(const gchar *json, const gchar *field, const gchar *value, gsize len,
+    const gchar *expected)
+{
+  if (!expected) {
+    fail_unless(value == NULL, "%s: unexpected %s", json, field);
+    return;
+  }
+  fail_unless(value != NULL, "%s: no %s", json, field);
+  fail_unless(len == strlen(expected) && memcmp(value, expected, len) == 0,
+      "%s: %s is '%.*s'", json, field, (gint)len, value);
+}
+
+GST_START_TEST(test_control_scan_table)
+{
+  for (guint i = 0; i < G_N_ELEMENTS(control_cases); i++) {
+    const ControlCase *c = &control_cases[i];
+    GstWsControlFields fields;
+    gboolean scanned = gst_ws_control_scan(c->json, strlen(c->json), &fields);
+
+    fail_unless(scanned == c->scanned, "%s: scan returned %d", c->json, scanned);
+    if (!scanned)
+      continue;
+    check_control_field(c->json, "type", fields.type, fields.type_len, c->type);
+    check_control_field(c->json, "name", fields.name, fields.name_len, c->name);
+    fail_unless(fields.has_stream == (c->stream >= 0), "%s: stream", c->json);
+    if (c->stream >= 0)
+      fail_unless_equals_int(fields.stream, c->stream);
+  }
+}
+GST_END_TEST;
+
+// the scanner reads only the bytes it is given, so a message need not be terminated
+GST_START_TEST(test_control_scan_bounds)
+{
+  const gchar *json = "{\"type\":\"clear\",\"n\":truex";
+  GstWsControlFields fields;
+
+  fail_if(gst_ws_control_scan(json, strlen(json) - 1, &fields));
+  fail_unless(gst_ws_control_scan("{\"n\":true}", 10, &fields));
+  fail_if(gst_ws_control_scan("{\"n\":true}", 8, &fields));
+  fail_if(gst_ws_control_scan("{\"n\":-", 6, &fields));
+}
+GST_END_TEST;
+
+static Suite *
+websocket_suite(void)
+{
+  Suite *s = suite_create("websocket");
+  TCase *tc_jitter = tcase_create("jitter");
+  TCase *tc_convert = tcase_create("convert");
+  TCase *tc_control = tcase_create("control");
+
+  suite_add_tcase(s, tc_jitter);
+  tcase_add_test(tc_jitter, test_jitter_bursty_turns);
+  tcase_add_test(tc_jitter, test_jitter_realtime_turns);
+  tcase_add_test(tc_jitter, test_jitter_late_frames);
+
+  suite_add_tcase(s, tc_convert);
+  tcase_add_test(tc_convert, test_convert_kernels_match_scalar);
+  tcase_add_test(tc_convert, test_convert_g711_round_trip);
+  tcase_add_test(tc_convert, test_resampler_length_and_continuity);
+  tcase_add_test(tc_convert, test_resampler_reset);
+  tcase_add_test(tc_convert, test_converter_reset);
+
+  suite_add_tcase(s, tc_control);
+  tcase_add_test(tc_control, test_control_scan_table);
+  tcase_add_test(tc_control, test_control_scan_bounds);
+
+  return s;
+}
+
+GST_CHECK_MAIN(websocket);
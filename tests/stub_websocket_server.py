@@ -12,22 +12,68 @@ except ImportError:
     from websockets import serve
 
 PORT = 9999
+# Binary framing offered by the element with framing=v1; frames are echoed verbatim
+FRAMING_SUBPROTOCOL = "gst-websocket-frame.v1"
+# Offered by elements with mux=true; frames keep their stream id, so echoing them
+# verbatim routes every echo back to the stream that sent it. Every stream-open is
+# answered with one mark for that stream and one text mark without a stream.
+MUX_SUBPROTOCOL = "gst-websocket-mux.v1"
+FRAME_HEADER_SIZE = 20
+FRAME_CONTROL = 1
+# Sent by the element with replay-buffer-ms; the first connection of every token is
+# dropped after its 2nd binary message to exercise the resume path
+RESUME_TOKEN_HEADER = "X-Resume-Token"
+dropped_tokens = set()
+# Connections to this path are closed normally after their 2nd binary message, a server
+# ending the session on purpose
+CLOSE_NORMAL_PATH = "/close-normal"
 
 # Suppress noisy connection errors from health checks
 logging.getLogger("websockets").setLevel(logging.CRITICAL)
 
+def resume_token(websocket):
+    request = getattr(websocket, "request", None)
+    headers = request.headers if request is not None else websocket.request_headers
+    return headers.get(RESUME_TOKEN_HEADER)
+
+def request_path(websocket, path):
+    request = getattr(websocket, "request", None)
+    if request is not None:
+        return request.path
+    return path or getattr(websocket, "path", "")
+
 async def echo(websocket, path=None):
     """Echo binary messages, handle text commands."""
     binary_count = 0
+    token = resume_token(websocket)
+    close_normal = request_path(websocket, path) == CLOSE_NORMAL_PATH
     try:
         async for message in websocket:
             if isinstance(message, bytes):
+                if (websocket.subprotocol == MUX_SUBPROTOCOL and
+                        len(message) > FRAME_HEADER_SIZE and message[1] == FRAME_CONTROL and
+                        b"stream-open" in message[FRAME_HEADER_SIZE:]):
+                    stream = int.from_bytes(message[2:4], "big")
+                    await websocket.send('{"type": "mark", "name": "untagged"}')
+                    await websocket.send(
+                        '{"type": "mark", "name": "stream-%d", "stream": %d}' % (stream, stream))
                 # Echo binary messages back
                 await websocket.send(message)
                 binary_count += 1
+                if binary_count == 2 and close_normal:
+                    await websocket.close(1000, "done")
+                    return
+                # Simulate a network blip once per resumable session
+                if binary_count == 2 and token and token not in dropped_tokens:
+                    dropped_tokens.add(token)
+                    await websocket.close(1012, "restart")
+                    return
                 # After 3rd binary message, send a clear command to test barge-in
                 if binary_count == 3:
                     await websocket.send('{"type": "clear"}')
+                # After 5th binary message, send a mark to test playout notifications
+                elif binary_count == 5:
+                    await websocket.send('{"type": "mark", "name": "after-5"}')
             elif isinstance(message, str):
                 # Handle text commands
                 if message == "send_clear":
@@ -50,7 +96,7 @@ async def main():
     for sig in (signal.SIGTERM, signal.SIGINT):
         loop.add_signal_handler(sig, handle_signal)
 
-    async with serve(echo, "127.0.0.1", PORT):
+    async with serve(echo, "127.0.0.1", PORT, subprotocols=[FRAMING_SUBPROTOCOL, MUX_SUBPROTOCOL]):
         print(f"READY:{PORT}", flush=True)
         await stop
 